@@ -0,0 +1,4 @@
+void main(void)
+{
+    gl_FragColor = vec4(0.9, 0.6, 0.2, 1.0);
+}
@@ -0,0 +1,7 @@
+attribute vec4 position;
+
+void main(void)
+{
+    gl_PointSize = 1.0;
+    gl_Position = vec4(position.xy * Scale, 0.0, 1.0);
+}
@@ -0,0 +1,18 @@
+uniform sampler2D Texture0;
+uniform vec2 HalfPixel;
+uniform float Offset;
+
+varying vec2 TextureCoord;
+
+void main(void)
+{
+    vec2 d = HalfPixel * Offset;
+
+    vec4 result = texture2D(Texture0, TextureCoord) * 4.0;
+    result += texture2D(Texture0, TextureCoord - d);
+    result += texture2D(Texture0, TextureCoord + d);
+    result += texture2D(Texture0, TextureCoord + vec2(d.x, -d.y));
+    result += texture2D(Texture0, TextureCoord - vec2(d.x, -d.y));
+
+    gl_FragColor = vec4(result.xyz / 8.0, 1.0);
+}
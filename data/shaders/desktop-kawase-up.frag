@@ -0,0 +1,21 @@
+uniform sampler2D Texture0;
+uniform vec2 HalfPixel;
+uniform float Offset;
+
+varying vec2 TextureCoord;
+
+void main(void)
+{
+    vec2 d = HalfPixel * Offset;
+
+    vec4 result = texture2D(Texture0, TextureCoord + vec2(-2.0 * d.x, 0.0));
+    result += texture2D(Texture0, TextureCoord + vec2(2.0 * d.x, 0.0));
+    result += texture2D(Texture0, TextureCoord + vec2(0.0, -2.0 * d.y));
+    result += texture2D(Texture0, TextureCoord + vec2(0.0, 2.0 * d.y));
+    result += texture2D(Texture0, TextureCoord + vec2(-d.x, d.y)) * 2.0;
+    result += texture2D(Texture0, TextureCoord + vec2(d.x, d.y)) * 2.0;
+    result += texture2D(Texture0, TextureCoord + vec2(d.x, -d.y)) * 2.0;
+    result += texture2D(Texture0, TextureCoord + vec2(-d.x, -d.y)) * 2.0;
+
+    gl_FragColor = vec4(result.xyz / 12.0, 1.0);
+}
@@ -0,0 +1,12 @@
+uniform sampler2D Texture0;
+
+varying vec2 TextureCoord;
+
+void main(void)
+{
+    vec4 result = vec4(0.0);
+
+    $FETCHES$
+
+    gl_FragColor = result;
+}
@@ -0,0 +1,10 @@
+attribute vec2 position;
+
+varying vec2 TextureCoord;
+
+void main(void)
+{
+    gl_Position = vec4(position, 0.0, 1.0);
+
+    TextureCoord = position * 0.5 + 0.5;
+}
@@ -0,0 +1,35 @@
+attribute vec3 position;
+attribute vec3 normal;
+
+uniform mat4 ModelViewProjectionMatrix;
+uniform mat4 NormalMatrix;
+uniform float Rotation;
+
+varying vec4 Color;
+
+void main(void)
+{
+    // The per-instance data: the offset of the instance in xyz, and the
+    // phase of its rotation around the Y axis in w
+    vec4 instance = $INSTANCE$;
+
+    float angle = Rotation + instance.w;
+    float c = cos(angle);
+    float s = sin(angle);
+    mat3 rotation = mat3(c, 0.0, -s,
+                         0.0, 1.0, 0.0,
+                         s, 0.0, c);
+
+    // Transform the normal to eye coordinates
+    vec3 N = normalize(vec3(NormalMatrix * vec4(rotation * normal, 1.0)));
+
+    // The LightSourcePosition is actually its direction for directional light
+    vec3 L = normalize(LightSourcePosition.xyz);
+
+    float diffuse = max(dot(N, L), 0.0);
+    Color = vec4(diffuse * MaterialDiffuse.rgb, MaterialDiffuse.a);
+
+    // Transform the position to clip coordinates
+    vec3 p = rotation * (ModelScale * position) + instance.xyz;
+    gl_Position = ModelViewProjectionMatrix * vec4(p, 1.0);
+}
@@ -0,0 +1,8 @@
+uniform sampler2D Texture0;
+
+varying vec2 TextureCoord;
+
+void main(void)
+{
+    gl_FragColor = texture2D(Texture0, TextureCoord) * Color;
+}
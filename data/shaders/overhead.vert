@@ -0,0 +1,13 @@
+attribute vec3 position;
+
+uniform vec4 Offset;
+
+varying vec2 TextureCoord;
+
+void main(void)
+{
+    // A tiny triangle, so the draws cost next to nothing on the GPU
+    gl_Position = vec4(position * 0.02 + Offset.xyz, 1.0);
+
+    TextureCoord = position.xy * 0.5 + 0.5;
+}
@@ -1,17 +1,37 @@
 uniform sampler2D ShadowMap;
 
 varying vec4 Color;
-varying vec4 ShadowCoord;
+varying vec4 ShadowCoord[$CASCADES$];
 
 void main()
 {
-    vec4 sc_perspective = ShadowCoord / ShadowCoord.w;
+    // The cascades are side by side in the shadow map, from the coarsest to
+    // the finest. The finest one that covers the fragment is used.
+    vec4 sc_perspective = ShadowCoord[0] / ShadowCoord[0].w;
+    float w = ShadowCoord[0].w;
+    float cascade = 0.0;
+    for (int i = 1; i < $CASCADES$; i++) {
+        vec4 sc = ShadowCoord[i] / ShadowCoord[i].w;
+        if (all(greaterThanEqual(sc.st, vec2(0.0))) && all(lessThanEqual(sc.st, vec2(1.0)))) {
+            sc_perspective = sc;
+            w = ShadowCoord[i].w;
+            cascade = float(i);
+        }
+    }
     sc_perspective.z += 0.1505;
-    vec4 shadow_value = texture2D(ShadowMap, sc_perspective.st);
-    float light_distance = shadow_value.x;
-    float shadow = 1.0;
-    if (ShadowCoord.w > 0.0 && light_distance < sc_perspective.z) {
-        shadow = 0.5;
+
+    // Percentage closer filtering over PCF x PCF texels
+    float lit = 0.0;
+    for (int y = 0; y < $PCF$; y++) {
+        for (int x = 0; x < $PCF$; x++) {
+            vec2 offset = (vec2(float(x), float(y)) - 0.5 * float($PCF$ - 1)) * TexelSize;
+            vec2 st = clamp(sc_perspective.st + offset, 0.0, 1.0);
+            st.s = (st.s + cascade) / float($CASCADES$);
+            float light_distance = texture2D(ShadowMap, st).x;
+            if (w <= 0.0 || light_distance >= sc_perspective.z)
+                lit += 1.0;
+        }
     }
+    float shadow = mix(0.5, 1.0, lit / float($PCF$ * $PCF$));
     gl_FragColor = vec4(shadow * Color.rgb, 1.0);
 }
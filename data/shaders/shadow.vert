@@ -1,9 +1,9 @@
 attribute vec2 position;
 
-uniform mat4 LightMatrix;
+uniform mat4 LightMatrix[$CASCADES$];
 uniform mat4 ModelViewProjectionMatrix;
 
-varying vec4 ShadowCoord;
+varying vec4 ShadowCoord[$CASCADES$];
 varying vec4 Color;
 
 void main()
@@ -11,6 +11,7 @@ void main()
     Color = MaterialDiffuse;
 
     vec4 pos4 = vec4(position, 0.0, 1.0);
-    ShadowCoord = LightMatrix * pos4;
+    for (int i = 0; i < $CASCADES$; i++)
+        ShadowCoord[i] = LightMatrix[i] * pos4;
     gl_Position = ModelViewProjectionMatrix * pos4;
 }
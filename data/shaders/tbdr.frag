@@ -0,0 +1,6 @@
+uniform vec4 Color;
+
+void main(void)
+{
+    gl_FragColor = Color;
+}
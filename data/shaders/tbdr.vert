@@ -0,0 +1,8 @@
+attribute vec3 position;
+
+uniform float Depth;
+
+void main(void)
+{
+    gl_Position = vec4(position.xy, Depth, 1.0);
+}
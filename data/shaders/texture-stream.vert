@@ -0,0 +1,11 @@
+attribute vec3 position;
+
+varying vec2 TextureCoord;
+
+void main(void)
+{
+    gl_Position = vec4(position.xy, 0.0, 1.0);
+
+    // The first row of the uploads is at the top
+    TextureCoord = vec2(position.x * 0.5 + 0.5, 0.5 - position.y * 0.5);
+}
@@ -1,5 +1,7 @@
 
 #include "canvas-android.h"
+#include "egl-shared-context.h"
+#include "egl-texture-image.h"
 #include "log.h"
 #include "options.h"
 #include "gl-headers.h"
@@ -182,6 +184,19 @@ CanvasAndroid::resize(int width, int height)
                                                1.0, 1024.0);
 }
 
+GLSharedContext *
+CanvasAndroid::create_shared_context()
+{
+    /* The context is created by the Java code, and is current here */
+    return EGLSharedContext::create();
+}
+
+bool
+CanvasAndroid::bind_texture_image(unsigned int source, unsigned int target)
+{
+    return egl_bind_texture_image(source, target);
+}
+
 /*******************
  * Private methods *
  *******************/
@@ -219,4 +234,19 @@ CanvasAndroid::init_gl_extensions()
     GLExtensions::RenderbufferStorage = glRenderbufferStorage;
 
     GLExtensions::GenerateMipmap = glGenerateMipmap;
+
+    if (GLExtensions::support("GL_OES_get_program_binary")) {
+        GLExtensions::GetProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::GetProgramBinary)>(
+                load_proc(&gles_lib_, "glGetProgramBinaryOES"));
+        GLExtensions::ProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::ProgramBinary)>(
+                load_proc(&gles_lib_, "glProgramBinaryOES"));
+    }
+
+    GLExtensions::init_buffer_functions(load_proc, &gles_lib_);
+    GLExtensions::init_draw_functions(load_proc, &gles_lib_);
+    GLExtensions::init_query_functions(load_proc, &gles_lib_);
+    GLExtensions::init_compute_functions(load_proc, &gles_lib_);
+    GLExtensions::init_framebuffer_functions(load_proc, &gles_lib_);
 }
@@ -29,6 +29,8 @@ public:
     void write_to_file(std::string &filename);
     bool should_quit();
     void resize(int width, int height);
+    GLSharedContext *create_shared_context();
+    bool bind_texture_image(unsigned int source, unsigned int target);
 
 private:
     SharedLibrary egl_lib_;
@@ -5,6 +5,7 @@
 #include "log.h"
 #include "options.h"
 #include "util.h"
+#include "pass-timer.h"
 
 #include <fstream>
 #include <sstream>
@@ -89,6 +90,9 @@ CanvasGeneric::update()
             m = Options::FrameEndSwap;
     }
 
+    if (msaa_fbo_ && !msaa_implicit_)
+        resolve(true);
+
     switch(m) {
         case Options::FrameEndSwap:
             gl_state_.swap();
@@ -98,7 +102,7 @@ CanvasGeneric::update()
             glFinish();
             break;
         case Options::FrameEndReadPixels:
-            read_pixel(width_ / 2, height_ / 2);
+            read_resolved_pixel(width_ / 2, height_ / 2);
             break;
         case Options::FrameEndNone:
         default:
@@ -125,7 +129,7 @@ CanvasGeneric::print_info()
     ss << "    Surface Config: " << "buf=" << config.buffer
        << " r=" << config.red << " g=" << config.green << " b=" << config.blue
        << " a=" << config.alpha << " depth=" << config.depth
-       << " stencil=" << config.stencil << std::endl;
+       << " stencil=" << config.stencil << " samples=" << config.samples << std::endl;
     ss << "    Surface Size:   " << win_props.width << "x" << win_props.height
        << (win_props.fullscreen ? " fullscreen" : " windowed") << std::endl;
 
@@ -135,23 +139,31 @@ CanvasGeneric::print_info()
 Canvas::Pixel
 CanvasGeneric::read_pixel(int x, int y)
 {
-    uint8_t pixel[4];
-
-    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    if (msaa_fbo_ && !msaa_implicit_)
+        resolve(false);
 
-    return Canvas::Pixel(pixel[0], pixel[1], pixel[2], pixel[3]);
+    return read_resolved_pixel(x, y);
 }
 
 void
 CanvasGeneric::write_to_file(std::string &filename)
 {
     char *pixels = new char[width_ * height_ * 4];
+    bool resolved = msaa_fbo_ && !msaa_implicit_;
+
+    if (resolved) {
+        resolve(false);
+        GLExtensions::BindFramebuffer(GL_READ_FRAMEBUFFER, fbo_);
+    }
 
     for (int i = 0; i < height_; i++) {
         glReadPixels(0, i, width_, 1, GL_RGBA, GL_UNSIGNED_BYTE,
                      &pixels[(height_ - i - 1) * width_ * 4]);
     }
 
+    if (resolved)
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, msaa_fbo_);
+
     std::ofstream output (filename.c_str(), std::ios::out | std::ios::binary);
     output.write(pixels, 4 * width_ * height_);
 
@@ -174,7 +186,65 @@ CanvasGeneric::resize(int width, int height)
 unsigned int
 CanvasGeneric::fbo()
 {
-    return fbo_;
+    return msaa_fbo_ ? msaa_fbo_ : fbo_;
+}
+
+bool
+CanvasGeneric::samples(unsigned int samples)
+{
+    if (samples == samples_ && (samples == 0 || msaa_fbo_)) {
+        /* Keep the FBO, but restart the resolve timing for the new scene */
+        if (resolve_timer_) {
+            delete resolve_timer_;
+            resolve_timer_ = new PassTimer(PassTimer::ModeGPU);
+        }
+        return true;
+    }
+
+    release_msaa_fbo();
+    samples_ = samples;
+
+    if (samples_ && !ensure_msaa_fbo()) {
+        samples_ = 0;
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        return false;
+    }
+
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, fbo());
+
+    return true;
+}
+
+void
+CanvasGeneric::log_samples(double frame_ms)
+{
+    if (!msaa_fbo_)
+        return;
+
+    if (msaa_implicit_) {
+        Log::info("    MSAA %ux: resolved on tile store (GL_EXT_multisampled_render_to_texture)\n",
+                  samples_);
+    }
+    else if (resolve_timer_) {
+        Log::info("    MSAA %ux: resolved with glBlitFramebuffer\n", samples_);
+        resolve_timer_->report(frame_ms);
+    }
+    else {
+        Log::info("    MSAA %ux: resolved with glBlitFramebuffer (not timed, "
+                  "timer queries are not supported)\n", samples_);
+    }
+}
+
+GLSharedContext *
+CanvasGeneric::create_shared_context()
+{
+    return gl_state_.create_shared_context();
+}
+
+bool
+CanvasGeneric::bind_texture_image(unsigned int source, unsigned int target)
+{
+    return gl_state_.bind_texture_image(source, target);
 }
 
 
@@ -258,6 +328,12 @@ CanvasGeneric::resize_no_viewport(int width, int height)
                                           width_, height_);
     }
 
+    if (msaa_fbo_) {
+        release_msaa_fbo();
+        if (!ensure_msaa_fbo())
+            samples_ = 0;
+    }
+
     projection_ = LibMatrix::Mat4::perspective(60.0, width_ / static_cast<float>(height_),
                                                1.0, 1024.0);
 
@@ -414,6 +490,8 @@ CanvasGeneric::ensure_fbo()
 void
 CanvasGeneric::release_fbo()
 {
+    release_msaa_fbo();
+
     if (fbo_) {
         GLExtensions::DeleteFramebuffers(1, &fbo_);
         fbo_ = 0;
@@ -431,6 +509,180 @@ CanvasGeneric::release_fbo()
     gl_depth_format_ = 0;
 }
 
+/**
+ * Creates the multisampled FBO the scenes render to, for the current number
+ * of samples.
+ *
+ * Off-screen, GL_EXT_multisampled_render_to_texture is preferred, as it
+ * resolves the samples when the tiles are stored, without an explicit pass.
+ * Otherwise the samples are stored in multisampled renderbuffers, and
+ * resolved with a blit to the window or the off-screen FBO.
+ */
+bool
+CanvasGeneric::ensure_msaa_fbo()
+{
+    if (msaa_fbo_)
+        return true;
+
+    if (!ensure_gl_formats())
+        return false;
+
+    msaa_implicit_ = offscreen_ && GLExtensions::FramebufferTexture2DMultisampleEXT &&
+                     GLExtensions::RenderbufferStorageMultisampleEXT;
+
+    if (!msaa_implicit_ && !(GLExtensions::RenderbufferStorageMultisample &&
+                             GLExtensions::BlitFramebuffer))
+    {
+        Log::error("MSAA requires OpenGL ES 3.0, OpenGL 3.0, GL_EXT_framebuffer_multisample "
+                   "or GL_EXT_multisampled_render_to_texture (off-screen)\n");
+        return false;
+    }
+
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    if (samples_ > static_cast<unsigned int>(max_samples)) {
+        Log::error("MSAA with %u samples requested, but at most %d are supported\n",
+                   samples_, max_samples);
+        return false;
+    }
+
+    GLExtensions::GenRenderbuffers(1, &msaa_depth_renderbuffer_);
+    GLExtensions::BindRenderbuffer(GL_RENDERBUFFER, msaa_depth_renderbuffer_);
+    GLExtensions::GenFramebuffers(1, &msaa_fbo_);
+
+    if (msaa_implicit_) {
+        glGenTextures(1, &msaa_texture_);
+        glBindTexture(GL_TEXTURE_2D, msaa_texture_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        GLExtensions::RenderbufferStorageMultisampleEXT(GL_RENDERBUFFER, samples_,
+                                                        gl_depth_format_, width_, height_);
+
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, msaa_fbo_);
+        GLExtensions::FramebufferTexture2DMultisampleEXT(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                                         GL_TEXTURE_2D, msaa_texture_, 0,
+                                                         samples_);
+    }
+    else {
+        GLExtensions::RenderbufferStorageMultisample(GL_RENDERBUFFER, samples_,
+                                                     gl_depth_format_, width_, height_);
+
+        GLExtensions::GenRenderbuffers(1, &msaa_color_renderbuffer_);
+        GLExtensions::BindRenderbuffer(GL_RENDERBUFFER, msaa_color_renderbuffer_);
+        GLExtensions::RenderbufferStorageMultisample(GL_RENDERBUFFER, samples_,
+                                                     gl_color_format_, width_, height_);
+
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, msaa_fbo_);
+        GLExtensions::FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                              GL_RENDERBUFFER, msaa_color_renderbuffer_);
+
+        if (PassTimer::gpu_supported())
+            resolve_timer_ = new PassTimer(PassTimer::ModeGPU);
+    }
+
+    GLExtensions::FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                          GL_RENDERBUFFER, msaa_depth_renderbuffer_);
+
+    if (GLExtensions::CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        Log::error("The multisampled framebuffer with %u samples is incomplete\n", samples_);
+        release_msaa_fbo();
+        return false;
+    }
+
+    Log::debug("Rendering with MSAA %ux, resolved %s\n", samples_,
+               msaa_implicit_ ? "implicitly" : "with a blit");
+
+    return true;
+}
+
+void
+CanvasGeneric::release_msaa_fbo()
+{
+    delete resolve_timer_;
+    resolve_timer_ = 0;
+
+    if (msaa_fbo_) {
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        GLExtensions::DeleteFramebuffers(1, &msaa_fbo_);
+        msaa_fbo_ = 0;
+    }
+    if (msaa_texture_) {
+        glDeleteTextures(1, &msaa_texture_);
+        msaa_texture_ = 0;
+    }
+    if (msaa_color_renderbuffer_) {
+        GLExtensions::DeleteRenderbuffers(1, &msaa_color_renderbuffer_);
+        msaa_color_renderbuffer_ = 0;
+    }
+    if (msaa_depth_renderbuffer_) {
+        GLExtensions::DeleteRenderbuffers(1, &msaa_depth_renderbuffer_);
+        msaa_depth_renderbuffer_ = 0;
+    }
+
+    msaa_implicit_ = false;
+}
+
+/**
+ * Resolves the multisampled FBO to the window or the off-screen FBO, and
+ * makes the multisampled FBO current again.
+ *
+ * @param timed whether this is the resolve at the end of a frame, which is
+ *              timed, and after which the multisampled contents are invalidated
+ */
+void
+CanvasGeneric::resolve(bool timed)
+{
+    static const GLenum depth_attachment[] = {GL_DEPTH_ATTACHMENT};
+    static const GLenum color_attachment[] = {GL_COLOR_ATTACHMENT0};
+
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, msaa_fbo_);
+
+    /* Only the color samples are resolved, the depth ones needn't be stored */
+    if (timed && GLExtensions::InvalidateFramebuffer)
+        GLExtensions::InvalidateFramebuffer(GL_FRAMEBUFFER, 1, depth_attachment);
+
+    if (timed && resolve_timer_) {
+        resolve_timer_->begin_frame();
+        resolve_timer_->begin("Resolve");
+    }
+
+    GLExtensions::BindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo_);
+    GLExtensions::BlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_,
+                                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    if (timed && resolve_timer_)
+        resolve_timer_->end();
+
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, msaa_fbo_);
+
+    if (timed && GLExtensions::InvalidateFramebuffer)
+        GLExtensions::InvalidateFramebuffer(GL_FRAMEBUFFER, 1, color_attachment);
+}
+
+/**
+ * Reads a pixel of the resolved window or off-screen FBO contents.
+ */
+Canvas::Pixel
+CanvasGeneric::read_resolved_pixel(int x, int y)
+{
+    uint8_t pixel[4];
+    bool resolved = msaa_fbo_ && !msaa_implicit_;
+
+    if (resolved)
+        GLExtensions::BindFramebuffer(GL_READ_FRAMEBUFFER, fbo_);
+
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+
+    if (resolved)
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, msaa_fbo_);
+
+    return Canvas::Pixel(pixel[0], pixel[1], pixel[2], pixel[3]);
+}
+
 const char *
 CanvasGeneric::get_gl_format_str(GLenum f)
 {
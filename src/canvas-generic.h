@@ -6,6 +6,7 @@
 
 class GLState;
 class NativeState;
+class PassTimer;
 
 /**
  * Canvas for rendering with GL to an X11 window.
@@ -19,7 +20,9 @@ public:
           native_state_(native_state), gl_state_(gl_state), native_window_(0),
           gl_color_format_(0), gl_depth_format_(0),
           color_renderbuffer_(0), depth_renderbuffer_(0), fbo_(0),
-          window_initialized_(false) {}
+          samples_(0), msaa_implicit_(false), msaa_texture_(0),
+          msaa_color_renderbuffer_(0), msaa_depth_renderbuffer_(0), msaa_fbo_(0),
+          resolve_timer_(0), window_initialized_(false) {}
 
     bool init();
     bool reset();
@@ -32,6 +35,10 @@ public:
     bool should_quit();
     void resize(int width, int height);
     unsigned int fbo();
+    bool samples(unsigned int samples);
+    void log_samples(double frame_ms);
+    GLSharedContext *create_shared_context();
+    bool bind_texture_image(unsigned int source, unsigned int target);
 
 private:
     bool supports_gl2();
@@ -40,6 +47,10 @@ private:
     bool ensure_gl_formats();
     bool ensure_fbo();
     void release_fbo();
+    bool ensure_msaa_fbo();
+    void release_msaa_fbo();
+    void resolve(bool timed);
+    Pixel read_resolved_pixel(int x, int y);
     const char *get_gl_format_str(GLenum f);
 
     NativeState& native_state_;
@@ -50,6 +61,14 @@ private:
     GLuint color_renderbuffer_;
     GLuint depth_renderbuffer_;
     GLuint fbo_;
+    unsigned int samples_;
+    /* Whether GL_EXT_multisampled_render_to_texture resolves the samples */
+    bool msaa_implicit_;
+    GLuint msaa_texture_;
+    GLuint msaa_color_renderbuffer_;
+    GLuint msaa_depth_renderbuffer_;
+    GLuint msaa_fbo_;
+    PassTimer *resolve_timer_;
     bool window_initialized_;
 };
 
@@ -11,6 +11,8 @@
 #include <stdio.h>
 #include <cmath>
 
+class GLSharedContext;
+
 /**
  * Abstraction for a GL rendering target.
  */
@@ -176,6 +178,60 @@ public:
      */
     virtual unsigned int fbo() { return 0; }
 
+    /**
+     * Sets the number of samples per pixel to render with.
+     *
+     * With more than one sample, rendering goes to a multisampled FBO
+     * (returned by fbo()) that is resolved when the canvas is updated.
+     *
+     * This method may be implemented in derived classes.
+     *
+     * @param samples the number of samples, 0 for no multisampling
+     *
+     * @return whether the number of samples is supported
+     */
+    virtual bool samples(unsigned int samples) { return samples == 0; }
+
+    /**
+     * Logs the number of samples per pixel and the time spent resolving
+     * them, since samples() was last called (even with an unchanged number
+     * of samples).
+     *
+     * This method may be implemented in derived classes.
+     *
+     * @param frame_ms the average frame time, in milliseconds
+     */
+    virtual void log_samples(double frame_ms) { static_cast<void>(frame_ms); }
+
+    /**
+     * Creates a context sharing objects with the canvas context, which can
+     * be made current on a worker thread.
+     *
+     * This method may be implemented in derived classes.
+     *
+     * @return the context, owned by the caller, or 0 if not supported
+     */
+    virtual GLSharedContext *create_shared_context() { return 0; }
+
+    /**
+     * Makes a texture share the storage of another texture of the canvas
+     * context, through an image of the window system (e.g. an EGLImage),
+     * as textures shared between APIs or processes do.
+     *
+     * This method may be implemented in derived classes.
+     *
+     * @param source the texture to share the storage of, with a level 0
+     * @param target the texture to bind to the storage of @a source
+     *
+     * @return whether the operation succeeded (false if not supported)
+     */
+    virtual bool bind_texture_image(unsigned int source, unsigned int target)
+    {
+        static_cast<void>(source);
+        static_cast<void>(target);
+        return false;
+    }
+
     /**
      * Gets a dummy canvas object.
      *
@@ -0,0 +1,112 @@
+#ifndef GPULOAD_EGL_SHARED_CONTEXT_H_
+#define GPULOAD_EGL_SHARED_CONTEXT_H_
+
+#include "gl-state.h"
+#include "log.h"
+
+#include <glad/egl.h>
+#include <cstring>
+
+/**
+ * A shared context created through EGL.
+ *
+ * The context is made current without a surface if the display supports
+ * EGL_KHR_surfaceless_context, and with a 1x1 pbuffer otherwise.
+ */
+class EGLSharedContext : public GLSharedContext
+{
+public:
+    /**
+     * Creates a context sharing objects with the current context.
+     *
+     * @return the context, or 0 if it couldn't be created
+     */
+    static EGLSharedContext *create()
+    {
+        EGLDisplay display = eglGetCurrentDisplay();
+        EGLContext share_context = eglGetCurrentContext();
+
+        if (display == EGL_NO_DISPLAY || share_context == EGL_NO_CONTEXT)
+            return 0;
+
+        /* Use the same config and client API version as the current context */
+        EGLint config_attribs[] = { EGL_CONFIG_ID, 0, EGL_NONE };
+        EGLConfig config = 0;
+        EGLint num_configs = 0;
+
+        eglQueryContext(display, share_context, EGL_CONFIG_ID, &config_attribs[1]);
+        if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) ||
+            num_configs < 1)
+        {
+            Log::debug("Couldn't find the config of the current EGL context\n");
+            return 0;
+        }
+
+        EGLenum api = eglQueryAPI();
+        EGLint context_attribs[] = { EGL_NONE, 0, EGL_NONE };
+
+        if (api == EGL_OPENGL_ES_API) {
+            context_attribs[0] = EGL_CONTEXT_CLIENT_VERSION;
+            eglQueryContext(display, share_context, EGL_CONTEXT_CLIENT_VERSION,
+                            &context_attribs[1]);
+        }
+
+        EGLContext context = eglCreateContext(display, config, share_context,
+                                              context_attribs);
+        if (context == EGL_NO_CONTEXT) {
+            Log::debug("eglCreateContext() for a shared context failed with error: 0x%x\n",
+                       eglGetError());
+            return 0;
+        }
+
+        EGLSurface surface = EGL_NO_SURFACE;
+        const char *exts = eglQueryString(display, EGL_EXTENSIONS);
+
+        if (!exts || !strstr(exts, "EGL_KHR_surfaceless_context")) {
+            static const EGLint pbuffer_attribs[] = {
+                EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE
+            };
+
+            surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+            if (surface == EGL_NO_SURFACE) {
+                Log::debug("eglCreatePbufferSurface() for a shared context failed with error: 0x%x\n",
+                           eglGetError());
+                eglDestroyContext(display, context);
+                return 0;
+            }
+        }
+
+        return new EGLSharedContext(display, context, surface, api);
+    }
+
+    ~EGLSharedContext()
+    {
+        if (surface_ != EGL_NO_SURFACE)
+            eglDestroySurface(display_, surface_);
+        eglDestroyContext(display_, context_);
+    }
+
+    bool make_current()
+    {
+        /* The bound API is per thread */
+        return eglBindAPI(api_) &&
+               eglMakeCurrent(display_, surface_, surface_, context_);
+    }
+
+    void release()
+    {
+        eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+
+private:
+    EGLSharedContext(EGLDisplay display, EGLContext context, EGLSurface surface,
+                     EGLenum api) :
+        display_(display), context_(context), surface_(surface), api_(api) {}
+
+    EGLDisplay display_;
+    EGLContext context_;
+    EGLSurface surface_;
+    EGLenum api_;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef GPULOAD_EGL_TEXTURE_IMAGE_H_
+#define GPULOAD_EGL_TEXTURE_IMAGE_H_
+
+#include "gl-headers.h"
+#include "log.h"
+
+#include <glad/egl.h>
+#include <cstring>
+#include <stdint.h>
+
+#ifndef EGL_GL_TEXTURE_2D_KHR
+#define EGL_GL_TEXTURE_2D_KHR 0x30B1
+#endif
+#ifndef EGL_IMAGE_PRESERVED_KHR
+#define EGL_IMAGE_PRESERVED_KHR 0x30D2
+#endif
+
+/**
+ * Binds a texture to an EGLImage created from another texture of the current
+ * context, so that both share the storage of the source texture.
+ *
+ * The image itself is destroyed right away, the target texture keeps the
+ * storage alive.
+ *
+ * @param source the texture to create the image from, with a level 0
+ * @param target the texture to bind to the image
+ *
+ * @return whether the operation succeeded
+ */
+static inline bool
+egl_bind_texture_image(unsigned int source, unsigned int target)
+{
+    typedef void *(GLAD_API_PTR *CreateImageProc)(EGLDisplay dpy, EGLContext ctx,
+                                                  EGLenum target, EGLClientBuffer buffer,
+                                                  const EGLint *attrib_list);
+    typedef EGLBoolean (GLAD_API_PTR *DestroyImageProc)(EGLDisplay dpy, void *image);
+    typedef void (GLAD_API_PTR *ImageTargetTextureProc)(GLenum target, void *image);
+
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLContext context = eglGetCurrentContext();
+
+    if (display == EGL_NO_DISPLAY || context == EGL_NO_CONTEXT || !eglGetProcAddress)
+        return false;
+
+    const char *exts = eglQueryString(display, EGL_EXTENSIONS);
+
+    if (!exts || !strstr(exts, "EGL_KHR_gl_texture_2D_image") ||
+        !GLExtensions::support("GL_OES_EGL_image"))
+    {
+        Log::debug("EGL_KHR_gl_texture_2D_image or GL_OES_EGL_image is not supported\n");
+        return false;
+    }
+
+    CreateImageProc create_image = reinterpret_cast<CreateImageProc>(
+        eglGetProcAddress("eglCreateImageKHR"));
+    DestroyImageProc destroy_image = reinterpret_cast<DestroyImageProc>(
+        eglGetProcAddress("eglDestroyImageKHR"));
+    ImageTargetTextureProc image_target_texture = reinterpret_cast<ImageTargetTextureProc>(
+        eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+
+    if (!create_image || !destroy_image || !image_target_texture)
+        return false;
+
+    static const EGLint image_attribs[] = {
+        EGL_IMAGE_PRESERVED_KHR, EGL_TRUE,
+        EGL_NONE
+    };
+
+    void *image = create_image(display, context, EGL_GL_TEXTURE_2D_KHR,
+                               reinterpret_cast<EGLClientBuffer>(static_cast<uintptr_t>(source)),
+                               image_attribs);
+    if (!image) {
+        Log::debug("eglCreateImageKHR() failed with error: 0x%x\n", eglGetError());
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, target);
+    image_target_texture(GL_TEXTURE_2D, image);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    destroy_image(display, image);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+#endif
@@ -1,6 +1,8 @@
 
 #include "gl-headers.h"
 
+#include <cstdio>
+
 void* (GLAD_API_PTR *GLExtensions::MapBuffer) (GLenum target, GLenum access) = 0;
 GLboolean (GLAD_API_PTR *GLExtensions::UnmapBuffer) (GLenum target) = 0;
 
@@ -18,6 +20,40 @@ void (GLAD_API_PTR *GLExtensions::RenderbufferStorage)(GLenum target, GLenum int
 
 void (GLAD_API_PTR *GLExtensions::GenerateMipmap)(GLenum target) = 0;
 
+void (GLAD_API_PTR *GLExtensions::GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary) = 0;
+void (GLAD_API_PTR *GLExtensions::ProgramBinary)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) = 0;
+void (GLAD_API_PTR *GLExtensions::ProgramParameteri)(GLuint program, GLenum pname, GLint value) = 0;
+
+void* (GLAD_API_PTR *GLExtensions::MapBufferRange)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) = 0;
+void (GLAD_API_PTR *GLExtensions::BufferStorage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) = 0;
+GLsync (GLAD_API_PTR *GLExtensions::FenceSync)(GLenum condition, GLbitfield flags) = 0;
+GLenum (GLAD_API_PTR *GLExtensions::ClientWaitSync)(GLsync sync, GLbitfield flags, GLuint64 timeout) = 0;
+void (GLAD_API_PTR *GLExtensions::DeleteSync)(GLsync sync) = 0;
+
+void (GLAD_API_PTR *GLExtensions::DrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) = 0;
+void (GLAD_API_PTR *GLExtensions::DrawElementsInstanced)(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount) = 0;
+void (GLAD_API_PTR *GLExtensions::VertexAttribDivisor)(GLuint index, GLuint divisor) = 0;
+
+void (GLAD_API_PTR *GLExtensions::GenQueries)(GLsizei n, GLuint *ids) = 0;
+void (GLAD_API_PTR *GLExtensions::DeleteQueries)(GLsizei n, const GLuint *ids) = 0;
+void (GLAD_API_PTR *GLExtensions::BeginQuery)(GLenum target, GLuint id) = 0;
+void (GLAD_API_PTR *GLExtensions::EndQuery)(GLenum target) = 0;
+void (GLAD_API_PTR *GLExtensions::GetQueryObjectuiv)(GLuint id, GLenum pname, GLuint *params) = 0;
+void (GLAD_API_PTR *GLExtensions::GetQueryObjectui64v)(GLuint id, GLenum pname, GLuint64 *params) = 0;
+bool GLExtensions::TimerQueryDisjoint = false;
+
+void (GLAD_API_PTR *GLExtensions::InvalidateFramebuffer)(GLenum target, GLsizei numAttachments, const GLenum *attachments) = 0;
+void (GLAD_API_PTR *GLExtensions::RenderbufferStorageMultisample)(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height) = 0;
+void (GLAD_API_PTR *GLExtensions::BlitFramebuffer)(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) = 0;
+void (GLAD_API_PTR *GLExtensions::FramebufferTexture2DMultisampleEXT)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level, GLsizei samples) = 0;
+void (GLAD_API_PTR *GLExtensions::RenderbufferStorageMultisampleEXT)(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height) = 0;
+
+void (GLAD_API_PTR *GLExtensions::DispatchCompute)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z) = 0;
+void (GLAD_API_PTR *GLExtensions::MemoryBarrierGL)(GLbitfield barriers) = 0;
+void (GLAD_API_PTR *GLExtensions::BindBufferBase)(GLenum target, GLuint index, GLuint buffer) = 0;
+void (GLAD_API_PTR *GLExtensions::BindImageTexture)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format) = 0;
+void (GLAD_API_PTR *GLExtensions::TexStorage2D)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height) = 0;
+
 bool
 GLExtensions::support(const std::string &ext)
 {
@@ -32,9 +68,226 @@ GLExtensions::support(const std::string &ext)
 
     while ((pos = ext_string.find(ext, pos)) != std::string::npos) {
         char c = ext_string[pos + ext_size];
-        if (c == ' ' || c == '\0')
+        if ((pos == 0 || ext_string[pos - 1] == ' ') && (c == ' ' || c == '\0'))
             break;
+        /* A prefix of a longer extension name, keep looking */
+        pos += ext_size;
     }
 
     return pos != std::string::npos;
 }
+
+bool
+GLExtensions::version_at_least(int major, int minor)
+{
+    const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    int ctx_major = 0;
+    int ctx_minor = 0;
+
+    if (!version)
+        return false;
+
+    /* "OpenGL ES N.M ..." for OpenGL ES, "N.M..." for desktop OpenGL */
+    if (sscanf(version, "OpenGL ES %d.%d", &ctx_major, &ctx_minor) != 2 &&
+        sscanf(version, "%d.%d", &ctx_major, &ctx_minor) != 2)
+    {
+        return false;
+    }
+
+    return ctx_major > major || (ctx_major == major && ctx_minor >= minor);
+}
+
+void
+GLExtensions::init_buffer_functions(GLADuserptrloadfunc load, void *userptr)
+{
+#if GPULOAD_USE_GLESv2
+    const bool gles3 = version_at_least(3, 0);
+
+    if (gles3) {
+        MapBufferRange = reinterpret_cast<decltype(MapBufferRange)>(
+            load(userptr, "glMapBufferRange"));
+        FenceSync = reinterpret_cast<decltype(FenceSync)>(
+            load(userptr, "glFenceSync"));
+        ClientWaitSync = reinterpret_cast<decltype(ClientWaitSync)>(
+            load(userptr, "glClientWaitSync"));
+        DeleteSync = reinterpret_cast<decltype(DeleteSync)>(
+            load(userptr, "glDeleteSync"));
+
+        /* glUnmapBuffer() is core in GLES 3.0, even without GL_OES_mapbuffer */
+        if (!UnmapBuffer) {
+            UnmapBuffer = reinterpret_cast<decltype(UnmapBuffer)>(
+                load(userptr, "glUnmapBuffer"));
+        }
+    }
+    else if (support("GL_EXT_map_buffer_range")) {
+        MapBufferRange = reinterpret_cast<decltype(MapBufferRange)>(
+            load(userptr, "glMapBufferRangeEXT"));
+    }
+
+    if (support("GL_EXT_buffer_storage")) {
+        BufferStorage = reinterpret_cast<decltype(BufferStorage)>(
+            load(userptr, "glBufferStorageEXT"));
+    }
+#elif GPULOAD_USE_GL
+    if (version_at_least(3, 0) || support("GL_ARB_map_buffer_range")) {
+        MapBufferRange = reinterpret_cast<decltype(MapBufferRange)>(
+            load(userptr, "glMapBufferRange"));
+    }
+
+    if (version_at_least(3, 2) || support("GL_ARB_sync")) {
+        FenceSync = reinterpret_cast<decltype(FenceSync)>(
+            load(userptr, "glFenceSync"));
+        ClientWaitSync = reinterpret_cast<decltype(ClientWaitSync)>(
+            load(userptr, "glClientWaitSync"));
+        DeleteSync = reinterpret_cast<decltype(DeleteSync)>(
+            load(userptr, "glDeleteSync"));
+    }
+
+    if (version_at_least(4, 4) || support("GL_ARB_buffer_storage")) {
+        BufferStorage = reinterpret_cast<decltype(BufferStorage)>(
+            load(userptr, "glBufferStorage"));
+    }
+#endif
+}
+
+void
+GLExtensions::init_draw_functions(GLADuserptrloadfunc load, void *userptr)
+{
+    /* The entry point name suffix, if the functions come from an extension */
+    const char *suffix = 0;
+
+#if GPULOAD_USE_GLESv2
+    if (version_at_least(3, 0))
+        suffix = "";
+    else if (support("GL_EXT_instanced_arrays"))
+        suffix = "EXT";
+    else if (support("GL_ANGLE_instanced_arrays"))
+        suffix = "ANGLE";
+#elif GPULOAD_USE_GL
+    if (version_at_least(3, 3))
+        suffix = "";
+    else if (support("GL_ARB_instanced_arrays") && support("GL_ARB_draw_instanced"))
+        suffix = "ARB";
+#endif
+
+    if (!suffix)
+        return;
+
+    std::string s(suffix);
+
+    DrawArraysInstanced = reinterpret_cast<decltype(DrawArraysInstanced)>(
+        load(userptr, ("glDrawArraysInstanced" + s).c_str()));
+    DrawElementsInstanced = reinterpret_cast<decltype(DrawElementsInstanced)>(
+        load(userptr, ("glDrawElementsInstanced" + s).c_str()));
+    VertexAttribDivisor = reinterpret_cast<decltype(VertexAttribDivisor)>(
+        load(userptr, ("glVertexAttribDivisor" + s).c_str()));
+}
+
+void
+GLExtensions::init_query_functions(GLADuserptrloadfunc load, void *userptr)
+{
+    /* The entry point name suffix, if the functions come from an extension */
+    const char *suffix = 0;
+
+#if GPULOAD_USE_GLESv2
+    /* Timer queries are only available through the extension on GLES */
+    if (support("GL_EXT_disjoint_timer_query")) {
+        suffix = "EXT";
+        TimerQueryDisjoint = true;
+    }
+#elif GPULOAD_USE_GL
+    if (version_at_least(3, 3) || support("GL_ARB_timer_query"))
+        suffix = "";
+#endif
+
+    if (!suffix)
+        return;
+
+    std::string s(suffix);
+
+    GenQueries = reinterpret_cast<decltype(GenQueries)>(
+        load(userptr, ("glGenQueries" + s).c_str()));
+    DeleteQueries = reinterpret_cast<decltype(DeleteQueries)>(
+        load(userptr, ("glDeleteQueries" + s).c_str()));
+    BeginQuery = reinterpret_cast<decltype(BeginQuery)>(
+        load(userptr, ("glBeginQuery" + s).c_str()));
+    EndQuery = reinterpret_cast<decltype(EndQuery)>(
+        load(userptr, ("glEndQuery" + s).c_str()));
+    GetQueryObjectuiv = reinterpret_cast<decltype(GetQueryObjectuiv)>(
+        load(userptr, ("glGetQueryObjectuiv" + s).c_str()));
+    GetQueryObjectui64v = reinterpret_cast<decltype(GetQueryObjectui64v)>(
+        load(userptr, ("glGetQueryObjectui64v" + s).c_str()));
+}
+
+void
+GLExtensions::init_compute_functions(GLADuserptrloadfunc load, void *userptr)
+{
+#if GPULOAD_USE_GLESv2
+    if (!version_at_least(3, 1))
+        return;
+#elif GPULOAD_USE_GL
+    if (!version_at_least(4, 3))
+        return;
+#endif
+
+    DispatchCompute = reinterpret_cast<decltype(DispatchCompute)>(
+        load(userptr, "glDispatchCompute"));
+    MemoryBarrierGL = reinterpret_cast<decltype(MemoryBarrierGL)>(
+        load(userptr, "glMemoryBarrier"));
+    BindBufferBase = reinterpret_cast<decltype(BindBufferBase)>(
+        load(userptr, "glBindBufferBase"));
+    BindImageTexture = reinterpret_cast<decltype(BindImageTexture)>(
+        load(userptr, "glBindImageTexture"));
+    TexStorage2D = reinterpret_cast<decltype(TexStorage2D)>(
+        load(userptr, "glTexStorage2D"));
+}
+
+void
+GLExtensions::init_framebuffer_functions(GLADuserptrloadfunc load, void *userptr)
+{
+    const char *invalidate = 0;
+    /* The multisample and blit entry point name suffix, if they are available */
+    const char *suffix = 0;
+
+#if GPULOAD_USE_GLESv2
+    if (version_at_least(3, 0)) {
+        invalidate = "glInvalidateFramebuffer";
+        suffix = "";
+    }
+    else if (support("GL_EXT_discard_framebuffer")) {
+        invalidate = "glDiscardFramebufferEXT";
+    }
+
+    if (support("GL_EXT_multisampled_render_to_texture")) {
+        FramebufferTexture2DMultisampleEXT =
+            reinterpret_cast<decltype(FramebufferTexture2DMultisampleEXT)>(
+                load(userptr, "glFramebufferTexture2DMultisampleEXT"));
+        RenderbufferStorageMultisampleEXT =
+            reinterpret_cast<decltype(RenderbufferStorageMultisampleEXT)>(
+                load(userptr, "glRenderbufferStorageMultisampleEXT"));
+    }
+#elif GPULOAD_USE_GL
+    if (version_at_least(4, 3) || support("GL_ARB_invalidate_subdata"))
+        invalidate = "glInvalidateFramebuffer";
+
+    if (version_at_least(3, 0) || support("GL_ARB_framebuffer_object"))
+        suffix = "";
+    else if (support("GL_EXT_framebuffer_multisample") && support("GL_EXT_framebuffer_blit"))
+        suffix = "EXT";
+#endif
+
+    if (invalidate) {
+        InvalidateFramebuffer = reinterpret_cast<decltype(InvalidateFramebuffer)>(
+            load(userptr, invalidate));
+    }
+
+    if (suffix) {
+        std::string s(suffix);
+
+        RenderbufferStorageMultisample =
+            reinterpret_cast<decltype(RenderbufferStorageMultisample)>(
+                load(userptr, ("glRenderbufferStorageMultisample" + s).c_str()));
+        BlitFramebuffer = reinterpret_cast<decltype(BlitFramebuffer)>(
+            load(userptr, ("glBlitFramebuffer" + s).c_str()));
+    }
+}
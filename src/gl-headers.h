@@ -47,6 +47,143 @@
 #ifndef GL_GENERATE_MIPMAP
 #define GL_GENERATE_MIPMAP 0x8191
 #endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#endif
+
+/* Program binaries (GL_OES/ARB_get_program_binary) */
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+/* Buffer mapping, storage and sync objects (GL(ES) 3.x, GL 4.4, GL_EXT_buffer_storage) */
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT 0x0004
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#define GL_MAP_FLUSH_EXPLICIT_BIT 0x0010
+#define GL_MAP_UNSYNCHRONIZED_BIT 0x0020
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_ALREADY_SIGNALED 0x911A
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_CONDITION_SATISFIED 0x911C
+#define GL_WAIT_FAILED 0x911D
+#endif
+
+/* Timer queries (GL 3.3, GL_ARB_timer_query, GL_EXT_disjoint_timer_query) */
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+/* Compute shaders, storage buffers and images (GLES 3.1, GL 4.3) */
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY 0x88B8
+#endif
+#ifndef GL_DYNAMIC_COPY
+#define GL_DYNAMIC_COPY 0x88EA
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+
+/* Half float color formats (GLES 3.0, GL 3.0, GL_OES_texture_half_float) */
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+#ifndef GL_HALF_FLOAT_OES
+#define GL_HALF_FLOAT_OES 0x8D61
+#endif
+#ifndef GL_RGBA16F
+#define GL_RGBA16F 0x881A
+#endif
+
+/* Floating point depth (GLES 3.0, GL 3.0) */
+#ifndef GL_DEPTH_COMPONENT32F
+#define GL_DEPTH_COMPONENT32F 0x8CAC
+#endif
+
+/* Attachments of the default framebuffer (GLES 3.0, GL_EXT_discard_framebuffer) */
+#ifndef GL_COLOR
+#define GL_COLOR 0x1800
+#define GL_DEPTH 0x1801
+#define GL_STENCIL 0x1802
+#endif
+#ifndef GL_STENCIL_ATTACHMENT
+#define GL_STENCIL_ATTACHMENT 0x8D20
+#endif
+
+/* Multisampled framebuffers and resolve blits (GLES 3.0, GL 3.0) */
+#ifndef GL_READ_FRAMEBUFFER
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+#ifndef GL_MAX_SAMPLES
+#define GL_MAX_SAMPLES 0x8D57
+#endif
+
+/* Compressed texture formats (ETC1/ETC2/EAC and ASTC LDR) */
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#define GL_COMPRESSED_SRGB8_ETC2 0x9275
+#define GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9276
+#define GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9277
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC 0x9279
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+#define GL_COMPRESSED_RGBA_ASTC_5x4_KHR 0x93B1
+#define GL_COMPRESSED_RGBA_ASTC_5x5_KHR 0x93B2
+#define GL_COMPRESSED_RGBA_ASTC_6x5_KHR 0x93B3
+#define GL_COMPRESSED_RGBA_ASTC_6x6_KHR 0x93B4
+#define GL_COMPRESSED_RGBA_ASTC_8x5_KHR 0x93B5
+#define GL_COMPRESSED_RGBA_ASTC_8x6_KHR 0x93B6
+#define GL_COMPRESSED_RGBA_ASTC_8x8_KHR 0x93B7
+#define GL_COMPRESSED_RGBA_ASTC_10x5_KHR 0x93B8
+#define GL_COMPRESSED_RGBA_ASTC_10x6_KHR 0x93B9
+#define GL_COMPRESSED_RGBA_ASTC_10x8_KHR 0x93BA
+#define GL_COMPRESSED_RGBA_ASTC_10x10_KHR 0x93BB
+#define GL_COMPRESSED_RGBA_ASTC_12x10_KHR 0x93BC
+#define GL_COMPRESSED_RGBA_ASTC_12x12_KHR 0x93BD
+#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR 0x93D0
+#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR 0x93DD
 #endif
 
 #include <string>
@@ -63,6 +200,64 @@ struct GLExtensions {
      */
     static bool support(const std::string &ext);
 
+    /**
+     * Whether the version of the current context is at least major.minor.
+     *
+     * The version is that of OpenGL ES or desktop OpenGL, depending on the
+     * API of the context.
+     *
+     * @return true if the version is at least major.minor
+     */
+    static bool version_at_least(int major, int minor);
+
+    /**
+     * Loads the buffer range mapping, buffer storage and sync object entry
+     * points that are available in the current context, from the core API
+     * or the equivalent extensions.
+     *
+     * @param load the function to look up entry points with
+     * @param userptr the user data to pass to @a load
+     */
+    static void init_buffer_functions(GLADuserptrloadfunc load, void *userptr);
+
+    /**
+     * Loads the instanced drawing entry points that are available in the
+     * current context, from the core API or the equivalent extensions.
+     *
+     * @param load the function to look up entry points with
+     * @param userptr the user data to pass to @a load
+     */
+    static void init_draw_functions(GLADuserptrloadfunc load, void *userptr);
+
+    /**
+     * Loads the timer query entry points, if timer queries are available in
+     * the current context.
+     *
+     * @param load the function to look up entry points with
+     * @param userptr the user data to pass to @a load
+     */
+    static void init_query_functions(GLADuserptrloadfunc load, void *userptr);
+
+    /**
+     * Loads the compute shader, storage buffer and image load/store entry
+     * points, if compute shaders are available in the current context.
+     *
+     * @param load the function to look up entry points with
+     * @param userptr the user data to pass to @a load
+     */
+    static void init_compute_functions(GLADuserptrloadfunc load, void *userptr);
+
+    /**
+     * Loads the framebuffer invalidation, multisampled renderbuffer and
+     * framebuffer blit entry points that are available in the current
+     * context, from the core API or the equivalent extensions, and the
+     * GL_EXT_multisampled_render_to_texture ones.
+     *
+     * @param load the function to look up entry points with
+     * @param userptr the user data to pass to @a load
+     */
+    static void init_framebuffer_functions(GLADuserptrloadfunc load, void *userptr);
+
     static void* (GLAD_API_PTR *MapBuffer) (GLenum target, GLenum access);
     static GLboolean (GLAD_API_PTR *UnmapBuffer) (GLenum target);
 
@@ -72,6 +267,13 @@ struct GLExtensions {
     static void (GLAD_API_PTR *FramebufferTexture2D)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
     static void (GLAD_API_PTR *FramebufferRenderbuffer)(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
     static GLenum (GLAD_API_PTR *CheckFramebufferStatus)(GLenum target);
+    /* glInvalidateFramebuffer or glDiscardFramebufferEXT, which take the same arguments */
+    static void (GLAD_API_PTR *InvalidateFramebuffer)(GLenum target, GLsizei numAttachments, const GLenum *attachments);
+    static void (GLAD_API_PTR *RenderbufferStorageMultisample)(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height);
+    static void (GLAD_API_PTR *BlitFramebuffer)(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
+    /* GL_EXT_multisampled_render_to_texture, which resolves implicitly */
+    static void (GLAD_API_PTR *FramebufferTexture2DMultisampleEXT)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level, GLsizei samples);
+    static void (GLAD_API_PTR *RenderbufferStorageMultisampleEXT)(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height);
 
     static void (GLAD_API_PTR *GenRenderbuffers)(GLsizei n, GLuint * renderbuffers);
     static void (GLAD_API_PTR *DeleteRenderbuffers)(GLsizei n, const GLuint * renderbuffers);
@@ -79,6 +281,37 @@ struct GLExtensions {
     static void (GLAD_API_PTR *RenderbufferStorage)(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
 
     static void (GLAD_API_PTR *GenerateMipmap)(GLenum target);
+
+    static void (GLAD_API_PTR *GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    static void (GLAD_API_PTR *ProgramBinary)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    /* Only needed on desktop GL, GL_OES_get_program_binary has no hint */
+    static void (GLAD_API_PTR *ProgramParameteri)(GLuint program, GLenum pname, GLint value);
+
+    static void* (GLAD_API_PTR *MapBufferRange)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    static void (GLAD_API_PTR *BufferStorage)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+    static GLsync (GLAD_API_PTR *FenceSync)(GLenum condition, GLbitfield flags);
+    static GLenum (GLAD_API_PTR *ClientWaitSync)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+    static void (GLAD_API_PTR *DeleteSync)(GLsync sync);
+
+    static void (GLAD_API_PTR *DrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+    static void (GLAD_API_PTR *DrawElementsInstanced)(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount);
+    static void (GLAD_API_PTR *VertexAttribDivisor)(GLuint index, GLuint divisor);
+
+    static void (GLAD_API_PTR *GenQueries)(GLsizei n, GLuint *ids);
+    static void (GLAD_API_PTR *DeleteQueries)(GLsizei n, const GLuint *ids);
+    static void (GLAD_API_PTR *BeginQuery)(GLenum target, GLuint id);
+    static void (GLAD_API_PTR *EndQuery)(GLenum target);
+    static void (GLAD_API_PTR *GetQueryObjectuiv)(GLuint id, GLenum pname, GLuint *params);
+    static void (GLAD_API_PTR *GetQueryObjectui64v)(GLuint id, GLenum pname, GLuint64 *params);
+    /* Whether GL_GPU_DISJOINT_EXT must be checked before using timer query results */
+    static bool TimerQueryDisjoint;
+
+    static void (GLAD_API_PTR *DispatchCompute)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+    /* Not MemoryBarrier, which is a macro on Windows */
+    static void (GLAD_API_PTR *MemoryBarrierGL)(GLbitfield barriers);
+    static void (GLAD_API_PTR *BindBufferBase)(GLenum target, GLuint index, GLuint buffer);
+    static void (GLAD_API_PTR *BindImageTexture)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+    static void (GLAD_API_PTR *TexStorage2D)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
 };
 
 #endif
@@ -1,5 +1,7 @@
 
 #include "gl-state-egl.h"
+#include "egl-shared-context.h"
+#include "egl-texture-image.h"
 #include "log.h"
 #include "options.h"
 #include "gl-headers.h"
@@ -336,6 +338,21 @@ GLStateEGL::init_gl_extensions()
     GLExtensions::RenderbufferStorage = glRenderbufferStorage;
 
     GLExtensions::GenerateMipmap = glGenerateMipmap;
+
+    if (GLExtensions::support("GL_OES_get_program_binary")) {
+        GLExtensions::GetProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::GetProgramBinary)>(
+                load_proc(this, "glGetProgramBinaryOES"));
+        GLExtensions::ProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::ProgramBinary)>(
+                load_proc(this, "glProgramBinaryOES"));
+    }
+
+    GLExtensions::init_buffer_functions(load_proc, this);
+    GLExtensions::init_draw_functions(load_proc, this);
+    GLExtensions::init_query_functions(load_proc, this);
+    GLExtensions::init_compute_functions(load_proc, this);
+    GLExtensions::init_framebuffer_functions(load_proc, this);
 #elif GPULOAD_USE_GL
     if (!gladLoadGLUserPtr(load_proc, this)) {
         Log::error("Loading GL entry points failed.");
@@ -357,6 +374,24 @@ GLStateEGL::init_gl_extensions()
     GLExtensions::RenderbufferStorage = glRenderbufferStorageEXT;
 
     GLExtensions::GenerateMipmap = glGenerateMipmapEXT;
+
+    if (GLExtensions::support("GL_ARB_get_program_binary")) {
+        GLExtensions::GetProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::GetProgramBinary)>(
+                load_proc(this, "glGetProgramBinary"));
+        GLExtensions::ProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::ProgramBinary)>(
+                load_proc(this, "glProgramBinary"));
+        GLExtensions::ProgramParameteri =
+            reinterpret_cast<decltype(GLExtensions::ProgramParameteri)>(
+                load_proc(this, "glProgramParameteri"));
+    }
+
+    GLExtensions::init_buffer_functions(load_proc, this);
+    GLExtensions::init_draw_functions(load_proc, this);
+    GLExtensions::init_query_functions(load_proc, this);
+    GLExtensions::init_compute_functions(load_proc, this);
+    GLExtensions::init_framebuffer_functions(load_proc, this);
 #endif
     return true;
 }
@@ -449,6 +484,24 @@ GLStateEGL::getVisualConfig(GLVisualConfig& vc)
     get_glvisualconfig(egl_config_, vc);
 }
 
+GLSharedContext *
+GLStateEGL::create_shared_context()
+{
+    if (!gotValidContext())
+        return 0;
+
+    return EGLSharedContext::create();
+}
+
+bool
+GLStateEGL::bind_texture_image(unsigned int source, unsigned int target)
+{
+    if (!gotValidContext())
+        return false;
+
+    return egl_bind_texture_image(source, target);
+}
+
 /******************************
  * GLStateEGL private methods *
  *****************************/
@@ -585,6 +638,7 @@ GLStateEGL::get_glvisualconfig(EGLConfig config, GLVisualConfig& visual_config)
     eglGetConfigAttrib(egl_display_, config, EGL_ALPHA_SIZE, &visual_config.alpha);
     eglGetConfigAttrib(egl_display_, config, EGL_DEPTH_SIZE, &visual_config.depth);
     eglGetConfigAttrib(egl_display_, config, EGL_STENCIL_SIZE, &visual_config.stencil);
+    eglGetConfigAttrib(egl_display_, config, EGL_SAMPLES, &visual_config.samples);
 }
 
 EGLConfig
@@ -634,6 +688,7 @@ GLStateEGL::gotValidConfig()
         EGL_ALPHA_SIZE, requested_visual_config_.alpha,
         EGL_DEPTH_SIZE, requested_visual_config_.depth,
         EGL_STENCIL_SIZE, requested_visual_config_.stencil,
+        EGL_SAMPLES, requested_visual_config_.samples,
 #if GPULOAD_USE_GLESv2
         EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
 #elif GPULOAD_USE_GL
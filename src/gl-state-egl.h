@@ -135,6 +135,8 @@ public:
     // Performs a config search, returning a native visual ID on success
     bool gotNativeConfig(intptr_t& vid);
     void getVisualConfig(GLVisualConfig& vc);
+    GLSharedContext *create_shared_context();
+    bool bind_texture_image(unsigned int source, unsigned int target);
 };
 
 #endif // GPULOAD_GL_STATE_EGL_H_
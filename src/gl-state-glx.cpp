@@ -52,6 +52,24 @@ GLStateGLX::init_gl_extensions()
 
     GLExtensions::GenerateMipmap = glGenerateMipmapEXT;
 
+    if (GLExtensions::support("GL_ARB_get_program_binary")) {
+        GLExtensions::GetProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::GetProgramBinary)>(
+                load_proc(this, "glGetProgramBinary"));
+        GLExtensions::ProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::ProgramBinary)>(
+                load_proc(this, "glProgramBinary"));
+        GLExtensions::ProgramParameteri =
+            reinterpret_cast<decltype(GLExtensions::ProgramParameteri)>(
+                load_proc(this, "glProgramParameteri"));
+    }
+
+    GLExtensions::init_buffer_functions(load_proc, this);
+    GLExtensions::init_draw_functions(load_proc, this);
+    GLExtensions::init_query_functions(load_proc, this);
+    GLExtensions::init_compute_functions(load_proc, this);
+    GLExtensions::init_framebuffer_functions(load_proc, this);
+
     return true;
 }
 
@@ -206,6 +224,7 @@ GLStateGLX::ensure_glx_fbconfig()
         GLX_DEPTH_SIZE, requested_visual_config_.depth,
         GLX_STENCIL_SIZE, requested_visual_config_.stencil,
         GLX_BUFFER_SIZE, requested_visual_config_.buffer,
+        GLX_SAMPLES, requested_visual_config_.samples,
         GLX_DOUBLEBUFFER, True,
         None
     };
@@ -290,6 +309,7 @@ GLStateGLX::get_glvisualconfig_glx(const GLXFBConfig config, GLVisualConfig &vis
     glXGetFBConfigAttrib(xdpy_, config, GLX_ALPHA_SIZE, &visual_config.alpha);
     glXGetFBConfigAttrib(xdpy_, config, GLX_DEPTH_SIZE, &visual_config.depth);
     glXGetFBConfigAttrib(xdpy_, config, GLX_STENCIL_SIZE, &visual_config.stencil);
+    glXGetFBConfigAttrib(xdpy_, config, GLX_SAMPLES, &visual_config.samples);
 }
 
 GLXFBConfig
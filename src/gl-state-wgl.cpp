@@ -109,6 +109,24 @@ GLStateWGL::init_gl_extensions()
 
     GLExtensions::GenerateMipmap = glGenerateMipmapEXT;
 
+    if (GLExtensions::support("GL_ARB_get_program_binary")) {
+        GLExtensions::GetProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::GetProgramBinary)>(
+                load_proc(this, "glGetProgramBinary"));
+        GLExtensions::ProgramBinary =
+            reinterpret_cast<decltype(GLExtensions::ProgramBinary)>(
+                load_proc(this, "glProgramBinary"));
+        GLExtensions::ProgramParameteri =
+            reinterpret_cast<decltype(GLExtensions::ProgramParameteri)>(
+                load_proc(this, "glProgramParameteri"));
+    }
+
+    GLExtensions::init_buffer_functions(load_proc, this);
+    GLExtensions::init_draw_functions(load_proc, this);
+    GLExtensions::init_query_functions(load_proc, this);
+    GLExtensions::init_compute_functions(load_proc, this);
+    GLExtensions::init_framebuffer_functions(load_proc, this);
+
     return true;
 }
 
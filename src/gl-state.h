@@ -6,6 +6,28 @@
 
 class GLVisualConfig;
 
+/**
+ * A GL context sharing objects with the main rendering context, for use
+ * on a worker thread.
+ */
+class GLSharedContext
+{
+public:
+    virtual ~GLSharedContext() {}
+
+    /**
+     * Makes the context current on the calling thread.
+     *
+     * @return whether the operation succeeded
+     */
+    virtual bool make_current() = 0;
+
+    /**
+     * Releases the context from the calling thread.
+     */
+    virtual void release() = 0;
+};
+
 class GLState
 {
 public:
@@ -19,6 +41,13 @@ public:
     virtual void swap() = 0;
     virtual bool gotNativeConfig(intptr_t& vid) = 0;
     virtual void getVisualConfig(GLVisualConfig& vc) = 0;
+    virtual GLSharedContext *create_shared_context() { return 0; }
+    virtual bool bind_texture_image(unsigned int source, unsigned int target)
+    {
+        static_cast<void>(source);
+        static_cast<void>(target);
+        return false;
+    }
 };
 
 #endif /* GPULOAD_GL_STATE_H_ */
@@ -6,7 +6,7 @@
 #include <vector>
 
 GLVisualConfig::GLVisualConfig(const std::string &s) :
-    red(1), green(1), blue(1), alpha(1), depth(1), stencil(0), buffer(1)
+    red(1), green(1), blue(1), alpha(1), depth(1), stencil(0), buffer(1), samples(0)
 {
     std::vector<std::string> elems;
 
@@ -34,6 +34,8 @@ GLVisualConfig::GLVisualConfig(const std::string &s) :
                 stencil = Util::fromString<int>(opt[1]);
             else if (opt[0] == "buf" || opt[0] == "buffer")
                 buffer = Util::fromString<int>(opt[1]);
+            else if (opt[0] == "samples")
+                samples = Util::fromString<int>(opt[1]);
         }
         else
             Log::info("Warning: ignoring invalid option string '%s' "
@@ -58,6 +60,7 @@ GLVisualConfig::match_score(const GLVisualConfig &target) const
     score += score_component(depth, target.depth, 1);
     score += score_component(stencil, target.stencil, 0);
     score += score_component(buffer, target.buffer, 1);
+    score += score_component(samples, target.samples, 0);
 
     return score;
 }
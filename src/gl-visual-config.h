@@ -11,9 +11,9 @@ class GLVisualConfig
 {
 public:
     GLVisualConfig():
-        red(1), green(1), blue(1), alpha(1), depth(1), stencil(0), buffer(1) {}
+        red(1), green(1), blue(1), alpha(1), depth(1), stencil(0), buffer(1), samples(0) {}
     GLVisualConfig(int r, int g, int b, int a, int d, int s, int buf):
-        red(r), green(g), blue(b), alpha(a), depth(d), stencil(s), buffer(buf) {}
+        red(r), green(g), blue(b), alpha(a), depth(d), stencil(s), buffer(buf), samples(0) {}
     GLVisualConfig(const std::string &s);
 
     /**
@@ -37,6 +37,8 @@ public:
     int depth;
     int stencil;
     int buffer;
+    /* The samples per pixel of a multisampled surface, 0 if not multisampled */
+    int samples;
 
 private:
     int score_component(int component, int target, int scale) const;
@@ -1,13 +1,39 @@
 
 #include <png.h>
 #include <jpeglib.h>
+#include <turbojpeg.h>
 #include <cstring>
 #include <memory>
+#include <vector>
 
 #include "image-reader.h"
 #include "log.h"
 #include "util.h"
 
+/***************
+ * ImageReader *
+ ***************/
+
+/**
+ * Reads the whole image into a buffer in bottom-up row order, which is
+ * the order expected by glTexImage2D().
+ *
+ * @param dst the buffer to read into, of size width() * height() * pixelBytes()
+ *
+ * @return whether the operation succeeded
+ */
+bool
+ImageReader::readImage(unsigned char *dst)
+{
+    unsigned int stride = width() * pixelBytes();
+    unsigned char *ptr = dst + stride * (height() - 1);
+
+    while (nextRow(ptr))
+        ptr -= stride;
+
+    return !error();
+}
+
 /*******
  * PNG *
  *******/
@@ -15,7 +41,7 @@
 struct PNGReaderPrivate
 {
     PNGReaderPrivate() :
-        png(0), info(0), rows(0), png_error(0),
+        is(0), png(0), info(0), png_error(0), decoded(false),
         current_row(0), row_stride(0) {}
 
     static void png_read_fn(png_structp png_ptr, png_bytep data, png_size_t length)
@@ -24,10 +50,12 @@ struct PNGReaderPrivate
         is->read(reinterpret_cast<char *>(data), length);
     }
 
+    std::istream *is;
     png_structp png;
     png_infop info;
-    png_bytepp rows;
+    std::vector<unsigned char> data;
     bool png_error;
+    bool decoded;
     unsigned int current_row;
     unsigned int row_stride;
 };
@@ -53,10 +81,26 @@ PNGReader::error()
 bool
 PNGReader::nextRow(unsigned char *dst)
 {
+    if (priv_->png_error)
+        return false;
+
+    /*
+     * Row by row access needs a copy of the image, since interlaced images
+     * can only be decoded as a whole. Use readImage() to avoid it.
+     */
+    if (priv_->data.empty()) {
+        unsigned int image_size = priv_->row_stride * height();
+        priv_->data.resize(image_size);
+        if (!readImage(&priv_->data[0]))
+            return false;
+    }
+
     bool ret;
 
     if (priv_->current_row < height()) {
-        memcpy(dst, priv_->rows[priv_->current_row], priv_->row_stride);
+        /* The decoded data is bottom-up */
+        unsigned int row = height() - 1 - priv_->current_row;
+        memcpy(dst, &priv_->data[row * priv_->row_stride], priv_->row_stride);
         priv_->current_row++;
         ret = true;
     }
@@ -67,6 +111,37 @@ PNGReader::nextRow(unsigned char *dst)
     return ret;
 }
 
+/**
+ * Decodes the image directly into the destination buffer, by handing
+ * libpng row pointers in reverse order. This avoids any intermediate
+ * copies of the image data.
+ */
+bool
+PNGReader::readImage(unsigned char *dst)
+{
+    if (priv_->png_error || priv_->decoded)
+        return false;
+
+    unsigned int h = height();
+    std::vector<png_bytep> rows(h);
+
+    for (unsigned int i = 0; i < h; i++)
+        rows[i] = dst + (h - 1 - i) * priv_->row_stride;
+
+    /* Set up libpng error handling */
+    if (setjmp(png_jmpbuf(priv_->png))) {
+        Log::error("libpng error while decoding image\n");
+        priv_->png_error = true;
+        return false;
+    }
+
+    png_read_image(priv_->png, &rows[0]);
+    png_read_end(priv_->png, 0);
+    priv_->decoded = true;
+
+    return true;
+}
+
 unsigned int
 PNGReader::width() const
 { 
@@ -93,15 +168,10 @@ PNGReader::pixelBytes() const
 bool
 PNGReader::init(const std::string& filename)
 {
-    static const int png_transforms = PNG_TRANSFORM_STRIP_16 |
-                                      PNG_TRANSFORM_GRAY_TO_RGB |
-                                      PNG_TRANSFORM_PACKING |
-                                      PNG_TRANSFORM_EXPAND;
-
     Log::debug("Reading PNG file %s\n", filename.c_str());
 
-    const std::unique_ptr<std::istream> is_ptr(Util::get_resource(filename));
-    if (!(*is_ptr)) {
+    priv_->is = Util::get_resource(filename);
+    if (!(*priv_->is)) {
         Log::error("Cannot open file %s!\n", filename.c_str());
         return false;
     }
@@ -125,13 +195,19 @@ PNGReader::init(const std::string& filename)
         return false;
     }
 
-    /* Read the image information and data */
-    png_set_read_fn(priv_->png, reinterpret_cast<void*>(is_ptr.get()),
+    /* Read the image information, the data is decoded on demand */
+    png_set_read_fn(priv_->png, reinterpret_cast<void*>(priv_->is),
                     PNGReaderPrivate::png_read_fn);
 
-    png_read_png(priv_->png, priv_->info, png_transforms, 0);
+    png_read_info(priv_->png, priv_->info);
 
-    priv_->rows = png_get_rows(priv_->png, priv_->info);
+    /* Convert to 8-bit RGB or RGBA */
+    png_set_strip_16(priv_->png);
+    png_set_gray_to_rgb(priv_->png);
+    png_set_packing(priv_->png);
+    png_set_expand(priv_->png);
+    png_set_interlace_handling(priv_->png);
+    png_read_update_info(priv_->png, priv_->info);
 
     priv_->current_row = 0;
     priv_->row_stride = width() * pixelBytes();
@@ -146,6 +222,8 @@ PNGReader::finish()
     {
         png_destroy_read_struct(&priv_->png, &priv_->info, 0);
     }
+
+    delete priv_->is;
 }
 
 
@@ -364,3 +442,184 @@ JPEGReader::finish()
 
 
 
+
+
+/*************
+ * TurboJPEG *
+ *************/
+
+struct TurboJPEGReaderPrivate
+{
+    TurboJPEGReaderPrivate() :
+        handle(0), width(0), height(0), tj_error(false), decoded(false),
+        current_row(0) {}
+
+    tjhandle handle;
+    std::vector<unsigned char> file_data;
+    std::vector<unsigned char> rows;
+    unsigned int width;
+    unsigned int height;
+    bool tj_error;
+    bool decoded;
+    unsigned int current_row;
+};
+
+TurboJPEGReader::TurboJPEGReader(const std::string& filename, unsigned int max_size) :
+    priv_(new TurboJPEGReaderPrivate())
+{
+    priv_->tj_error = !init(filename, max_size);
+}
+
+TurboJPEGReader::~TurboJPEGReader()
+{
+    finish();
+    delete priv_;
+}
+
+bool
+TurboJPEGReader::error()
+{
+    return priv_->tj_error;
+}
+
+bool
+TurboJPEGReader::nextRow(unsigned char *dst)
+{
+    if (priv_->tj_error)
+        return false;
+
+    /* Row by row access needs a copy of the image, use readImage() to avoid it */
+    unsigned int stride = width() * pixelBytes();
+
+    if (priv_->rows.empty()) {
+        priv_->rows.resize(stride * height());
+        if (!readImage(&priv_->rows[0]))
+            return false;
+    }
+
+    if (priv_->current_row >= height())
+        return false;
+
+    /* The decoded data is bottom-up */
+    unsigned int row = height() - 1 - priv_->current_row;
+    memcpy(dst, &priv_->rows[row * stride], stride);
+    priv_->current_row++;
+
+    return true;
+}
+
+bool
+TurboJPEGReader::readImage(unsigned char *dst)
+{
+    if (priv_->tj_error || priv_->decoded)
+        return false;
+
+    if (tjDecompress2(priv_->handle, &priv_->file_data[0], priv_->file_data.size(),
+                      dst, priv_->width, 0, priv_->height, TJPF_RGB,
+                      TJFLAG_BOTTOMUP) != 0)
+    {
+        Log::error("TurboJPEG error while decoding image: %s\n", tjGetErrorStr());
+        priv_->tj_error = true;
+        return false;
+    }
+
+    priv_->decoded = true;
+
+    return true;
+}
+
+unsigned int
+TurboJPEGReader::width() const
+{
+    return priv_->width;
+}
+
+unsigned int
+TurboJPEGReader::height() const
+{
+    return priv_->height;
+}
+
+unsigned int
+TurboJPEGReader::pixelBytes() const
+{
+    return 3;
+}
+
+bool
+TurboJPEGReader::init(const std::string& filename, unsigned int max_size)
+{
+    Log::debug("Reading JPEG file %s (TurboJPEG)\n", filename.c_str());
+
+    const std::unique_ptr<std::istream> is_ptr(Util::get_resource(filename));
+    if (!is_ptr || !(*is_ptr)) {
+        Log::error("Cannot open file %s!\n", filename.c_str());
+        return false;
+    }
+
+    std::istream &is(*is_ptr);
+    is.seekg(0, std::ios::end);
+    std::streamoff size = is.tellg();
+    is.seekg(0, std::ios::beg);
+
+    if (size <= 0) {
+        Log::error("Cannot read file %s!\n", filename.c_str());
+        return false;
+    }
+
+    priv_->file_data.resize(size);
+    is.read(reinterpret_cast<char *>(&priv_->file_data[0]), size);
+    if (!is) {
+        Log::error("Cannot read file %s!\n", filename.c_str());
+        return false;
+    }
+
+    priv_->handle = tjInitDecompress();
+    if (!priv_->handle) {
+        Log::error("Couldn't create TurboJPEG decompressor: %s\n", tjGetErrorStr());
+        return false;
+    }
+
+    int w, h, subsamp, colorspace;
+
+    if (tjDecompressHeader3(priv_->handle, &priv_->file_data[0],
+                            priv_->file_data.size(), &w, &h, &subsamp,
+                            &colorspace) != 0)
+    {
+        Log::error("TurboJPEG error while reading file %s: %s\n",
+                   filename.c_str(), tjGetErrorStr());
+        return false;
+    }
+
+    /*
+     * Pick the smallest IDCT reduction that fits the image within the
+     * maximum size, down to 1/8.
+     */
+    static const tjscalingfactor factors[] = { {1, 1}, {1, 2}, {1, 4}, {1, 8} };
+    static const unsigned int nfactors = sizeof(factors) / sizeof(*factors);
+    unsigned int i = 0;
+
+    while (max_size > 0 && i < nfactors - 1 &&
+           (static_cast<unsigned int>(TJSCALED(w, factors[i])) > max_size ||
+            static_cast<unsigned int>(TJSCALED(h, factors[i])) > max_size))
+    {
+        i++;
+    }
+
+    priv_->width = TJSCALED(w, factors[i]);
+    priv_->height = TJSCALED(h, factors[i]);
+
+    if (i > 0) {
+        Log::debug("    Scaling %dx%d image by 1/%d to %ux%u\n", w, h,
+                   factors[i].denom, priv_->width, priv_->height);
+    }
+
+    return true;
+}
+
+void
+TurboJPEGReader::finish()
+{
+    if (priv_->handle)
+        tjDestroy(priv_->handle);
+}
@@ -6,6 +6,7 @@ class ImageReader
 public:
     virtual bool error() = 0;
     virtual bool nextRow(unsigned char *dst) = 0;
+    virtual bool readImage(unsigned char *dst);
     virtual unsigned int width() const = 0;
     virtual unsigned int height() const = 0;
     virtual unsigned int pixelBytes() const = 0;
@@ -22,6 +23,7 @@ public:
     virtual ~PNGReader();
     bool error();
     bool nextRow(unsigned char *dst);
+    bool readImage(unsigned char *dst);
 
     unsigned int width() const;
     unsigned int height() const;
@@ -55,3 +57,39 @@ private:
     JPEGReaderPrivate *priv_;
 };
 
+struct TurboJPEGReaderPrivate;
+
+/**
+ * Reads JPEG images through the TurboJPEG API.
+ *
+ * The whole file is read into memory and decoded in one call, straight into
+ * the destination buffer in bottom-up order. Images larger than a maximum
+ * size are scaled down by 1/2, 1/4 or 1/8 during decoding, which skips most
+ * of the IDCT work instead of resampling the decoded pixels.
+ */
+class TurboJPEGReader : public ImageReader
+{
+public:
+    /**
+     * @param filename the file to read
+     * @param max_size the maximum width and height of the decoded image,
+     *                 0 for no limit
+     */
+    TurboJPEGReader(const std::string& filename, unsigned int max_size = 0);
+
+    virtual ~TurboJPEGReader();
+    bool error();
+    bool nextRow(unsigned char *dst);
+    bool readImage(unsigned char *dst);
+
+    unsigned int width() const;
+    unsigned int height() const;
+    unsigned int pixelBytes() const;
+
+private:
+    bool init(const std::string& filename, unsigned int max_size);
+    void finish();
+
+    TurboJPEGReaderPrivate *priv_;
+};
+
@@ -0,0 +1,302 @@
+#include "ktx-reader.h"
+#include "texture-decoder.h"
+#include "log.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+
+const unsigned char ktx1_identifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+const unsigned char ktx2_identifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+const uint32_t ktx1_endianness = 0x04030201;
+const uint32_t ktx1_endianness_swapped = 0x01020304;
+const size_t ktx1_header_size = 64;
+const size_t ktx2_header_size = 80;
+const size_t ktx2_level_index_entry_size = 24;
+
+/* Vulkan formats that can appear in KTX2 files */
+const uint32_t vk_format_r8g8b8_unorm = 23;
+const uint32_t vk_format_r8g8b8a8_unorm = 37;
+const uint32_t vk_format_etc2_r8g8b8_unorm = 147;
+const uint32_t vk_format_etc2_r8g8b8a8_srgb = 152;
+const uint32_t vk_format_astc_4x4_unorm = 157;
+const uint32_t vk_format_astc_12x12_srgb = 184;
+
+uint32_t
+swap32(uint32_t v)
+{
+    return ((v & 0xff) << 24) | ((v & 0xff00) << 8) |
+           ((v >> 8) & 0xff00) | (v >> 24);
+}
+
+/**
+ * Maps a Vulkan format to the equivalent GL internal format.
+ *
+ * @return the GL format, or GL_NONE if the format is not supported
+ */
+GLenum
+gl_format_from_vk(uint32_t vk_format)
+{
+    static const GLenum etc2_formats[] = {
+        GL_COMPRESSED_RGB8_ETC2,
+        GL_COMPRESSED_SRGB8_ETC2,
+        GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+        GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+        GL_COMPRESSED_RGBA8_ETC2_EAC,
+        GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+    };
+
+    if (vk_format == vk_format_r8g8b8_unorm)
+        return GL_RGB;
+    if (vk_format == vk_format_r8g8b8a8_unorm)
+        return GL_RGBA;
+
+    if (vk_format >= vk_format_etc2_r8g8b8_unorm &&
+        vk_format <= vk_format_etc2_r8g8b8a8_srgb)
+    {
+        return etc2_formats[vk_format - vk_format_etc2_r8g8b8_unorm];
+    }
+
+    /* ASTC formats alternate between UNORM and SRGB, in the GL order */
+    if (vk_format >= vk_format_astc_4x4_unorm &&
+        vk_format <= vk_format_astc_12x12_srgb)
+    {
+        unsigned int index = (vk_format - vk_format_astc_4x4_unorm) / 2;
+        bool srgb = (vk_format - vk_format_astc_4x4_unorm) % 2;
+        return (srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR :
+                       GL_COMPRESSED_RGBA_ASTC_4x4_KHR) + index;
+    }
+
+    return GL_NONE;
+}
+
+}
+
+KTXReader::KTXReader(const std::string& filename) :
+    internal_format_(GL_NONE), width_(0), height_(0), compressed_(false),
+    error_(false)
+{
+    error_ = !init(filename);
+}
+
+bool
+KTXReader::init(const std::string& filename)
+{
+    Log::debug("Reading KTX file %s\n", filename.c_str());
+
+    const std::unique_ptr<std::istream> is_ptr(Util::get_resource(filename));
+
+    if (!is_ptr || !is_ptr->good()) {
+        Log::error("Couldn't open %s for reading!\n", filename.c_str());
+        return false;
+    }
+
+    std::istream& is(*is_ptr);
+
+    is.seekg(0, std::ios::end);
+    std::streamoff file_size = is.tellg();
+    is.seekg(0, std::ios::beg);
+
+    if (file_size < static_cast<std::streamoff>(ktx1_header_size)) {
+        Log::error("%s is too small to be a KTX file\n", filename.c_str());
+        return false;
+    }
+
+    data_.resize(file_size);
+    is.read(reinterpret_cast<char *>(&data_[0]), file_size);
+
+    if (!is) {
+        Log::error("Failed to read %s\n", filename.c_str());
+        return false;
+    }
+
+    bool ret;
+
+    if (!memcmp(&data_[0], ktx1_identifier, sizeof(ktx1_identifier))) {
+        ret = parse_ktx1();
+    }
+    else if (!memcmp(&data_[0], ktx2_identifier, sizeof(ktx2_identifier))) {
+        ret = parse_ktx2();
+    }
+    else {
+        Log::error("%s is not a KTX file\n", filename.c_str());
+        return false;
+    }
+
+    if (!ret) {
+        Log::error("Unsupported or corrupt KTX file %s\n", filename.c_str());
+        return false;
+    }
+
+    Log::debug("    Height: %d Width: %d Levels: %d Format: 0x%x\n",
+               height(), width(), num_levels(), internal_format_);
+
+    return true;
+}
+
+/**
+ * Adds a mipmap level whose data is at [offset, offset + size) in the file.
+ *
+ * @return false if the data is out of bounds or has an unexpected size
+ */
+bool
+KTXReader::add_level(unsigned int index, size_t offset, size_t size)
+{
+    Level level;
+    level.width = std::max(width() >> index, 1U);
+    level.height = std::max(height() >> index, 1U);
+
+    if (offset > data_.size() || size > data_.size() - offset)
+        return false;
+
+    unsigned int expected = compressed_ ?
+        TextureDecoder::image_size(internal_format_, level.width, level.height) :
+        level.width * level.height * (internal_format_ == GL_RGB ? 3 : 4);
+
+    /* Uncompressed KTX1 rows are padded to 4 bytes, which we can't handle */
+    if (size != expected)
+        return false;
+
+    level.data = &data_[offset];
+    level.size = size;
+    levels_.push_back(level);
+
+    return true;
+}
+
+bool
+KTXReader::parse_ktx1()
+{
+    uint32_t header[13];
+    memcpy(header, &data_[12], sizeof(header));
+
+    bool swap = header[0] == ktx1_endianness_swapped;
+    if (!swap && header[0] != ktx1_endianness)
+        return false;
+
+    if (swap) {
+        for (unsigned int i = 0; i < 13; i++)
+            header[i] = swap32(header[i]);
+    }
+
+    uint32_t gl_type = header[1];
+    uint32_t gl_format = header[3];
+    uint32_t gl_internal_format = header[4];
+    uint32_t pixel_width = header[6];
+    uint32_t pixel_height = header[7];
+    uint32_t pixel_depth = header[8];
+    uint32_t array_elements = header[9];
+    uint32_t faces = header[10];
+    uint32_t mipmap_levels = header[11];
+    uint32_t key_value_bytes = header[12];
+
+    if (pixel_width == 0 || pixel_height == 0 || pixel_depth > 1 ||
+        array_elements > 1 || faces != 1)
+    {
+        return false;
+    }
+
+    if (gl_type == 0) {
+        unsigned int bw, bh, bytes;
+        if (!TextureDecoder::block_info(gl_internal_format, bw, bh, bytes))
+            return false;
+        compressed_ = true;
+        internal_format_ = gl_internal_format;
+    }
+    else if (gl_type == GL_UNSIGNED_BYTE &&
+             (gl_format == GL_RGB || gl_format == GL_RGBA))
+    {
+        internal_format_ = gl_format;
+    }
+    else {
+        return false;
+    }
+
+    if (mipmap_levels == 0)
+        mipmap_levels = 1;
+
+    width_ = pixel_width;
+    height_ = pixel_height;
+
+    size_t offset = ktx1_header_size + key_value_bytes;
+
+    for (unsigned int i = 0; i < mipmap_levels; i++) {
+        if (offset + 4 > data_.size())
+            return false;
+
+        uint32_t image_size;
+        memcpy(&image_size, &data_[offset], 4);
+        if (swap)
+            image_size = swap32(image_size);
+        offset += 4;
+
+        if (!add_level(i, offset, image_size))
+            return false;
+
+        /* Image data is padded to 4 bytes */
+        offset += (image_size + 3) & ~3U;
+    }
+
+    return true;
+}
+
+bool
+KTXReader::parse_ktx2()
+{
+    if (data_.size() < ktx2_header_size)
+        return false;
+
+    uint32_t header[9];
+    memcpy(header, &data_[12], sizeof(header));
+
+    uint32_t vk_format = header[0];
+    uint32_t pixel_width = header[2];
+    uint32_t pixel_height = header[3];
+    uint32_t pixel_depth = header[4];
+    uint32_t layers = header[5];
+    uint32_t faces = header[6];
+    uint32_t level_count = header[7];
+    uint32_t supercompression = header[8];
+
+    if (pixel_width == 0 || pixel_height == 0 || pixel_depth > 0 ||
+        layers > 0 || faces != 1 || supercompression != 0)
+    {
+        return false;
+    }
+
+    internal_format_ = gl_format_from_vk(vk_format);
+    if (internal_format_ == GL_NONE)
+        return false;
+
+    compressed_ = internal_format_ != GL_RGB && internal_format_ != GL_RGBA;
+
+    if (level_count == 0)
+        level_count = 1;
+
+    if (data_.size() < ktx2_header_size + level_count * ktx2_level_index_entry_size)
+        return false;
+
+    width_ = pixel_width;
+    height_ = pixel_height;
+
+    for (unsigned int i = 0; i < level_count; i++) {
+        uint64_t entry[2];
+        memcpy(entry, &data_[ktx2_header_size + i * ktx2_level_index_entry_size],
+               sizeof(entry));
+
+        if (!add_level(i, entry[0], entry[1]))
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef GPULOAD_KTX_READER_H_
+#define GPULOAD_KTX_READER_H_
+
+#include "gl-headers.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Reads KTX (version 1) and KTX2 texture container files.
+ *
+ * Only the first array element and face of 2D textures are used, and KTX2
+ * supercompression is not supported. Images are expected to be stored with
+ * the bottom row first, which is the order expected by glTexImage2D().
+ */
+class KTXReader
+{
+public:
+    struct Level
+    {
+        unsigned int width;
+        unsigned int height;
+        const unsigned char *data;
+        unsigned int size;
+    };
+
+    KTXReader(const std::string& filename);
+
+    bool error() const { return error_; }
+
+    /**
+     * Whether the image data is block compressed.
+     */
+    bool compressed() const { return compressed_; }
+
+    /**
+     * The GL internal format of the image data. For uncompressed data this
+     * is either GL_RGB or GL_RGBA, with GL_UNSIGNED_BYTE components.
+     */
+    GLenum internal_format() const { return internal_format_; }
+
+    unsigned int width() const { return width_; }
+    unsigned int height() const { return height_; }
+    unsigned int num_levels() const { return levels_.size(); }
+    const Level& level(unsigned int i) const { return levels_[i]; }
+
+private:
+    bool init(const std::string& filename);
+    bool parse_ktx1();
+    bool parse_ktx2();
+    bool add_level(unsigned int index, size_t offset, size_t size);
+
+    std::vector<unsigned char> data_;
+    std::vector<Level> levels_;
+    GLenum internal_format_;
+    unsigned int width_;
+    unsigned int height_;
+    bool compressed_;
+    bool error_;
+};
+
+#endif
@@ -0,0 +1,431 @@
+//
+// All rights reserved. This program and the accompanying materials
+// are made available under the terms of the MIT License which accompanies
+// this distribution, and is available at
+// http://www.opensource.org/licenses/mit-license.php
+//
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <zlib.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "asset-archive.h"
+#include "log.h"
+#include "util.h"
+
+using std::string;
+using std::vector;
+
+const char AssetArchive::magic[8] = { 'G', 'P', 'U', 'P', 'A', 'C', 'K', '\0' };
+
+namespace
+{
+
+struct MountedArchive
+{
+    MountedArchive() :
+        data(0), size(0), header(0), entries(0), names(0) {}
+
+    const char* data;
+    size_t size;
+    string root;
+    const AssetArchive::Header* header;
+    const AssetArchive::Entry* entries;
+    const char* names;
+
+    // Inflated compressed entries, by entry index
+    std::map<uint32_t, string> inflated;
+    std::mutex mutex;
+
+#ifdef _WIN32
+    vector<char> buffer;
+#endif
+};
+
+MountedArchive archive;
+
+//
+// Maps a file, setting the archive data and size.
+//
+bool
+map_file(const string& filename)
+{
+#ifdef _WIN32
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    if (!ifs)
+        return false;
+
+    archive.buffer.assign(std::istreambuf_iterator<char>(ifs),
+                          std::istreambuf_iterator<char>());
+    archive.data = archive.buffer.empty() ? 0 : &archive.buffer[0];
+    archive.size = archive.buffer.size();
+    return archive.data != 0;
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* addr = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        addr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED)
+        return false;
+
+    archive.data = static_cast<const char*>(addr);
+    archive.size = st.st_size;
+    return true;
+#endif
+}
+
+void
+unmap_file()
+{
+#ifdef _WIN32
+    vector<char>().swap(archive.buffer);
+#else
+    if (archive.data)
+        munmap(const_cast<char*>(archive.data), archive.size);
+#endif
+    archive.data = 0;
+    archive.size = 0;
+}
+
+//
+// Checks that all the offsets in the index are within the archive, and that
+// the entries are sorted, so lookups can't read outside the mapping.
+//
+bool
+validate_index(const string& filename)
+{
+    if (archive.size < sizeof(AssetArchive::Header))
+        return false;
+
+    const AssetArchive::Header* header =
+        reinterpret_cast<const AssetArchive::Header*>(archive.data);
+
+    if (memcmp(header->magic, AssetArchive::magic, sizeof(AssetArchive::magic)))
+        return false;
+
+    uint32_t swapped_version = ((AssetArchive::version & 0xff) << 24) |
+                               ((AssetArchive::version & 0xff00) << 8) |
+                               ((AssetArchive::version >> 8) & 0xff00) |
+                               (AssetArchive::version >> 24);
+
+    if (header->version == swapped_version) {
+        Log::error("Asset archive %s was written on a host of the other byte order\n",
+                   filename.c_str());
+        return false;
+    }
+
+    if (header->version != AssetArchive::version)
+        return false;
+
+    uint64_t index_size = sizeof(AssetArchive::Header) +
+                          static_cast<uint64_t>(header->count) * sizeof(AssetArchive::Entry) +
+                          header->names_size;
+    if (index_size > archive.size)
+        return false;
+
+    const AssetArchive::Entry* entries =
+        reinterpret_cast<const AssetArchive::Entry*>(header + 1);
+    const char* names = reinterpret_cast<const char*>(entries + header->count);
+
+    if (header->count > 0 &&
+        (header->names_size == 0 || names[header->names_size - 1] != '\0'))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->count; i++) {
+        const AssetArchive::Entry& entry(entries[i]);
+
+        if (entry.name >= header->names_size ||
+            entry.offset > archive.size ||
+            entry.stored_size > archive.size - entry.offset)
+        {
+            return false;
+        }
+
+        if (!(entry.flags & AssetArchive::EntryCompressed) &&
+            entry.stored_size != entry.size)
+        {
+            return false;
+        }
+
+        if (i > 0 && strcmp(names + entries[i - 1].name, names + entry.name) >= 0)
+            return false;
+    }
+
+    archive.header = header;
+    archive.entries = entries;
+    archive.names = names;
+
+    return true;
+}
+
+//
+// Gets the path of a file relative to the mount root, returning false if
+// the file is not under the root.
+//
+bool
+relative_path(const string& path, string& rel)
+{
+    if (!archive.header || path.compare(0, archive.root.size(), archive.root) != 0)
+        return false;
+
+    size_t start = archive.root.size();
+
+    // Don't match "/a/bc" against the root "/a/b"
+    if (!archive.root.empty() && start < path.size() && path[start] != '/')
+        return false;
+
+    while (start < path.size() && path[start] == '/')
+        start++;
+
+    rel = path.substr(start);
+
+    return true;
+}
+
+struct EntryNameLess
+{
+    bool operator()(const AssetArchive::Entry& entry, const char* name) const
+    {
+        return strcmp(archive.names + entry.name, name) < 0;
+    }
+};
+
+const AssetArchive::Entry*
+lower_bound(const string& name)
+{
+    const AssetArchive::Entry* end = archive.entries + archive.header->count;
+
+    return std::lower_bound(archive.entries, end, name.c_str(), EntryNameLess());
+}
+
+}
+
+bool
+AssetArchive::mount(const string& filename, const string& root)
+{
+    unmount();
+
+    if (!map_file(filename)) {
+        Log::debug("Couldn't map asset archive %s\n", filename.c_str());
+        unmap_file();
+        return false;
+    }
+
+    if (!validate_index(filename)) {
+        Log::error("%s is not a valid asset archive\n", filename.c_str());
+        unmap_file();
+        return false;
+    }
+
+    archive.root = root;
+    while (!archive.root.empty() && archive.root[archive.root.size() - 1] == '/')
+        archive.root.erase(archive.root.size() - 1);
+
+    Log::debug("Mounted asset archive %s with %u files\n",
+               filename.c_str(), archive.header->count);
+
+    return true;
+}
+
+void
+AssetArchive::unmount()
+{
+    std::lock_guard<std::mutex> lock(archive.mutex);
+
+    archive.inflated.clear();
+    archive.header = 0;
+    archive.entries = 0;
+    archive.names = 0;
+    archive.root.clear();
+    unmap_file();
+}
+
+bool
+AssetArchive::mounted()
+{
+    return archive.header != 0;
+}
+
+bool
+AssetArchive::find(const string& path, const char*& data, size_t& size)
+{
+    string rel;
+    if (!relative_path(path, rel))
+        return false;
+
+    const Entry* entry = lower_bound(rel);
+    if (entry == archive.entries + archive.header->count ||
+        rel != archive.names + entry->name)
+    {
+        return false;
+    }
+
+    if (!(entry->flags & EntryCompressed)) {
+        data = archive.data + entry->offset;
+        size = entry->size;
+        return true;
+    }
+
+    // Entries can be looked up concurrently, e.g. by texture decoding threads
+    std::lock_guard<std::mutex> lock(archive.mutex);
+    uint32_t index = entry - archive.entries;
+    std::map<uint32_t, string>::iterator iter = archive.inflated.find(index);
+
+    if (iter == archive.inflated.end()) {
+        string inflated(entry->size, '\0');
+        uLongf inflated_size = entry->size;
+
+        if (uncompress(reinterpret_cast<Bytef*>(&inflated[0]), &inflated_size,
+                       reinterpret_cast<const Bytef*>(archive.data + entry->offset),
+                       entry->stored_size) != Z_OK ||
+            inflated_size != entry->size)
+        {
+            Log::error("Failed to inflate %s from the asset archive\n", path.c_str());
+            return false;
+        }
+
+        iter = archive.inflated.insert(std::make_pair(index, inflated)).first;
+    }
+
+    data = iter->second.data();
+    size = iter->second.size();
+
+    return true;
+}
+
+bool
+AssetArchive::list(const string& dirName, vector<string>& fileVec)
+{
+    string rel;
+    if (!relative_path(dirName, rel))
+        return false;
+
+    string prefix(rel.empty() ? rel : rel + "/");
+    const Entry* end = archive.entries + archive.header->count;
+    string last;
+    bool found = false;
+
+    for (const Entry* entry = lower_bound(prefix); entry != end; entry++) {
+        const char* name = archive.names + entry->name;
+        if (strncmp(name, prefix.c_str(), prefix.size()) != 0)
+            break;
+
+        // Report files in subdirectories once, as the subdirectory
+        string component(name + prefix.size());
+        component = component.substr(0, component.find('/'));
+
+        if (!found || component != last)
+            fileVec.push_back(dirName + "/" + component);
+
+        last = component;
+        found = true;
+    }
+
+    return found;
+}
+
+void
+AssetArchiveWriter::add(const string& name, const string& data, bool compress)
+{
+    File file;
+    file.name = name;
+    file.data = data;
+    file.size = data.size();
+    file.compressed = false;
+
+    if (compress && !data.empty()) {
+        uLongf compressed_size = compressBound(data.size());
+        string compressed(compressed_size, '\0');
+
+        if (compress2(reinterpret_cast<Bytef*>(&compressed[0]), &compressed_size,
+                      reinterpret_cast<const Bytef*>(data.data()), data.size(),
+                      Z_BEST_COMPRESSION) == Z_OK &&
+            compressed_size <= data.size() - data.size() / 8)
+        {
+            compressed.resize(compressed_size);
+            file.data.swap(compressed);
+            file.compressed = true;
+        }
+    }
+
+    files_.push_back(file);
+}
+
+bool
+AssetArchiveWriter::write(const string& filename) const
+{
+    vector<const File*> files;
+    for (vector<File>::const_iterator iter = files_.begin(); iter != files_.end(); iter++)
+        files.push_back(&*iter);
+
+    std::sort(files.begin(), files.end(),
+              [](const File* a, const File* b) { return a->name < b->name; });
+
+    AssetArchive::Header header;
+    vector<AssetArchive::Entry> entries(files.size());
+    string names;
+
+    memcpy(header.magic, AssetArchive::magic, sizeof(header.magic));
+    header.version = AssetArchive::version;
+    header.count = files.size();
+    header.alignment = alignment_;
+
+    for (unsigned int i = 0; i < files.size(); i++) {
+        if (i > 0 && files[i]->name == files[i - 1]->name) {
+            Log::error("Duplicate asset archive entry %s\n", files[i]->name.c_str());
+            return false;
+        }
+
+        entries[i].name = names.size();
+        names += files[i]->name;
+        names += '\0';
+    }
+
+    header.names_size = names.size();
+
+    uint64_t offset = sizeof(header) + entries.size() * sizeof(AssetArchive::Entry) +
+                      names.size();
+
+    for (unsigned int i = 0; i < files.size(); i++) {
+        offset = (offset + alignment_ - 1) / alignment_ * alignment_;
+        entries[i].offset = offset;
+        entries[i].size = files[i]->size;
+        entries[i].stored_size = files[i]->data.size();
+        entries[i].flags = files[i]->compressed ? AssetArchive::EntryCompressed : 0;
+        offset += files[i]->data.size();
+    }
+
+    std::ofstream os(filename.c_str(), std::ios::binary);
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!entries.empty())
+        os.write(reinterpret_cast<const char*>(&entries[0]),
+                 entries.size() * sizeof(AssetArchive::Entry));
+    os.write(names.data(), names.size());
+
+    for (unsigned int i = 0; i < files.size(); i++) {
+        string padding(entries[i].offset - static_cast<uint64_t>(os.tellp()), '\0');
+        os.write(padding.data(), padding.size());
+        os.write(files[i]->data.data(), files[i]->data.size());
+    }
+
+    return os.good();
+}
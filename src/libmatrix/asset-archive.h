@@ -0,0 +1,131 @@
+//
+// All rights reserved. This program and the accompanying materials
+// are made available under the terms of the MIT License which accompanies
+// this distribution, and is available at
+// http://www.opensource.org/licenses/mit-license.php
+//
+#ifndef ASSET_ARCHIVE_H_
+#define ASSET_ARCHIVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//
+// A packed archive of the data files, memory mapped as a whole.
+//
+// The layout is a Header, followed by Header::count Entry records sorted by
+// name, the NUL-terminated entry names (referenced by Entry::name) and the
+// entry payloads, each starting at a multiple of Header::alignment from the
+// start of the archive.  The fields are in the byte order of the host that
+// wrote the archive, so that the index can be used in place; an archive
+// written on a host of the other byte order is recognized by its byte
+// swapped Header::version and rejected.  Payloads are stored as is or, with
+// EntryCompressed, as a zlib stream of Entry::size bytes once inflated.
+//
+// When an archive is mounted, Util::get_resource(), Util::list_files() and
+// ShaderSource::load_file() look up paths under the mount root in the
+// archive before the filesystem.  Stored entries are returned as spans of
+// the mapping, so reading them neither opens a file nor copies the data.
+// Compressed entries are inflated on first use and kept until unmount().
+//
+class AssetArchive
+{
+public:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+        uint32_t names_size;
+        uint32_t alignment;
+    };
+
+    struct Entry
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t stored_size;
+        uint32_t name;
+        uint32_t flags;
+    };
+
+    enum EntryFlags {
+        EntryCompressed = 1
+    };
+
+    static const char magic[8];
+    static const uint32_t version = 1;
+
+    //
+    // mount() - Maps an archive and makes its entries available.
+    //
+    // @filename:   the archive file
+    // @root:       the path the archive entries are relative to
+    //
+    // Replaces any previously mounted archive.  Returns whether the archive
+    // was mounted.
+    //
+    static bool mount(const std::string& filename, const std::string& root);
+    // Unmounts the archive, invalidating all the spans it returned.
+    static void unmount();
+    static bool mounted();
+
+    //
+    // find() - Looks up a file in the mounted archive.
+    //
+    // @path:       the path of the file, including the mount root
+    // @data:       set to the contents of the file
+    // @size:       set to the size of the file
+    //
+    // The contents stay valid until the archive is unmounted.  Returns
+    // whether the file was found.
+    //
+    static bool find(const std::string& path, const char*& data, size_t& size);
+
+    //
+    // list() - Lists a directory of the mounted archive.
+    //
+    // @dirName:    the directory path, including the mount root
+    // @fileVec:    the string vector to append the paths of the files and
+    //              subdirectories to
+    //
+    // Returns whether the directory is in the archive.
+    //
+    static bool list(const std::string& dirName, std::vector<std::string>& fileVec);
+};
+
+//
+// Builds an archive in memory and writes it out.
+//
+class AssetArchiveWriter
+{
+public:
+    AssetArchiveWriter(unsigned int alignment = 64) : alignment_(alignment) {}
+
+    //
+    // add() - Adds a file to the archive.
+    //
+    // @name:       the path of the file, relative to the archive root
+    // @data:       the contents of the file
+    // @compress:   whether to try storing the file compressed; it is only
+    //              compressed if that saves at least an eighth of its size
+    //
+    void add(const std::string& name, const std::string& data, bool compress);
+    bool write(const std::string& filename) const;
+
+private:
+    struct File
+    {
+        std::string name;
+        std::string data;
+        uint64_t size;
+        bool compressed;
+    };
+
+    unsigned int alignment_;
+    std::vector<File> files_;
+};
+
+#endif // ASSET_ARCHIVE_H_
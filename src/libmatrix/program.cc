@@ -223,6 +223,68 @@ Program::build()
     ready_ = true;
 }
 
+void
+Program::setBinaryRetrievable()
+{
+    if (!valid_ || !GLExtensions::ProgramParameteri)
+    {
+        return;
+    }
+
+    GLExtensions::ProgramParameteri(handle_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                    GL_TRUE);
+}
+
+bool
+Program::getBinary(unsigned int& format, std::vector<unsigned char>& binary)
+{
+    if (!valid_ || !ready_ || !GLExtensions::GetProgramBinary)
+    {
+        return false;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(handle_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return false;
+    }
+
+    binary.resize(length);
+    GLsizei written = 0;
+    GLenum binaryFormat = 0;
+    GLExtensions::GetProgramBinary(handle_, length, &written, &binaryFormat,
+                                   &binary[0]);
+    if (written <= 0)
+    {
+        binary.clear();
+        return false;
+    }
+
+    binary.resize(written);
+    format = binaryFormat;
+    return true;
+}
+
+void
+Program::loadBinary(unsigned int format, const std::vector<unsigned char>& binary)
+{
+    if (!valid_ || ready_ || binary.empty() || !GLExtensions::ProgramBinary)
+    {
+        return;
+    }
+
+    GLExtensions::ProgramBinary(handle_, format, &binary[0], binary.size());
+    GLint param = 0;
+    glGetProgramiv(handle_, GL_LINK_STATUS, &param);
+    if (param == GL_FALSE)
+    {
+        message_ = string("The program binary was rejected");
+        return;
+    }
+    ready_ = true;
+}
+
 void
 Program::start()
 {
@@ -107,6 +107,30 @@ public:
     // has been successfully added before calling this one.
     void build();
 
+    // Hint that the binary of the program will be retrieved with
+    // getBinary() (see GL_ARB_get_program_binary).  Desktop GL may not
+    // keep the binary around otherwise.
+    //
+    // Make sure the program is "valid" before calling this one, and call
+    // it before build().
+    void setBinaryRetrievable();
+
+    // Retrieve the binary of a built program (see GL_OES_get_program_binary),
+    // so that it can be loaded with loadBinary() in a later run.
+    //
+    // Returns false if the program isn't "ready" or program binaries are
+    // not supported.
+    bool getBinary(unsigned int& format, std::vector<unsigned char>& binary);
+
+    // Load a program from a binary retrieved with getBinary(), instead of
+    // adding shaders and building it.
+    //
+    // Make sure the program is "valid" and has no shaders before calling
+    // this one.  If the binary is rejected (e.g. after a driver update) the
+    // program is not "ready", but stays "valid", so shaders can still be
+    // added and built as usual.
+    void loadBinary(unsigned int format, const std::vector<unsigned char>& binary);
+
     // Bind the program for use by the rendering context (i.e. actually
     // run it).
     //
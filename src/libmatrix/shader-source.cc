@@ -14,6 +14,7 @@
 #include <memory>
 
 #include "shader-source.h"
+#include "asset-archive.h"
 #include "log.h"
 #include "vec.h"
 #include "util.h"
@@ -64,6 +65,18 @@ ShaderSource::default_precision_(ShaderSource::ShaderTypeUnknown + 1);
 bool
 ShaderSource::load_file(const std::string& filename, std::string& str)
 {
+    const char *data;
+    size_t size;
+
+    /* Files in the asset archive are used in place, without a stream */
+    if (AssetArchive::find(filename, data, size))
+    {
+        str.append(data, size);
+        if (size > 0 && data[size - 1] != '\n')
+            str += '\n';
+        return true;
+    }
+
     std::unique_ptr<std::istream> is_ptr(Util::get_resource(filename));
     std::istream& inputFile(*is_ptr);
 
@@ -398,6 +411,21 @@ ShaderSource::add_array(const std::string &name, std::vector<float> &array,
     add(decl, decl_function);
 }
 
+/**
+ * Sets the GLSL version of the shader source.
+ *
+ * The #version directive must come before anything else in the shader,
+ * so it is emitted at the very start of the final string, before the
+ * precision statements.
+ *
+ * @param version the version, e.g. "310 es"
+ */
+void
+ShaderSource::version(const std::string &version)
+{
+    version_ = version;
+}
+
 /**
  * Gets the ShaderType for this ShaderSource.
  *
@@ -517,7 +545,11 @@ ShaderSource::str()
         precision_str.insert(precision_str.size(), "#endif\n");
     }
 
-    return precision_macros_ss.str() + precision_str + source_.str();
+    std::string version_str;
+    if (!version_.empty())
+        version_str = "#version " + version_ + "\n";
+
+    return version_str + precision_macros_ss.str() + precision_str + source_.str();
 }
 
 /**
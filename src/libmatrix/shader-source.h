@@ -58,6 +58,8 @@ public:
                    const std::string &init_function,
                    const std::string &decl_function = "");
 
+    void version(const std::string &version);
+
     ShaderType type();
     std::string str();
 
@@ -95,6 +97,7 @@ private:
                         const std::string& type_str);
 
     std::stringstream source_;
+    std::string version_;
     Precision precision_;
     bool precision_has_been_set_;
     ShaderType type_;
@@ -0,0 +1,421 @@
+//
+// All rights reserved. This program and the accompanying materials
+// are made available under the terms of the MIT License which accompanies
+// this distribution, and is available at
+// http://www.opensource.org/licenses/mit-license.php
+//
+#include <algorithm>
+#include <math.h>
+#include <thread>
+#include "tangent-space.h"
+#include "vec.h"
+
+namespace LibMatrix
+{
+
+// Minimum number of items (faces or vertices) worth handing to a thread.
+static const unsigned int min_items_per_thread = 4096;
+// Number of faces processed per gather/compute block in compute_faces().
+static const unsigned int face_block_size = 64;
+
+//
+// Runs func(first, last) over [0, count) split into contiguous ranges, one
+// per thread. The calling thread processes the last range itself.
+//
+static unsigned int
+thread_count(unsigned int count, unsigned int nthreads)
+{
+    if (nthreads > count / min_items_per_thread)
+        nthreads = count / min_items_per_thread;
+    if (nthreads < 1)
+        nthreads = 1;
+
+    return nthreads;
+}
+
+template <typename Func> static void
+parallel_ranges(unsigned int count, unsigned int nthreads, Func func)
+{
+    nthreads = thread_count(count, nthreads);
+
+    std::vector<std::thread> threads;
+    unsigned int chunk = count / nthreads;
+    unsigned int first = 0;
+
+    for (unsigned int i = 0; i < nthreads - 1; i++) {
+        threads.push_back(std::thread(func, first, first + chunk));
+        first += chunk;
+    }
+
+    func(first, count);
+
+    for (unsigned int i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+void
+TangentSpace::resize(unsigned int nvertices)
+{
+    std::vector<float>* arrays[] = {
+        &px, &py, &pz, &tu, &tv, &nx, &ny, &nz, &tx, &ty, &tz, &bx, &by, &bz
+    };
+
+    for (unsigned int i = 0; i < sizeof(arrays) / sizeof(*arrays); i++)
+        arrays[i]->resize(nvertices, 0.0f);
+}
+
+void
+TangentSpace::compute_reference()
+{
+    unsigned int nfaces = indices.size() / 3;
+
+    for (unsigned int f = 0; f < nfaces; f++) {
+        unsigned int ia = indices[3 * f];
+        unsigned int ib = indices[3 * f + 1];
+        unsigned int ic = indices[3 * f + 2];
+        vec3 av(px[ia], py[ia], pz[ia]);
+        vec3 bv(px[ib], py[ib], pz[ib]);
+        vec3 cv(px[ic], py[ic], pz[ic]);
+        vec2 at(tu[ia], tv[ia]);
+        vec2 bt(tu[ib], tv[ib]);
+        vec2 ct(tu[ic], tv[ic]);
+
+        /* Calculate normal */
+        vec3 n(vec3::cross(bv - av, cv - av));
+        n.normalize();
+
+        vec3 q1(bv - av);
+        vec3 q2(cv - av);
+        vec2 u1(bt - at);
+        vec2 u2(ct - at);
+        float det = (u1.x() * u2.y() - u2.x() * u1.y());
+
+        /* Calculate tangent */
+        vec3 nt;
+        nt.x(det * (u2.y() * q1.x() - u1.y() * q2.x()));
+        nt.y(det * (u2.y() * q1.y() - u1.y() * q2.y()));
+        nt.z(det * (u2.y() * q1.z() - u1.y() * q2.z()));
+        nt.normalize();
+
+        /* Calculate bitangent */
+        vec3 nb;
+        nb.x(det * (u1.x() * q2.x() - u2.x() * q1.x()));
+        nb.y(det * (u1.x() * q2.y() - u2.x() * q1.y()));
+        nb.z(det * (u1.x() * q2.z() - u2.x() * q1.z()));
+        nb.normalize();
+
+        unsigned int idx[3] = { ia, ib, ic };
+        for (unsigned int i = 0; i < 3; i++) {
+            unsigned int v = idx[i];
+            nx[v] += n.x(); ny[v] += n.y(); nz[v] += n.z();
+            tx[v] += nt.x(); ty[v] += nt.y(); tz[v] += nt.z();
+            bx[v] += nb.x(); by[v] += nb.y(); bz[v] += nb.z();
+        }
+    }
+
+    for (unsigned int v = 0; v < size(); v++) {
+        vec3 n(nx[v], ny[v], nz[v]);
+        vec3 nt(tx[v], ty[v], tz[v]);
+        vec3 nb(bx[v], by[v], bz[v]);
+
+        /* Orthogonalize */
+        nt = (nt - n * vec3::dot(nt, n));
+        n.normalize();
+        nt.normalize();
+        nb.normalize();
+
+        nx[v] = n.x(); ny[v] = n.y(); nz[v] = n.z();
+        tx[v] = nt.x(); ty[v] = nt.y(); tz[v] = nt.z();
+        bx[v] = nb.x(); by[v] = nb.y(); bz[v] = nb.z();
+    }
+}
+
+/*
+ * Computes the normalized normal, tangent and bitangent of the count
+ * (at most face_block_size) faces from start, into out: nine rows of
+ * face_block_size floats, with the x, y and z of the normals, then of the
+ * tangents, then of the bitangents.
+ *
+ * The vertex data of the faces is first gathered into small contiguous
+ * arrays, so that the arithmetic loops that follow run over unit-stride
+ * data and can be vectorized by the compiler.  They always process a whole
+ * block (the rows past count are zero-filled and their results unused), and
+ * the square roots, which may set errno, are taken in a loop of their own.
+ */
+void
+TangentSpace::compute_face_block(unsigned int start, unsigned int count,
+                                 float* out) const
+{
+    float q1x[face_block_size], q1y[face_block_size], q1z[face_block_size];
+    float q2x[face_block_size], q2y[face_block_size], q2z[face_block_size];
+    float u1x[face_block_size], u1y[face_block_size];
+    float u2x[face_block_size], u2y[face_block_size];
+    /* The squared lengths, then the lengths of the normals, tangents and bitangents */
+    float lengths[3 * face_block_size];
+
+    /* Gather */
+    for (unsigned int i = 0; i < face_block_size; i++) {
+        if (i >= count) {
+            q1x[i] = q1y[i] = q1z[i] = q2x[i] = q2y[i] = q2z[i] = 0.0f;
+            u1x[i] = u1y[i] = u2x[i] = u2y[i] = 0.0f;
+            continue;
+        }
+
+        const unsigned int *face = &indices[3 * (start + i)];
+        unsigned int ia = face[0];
+        unsigned int ib = face[1];
+        unsigned int ic = face[2];
+        q1x[i] = px[ib] - px[ia];
+        q1y[i] = py[ib] - py[ia];
+        q1z[i] = pz[ib] - pz[ia];
+        q2x[i] = px[ic] - px[ia];
+        q2y[i] = py[ic] - py[ia];
+        q2z[i] = pz[ic] - pz[ia];
+        u1x[i] = tu[ib] - tu[ia];
+        u1y[i] = tv[ib] - tv[ia];
+        u2x[i] = tu[ic] - tu[ia];
+        u2y[i] = tv[ic] - tv[ia];
+    }
+
+    float *fnx = out, *fny = fnx + face_block_size, *fnz = fny + face_block_size;
+    float *ftx = fnz + face_block_size, *fty = ftx + face_block_size, *ftz = fty + face_block_size;
+    float *fbx = ftz + face_block_size, *fby = fbx + face_block_size, *fbz = fby + face_block_size;
+    float *nl = lengths, *tl = nl + face_block_size, *bl = tl + face_block_size;
+
+    /* Compute */
+    for (unsigned int i = 0; i < face_block_size; i++) {
+        float n0 = q1y[i] * q2z[i] - q1z[i] * q2y[i];
+        float n1 = q1z[i] * q2x[i] - q1x[i] * q2z[i];
+        float n2 = q1x[i] * q2y[i] - q1y[i] * q2x[i];
+        fnx[i] = n0;
+        fny[i] = n1;
+        fnz[i] = n2;
+        nl[i] = n0 * n0 + n1 * n1 + n2 * n2;
+
+        float det = u1x[i] * u2y[i] - u2x[i] * u1y[i];
+
+        float t0 = det * (u2y[i] * q1x[i] - u1y[i] * q2x[i]);
+        float t1 = det * (u2y[i] * q1y[i] - u1y[i] * q2y[i]);
+        float t2 = det * (u2y[i] * q1z[i] - u1y[i] * q2z[i]);
+        ftx[i] = t0;
+        fty[i] = t1;
+        ftz[i] = t2;
+        tl[i] = t0 * t0 + t1 * t1 + t2 * t2;
+
+        float b0 = det * (u1x[i] * q2x[i] - u2x[i] * q1x[i]);
+        float b1 = det * (u1x[i] * q2y[i] - u2x[i] * q1y[i]);
+        float b2 = det * (u1x[i] * q2z[i] - u2x[i] * q1z[i]);
+        fbx[i] = b0;
+        fby[i] = b1;
+        fbz[i] = b2;
+        bl[i] = b0 * b0 + b1 * b1 + b2 * b2;
+    }
+
+    for (unsigned int i = 0; i < 3 * face_block_size; i++)
+        lengths[i] = sqrtf(lengths[i]);
+
+    /* Normalize */
+    for (unsigned int i = 0; i < face_block_size; i++) {
+        fnx[i] /= nl[i];
+        fny[i] /= nl[i];
+        fnz[i] /= nl[i];
+        ftx[i] /= tl[i];
+        fty[i] /= tl[i];
+        ftz[i] /= tl[i];
+        fbx[i] /= bl[i];
+        fby[i] /= bl[i];
+        fbz[i] /= bl[i];
+    }
+}
+
+/*
+ * Computes the face vectors of faces [first, last) into the per-face arrays.
+ */
+void
+TangentSpace::compute_faces(unsigned int first, unsigned int last)
+{
+    float block[9 * face_block_size];
+    float *rows[9] = {
+        &fnx_[0], &fny_[0], &fnz_[0], &ftx_[0], &fty_[0], &ftz_[0],
+        &fbx_[0], &fby_[0], &fbz_[0]
+    };
+
+    for (unsigned int start = first; start < last; start += face_block_size) {
+        unsigned int count = last - start;
+        if (count > face_block_size)
+            count = face_block_size;
+
+        compute_face_block(start, count, block);
+
+        for (unsigned int k = 0; k < 9; k++) {
+            const float *row = &block[k * face_block_size];
+            std::copy(row, row + count, rows[k] + start);
+        }
+    }
+}
+
+/*
+ * Builds the vertex to face adjacency lists. The faces of each vertex are
+ * stored in increasing face order (a face referencing a vertex more than once
+ * appears multiple times), which keeps the gather summation order identical
+ * to the serial scatter.
+ */
+void
+TangentSpace::build_adjacency()
+{
+    unsigned int nvertices = size();
+
+    adj_start_.assign(nvertices + 1, 0);
+    adj_faces_.resize(indices.size());
+
+    for (unsigned int i = 0; i < indices.size(); i++)
+        adj_start_[indices[i] + 1]++;
+
+    for (unsigned int v = 0; v < nvertices; v++)
+        adj_start_[v + 1] += adj_start_[v];
+
+    std::vector<unsigned int> cursor(adj_start_.begin(), adj_start_.end() - 1);
+
+    for (unsigned int i = 0; i < indices.size(); i++)
+        adj_faces_[cursor[indices[i]]++] = i / 3;
+}
+
+/*
+ * Accumulates the face vectors of vertices [first, last), then
+ * orthogonalizes and normalizes the results.
+ */
+void
+TangentSpace::gather_vertices(unsigned int first, unsigned int last)
+{
+    for (unsigned int v = first; v < last; v++) {
+        float n0 = nx[v], n1 = ny[v], n2 = nz[v];
+        float t0 = tx[v], t1 = ty[v], t2 = tz[v];
+        float b0 = bx[v], b1 = by[v], b2 = bz[v];
+
+        for (unsigned int k = adj_start_[v]; k < adj_start_[v + 1]; k++) {
+            unsigned int f = adj_faces_[k];
+            n0 += fnx_[f]; n1 += fny_[f]; n2 += fnz_[f];
+            t0 += ftx_[f]; t1 += fty_[f]; t2 += ftz_[f];
+            b0 += fbx_[f]; b1 += fby_[f]; b2 += fbz_[f];
+        }
+
+        nx[v] = n0; ny[v] = n1; nz[v] = n2;
+        tx[v] = t0; ty[v] = t1; tz[v] = t2;
+        bx[v] = b0; by[v] = b1; bz[v] = b2;
+    }
+
+    normalize_vertices(first, last);
+}
+
+/*
+ * Orthogonalizes the tangents against the normals and normalizes all the
+ * vectors of vertices [first, last).
+ */
+void
+TangentSpace::normalize_vertices(unsigned int first, unsigned int last)
+{
+    float *vnx = &nx[0], *vny = &ny[0], *vnz = &nz[0];
+    float *vtx = &tx[0], *vty = &ty[0], *vtz = &tz[0];
+    float *vbx = &bx[0], *vby = &by[0], *vbz = &bz[0];
+
+    for (unsigned int v = first; v < last; v++) {
+        float n0 = vnx[v], n1 = vny[v], n2 = vnz[v];
+
+        /* Orthogonalize */
+        float d = vtx[v] * n0 + vty[v] * n1 + vtz[v] * n2;
+        float t0 = vtx[v] - n0 * d;
+        float t1 = vty[v] - n1 * d;
+        float t2 = vtz[v] - n2 * d;
+
+        float nl = sqrtf(n0 * n0 + n1 * n1 + n2 * n2);
+        vnx[v] = n0 / nl;
+        vny[v] = n1 / nl;
+        vnz[v] = n2 / nl;
+
+        float tl = sqrtf(t0 * t0 + t1 * t1 + t2 * t2);
+        vtx[v] = t0 / tl;
+        vty[v] = t1 / tl;
+        vtz[v] = t2 / tl;
+
+        float b0 = vbx[v], b1 = vby[v], b2 = vbz[v];
+        float bl = sqrtf(b0 * b0 + b1 * b1 + b2 * b2);
+        vbx[v] = b0 / bl;
+        vby[v] = b1 / bl;
+        vbz[v] = b2 / bl;
+    }
+}
+
+/*
+ * Single threaded compute(): the face vectors are computed a block at a time
+ * and scattered into the vertices right away, in face order, as
+ * compute_reference() does.  This needs neither the per-face arrays nor the
+ * adjacency lists of the threaded version.
+ */
+void
+TangentSpace::compute_serial()
+{
+    unsigned int nfaces = indices.size() / 3;
+    float block[9 * face_block_size];
+
+    for (unsigned int start = 0; start < nfaces; start += face_block_size) {
+        unsigned int count = nfaces - start;
+        if (count > face_block_size)
+            count = face_block_size;
+
+        compute_face_block(start, count, block);
+
+        const float *fnx = block, *fny = fnx + face_block_size, *fnz = fny + face_block_size;
+        const float *ftx = fnz + face_block_size, *fty = ftx + face_block_size, *ftz = fty + face_block_size;
+        const float *fbx = ftz + face_block_size, *fby = fbx + face_block_size, *fbz = fby + face_block_size;
+        const unsigned int *face = &indices[3 * start];
+        for (unsigned int i = 0; i < count; i++) {
+            for (unsigned int c = 0; c < 3; c++) {
+                unsigned int v = face[3 * i + c];
+                nx[v] += fnx[i]; ny[v] += fny[i]; nz[v] += fnz[i];
+                tx[v] += ftx[i]; ty[v] += fty[i]; tz[v] += ftz[i];
+                bx[v] += fbx[i]; by[v] += fby[i]; bz[v] += fbz[i];
+            }
+        }
+    }
+
+    normalize_vertices(0, size());
+}
+
+void
+TangentSpace::compute(unsigned int nthreads)
+{
+    unsigned int nfaces = indices.size() / 3;
+    unsigned int nvertices = size();
+
+    if (nvertices == 0)
+        return;
+
+    if (nthreads == 0)
+        nthreads = std::thread::hardware_concurrency();
+
+    if (thread_count(nfaces, nthreads) == 1) {
+        compute_serial();
+        return;
+    }
+
+    std::vector<float>* face_arrays[] = {
+        &fnx_, &fny_, &fnz_, &ftx_, &fty_, &ftz_, &fbx_, &fby_, &fbz_
+    };
+
+    for (unsigned int i = 0; i < sizeof(face_arrays) / sizeof(*face_arrays); i++)
+        face_arrays[i]->resize(nfaces);
+
+    parallel_ranges(nfaces, nthreads,
+                    [this](unsigned int first, unsigned int last) {
+                        compute_faces(first, last);
+                    });
+
+    build_adjacency();
+
+    parallel_ranges(nvertices, nthreads,
+                    [this](unsigned int first, unsigned int last) {
+                        gather_vertices(first, last);
+                    });
+}
+
+} // namespace LibMatrix
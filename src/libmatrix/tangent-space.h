@@ -0,0 +1,85 @@
+//
+// All rights reserved. This program and the accompanying materials
+// are made available under the terms of the MIT License which accompanies
+// this distribution, and is available at
+// http://www.opensource.org/licenses/mit-license.php
+//
+#ifndef TANGENT_SPACE_H_
+#define TANGENT_SPACE_H_
+
+#include <vector>
+
+namespace LibMatrix
+{
+
+//
+// Per-vertex normal, tangent and bitangent generation for indexed triangle
+// lists, using a structure-of-arrays layout.
+//
+// The caller fills in the position and texcoord arrays, the triangle
+// indices (3 per face) and the initial values of the normal, tangent and
+// bitangent arrays (usually zero).  compute() adds the contribution of every
+// face to the vertices it references, orthogonalizes the tangent against the
+// normal and normalizes all three vectors, in place.
+//
+// compute_reference() walks the faces serially and scatters into the
+// vertices in face order.  compute() computes the face vectors in blocks over
+// unit-stride data.  With a single thread it scatters each block into the
+// vertices in face order right away.  With more, it splits the work across
+// threads: face vectors are computed per face range, and each vertex then
+// gathers the vectors of its faces (via a vertex-to-face adjacency list) in
+// face order.
+// As the per-vertex summation order is the same, all methods produce
+// bit-identical results (as long as the compiler is not allowed to contract
+// or reassociate floating point operations).
+//
+class TangentSpace
+{
+public:
+    TangentSpace() {}
+    ~TangentSpace() {}
+
+    // Resizes all the per-vertex arrays, zero-filling the new elements.
+    void resize(unsigned int nvertices);
+    unsigned int size() const { return px.size(); }
+
+    // Serial, scatter-based implementation.
+    void compute_reference();
+    // Parallel, gather-based implementation. If nthreads is 0 the number of
+    // threads is picked automatically.
+    void compute(unsigned int nthreads = 0);
+
+    // Positions
+    std::vector<float> px, py, pz;
+    // Texcoords
+    std::vector<float> tu, tv;
+    // Normals
+    std::vector<float> nx, ny, nz;
+    // Tangents
+    std::vector<float> tx, ty, tz;
+    // Bitangents
+    std::vector<float> bx, by, bz;
+    // Triangle vertex indices, 3 per face
+    std::vector<unsigned int> indices;
+
+private:
+    // Per-face vectors, used by compute()
+    std::vector<float> fnx_, fny_, fnz_;
+    std::vector<float> ftx_, fty_, ftz_;
+    std::vector<float> fbx_, fby_, fbz_;
+    // Vertex to face adjacency (CSR), used by compute()
+    std::vector<unsigned int> adj_start_;
+    std::vector<unsigned int> adj_faces_;
+
+    void compute_face_block(unsigned int start, unsigned int count,
+                            float* out) const;
+    void compute_faces(unsigned int first, unsigned int last);
+    void gather_vertices(unsigned int first, unsigned int last);
+    void normalize_vertices(unsigned int first, unsigned int last);
+    void build_adjacency();
+    void compute_serial();
+};
+
+} // namespace LibMatrix
+
+#endif // TANGENT_SPACE_H_
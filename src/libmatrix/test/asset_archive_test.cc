@@ -0,0 +1,140 @@
+//
+// All rights reserved. This program and the accompanying materials
+// are made available under the terms of the MIT License which accompanies
+// this distribution, and is available at
+// http://www.opensource.org/licenses/mit-license.php
+//
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <unistd.h>
+#include "libmatrix_test.h"
+#include "asset_archive_test.h"
+#include "../asset-archive.h"
+#include "../shader-source.h"
+#include "../util.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+static bool
+readResource(const string& path, string& contents)
+{
+    std::unique_ptr<std::istream> is(Util::get_resource(path));
+    std::stringstream ss;
+
+    if (!*is)
+        return false;
+
+    ss << is->rdbuf();
+    contents = ss.str();
+
+    return true;
+}
+
+void
+AssetArchiveTestRoundTrip::run(const Options& options)
+{
+    // Compressible text, incompressible bytes and an empty file
+    string text;
+    for (unsigned int i = 0; i < 200; i++)
+        text += "gl_FragColor = vec4(1.0);\n";
+
+    string bytes;
+    for (unsigned int i = 0; i < 4096; i++)
+        bytes += static_cast<char>((i * 2654435761U) >> 24);
+
+    std::stringstream ss;
+    ss << "/tmp/libmatrix_test_" << getpid() << ".pak";
+    const string filename(ss.str());
+    const string root("/data/root");
+
+    AssetArchiveWriter writer(16);
+    writer.add("shaders/test.frag", text, true);
+    writer.add("textures/noise.raw", bytes, true);
+    writer.add("models/empty.obj", "", true);
+    writer.add("models/extras/cube.obj", "v 0 0 0", false);
+
+    if (!writer.write(filename) || !AssetArchive::mount(filename, root + "/"))
+    {
+        cout << "Failed to create the archive" << endl;
+        remove(filename.c_str());
+        return;
+    }
+
+    // The mapping stays valid after the file is removed
+    remove(filename.c_str());
+
+    string contents;
+    const char* data;
+    size_t size;
+
+    if (!readResource(root + "/shaders/test.frag", contents) || contents != text ||
+        !readResource(root + "/textures/noise.raw", contents) || contents != bytes ||
+        !readResource(root + "/models/empty.obj", contents) || !contents.empty())
+    {
+        cout << "Archive contents don't match" << endl;
+        AssetArchive::unmount();
+        return;
+    }
+
+    // Stored entries are returned in place, and aligned
+    if (!AssetArchive::find(root + "/textures/noise.raw", data, size) ||
+        reinterpret_cast<uintptr_t>(data) % 16 != 0 ||
+        AssetArchive::find(root + "/shaders/test.vert", data, size) ||
+        AssetArchive::find("/data/rootless/shaders/test.frag", data, size))
+    {
+        cout << "Archive lookups are wrong" << endl;
+        AssetArchive::unmount();
+        return;
+    }
+
+    // Streams are seekable
+    std::unique_ptr<std::istream> is(Util::get_resource(root + "/textures/noise.raw"));
+    is->seekg(0, std::ios::end);
+    std::streampos end = is->tellg();
+    is->seekg(100);
+    char c = 0;
+    is->get(c);
+
+    if (end != static_cast<std::streampos>(bytes.size()) || c != bytes[100])
+    {
+        cout << "Archive streams can't seek" << endl;
+        AssetArchive::unmount();
+        return;
+    }
+
+    vector<string> files;
+    Util::list_files(root + "/models", files);
+
+    vector<string> expected;
+    expected.push_back(root + "/models/empty.obj");
+    expected.push_back(root + "/models/extras");
+
+    if (files != expected)
+    {
+        if (options.beVerbose())
+        {
+            for (unsigned int i = 0; i < files.size(); i++)
+                cout << "Listed " << files[i] << endl;
+        }
+        AssetArchive::unmount();
+        return;
+    }
+
+    ShaderSource source(root + "/shaders/test.frag");
+    AssetArchive::unmount();
+
+    if (source.str().find(text) == string::npos)
+    {
+        cout << "ShaderSource didn't load from the archive" << endl;
+        return;
+    }
+
+    pass_ = true;
+}
@@ -0,0 +1,20 @@
+//
+// All rights reserved. This program and the accompanying materials
+// are made available under the terms of the MIT License which accompanies
+// this distribution, and is available at
+// http://www.opensource.org/licenses/mit-license.php
+//
+#ifndef ASSET_ARCHIVE_TEST_H_
+#define ASSET_ARCHIVE_TEST_H_
+
+class MatrixTest;
+class Options;
+
+class AssetArchiveTestRoundTrip : public MatrixTest
+{
+public:
+    AssetArchiveTestRoundTrip() : MatrixTest("AssetArchive::round_trip") {}
+    virtual void run(const Options& options);
+};
+
+#endif // ASSET_ARCHIVE_TEST_H_
@@ -19,6 +19,8 @@
 #include "const_vec_test.h"
 #include "shader_source_test.h"
 #include "util_split_test.h"
+#include "tangent_space_test.h"
+#include "asset_archive_test.h"
 
 using std::cerr;
 using std::cout;
@@ -44,8 +46,11 @@ main(int argc, char** argv)
     testVec.push_back(new MatrixTest3x3Transpose());
     testVec.push_back(new MatrixTest4x4Transpose());
     testVec.push_back(new ShaderSourceBasic());
+    testVec.push_back(new ShaderSourceVersion());
     testVec.push_back(new UtilSplitTestNormal());
     testVec.push_back(new UtilSplitTestQuoted());
+    testVec.push_back(new TangentSpaceTestParallel());
+    testVec.push_back(new AssetArchiveTestRoundTrip());
 
     for (vector<MatrixTest*>::iterator testIt = testVec.begin();
          testIt != testVec.end();
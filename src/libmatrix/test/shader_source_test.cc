@@ -47,3 +47,19 @@ ShaderSourceAddConstGlobal::run(const Options& options)
     // Compare the output strings to confirm the results.
     pass_ = (src_shader.str() == result_shader.str());
 }
+
+void
+ShaderSourceVersion::run(const Options& options)
+{
+    static const string vtx_shader_filename("test/basic.vert");
+
+    ShaderSource vtx_source(vtx_shader_filename);
+    vtx_source.add_const("ConstantColor", vec4(1.0, 1.0, 1.0, 1.0));
+    vtx_source.version("310 es");
+
+    // The version directive must be the very first line.
+    string source(vtx_source.str());
+    pass_ = (source.find("#version 310 es\n") == 0 &&
+             source.find("#version", 1) == string::npos &&
+             source.find("ConstantColor") != string::npos);
+}
@@ -0,0 +1,126 @@
+//
+// All rights reserved. This program and the accompanying materials
+// are made available under the terms of the MIT License which accompanies
+// this distribution, and is available at
+// http://www.opensource.org/licenses/mit-license.php
+//
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <math.h>
+#include <stdint.h>
+#include "libmatrix_test.h"
+#include "tangent_space_test.h"
+#include "../tangent-space.h"
+#include "../util.h"
+
+using LibMatrix::TangentSpace;
+using std::cout;
+using std::endl;
+using std::vector;
+
+//
+// Creates a (slightly bumpy) UV sphere with rings x segments quads. Seam and
+// pole vertices are shared, so vertices accumulate contributions from a
+// varying number of faces.
+//
+static void
+make_sphere(TangentSpace& ts, unsigned int rings, unsigned int segments)
+{
+    ts.resize((rings + 1) * segments);
+
+    for (unsigned int r = 0; r <= rings; r++) {
+        float phi = M_PI * r / rings;
+        for (unsigned int s = 0; s < segments; s++) {
+            float theta = 2.0 * M_PI * s / segments;
+            float radius = 1.0 + 0.05 * sin(7.0 * theta) * sin(5.0 * phi);
+            unsigned int v = r * segments + s;
+            ts.px[v] = radius * sin(phi) * cos(theta);
+            ts.py[v] = radius * cos(phi);
+            ts.pz[v] = radius * sin(phi) * sin(theta);
+            ts.tu[v] = static_cast<float>(s) / segments;
+            ts.tv[v] = static_cast<float>(r) / rings;
+        }
+    }
+
+    for (unsigned int r = 0; r < rings; r++) {
+        for (unsigned int s = 0; s < segments; s++) {
+            unsigned int a = r * segments + s;
+            unsigned int b = r * segments + (s + 1) % segments;
+            unsigned int c = a + segments;
+            unsigned int d = b + segments;
+            unsigned int quad[6] = { a, c, b, b, c, d };
+            ts.indices.insert(ts.indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+static bool
+areArraysIdentical(const vector<float>& a, const vector<float>& b)
+{
+    return a.size() == b.size() &&
+           memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0;
+}
+
+static bool
+areIdentical(const TangentSpace& a, const TangentSpace& b)
+{
+    return areArraysIdentical(a.nx, b.nx) && areArraysIdentical(a.ny, b.ny) &&
+           areArraysIdentical(a.nz, b.nz) && areArraysIdentical(a.tx, b.tx) &&
+           areArraysIdentical(a.ty, b.ty) && areArraysIdentical(a.tz, b.tz) &&
+           areArraysIdentical(a.bx, b.bx) && areArraysIdentical(a.by, b.by) &&
+           areArraysIdentical(a.bz, b.bz);
+}
+
+void
+TangentSpaceTestParallel::run(const Options& options)
+{
+    static const unsigned int iterations = 5;
+    TangentSpace input;
+    make_sphere(input, 256, 512);
+
+    if (options.beVerbose())
+    {
+        cout << "Mesh: " << input.size() << " vertices, "
+             << input.indices.size() / 3 << " faces" << endl;
+    }
+
+    TangentSpace reference(input);
+    uint64_t start = Util::get_timestamp_us();
+    for (unsigned int i = 0; i < iterations; i++)
+    {
+        reference = input;
+        reference.compute_reference();
+    }
+    uint64_t reference_us = (Util::get_timestamp_us() - start) / iterations;
+
+    // Single threaded and automatic thread count
+    unsigned int thread_counts[2] = { 1, 0 };
+
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        TangentSpace parallel(input);
+        start = Util::get_timestamp_us();
+        for (unsigned int i = 0; i < iterations; i++)
+        {
+            parallel = input;
+            parallel.compute(thread_counts[t]);
+        }
+        uint64_t parallel_us = (Util::get_timestamp_us() - start) / iterations;
+
+        if (options.beVerbose())
+        {
+            cout << "reference: " << reference_us / 1000.0 << " ms, "
+                 << "parallel (threads=" << thread_counts[t] << "): "
+                 << parallel_us / 1000.0 << " ms" << endl;
+        }
+
+        if (!areIdentical(reference, parallel))
+        {
+            return;
+        }
+    }
+
+    pass_ = true;
+}
@@ -0,0 +1,20 @@
+//
+// All rights reserved. This program and the accompanying materials
+// are made available under the terms of the MIT License which accompanies
+// this distribution, and is available at
+// http://www.opensource.org/licenses/mit-license.php
+//
+#ifndef TANGENT_SPACE_TEST_H_
+#define TANGENT_SPACE_TEST_H_
+
+class MatrixTest;
+class Options;
+
+class TangentSpaceTestParallel : public MatrixTest
+{
+public:
+    TangentSpaceTestParallel() : MatrixTest("TangentSpace::parallel") {}
+    virtual void run(const Options& options);
+};
+
+#endif // TANGENT_SPACE_TEST_H_
@@ -19,12 +19,64 @@
 #include <dirent.h>
 #endif
 
+#include "asset-archive.h"
 #include "log.h"
 #include "util.h"
 
 using std::string;
 using std::vector;
 
+/*
+ * A read-only, seekable stream over memory owned by someone else, used for
+ * files in the asset archive.
+ */
+class MemoryStreamBuf : public std::streambuf
+{
+public:
+    MemoryStreamBuf(const char *data, size_t size)
+    {
+        char *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which)
+    {
+        if (!(which & std::ios_base::in))
+            return pos_type(off_type(-1));
+
+        off_type base = dir == std::ios_base::beg ? 0 :
+                        dir == std::ios_base::cur ? gptr() - eback() :
+                        egptr() - eback();
+
+        if (base + off < 0 || base + off > egptr() - eback())
+            return pos_type(off_type(-1));
+
+        setg(eback(), eback() + base + off, egptr());
+
+        return pos_type(base + off);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which)
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+class MemoryIStream : public std::istream
+{
+public:
+    MemoryIStream(const char *data, size_t size) :
+        std::istream(0), buf_(data, size)
+    {
+        rdbuf(&buf_);
+    }
+
+private:
+    MemoryStreamBuf buf_;
+};
+
 /*
  * State machine for bash-like quoted string escaping:
  *
@@ -245,6 +297,12 @@ Util::appname_from_path(const std::string& path)
 std::istream *
 Util::get_resource(const std::string &path)
 {
+    const char *data;
+    size_t size;
+
+    if (AssetArchive::find(path, data, size))
+        return new MemoryIStream(data, size);
+
     std::ifstream *ifs = new std::ifstream(path.c_str(), std::ios::binary);
 
     return static_cast<std::istream *>(ifs);
@@ -253,6 +311,9 @@ Util::get_resource(const std::string &path)
 void
 Util::list_files(const std::string& dirName, std::vector<std::string>& fileVec)
 {
+    if (AssetArchive::list(dirName, fileVec))
+        return;
+
     DIR* dir = opendir(dirName.c_str());
     if (!dir)
     {
@@ -294,6 +355,12 @@ Util::android_get_asset_manager()
 std::istream *
 Util::get_resource(const std::string &path)
 {
+    const char *data;
+    size_t size;
+
+    if (AssetArchive::find(path, data, size))
+        return new MemoryIStream(data, size);
+
     std::string path2(path);
     /* Remove leading '/' from path name, it confuses the AssetManager */
     if (path2.size() > 0 && path2[0] == '/')
@@ -318,6 +385,9 @@ Util::get_resource(const std::string &path)
 void
 Util::list_files(const std::string& dirName, std::vector<std::string>& fileVec)
 {
+    if (AssetArchive::list(dirName, fileVec))
+        return;
+
     AAssetManager *mgr(Util::android_get_asset_manager());
     std::string dir_name(dirName);
 
@@ -62,7 +62,8 @@ struct Util {
      * @path:       the path to the file
      *
      * Returns a pointer to an input stream, which must be deleted when no
-     * longer in use.
+     * longer in use.  Files in the mounted asset archive (see AssetArchive)
+     * are read in place from memory.
      */
     static std::istream *get_resource(const std::string &path);
     /**
@@ -72,7 +73,8 @@ struct Util {
      * @fileVec:    the string vector to populate.
      *
      * Obtains a list of the files in @dirName, and returns them in the string
-     * vector @fileVec.
+     * vector @fileVec.  Directories in the mounted asset archive are listed
+     * from its index.
      */
     static void list_files(const std::string& dirName, std::vector<std::string>& fileVec);
     /**
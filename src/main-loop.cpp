@@ -66,7 +66,9 @@ MainLoop::step()
             before_scene_setup();
             if (!Options::reuse_context)
                 canvas_.reset();
+            ProgramCache::reset_stats();
             scene_ = &(*bench_iter_)->setup_scene();
+            shader_stats_ = ProgramCache::stats();
             if (!scene_->running()) {
                 if (!scene_->supported(false))
                     scene_setup_status_ = SceneSetupStatusUnsupported;
@@ -100,6 +102,10 @@ MainLoop::step()
             benchmarks_run_++;
         }
         log_scene_result();
+        if (Options::shader_build_time)
+            log_shader_build_time();
+        if (scene_setup_status_ == SceneSetupStatusSuccess)
+            canvas_.log_samples(1000.0 / scene_->average_fps());
         scene_->statsStop();
         (*bench_iter_)->teardown_scene();
         scene_ = 0;
@@ -151,6 +157,17 @@ MainLoop::log_scene_result()
     }
 }
 
+/**
+ * Logs the time spent building the shader programs of the scene.
+ */
+void
+MainLoop::log_shader_build_time()
+{
+    Log::info("    Shader build: %.3f ms for %u programs (%u from cache)\n",
+              shader_stats_.build_us / 1000.0, shader_stats_.programs,
+              shader_stats_.hits);
+}
+
 void
 MainLoop::next_benchmark()
 {
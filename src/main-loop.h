@@ -4,6 +4,7 @@
 
 #include "canvas.h"
 #include "benchmark.h"
+#include "program-cache.h"
 #include "text-renderer.h"
 #include "vec.h"
 #include <vector>
@@ -71,12 +72,14 @@ protected:
         SceneSetupStatusUnsupported
     };
     void next_benchmark();
+    void log_shader_build_time();
     Canvas &canvas_;
     Scene *scene_;
     const std::vector<Benchmark *> &benchmarks_;
     unsigned int score_;
     unsigned int benchmarks_run_;
     SceneSetupStatus scene_setup_status_;
+    ProgramCache::Stats shader_stats_;
 
     std::vector<Benchmark *>::const_iterator bench_iter_;
 
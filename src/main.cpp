@@ -5,6 +5,7 @@
 #include "options.h"
 #include "log.h"
 #include "util.h"
+#include "asset-archive.h"
 #include "main-loop.h"
 #include "benchmark-collection.h"
 #include "scene-collection.h"
@@ -37,6 +38,29 @@ using std::vector;
 using std::map;
 using std::string;
 
+/*
+ * Mounts the data archive given with --data-archive, if any. Without it the
+ * data files are always read from the data path, so a stale archive can't
+ * shadow them.
+ */
+static bool
+mount_data_archive()
+{
+    if (Options::data_archive.empty())
+        return true;
+
+    if (!AssetArchive::mount(Options::data_archive, Options::data_path)) {
+        Log::error("Couldn't mount the data archive %s\n",
+                   Options::data_archive.c_str());
+        return false;
+    }
+
+    Log::info("Reading data files from the archive %s\n",
+              Options::data_archive.c_str());
+
+    return true;
+}
+
 static void
 list_scenes()
 {
@@ -137,6 +161,9 @@ main(int argc, char *argv[])
         return 0;
     }
 
+    if (!mount_data_archive())
+        return 1;
+
     /* Force 800x600 output for validation */
     if (Options::validate &&
         Options::size != std::pair<int,int>(800, 600))
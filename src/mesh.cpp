@@ -3,10 +3,13 @@
 #include "log.h"
 #include "gl-headers.h"
 
+#include <algorithm>
+#include <cstring>
+
 
 Mesh::Mesh() :
     vertex_size_(0), interleave_(false), vbo_update_method_(VBOUpdateMethodMap),
-    vbo_usage_(VBOUsageStatic)
+    vbo_usage_(VBOUsageStatic), vbo_ring_size_(3), vbo_ring_index_(0)
 {
 }
 
@@ -173,10 +176,52 @@ Mesh::vertices()
     return vertices_;
 }
 
+/**
+ * Whether a VBO update method is supported by the current GL context.
+ *
+ * VBOUpdateMethodMap needs glMapBuffer(), VBOUpdateMethodMapRange needs
+ * glMapBufferRange() and sync objects, and VBOUpdateMethodPersistent
+ * needs buffer storage as well.
+ *
+ * @param method the update method
+ *
+ * @return whether the method is supported
+ */
+bool
+Mesh::vbo_update_method_supported(Mesh::VBOUpdateMethod method)
+{
+    bool sync = GLExtensions::FenceSync && GLExtensions::ClientWaitSync &&
+                GLExtensions::DeleteSync;
+
+    switch (method) {
+        case VBOUpdateMethodMap:
+            return GLExtensions::MapBuffer && GLExtensions::UnmapBuffer;
+        case VBOUpdateMethodMapRange:
+            return GLExtensions::MapBufferRange && GLExtensions::UnmapBuffer && sync;
+        case VBOUpdateMethodPersistent:
+            return GLExtensions::MapBufferRange && GLExtensions::BufferStorage && sync;
+        default:
+            return true;
+    }
+}
+
 /**
  * Sets the VBO update method.
  *
- * The default value is VBOUpdateMethodMap.
+ * The methods are:
+ *  - VBOUpdateMethodMap: glMapBuffer() the whole buffer
+ *  - VBOUpdateMethodSubData: glBufferSubData() each updated range
+ *  - VBOUpdateMethodOrphan: respecify the whole buffer with glBufferData(),
+ *    so the driver can allocate new storage instead of waiting for the GPU
+ *  - VBOUpdateMethodMapRange: glMapBufferRange() the updated ranges of the
+ *    next segment of a ring without synchronization, guarded by fences
+ *  - VBOUpdateMethodPersistent: write the updated ranges through a
+ *    persistent, coherent mapping of a ring of segments, guarded by fences.
+ *    If the buffers can't be mapped, ::build_vbo() falls back to
+ *    VBOUpdateMethodMapRange.
+ *
+ * The method must be set before ::build_vbo(). The default value is
+ * VBOUpdateMethodMap.
  */
 void
 Mesh::vbo_update_method(Mesh::VBOUpdateMethod method)
@@ -197,6 +242,21 @@ Mesh::vbo_usage(Mesh::VBOUsage usage)
     vbo_usage_ = usage;
 }
 
+/**
+ * Sets the number of segments in the VBO rings used by the MapRange and
+ * Persistent update methods, i.e. how many frames can be in flight before
+ * an update waits for the GPU.
+ *
+ * The ring size takes effect in the next call to ::build_vbo().
+ *
+ * The default value is 3.
+ */
+void
+Mesh::vbo_ring_size(unsigned int size)
+{
+    vbo_ring_size_ = std::max(size, 1U);
+}
+
 /**
  * Sets the vertex attribute interleaving mode.
  *
@@ -299,46 +359,24 @@ Mesh::build_vbo()
     delete_array();
     build_array();
 
-    int nvertices = vertices_.size();
-
     attrib_data_ptr_.clear();
 
-    GLenum buffer_usage;
-    if (vbo_usage_ == Mesh::VBOUsageStream)
-        buffer_usage = GL_STREAM_DRAW;
-    else if (vbo_usage_ == Mesh::VBOUsageDynamic)
-        buffer_usage = GL_DYNAMIC_DRAW;
-    else /* if (vbo_usage_ == Mesh::VBOUsageStatic) */
-        buffer_usage = GL_STATIC_DRAW;
+    vbo_ring_index_ = 0;
+    vbo_ring_ranges_.clear();
+    vbo_fences_.assign(vbo_ring() ? vbo_ring_size_ : 0, GLsync(0));
 
     if (!interleave_) {
         /* Create a vbo for each attribute */
-        for (std::vector<std::pair<int, int> >::const_iterator ai = vertex_format_.begin();
-             ai != vertex_format_.end();
-             ai++)
-        {
-            float *data = vertex_arrays_[ai - vertex_format_.begin()];
-            GLuint vbo;
-
-            glGenBuffers(1, &vbo);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo);
-            glBufferData(GL_ARRAY_BUFFER, nvertices * ai->first * sizeof(float),
-                         data, buffer_usage);
-
-            vbos_.push_back(vbo);
+        for (size_t i = 0; i < vertex_format_.size(); i++) {
+            vbos_.push_back(create_vbo(i, vertex_arrays_[i], vbo_buffer_usage()));
             attrib_data_ptr_.push_back(0);
         }
 
         vertex_stride_ = 0;
     }
     else {
-        GLuint vbo;
         /* Create a single vbo to store all attribute data */
-        glGenBuffers(1, &vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-        glBufferData(GL_ARRAY_BUFFER, nvertices * vertex_size_ * sizeof(float),
-                     vertex_arrays_[0], GL_STATIC_DRAW);
+        GLuint vbo = create_vbo(0, vertex_arrays_[0], GL_STATIC_DRAW);
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -349,6 +387,21 @@ Mesh::build_vbo()
         vertex_stride_ = vertex_size_ * sizeof(float);
     }
 
+    /*
+     * The persistent mappings are written through directly, so if any of
+     * them failed use glMapBufferRange() on the same VBO rings instead.
+     */
+    if (vbo_update_method_ == VBOUpdateMethodPersistent &&
+        std::find(vbo_mapped_.begin(), vbo_mapped_.end(),
+                  static_cast<float *>(0)) != vbo_mapped_.end())
+    {
+        Log::info("Failed to map the VBOs persistently, using glMapBufferRange() instead\n");
+        delete_vbo();
+        vbo_update_method_ = VBOUpdateMethodMapRange;
+        build_vbo();
+        return;
+    }
+
     delete_array();
 }
 
@@ -409,11 +462,116 @@ Mesh::update_array(const std::vector<std::pair<size_t, size_t> >& ranges)
 }
 
 
+/**
+ * Whether the VBOs are rings of segments, which depends on the update method.
+ */
+bool
+Mesh::vbo_ring() const
+{
+    return vbo_update_method_ == VBOUpdateMethodMapRange ||
+           vbo_update_method_ == VBOUpdateMethodPersistent;
+}
+
+/**
+ * Gets the GL buffer usage for the current usage hint.
+ */
+GLenum
+Mesh::vbo_buffer_usage() const
+{
+    if (vbo_usage_ == Mesh::VBOUsageStream)
+        return GL_STREAM_DRAW;
+    else if (vbo_usage_ == Mesh::VBOUsageDynamic)
+        return GL_DYNAMIC_DRAW;
+    else /* if (vbo_usage_ == Mesh::VBOUsageStatic) */
+        return GL_STATIC_DRAW;
+}
+
+/**
+ * Gets the size in bytes of the vertex data in a VBO (of each segment of a
+ * VBO ring).
+ *
+ * @param n the index of the vbo
+ */
+size_t
+Mesh::vbo_segment_size(size_t n) const
+{
+    size_t nfloats = interleave_ ? vertex_size_ : vertex_format_[n].first;
+
+    return vertices_.size() * nfloats * sizeof(float);
+}
+
+/**
+ * Creates a VBO, or a VBO ring, holding the vertex data and leaves it bound.
+ *
+ * @param n the index of the vbo
+ * @param data the vertex data
+ * @param usage the GL buffer usage
+ *
+ * @return the VBO
+ */
+GLuint
+Mesh::create_vbo(size_t n, const float *data, GLenum usage)
+{
+    size_t size = vbo_segment_size(n);
+    GLuint vbo;
+
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    if (!vbo_ring()) {
+        glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+        return vbo;
+    }
+
+    /* Every segment starts with the initial data */
+    std::vector<char> ring(size * vbo_ring_size_);
+    for (unsigned int i = 0; i < vbo_ring_size_; i++)
+        memcpy(&ring[i * size], data, size);
+
+    if (vbo_update_method_ == VBOUpdateMethodPersistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        GLExtensions::BufferStorage(GL_ARRAY_BUFFER, ring.size(), &ring[0], flags);
+        vbo_mapped_.push_back(reinterpret_cast<float *>(
+            GLExtensions::MapBufferRange(GL_ARRAY_BUFFER, 0, ring.size(), flags)));
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, ring.size(), &ring[0], usage);
+    }
+
+    return vbo;
+}
+
+/**
+ * Waits until the GPU has finished reading from the current segment of the
+ * VBO rings.
+ */
+void
+Mesh::wait_vbo_segment()
+{
+    GLsync &fence(vbo_fences_[vbo_ring_index_]);
+
+    if (!fence)
+        return;
+
+    GLenum ret;
+    do {
+        ret = GLExtensions::ClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                           1000000000);
+    } while (ret == GL_TIMEOUT_EXPIRED);
+
+    if (ret == GL_WAIT_FAILED)
+        Log::error("Waiting for a VBO segment fence failed\n");
+
+    GLExtensions::DeleteSync(fence);
+    fence = 0;
+}
+
 /**
  * Updates ranges of a single VBO.
  *
- * This method use either glMapBuffer or glBufferSubData to perform
- * the update. The used method can be set with ::vbo_update_method().
+ * The method used to perform the update can be set with
+ * ::vbo_update_method().
  *
  * @param ranges the ranges of vertices to update
  * @param n the index of the vbo to update
@@ -425,14 +583,48 @@ Mesh::update_single_vbo(const std::vector<std::pair<size_t, size_t> >& ranges,
 {
     float *src_start(vertex_arrays_[n]);
     float *dest_start(0);
+    /* The first vertex in the memory dest_start points to */
+    size_t dest_first(0);
 
     glBindBuffer(GL_ARRAY_BUFFER, vbos_[n]);
 
+    if (vbo_update_method_ == VBOUpdateMethodOrphan) {
+        /* Respecify the whole buffer, the old storage is kept while in use */
+        glBufferData(GL_ARRAY_BUFFER, vbo_segment_size(n), src_start,
+                     vbo_buffer_usage());
+        return;
+    }
+
+    if (ranges.empty())
+        return;
+
+    size_t segment_offset(vbo_ring_index_ * vbo_segment_size(n));
+
     if (vbo_update_method_ == VBOUpdateMethodMap) {
         dest_start = reinterpret_cast<float *>(
                 GLExtensions::MapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY)
                 );
     }
+    else if (vbo_update_method_ == VBOUpdateMethodMapRange) {
+        /* Map only the span of the updated ranges in the current segment */
+        size_t dest_last(ranges[0].second);
+        dest_first = ranges[0].first;
+
+        for (size_t i = 1; i < ranges.size(); i++) {
+            dest_first = std::min(dest_first, ranges[i].first);
+            dest_last = std::max(dest_last, ranges[i].second);
+        }
+
+        dest_start = reinterpret_cast<float *>(
+                GLExtensions::MapBufferRange(GL_ARRAY_BUFFER,
+                    segment_offset + dest_first * nfloats * sizeof(float),
+                    (dest_last - dest_first + 1) * nfloats * sizeof(float),
+                    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT)
+                );
+    }
+    else if (vbo_update_method_ == VBOUpdateMethodPersistent) {
+        dest_start = vbo_mapped_[n] + segment_offset / sizeof(float);
+    }
 
     /* Update supplied ranges */
     for (std::vector<std::pair<size_t, size_t> >::const_iterator iter = ranges.begin();
@@ -442,18 +634,30 @@ Mesh::update_single_vbo(const std::vector<std::pair<size_t, size_t> >& ranges,
         float *src(src_start + nfloats * iter->first);
         float *src_end(src_start + nfloats * (iter->second + 1));
 
-        if (vbo_update_method_ == VBOUpdateMethodMap) {
-            float *dest(dest_start + nfloats * iter->first);
-            std::copy(src, src_end, dest);
-        }
-        else if (vbo_update_method_ == VBOUpdateMethodSubData) {
+        if (vbo_update_method_ == VBOUpdateMethodSubData) {
             glBufferSubData(GL_ARRAY_BUFFER, nfloats * iter->first * sizeof(float),
                             (src_end - src) * sizeof(float), src);
         }
+        else if (dest_start) {
+            float *dest(dest_start + nfloats * (iter->first - dest_first));
+            std::copy(src, src_end, dest);
+        }
     }
 
-    if (vbo_update_method_ == VBOUpdateMethodMap)
-        GLExtensions::UnmapBuffer(GL_ARRAY_BUFFER);
+    if (vbo_update_method_ == VBOUpdateMethodMap ||
+        vbo_update_method_ == VBOUpdateMethodMapRange)
+    {
+        /* A failed map leaves nothing to unmap, and fails every frame */
+        static bool map_error_logged(false);
+
+        if (dest_start) {
+            GLExtensions::UnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        else if (!map_error_logged) {
+            Log::error("Couldn't map the vertex buffer, the mesh isn't updated\n");
+            map_error_logged = true;
+        }
+    }
 }
 
 /**
@@ -472,12 +676,31 @@ Mesh::update_vbo(const std::vector<std::pair<size_t, size_t> >& ranges)
 
     update_array(ranges);
 
+    const std::vector<std::pair<size_t, size_t> > *vbo_ranges(&ranges);
+    std::vector<std::pair<size_t, size_t> > ring_ranges;
+
+    if (vbo_ring()) {
+        /* Move to the next segment, and bring it up to date */
+        vbo_ring_index_ = (vbo_ring_index_ + 1) % vbo_ring_size_;
+        wait_vbo_segment();
+
+        vbo_ring_ranges_.push_back(ranges);
+        if (vbo_ring_ranges_.size() > vbo_ring_size_)
+            vbo_ring_ranges_.pop_front();
+
+        for (size_t i = 0; i < vbo_ring_ranges_.size(); i++) {
+            ring_ranges.insert(ring_ranges.end(), vbo_ring_ranges_[i].begin(),
+                               vbo_ring_ranges_[i].end());
+        }
+        vbo_ranges = &ring_ranges;
+    }
+
     if (!interleave_) {
         for (size_t i = 0; i < vbos_.size(); i++)
-            update_single_vbo(ranges, i, vertex_format_[i].first);
+            update_single_vbo(*vbo_ranges, i, vertex_format_[i].first);
     }
     else {
-        update_single_vbo(ranges, 0, vertex_size_);
+        update_single_vbo(*vbo_ranges, 0, vertex_size_);
     }
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -503,12 +726,21 @@ Mesh::delete_array()
 void
 Mesh::delete_vbo()
 {
+    for (size_t i = 0; i < vbo_fences_.size(); i++) {
+        if (vbo_fences_[i])
+            GLExtensions::DeleteSync(vbo_fences_[i]);
+    }
+
+    /* Deleting the buffers also unmaps any persistent mappings */
     for (size_t i = 0; i < vbos_.size(); i++) {
         GLuint vbo = vbos_[i];
         glDeleteBuffers(1, &vbo);
     }
 
     vbos_.clear();
+    vbo_fences_.clear();
+    vbo_mapped_.clear();
+    vbo_ring_ranges_.clear();
 }
 
 
@@ -551,15 +783,27 @@ Mesh::render_vbo()
     for (size_t i = 0; i < vertex_format_.size(); i++) {
         if (attrib_locations_[i] < 0)
             continue;
+
+        /* Read from the current segment of VBO rings */
+        size_t segment_offset(vbo_ring_index_ * vbo_segment_size(interleave_ ? 0 : i));
+
         glEnableVertexAttribArray(attrib_locations_[i]);
         glBindBuffer(GL_ARRAY_BUFFER, vbos_[i]);
         glVertexAttribPointer(attrib_locations_[i], vertex_format_[i].first,
                               GL_FLOAT, GL_FALSE, vertex_stride_,
-                              attrib_data_ptr_[i]);
+                              reinterpret_cast<const char *>(attrib_data_ptr_[i]) +
+                              segment_offset);
     }
 
     glDrawArrays(GL_TRIANGLES, 0, vertices_.size());
 
+    if (vbo_ring()) {
+        GLsync &fence(vbo_fences_[vbo_ring_index_]);
+        if (fence)
+            GLExtensions::DeleteSync(fence);
+        fence = GLExtensions::FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
     for (size_t i = 0; i < vertex_format_.size(); i++) {
         if (attrib_locations_[i] < 0)
             continue;
@@ -2,6 +2,7 @@
 #ifndef GPULOAD_MESH_H_
 #define GPULOAD_MESH_H_
 
+#include <deque>
 #include <vector>
 #include "vec.h"
 #include "gl-headers.h"
@@ -27,6 +28,9 @@ public:
     enum VBOUpdateMethod {
         VBOUpdateMethodMap,
         VBOUpdateMethodSubData,
+        VBOUpdateMethodOrphan,
+        VBOUpdateMethodMapRange,
+        VBOUpdateMethodPersistent,
     };
     enum VBOUsage {
         VBOUsageStatic,
@@ -34,8 +38,10 @@ public:
         VBOUsageDynamic,
     };
 
+    static bool vbo_update_method_supported(VBOUpdateMethod method);
     void vbo_update_method(VBOUpdateMethod method);
     void vbo_usage(VBOUsage usage);
+    void vbo_ring_size(unsigned int size);
     void interleave(bool interleave);
 
     void reset();
@@ -65,6 +71,11 @@ private:
                              size_t n, size_t nfloats, size_t offset);
     void update_single_vbo(const std::vector<std::pair<size_t, size_t> >& ranges,
                            size_t n, size_t nfloats);
+    bool vbo_ring() const;
+    GLenum vbo_buffer_usage() const;
+    size_t vbo_segment_size(size_t n) const;
+    GLuint create_vbo(size_t n, const float *data, GLenum usage);
+    void wait_vbo_segment();
 
     //
     // vertex_format_ is a vector of pairs describing the attribute data.
@@ -89,6 +100,21 @@ private:
     bool interleave_;
     VBOUpdateMethod vbo_update_method_;
     VBOUsage vbo_usage_;
+
+    //
+    // With the MapRange and Persistent update methods each VBO holds
+    // vbo_ring_size_ copies (segments) of the vertex data.  Every update
+    // writes to the next segment, after waiting for the fence inserted after
+    // the last draw that read from it, so the GPU never has to be waited for
+    // on buffers that are in flight.  As a segment was last written
+    // vbo_ring_size_ updates ago, the ranges of all those updates are
+    // written to it (vbo_ring_ranges_).
+    //
+    unsigned int vbo_ring_size_;
+    unsigned int vbo_ring_index_;
+    std::vector<GLsync> vbo_fences_;
+    std::vector<float *> vbo_mapped_;
+    std::deque<std::vector<std::pair<size_t, size_t> > > vbo_ring_ranges_;
 };
 
 #endif
@@ -0,0 +1,289 @@
+#include "mipmap-builder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+
+/* Minimum number of rows worth handing to a thread */
+const unsigned int min_rows_per_thread = 32;
+
+/* Kaiser window parameters: alpha and half-width in destination texels */
+const double kaiser_alpha = 4.0;
+const double kaiser_width = 2.0;
+
+/* Size of the linear to sRGB conversion table */
+const unsigned int linear_to_srgb_size = 4096;
+
+/*
+ * Runs func(first, last) over [0, count) split into contiguous ranges, one
+ * per thread. The calling thread processes the last range itself.
+ */
+template <typename Func> void
+parallel_rows(unsigned int count, unsigned int nthreads, Func func)
+{
+    if (nthreads > count / min_rows_per_thread)
+        nthreads = count / min_rows_per_thread;
+    if (nthreads < 1)
+        nthreads = 1;
+
+    std::vector<std::thread> threads;
+    unsigned int chunk = count / nthreads;
+    unsigned int first = 0;
+
+    for (unsigned int i = 0; i < nthreads - 1; i++) {
+        threads.push_back(std::thread(func, first, first + chunk));
+        first += chunk;
+    }
+
+    func(first, count);
+
+    for (unsigned int i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+/* Zeroth order modified Bessel function of the first kind */
+double
+bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (unsigned int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+
+    return sum;
+}
+
+double
+sinc(double x)
+{
+    if (std::fabs(x) < 1e-9)
+        return 1.0;
+    return std::sin(M_PI * x) / (M_PI * x);
+}
+
+double
+kaiser(double x)
+{
+    if (std::fabs(x) >= 1.0)
+        return 0.0;
+    return bessel_i0(kaiser_alpha * std::sqrt(1.0 - x * x)) / bessel_i0(kaiser_alpha);
+}
+
+struct SRGBTables
+{
+    SRGBTables()
+    {
+        for (unsigned int i = 0; i < 256; i++) {
+            double c = i / 255.0;
+            to_linear[i] = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+        }
+
+        for (unsigned int i = 0; i < linear_to_srgb_size; i++) {
+            double l = i / static_cast<double>(linear_to_srgb_size - 1);
+            double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+            to_srgb[i] = static_cast<unsigned char>(c * 255.0 + 0.5);
+        }
+    }
+
+    float to_linear[256];
+    unsigned char to_srgb[linear_to_srgb_size];
+};
+
+const SRGBTables &
+srgb_tables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+inline unsigned char
+quantize_linear(float v)
+{
+    int i = static_cast<int>(v * 255.0f + 0.5f);
+    return static_cast<unsigned char>(std::min(std::max(i, 0), 255));
+}
+
+inline unsigned char
+quantize_srgb(float v, const unsigned char *table)
+{
+    int i = static_cast<int>(v * (linear_to_srgb_size - 1) + 0.5f);
+    return table[std::min(std::max(i, 0), static_cast<int>(linear_to_srgb_size - 1))];
+}
+
+}
+
+MipmapBuilder::MipmapBuilder(Filter filter, bool srgb, unsigned int nthreads) :
+    srgb_(srgb), nthreads_(nthreads)
+{
+    if (nthreads_ == 0)
+        nthreads_ = std::max(std::thread::hardware_concurrency(), 1U);
+
+    if (filter == FilterBox) {
+        kernel_.assign(2, 0.5f);
+        kernel_offset_ = 0;
+        return;
+    }
+
+    /*
+     * Destination texel x is centered between source texels 2x and 2x + 1.
+     * Source texel 2x + o is at (o - 0.5) / 2 destination texels from it.
+     */
+    int taps = static_cast<int>(2.0 * kaiser_width);
+    double sum = 0.0;
+    std::vector<double> weights;
+
+    kernel_offset_ = 1 - taps;
+
+    for (int o = kernel_offset_; o <= taps; o++) {
+        double d = (o - 0.5) / 2.0;
+        double w = sinc(d) * kaiser(d / kaiser_width);
+        weights.push_back(w);
+        sum += w;
+    }
+
+    for (unsigned int i = 0; i < weights.size(); i++)
+        kernel_.push_back(static_cast<float>(weights[i] / sum));
+}
+
+/**
+ * Halves the width of a number of rows.
+ */
+void
+MipmapBuilder::downsample_rows(const float *src, unsigned int width,
+                               unsigned int rows, unsigned int channels,
+                               float *dst) const
+{
+    unsigned int dst_width = std::max(width / 2, 1U);
+    unsigned int ntaps = kernel_.size();
+    int last = width - 1;
+
+    for (unsigned int y = 0; y < rows; y++) {
+        const float *src_row = src + y * width * channels;
+        float *dst_row = dst + y * dst_width * channels;
+
+        for (unsigned int x = 0; x < dst_width; x++) {
+            float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            int base = 2 * x + kernel_offset_;
+
+            for (unsigned int k = 0; k < ntaps; k++) {
+                int sx = std::min(std::max(base + static_cast<int>(k), 0), last);
+                const float *texel = src_row + sx * channels;
+                float w = kernel_[k];
+
+                for (unsigned int c = 0; c < channels; c++)
+                    acc[c] += w * texel[c];
+            }
+
+            for (unsigned int c = 0; c < channels; c++)
+                dst_row[x * channels + c] = acc[c];
+        }
+    }
+}
+
+/**
+ * Halves the height of an image, producing destination rows [first, last).
+ *
+ * Each destination row is a weighted sum of whole source rows, so the inner
+ * loop runs over unit-stride data and is vectorized by the compiler.
+ */
+void
+MipmapBuilder::downsample_columns(const float *src, unsigned int width,
+                                  unsigned int height, unsigned int channels,
+                                  unsigned int first, unsigned int last,
+                                  float *dst) const
+{
+    unsigned int stride = width * channels;
+    unsigned int ntaps = kernel_.size();
+    int last_row = height - 1;
+
+    for (unsigned int y = first; y < last; y++) {
+        float *__restrict dst_row = dst + y * stride;
+        int base = 2 * y + kernel_offset_;
+
+        std::fill(dst_row, dst_row + stride, 0.0f);
+
+        for (unsigned int k = 0; k < ntaps; k++) {
+            int sy = std::min(std::max(base + static_cast<int>(k), 0), last_row);
+            const float *__restrict src_row = src + sy * stride;
+            float w = kernel_[k];
+
+            for (unsigned int i = 0; i < stride; i++)
+                dst_row[i] += w * src_row[i];
+        }
+    }
+}
+
+void
+MipmapBuilder::build(const unsigned char *src, unsigned int width,
+                     unsigned int height, unsigned int bpp,
+                     std::vector<Level> &levels) const
+{
+    const SRGBTables &tables = srgb_tables();
+    unsigned int color_channels = srgb_ ? std::min(bpp, 3U) : 0;
+
+    levels.clear();
+
+    /* Convert the base level to linear floats */
+    std::vector<float> cur(width * height * bpp);
+    std::vector<float> tmp;
+    std::vector<float> next;
+
+    for (unsigned int i = 0; i < width * height; i++) {
+        for (unsigned int c = 0; c < bpp; c++) {
+            unsigned char v = src[i * bpp + c];
+            cur[i * bpp + c] = c < color_channels ? tables.to_linear[v] : v / 255.0f;
+        }
+    }
+
+    while (width > 1 || height > 1) {
+        unsigned int dst_width = std::max(width / 2, 1U);
+        unsigned int dst_height = std::max(height / 2, 1U);
+
+        tmp.resize(dst_width * height * bpp);
+        next.resize(dst_width * dst_height * bpp);
+        levels.push_back(Level());
+
+        Level &level = levels.back();
+        level.width = dst_width;
+        level.height = dst_height;
+        level.pixels.resize(dst_width * dst_height * bpp);
+
+        const float *cur_ptr = &cur[0];
+        float *tmp_ptr = &tmp[0];
+        float *next_ptr = &next[0];
+        unsigned char *out = &level.pixels[0];
+        unsigned int src_width = width;
+        unsigned int src_height = height;
+
+        parallel_rows(src_height, nthreads_,
+                      [=](unsigned int first, unsigned int last) {
+                          downsample_rows(cur_ptr + first * src_width * bpp,
+                                          src_width, last - first, bpp,
+                                          tmp_ptr + first * dst_width * bpp);
+                      });
+
+        parallel_rows(dst_height, nthreads_,
+                      [=, &tables](unsigned int first, unsigned int last) {
+                          downsample_columns(tmp_ptr, dst_width, src_height, bpp,
+                                             first, last, next_ptr);
+
+                          unsigned int stride = dst_width * bpp;
+                          for (unsigned int i = first * stride; i < last * stride; i++) {
+                              unsigned int c = i % bpp;
+                              out[i] = c < color_channels ?
+                                  quantize_srgb(next_ptr[i], tables.to_srgb) :
+                                  quantize_linear(next_ptr[i]);
+                          }
+                      });
+
+        cur.swap(next);
+        width = dst_width;
+        height = dst_height;
+    }
+}
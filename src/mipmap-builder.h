@@ -0,0 +1,64 @@
+#ifndef GPULOAD_MIPMAP_BUILDER_H_
+#define GPULOAD_MIPMAP_BUILDER_H_
+
+#include <vector>
+
+/**
+ * Builds mipmap chains on the CPU.
+ *
+ * Each level is produced from the previous one by a separable 2:1
+ * downsampling filter, either a 2x2 box or a Kaiser-windowed sinc. Filtering
+ * happens in linear space: when gamma-correct filtering is enabled the
+ * color channels are converted from sRGB before filtering and back after it,
+ * and the intermediate levels are kept at float precision so that errors
+ * don't accumulate down the chain. Rows are split across worker threads.
+ */
+class MipmapBuilder
+{
+public:
+    enum Filter {
+        FilterBox,
+        FilterKaiser
+    };
+
+    struct Level
+    {
+        unsigned int width;
+        unsigned int height;
+        std::vector<unsigned char> pixels;
+    };
+
+    /**
+     * @param filter the downsampling filter
+     * @param srgb whether the color channels are sRGB encoded
+     * @param nthreads the number of threads to use (0 for one per CPU)
+     */
+    MipmapBuilder(Filter filter, bool srgb = true, unsigned int nthreads = 0);
+
+    /**
+     * Builds all the levels below a base image, down to 1x1.
+     *
+     * @param src the base image, tightly packed
+     * @param width the width of the base image
+     * @param height the height of the base image
+     * @param bpp the bytes per pixel of the image (3 or 4)
+     * @param levels the built levels, starting from level 1
+     */
+    void build(const unsigned char *src, unsigned int width, unsigned int height,
+               unsigned int bpp, std::vector<Level> &levels) const;
+
+private:
+    void downsample_rows(const float *src, unsigned int width, unsigned int rows,
+                         unsigned int channels, float *dst) const;
+    void downsample_columns(const float *src, unsigned int width,
+                            unsigned int height, unsigned int channels,
+                            unsigned int first, unsigned int last,
+                            float *dst) const;
+
+    bool srgb_;
+    unsigned int nthreads_;
+    std::vector<float> kernel_;
+    int kernel_offset_;
+};
+
+#endif
@@ -0,0 +1,622 @@
+#include "model.h"
+#include "log.h"
+#include "util.h"
+#include <algorithm>
+#include <queue>
+#include <sstream>
+#include <math.h>
+
+using std::string;
+using std::vector;
+using LibMatrix::vec2;
+using LibMatrix::vec3;
+using LibMatrix::uvec3;
+
+std::map<std::string, std::vector<Model::Object> > Model::lod_cache_;
+
+namespace
+{
+
+// LOD levels stop being generated once a level has fewer faces than this
+const unsigned int lod_min_faces = 64;
+
+// Weight of the constraint planes that keep open boundaries in place
+const double boundary_weight = 1000.0;
+
+/**
+ * A symmetric 4x4 matrix holding an error quadric (Garland & Heckbert,
+ * "Surface Simplification Using Quadric Error Metrics", 1997).
+ */
+struct Quadric
+{
+    // a2, ab, ac, ad, b2, bc, bd, c2, cd, d2
+    double m[10];
+
+    Quadric() { std::fill(m, m + 10, 0.0); }
+
+    /** Creates the quadric of the plane ax + by + cz + d = 0 */
+    Quadric(double a, double b, double c, double d, double w = 1.0)
+    {
+        m[0] = w * a * a; m[1] = w * a * b; m[2] = w * a * c; m[3] = w * a * d;
+        m[4] = w * b * b; m[5] = w * b * c; m[6] = w * b * d;
+        m[7] = w * c * c; m[8] = w * c * d;
+        m[9] = w * d * d;
+    }
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        for (unsigned int i = 0; i < 10; i++)
+            m[i] += q.m[i];
+        return *this;
+    }
+
+    /** The squared distance error of placing a vertex at (x, y, z) */
+    double error(double x, double y, double z) const
+    {
+        return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x +
+               m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y +
+               m[7] * z * z + 2 * m[8] * z +
+               m[9];
+    }
+
+    /**
+     * Finds the position that minimizes the error.
+     *
+     * @return false if the system is (nearly) singular
+     */
+    bool optimize(double& x, double& y, double& z) const
+    {
+        double det = m[0] * (m[4] * m[7] - m[5] * m[5]) -
+                     m[1] * (m[1] * m[7] - m[5] * m[2]) +
+                     m[2] * (m[1] * m[5] - m[4] * m[2]);
+
+        double scale = m[0] + m[4] + m[7];
+        if (fabs(det) <= 1e-12 * scale * scale * scale)
+            return false;
+
+        double inv = 1.0 / det;
+        x = -inv * (m[3] * (m[4] * m[7] - m[5] * m[5]) -
+                    m[1] * (m[6] * m[7] - m[5] * m[8]) +
+                    m[2] * (m[6] * m[5] - m[4] * m[8]));
+        y = -inv * (m[0] * (m[6] * m[7] - m[8] * m[5]) -
+                    m[3] * (m[1] * m[7] - m[2] * m[5]) +
+                    m[2] * (m[1] * m[8] - m[6] * m[2]));
+        z = -inv * (m[0] * (m[4] * m[8] - m[5] * m[6]) -
+                    m[1] * (m[1] * m[8] - m[2] * m[6]) +
+                    m[3] * (m[1] * m[5] - m[4] * m[2]));
+        return true;
+    }
+};
+
+/** A candidate edge collapse, kept in a min-heap ordered by cost */
+struct Collapse
+{
+    double cost;
+    unsigned int v0;
+    unsigned int v1;
+    unsigned int stamp0;
+    unsigned int stamp1;
+    vec3 target;
+
+    bool operator<(const Collapse& other) const { return cost > other.cost; }
+};
+
+/**
+ * Edge collapse simplifier for an indexed triangle list.
+ */
+class Simplifier
+{
+public:
+    Simplifier(const vector<vec3>& positions, const vector<vec2>& texcoords,
+               const vector<uvec3>& faces) :
+        pos_(positions), tex_(texcoords), faces_(faces),
+        face_alive_(faces.size(), true), vertex_alive_(positions.size(), true),
+        stamp_(positions.size(), 0), quadrics_(positions.size()),
+        vertex_faces_(positions.size()), live_faces_(faces.size())
+    {
+        for (unsigned int f = 0; f < faces_.size(); f++) {
+            const uvec3& face = faces_[f];
+            vertex_faces_[face.x()].push_back(f);
+            vertex_faces_[face.y()].push_back(f);
+            vertex_faces_[face.z()].push_back(f);
+        }
+
+        init_quadrics();
+        init_collapses();
+    }
+
+    void run(unsigned int target_faces)
+    {
+        while (live_faces_ > target_faces && !heap_.empty()) {
+            Collapse c(heap_.top());
+            heap_.pop();
+
+            if (!vertex_alive_[c.v0] || !vertex_alive_[c.v1] ||
+                stamp_[c.v0] != c.stamp0 || stamp_[c.v1] != c.stamp1)
+            {
+                continue;
+            }
+
+            if (flips(c.v0, c.v1, c.target) || flips(c.v1, c.v0, c.target))
+                continue;
+
+            collapse(c);
+        }
+    }
+
+    void result(vector<vec3>& positions, vector<vec2>& texcoords,
+                vector<uvec3>& faces) const
+    {
+        vector<unsigned int> remap(pos_.size(), ~0u);
+
+        positions.clear();
+        texcoords.clear();
+        faces.clear();
+
+        for (unsigned int f = 0; f < faces_.size(); f++) {
+            if (!face_alive_[f])
+                continue;
+
+            const uvec3& face = faces_[f];
+            unsigned int idx[3] = { face.x(), face.y(), face.z() };
+
+            for (unsigned int i = 0; i < 3; i++) {
+                unsigned int v = idx[i];
+                if (remap[v] == ~0u) {
+                    remap[v] = positions.size();
+                    positions.push_back(pos_[v]);
+                    texcoords.push_back(tex_[v]);
+                }
+                idx[i] = remap[v];
+            }
+
+            faces.push_back(uvec3(idx[0], idx[1], idx[2]));
+        }
+    }
+
+private:
+    vector<vec3> pos_;
+    vector<vec2> tex_;
+    vector<uvec3> faces_;
+    vector<bool> face_alive_;
+    vector<bool> vertex_alive_;
+    vector<unsigned int> stamp_;
+    vector<Quadric> quadrics_;
+    vector<vector<unsigned int> > vertex_faces_;
+    std::priority_queue<Collapse> heap_;
+    unsigned int live_faces_;
+
+    static bool plane(const vec3& a, const vec3& b, const vec3& c, vec3& n)
+    {
+        n = vec3::cross(b - a, c - a);
+        float len = n.length();
+        if (len == 0.0f)
+            return false;
+        n /= len;
+        return true;
+    }
+
+    void init_quadrics()
+    {
+        vector<std::pair<unsigned long long, unsigned int> > edges;
+
+        for (unsigned int f = 0; f < faces_.size(); f++) {
+            const uvec3& face = faces_[f];
+            unsigned int idx[3] = { face.x(), face.y(), face.z() };
+            vec3 n;
+
+            if (!plane(pos_[idx[0]], pos_[idx[1]], pos_[idx[2]], n))
+                continue;
+
+            Quadric q(n.x(), n.y(), n.z(), -vec3::dot(n, pos_[idx[0]]));
+            for (unsigned int i = 0; i < 3; i++)
+                quadrics_[idx[i]] += q;
+
+            for (unsigned int i = 0; i < 3; i++) {
+                unsigned int a = idx[i];
+                unsigned int b = idx[(i + 1) % 3];
+                unsigned long long key = a < b ?
+                    (static_cast<unsigned long long>(a) << 32) | b :
+                    (static_cast<unsigned long long>(b) << 32) | a;
+                edges.push_back(std::make_pair(key, f));
+            }
+        }
+
+        // Edges used by a single face are on a boundary. Constrain them with
+        // a plane perpendicular to the face, so that the outline of open
+        // meshes doesn't shrink.
+        std::sort(edges.begin(), edges.end());
+
+        for (unsigned int i = 0; i < edges.size(); i++) {
+            if ((i > 0 && edges[i - 1].first == edges[i].first) ||
+                (i + 1 < edges.size() && edges[i + 1].first == edges[i].first))
+            {
+                continue;
+            }
+
+            unsigned int a = edges[i].first >> 32;
+            unsigned int b = edges[i].first & 0xffffffff;
+            const uvec3& face = faces_[edges[i].second];
+            vec3 n;
+            plane(pos_[face.x()], pos_[face.y()], pos_[face.z()], n);
+
+            vec3 e(pos_[b] - pos_[a]);
+            vec3 bn(vec3::cross(e, n));
+            float len = bn.length();
+            if (len == 0.0f)
+                continue;
+            bn /= len;
+
+            Quadric q(bn.x(), bn.y(), bn.z(), -vec3::dot(bn, pos_[a]),
+                      boundary_weight);
+            quadrics_[a] += q;
+            quadrics_[b] += q;
+        }
+    }
+
+    void init_collapses()
+    {
+        vector<unsigned long long> edges;
+
+        for (unsigned int f = 0; f < faces_.size(); f++) {
+            const uvec3& face = faces_[f];
+            unsigned int idx[3] = { face.x(), face.y(), face.z() };
+
+            for (unsigned int i = 0; i < 3; i++) {
+                unsigned int a = idx[i];
+                unsigned int b = idx[(i + 1) % 3];
+                if (a == b)
+                    continue;
+                if (a > b)
+                    std::swap(a, b);
+                edges.push_back((static_cast<unsigned long long>(a) << 32) | b);
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        for (unsigned int i = 0; i < edges.size(); i++)
+            push_collapse(edges[i] >> 32, edges[i] & 0xffffffff);
+    }
+
+    void push_collapse(unsigned int v0, unsigned int v1)
+    {
+        Quadric q(quadrics_[v0]);
+        q += quadrics_[v1];
+
+        Collapse c;
+        c.v0 = v0;
+        c.v1 = v1;
+        c.stamp0 = stamp_[v0];
+        c.stamp1 = stamp_[v1];
+
+        double x, y, z;
+        if (q.optimize(x, y, z)) {
+            c.target = vec3(x, y, z);
+            c.cost = q.error(x, y, z);
+        }
+        else {
+            // Fall back to the best of the end points and the midpoint
+            const vec3 candidates[3] = {
+                pos_[v0], pos_[v1], (pos_[v0] + pos_[v1]) * 0.5f
+            };
+
+            c.cost = -1.0;
+            for (unsigned int i = 0; i < 3; i++) {
+                const vec3& p = candidates[i];
+                double err = q.error(p.x(), p.y(), p.z());
+                if (c.cost < 0.0 || err < c.cost) {
+                    c.cost = err;
+                    c.target = p;
+                }
+            }
+        }
+
+        heap_.push(c);
+    }
+
+    /**
+     * Whether moving vertex v to target would flip one of its faces that
+     * doesn't also contain vertex other (those faces are removed).
+     */
+    bool flips(unsigned int v, unsigned int other, const vec3& target) const
+    {
+        const vector<unsigned int>& vf = vertex_faces_[v];
+
+        for (unsigned int i = 0; i < vf.size(); i++) {
+            unsigned int f = vf[i];
+            if (!face_alive_[f])
+                continue;
+
+            const uvec3& face = faces_[f];
+            if (face.x() == other || face.y() == other || face.z() == other)
+                continue;
+
+            vec3 p[3] = { pos_[face.x()], pos_[face.y()], pos_[face.z()] };
+            vec3 before(vec3::cross(p[1] - p[0], p[2] - p[0]));
+
+            if (face.x() == v) p[0] = target;
+            if (face.y() == v) p[1] = target;
+            if (face.z() == v) p[2] = target;
+
+            vec3 after(vec3::cross(p[1] - p[0], p[2] - p[0]));
+            if (vec3::dot(before, after) <= 0.0f)
+                return true;
+        }
+
+        return false;
+    }
+
+    void collapse(const Collapse& c)
+    {
+        unsigned int u = c.v0;
+        unsigned int v = c.v1;
+
+        // Keep the texcoord of the end point closest to the new position
+        if ((pos_[v] - c.target).length() < (pos_[u] - c.target).length())
+            tex_[u] = tex_[v];
+
+        pos_[u] = c.target;
+        quadrics_[u] += quadrics_[v];
+        vertex_alive_[v] = false;
+        stamp_[u]++;
+
+        vector<unsigned int>& uf = vertex_faces_[u];
+        const vector<unsigned int>& vf = vertex_faces_[v];
+
+        for (unsigned int i = 0; i < vf.size(); i++) {
+            unsigned int f = vf[i];
+            if (!face_alive_[f])
+                continue;
+
+            uvec3& face = faces_[f];
+            if (face.x() == u || face.y() == u || face.z() == u) {
+                face_alive_[f] = false;
+                live_faces_--;
+                continue;
+            }
+
+            if (face.x() == v) face.x(u);
+            if (face.y() == v) face.y(u);
+            if (face.z() == v) face.z(u);
+            uf.push_back(f);
+        }
+
+        vertex_faces_[v].clear();
+
+        // Drop the removed faces and queue the edges around the new vertex
+        vector<unsigned int> neighbors;
+        unsigned int n = 0;
+
+        for (unsigned int i = 0; i < uf.size(); i++) {
+            unsigned int f = uf[i];
+            if (!face_alive_[f])
+                continue;
+            uf[n++] = f;
+
+            const uvec3& face = faces_[f];
+            if (face.x() != u) neighbors.push_back(face.x());
+            if (face.y() != u) neighbors.push_back(face.y());
+            if (face.z() != u) neighbors.push_back(face.z());
+        }
+        uf.resize(n);
+
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                        neighbors.end());
+
+        for (unsigned int i = 0; i < neighbors.size(); i++)
+            push_collapse(u, neighbors[i]);
+    }
+};
+
+}
+
+/**
+ * Simplifies a set of objects with quadric error metric edge collapses.
+ *
+ * The face budget is distributed across the objects proportionally to their
+ * original face counts. The resulting vertices only have positions and
+ * texcoords, normals need to be recalculated.
+ *
+ * @param src the objects to simplify
+ * @param dst the simplified objects
+ * @param target_faces the total number of faces to reduce the objects to
+ */
+void
+Model::simplify(const std::vector<Object> &src, std::vector<Object> &dst,
+                unsigned int target_faces)
+{
+    unsigned int total_faces = 0;
+    for (vector<Object>::const_iterator iter = src.begin();
+         iter != src.end();
+         iter++)
+    {
+        total_faces += iter->faces.size();
+    }
+
+    dst.clear();
+
+    for (vector<Object>::const_iterator iter = src.begin();
+         iter != src.end();
+         iter++)
+    {
+        const Object &object = *iter;
+        vector<vec3> positions;
+        vector<vec2> texcoords;
+        vector<uvec3> faces;
+
+        for (vector<Vertex>::const_iterator v_iter = object.vertices.begin();
+             v_iter != object.vertices.end();
+             v_iter++)
+        {
+            positions.push_back(v_iter->v);
+            texcoords.push_back(v_iter->t);
+        }
+
+        for (vector<Face>::const_iterator f_iter = object.faces.begin();
+             f_iter != object.faces.end();
+             f_iter++)
+        {
+            faces.push_back(f_iter->v);
+        }
+
+        unsigned int target = static_cast<unsigned int>(
+            static_cast<double>(object.faces.size()) * target_faces / total_faces);
+
+        Simplifier simplifier(positions, texcoords, faces);
+        simplifier.run(target);
+        simplifier.result(positions, texcoords, faces);
+
+        dst.push_back(Object(object.name));
+        Object &out = dst.back();
+
+        out.vertices.resize(positions.size());
+        for (unsigned int i = 0; i < positions.size(); i++) {
+            out.vertices[i].v = positions[i];
+            out.vertices[i].t = texcoords[i];
+        }
+
+        out.faces.resize(faces.size());
+        for (unsigned int i = 0; i < faces.size(); i++) {
+            out.faces[i].v = faces[i];
+            out.faces[i].which = Face::OBJ_FACE_V;
+        }
+    }
+}
+
+/**
+ * Replaces the model data with simplified objects.
+ *
+ * The bounding box is kept, so that all the levels of detail of a model are
+ * framed the same way.
+ */
+void
+Model::use_simplified(const std::vector<Object> &objects)
+{
+    objects_ = objects;
+    gotNormals_ = false;
+}
+
+/**
+ * Gets the total number of faces in the model.
+ */
+unsigned int
+Model::num_faces() const
+{
+    unsigned int faces = 0;
+
+    for (vector<Object>::const_iterator iter = objects_.begin();
+         iter != objects_.end();
+         iter++)
+    {
+        faces += iter->faces.size();
+    }
+
+    return faces;
+}
+
+/**
+ * Selects a level of detail of the loaded model.
+ *
+ * Level 0 is the original model, and each subsequent level has half the
+ * faces of the previous one. Levels are generated on demand from the
+ * previous level and cached for the lifetime of the program. Requests for
+ * levels beyond the coarsest useful one are clamped.
+ *
+ * This must be called on a freshly loaded model, before calculating normals.
+ *
+ * @param level the level of detail to use
+ *
+ * @return the level actually selected
+ */
+unsigned int
+Model::select_lod(unsigned int level)
+{
+    if (level == 0)
+        return 0;
+
+    vector<Object> prev(objects_);
+    unsigned int prev_faces = num_faces();
+    unsigned int l;
+
+    for (l = 1; l <= level; l++) {
+        std::stringstream ss;
+        ss << name_ << ":lod=" << l;
+
+        std::map<string, vector<Object> >::iterator iter = lod_cache_.find(ss.str());
+
+        if (iter == lod_cache_.end()) {
+            if (prev_faces / 2 < lod_min_faces)
+                break;
+
+            uint64_t start = Util::get_timestamp_us();
+            simplify(prev, lod_cache_[ss.str()], prev_faces / 2);
+            iter = lod_cache_.find(ss.str());
+            Log::debug("Generated LOD %u of model '%s' in %.2f ms\n",
+                       l, name_.c_str(),
+                       (Util::get_timestamp_us() - start) / 1000.0);
+        }
+
+        objects_ = iter->second;
+        unsigned int faces = num_faces();
+
+        // Stop when simplification can't make any more progress
+        if (faces >= prev_faces) {
+            objects_ = prev;
+            break;
+        }
+
+        prev = objects_;
+        prev_faces = faces;
+    }
+
+    l--;
+
+    if (l > 0)
+        gotNormals_ = false;
+
+    Log::debug("Using LOD %u of model '%s' (%u faces)\n",
+               l, name_.c_str(), num_faces());
+
+    return l;
+}
+
+/**
+ * Simplifies the loaded model to a target number of faces.
+ *
+ * Simplified models are cached for the lifetime of the program. A target
+ * of 0, or one larger than the face count of the model, leaves the model
+ * unchanged.
+ *
+ * This must be called on a freshly loaded model, before calculating normals.
+ *
+ * @param triangles the target number of faces
+ */
+void
+Model::select_triangles(unsigned int triangles)
+{
+    if (triangles == 0 || triangles >= num_faces())
+        return;
+
+    std::stringstream ss;
+    ss << name_ << ":triangles=" << triangles;
+
+    std::map<string, vector<Object> >::iterator iter = lod_cache_.find(ss.str());
+
+    if (iter == lod_cache_.end()) {
+        uint64_t start = Util::get_timestamp_us();
+        vector<Object> &objects = lod_cache_[ss.str()];
+        simplify(objects_, objects, triangles);
+        Log::debug("Simplified model '%s' to %u faces in %.2f ms\n",
+                   name_.c_str(), triangles,
+                   (Util::get_timestamp_us() - start) / 1000.0);
+        use_simplified(objects);
+    }
+    else {
+        use_simplified(iter->second);
+    }
+
+    Log::debug("Using model '%s' with %u faces\n", name_.c_str(), num_faces());
+}
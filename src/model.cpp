@@ -5,6 +5,7 @@
 #include "log.h"
 #include "options.h"
 #include "util.h"
+#include "tangent-space.h"
 #include "float.h"
 #include "math.h"
 #include <algorithm>
@@ -274,67 +275,48 @@ Model::calculate_normals()
     if (gotNormals_)
         return;
 
-    LibMatrix::vec3 n;
-
     for (std::vector<Object>::iterator iter = objects_.begin();
          iter != objects_.end();
          iter++)
     {
         Object &object = *iter;
+        LibMatrix::TangentSpace ts;
+
+        ts.resize(object.vertices.size());
+        ts.indices.reserve(3 * object.faces.size());
+
+        for (unsigned int i = 0; i < object.vertices.size(); i++) {
+            const Vertex &v = object.vertices[i];
+            ts.px[i] = v.v.x(); ts.py[i] = v.v.y(); ts.pz[i] = v.v.z();
+            ts.tu[i] = v.t.x(); ts.tv[i] = v.t.y();
+            ts.nx[i] = v.n.x(); ts.ny[i] = v.n.y(); ts.nz[i] = v.n.z();
+            ts.tx[i] = v.nt.x(); ts.ty[i] = v.nt.y(); ts.tz[i] = v.nt.z();
+            ts.bx[i] = v.nb.x(); ts.by[i] = v.nb.y(); ts.bz[i] = v.nb.z();
+        }
 
         for (vector<Face>::const_iterator f_iter = object.faces.begin();
              f_iter != object.faces.end();
              f_iter++)
         {
-            const Face &face = *f_iter;
-            Vertex &a = object.vertices[face.v.x()];
-            Vertex &b = object.vertices[face.v.y()];
-            Vertex &c = object.vertices[face.v.z()];
-
-            /* Calculate normal */
-            n = LibMatrix::vec3::cross(b.v - a.v, c.v - a.v);
-            n.normalize();
-            a.n += n;
-            b.n += n;
-            c.n += n;
-
-            LibMatrix::vec3 q1(b.v - a.v);
-            LibMatrix::vec3 q2(c.v - a.v);
-            LibMatrix::vec2 u1(b.t - a.t);
-            LibMatrix::vec2 u2(c.t - a.t);
-            float det = (u1.x() * u2.y() - u2.x() * u1.y());
-
-            /* Calculate tangent */
-            LibMatrix::vec3 nt;
-            nt.x(det * (u2.y() * q1.x() - u1.y() * q2.x()));
-            nt.y(det * (u2.y() * q1.y() - u1.y() * q2.y()));
-            nt.z(det * (u2.y() * q1.z() - u1.y() * q2.z()));
-            nt.normalize();
-            a.nt += nt;
-            b.nt += nt;
-            c.nt += nt;
-
-            /* Calculate bitangent */
-            LibMatrix::vec3 nb;
-            nb.x(det * (u1.x() * q2.x() - u2.x() * q1.x()));
-            nb.y(det * (u1.x() * q2.y() - u2.x() * q1.y()));
-            nb.z(det * (u1.x() * q2.z() - u2.x() * q1.z()));
-            nb.normalize();
-            a.nb += nb;
-            b.nb += nb;
-            c.nb += nb;
+            ts.indices.push_back(f_iter->v.x());
+            ts.indices.push_back(f_iter->v.y());
+            ts.indices.push_back(f_iter->v.z());
         }
 
-        for (vector<Vertex>::iterator v_iter = object.vertices.begin();
-             v_iter != object.vertices.end();
-             v_iter++)
-        {
-            Vertex &v = *v_iter;
-            /* Orthogonalize */
-            v.nt = (v.nt - v.n * LibMatrix::vec3::dot(v.nt, v.n));
-            v.n.normalize();
-            v.nt.normalize();
-            v.nb.normalize();
+        /*
+         * Both implementations produce bit-identical results, the reference
+         * one is kept around to allow checking that.
+         */
+        if (Options::reference_normals)
+            ts.compute_reference();
+        else
+            ts.compute();
+
+        for (unsigned int i = 0; i < object.vertices.size(); i++) {
+            Vertex &v = object.vertices[i];
+            v.n = vec3(ts.nx[i], ts.ny[i], ts.nz[i]);
+            v.nt = vec3(ts.tx[i], ts.ty[i], ts.tz[i]);
+            v.nb = vec3(ts.bx[i], ts.by[i], ts.bz[i]);
         }
     }
 
@@ -878,6 +860,8 @@ Model::load(const string& modelName)
         return retVal;
     }
 
+    name_ = modelName;
+
     ModelDescriptor* desc = modelIt->second;
     switch (desc->format())
     {
@@ -61,6 +61,10 @@ public:
 
     bool load(const std::string& name);
 
+    unsigned int num_faces() const;
+    unsigned int select_lod(unsigned int level);
+    void select_triangles(unsigned int triangles);
+
     bool needTexcoords() const { return !gotTexcoords_; }
     bool needNormals() const { return !gotNormals_; }
     void calculate_texcoords();
@@ -117,6 +121,13 @@ private:
     LibMatrix::vec3 minVec_;
     LibMatrix::vec3 maxVec_;
     std::vector<Object> objects_;
+
+    // Level of detail generation (see model-simplify.cpp)
+    static void simplify(const std::vector<Object> &src,
+                         std::vector<Object> &dst, unsigned int target_faces);
+    void use_simplified(const std::vector<Object> &objects);
+    std::string name_;
+    static std::map<std::string, std::vector<Object> > lod_cache_;
 };
 
 #endif
@@ -32,6 +32,7 @@ std::vector<std::string> Options::benchmarks;
 std::vector<std::string> Options::benchmark_files;
 bool Options::validate = false;
 std::string Options::data_path = std::string(GPULOAD_DATA_PATH);
+std::string Options::data_archive;
 Options::FrameEnd Options::frame_end = Options::FrameEndDefault;
 Options::SwapMode Options::swap_mode = Options::SwapModeDefault;
 std::pair<int,int> Options::size(800, 600);
@@ -44,7 +45,15 @@ bool Options::reuse_context = false;
 bool Options::run_forever = false;
 bool Options::annotate = false;
 bool Options::offscreen = false;
+bool Options::reference_normals = false;
+bool Options::texture_pbo = false;
+Options::TextureMipmaps Options::texture_mipmaps = Options::TextureMipmapsGL;
+Options::JPEGDecoder Options::jpeg_decoder = Options::JPEGDecoderTurboJPEG;
+unsigned int Options::jpeg_max_size = 0;
+std::string Options::program_cache;
+bool Options::shader_build_time = false;
 GLVisualConfig Options::visual_config;
+unsigned int Options::msaa = 0;
 
 static struct option long_options[] = {
     {"annotate", 0, 0, 0},
@@ -52,12 +61,21 @@ static struct option long_options[] = {
     {"benchmark-file", 1, 0, 0},
     {"validate", 0, 0, 0},
     {"data-path", 1, 0, 0},
+    {"data-archive", 1, 0, 0},
     {"frame-end", 1, 0, 0},
     {"swap-mode", 1, 0, 0},
     {"off-screen", 0, 0, 0},
     {"visual-config", 1, 0, 0},
+    {"msaa", 1, 0, 0},
     {"reuse-context", 0, 0, 0},
     {"run-forever", 0, 0, 0},
+    {"reference-normals", 0, 0, 0},
+    {"texture-pbo", 0, 0, 0},
+    {"texture-mipmaps", 1, 0, 0},
+    {"jpeg-decoder", 1, 0, 0},
+    {"jpeg-max-size", 1, 0, 0},
+    {"program-cache", 1, 0, 0},
+    {"shader-build-time", 0, 0, 0},
     {"size", 1, 0, 0},
     {"fullscreen", 0, 0, 0},
     {"list-scenes", 0, 0, 0},
@@ -138,6 +156,44 @@ swap_mode_from_str(const std::string &str)
     return m;
 }
 
+/**
+ * Parses a texture mipmap generation method string
+ *
+ * @param str the string to parse
+ *
+ * @return the parsed mipmap generation method
+ */
+static Options::TextureMipmaps
+texture_mipmaps_from_str(const std::string &str)
+{
+    Options::TextureMipmaps m = Options::TextureMipmapsGL;
+
+    if (str == "box")
+        m = Options::TextureMipmapsBox;
+    else if (str == "kaiser")
+        m = Options::TextureMipmapsKaiser;
+
+    return m;
+}
+
+/**
+ * Parses a JPEG decoder string
+ *
+ * @param str the string to parse
+ *
+ * @return the parsed JPEG decoder
+ */
+static Options::JPEGDecoder
+jpeg_decoder_from_str(const std::string &str)
+{
+    Options::JPEGDecoder m = Options::JPEGDecoderTurboJPEG;
+
+    if (str == "libjpeg")
+        m = Options::JPEGDecoderLibJPEG;
+
+    return m;
+}
+
 void
 Options::print_help()
 {
@@ -153,6 +209,9 @@ Options::print_help()
            "                         running the benchmarks\n"
            "      --data-path PATH   Path to glmark2 models, shaders and textures\n"
            "                         Default: " GPULOAD_DATA_PATH "\n"
+           "      --data-archive F   Read the data files from the packed archive F\n"
+           "                         (see tools/pack-assets.cpp) instead of the data\n"
+           "                         path. Not supported on Android\n"
            "      --frame-end METHOD How to end a frame [default,none,swap,finish,readpixels]\n"
            "      --swap-mode MODE   How to swap a frame, all modes supported only in the DRM\n"
            "                         flavor, 'fifo' available in all flavors to force vsync\n"
@@ -162,6 +221,12 @@ Options::print_help()
            "                         target: 'red=R:green=G:blue=B:alpha=A:buffer=BUF'.\n"
            "                         The parameters may be defined in any order, and any\n"
            "                         omitted parameters assume a default value of '1'\n"
+           "                         ('samples=N' asks for a multisampled surface)\n"
+           "      --msaa N           Render the scenes with N samples per pixel into a\n"
+           "                         multisampled FBO, resolved with a blit every frame\n"
+           "                         (off-screen, GL_EXT_multisampled_render_to_texture\n"
+           "                         resolves it implicitly instead). Scenes can\n"
+           "                         override it with their msaa option\n"
            "      --reuse-context    Use a single context for all scenes\n"
            "                         (by default, each scene gets its own context)\n"
            "  -s, --size WxH         Size of the output window (default: 800x600)\n"
@@ -174,6 +239,23 @@ Options::print_help()
            "                         back to the first\n"
            "      --annotate         Annotate the benchmarks with on-screen information\n"
            "                         (same as -b :show-fps=true:title=#info#)\n"
+           "      --reference-normals Calculate model normals and tangents with the\n"
+           "                         serial reference implementation\n"
+           "      --texture-pbo      Decode PNG textures directly into a mapped pixel\n"
+           "                         unpack buffer (requires GL 2.1 or GLES 3.0)\n"
+           "      --texture-mipmaps METHOD How to generate texture mipmaps: by the GL\n"
+           "                         implementation, or on the CPU with a gamma-correct\n"
+           "                         box or Kaiser filter [gl,box,kaiser]\n"
+           "      --jpeg-decoder DECODER The JPEG decoding API to use: scanline based\n"
+           "                         libjpeg or whole image TurboJPEG [libjpeg,turbojpeg]\n"
+           "      --jpeg-max-size N  Scale JPEG textures down by up to 1/8 while decoding\n"
+           "                         so that they fit within NxN (TurboJPEG decoder only,\n"
+           "                         default: 0, no limit)\n"
+           "      --program-cache DIR Cache linked shader program binaries in DIR\n"
+           "                         and load them from there in later runs\n"
+           "                         (requires GL_OES/ARB_get_program_binary)\n"
+           "      --shader-build-time Report the time spent compiling and linking\n"
+           "                         (or loading) the shader programs of each scene\n"
            "  -d, --debug            Display debug messages\n"
            "      --version          Display program version\n"
            "  -h, --help             Display help\n");
@@ -207,6 +289,8 @@ Options::parse_args(int argc, char **argv)
             Options::validate = true;
         else if (!strcmp(optname, "data-path"))
             Options::data_path = std::string(optarg);
+        else if (!strcmp(optname, "data-archive"))
+            Options::data_archive = std::string(optarg);
         else if (!strcmp(optname, "frame-end"))
             Options::frame_end = frame_end_from_str(optarg);
         else if (!strcmp(optname, "swap-mode"))
@@ -215,6 +299,8 @@ Options::parse_args(int argc, char **argv)
             Options::offscreen = true;
         else if (!strcmp(optname, "visual-config"))
             Options::visual_config = GLVisualConfig(optarg);
+        else if (!strcmp(optname, "msaa"))
+            Options::msaa = Util::fromString<unsigned int>(optarg);
         else if (!strcmp(optname, "reuse-context"))
             Options::reuse_context = true;
         else if (c == 's' || !strcmp(optname, "size"))
@@ -227,6 +313,20 @@ Options::parse_args(int argc, char **argv)
             Options::show_all_options = true;
         else if (!strcmp(optname, "run-forever"))
             Options::run_forever = true;
+        else if (!strcmp(optname, "reference-normals"))
+            Options::reference_normals = true;
+        else if (!strcmp(optname, "texture-pbo"))
+            Options::texture_pbo = true;
+        else if (!strcmp(optname, "texture-mipmaps"))
+            Options::texture_mipmaps = texture_mipmaps_from_str(optarg);
+        else if (!strcmp(optname, "jpeg-decoder"))
+            Options::jpeg_decoder = jpeg_decoder_from_str(optarg);
+        else if (!strcmp(optname, "jpeg-max-size"))
+            Options::jpeg_max_size = Util::fromString<unsigned int>(optarg);
+        else if (!strcmp(optname, "program-cache"))
+            Options::program_cache = std::string(optarg);
+        else if (!strcmp(optname, "shader-build-time"))
+            Options::shader_build_time = true;
         else if (c == 'd' || !strcmp(optname, "debug"))
             Options::show_debug = true;
         else if (!strcmp(optname, "version"))
@@ -44,6 +44,17 @@ struct Options {
         SwapModeFIFO,
     };
 
+    enum TextureMipmaps {
+        TextureMipmapsGL,
+        TextureMipmapsBox,
+        TextureMipmapsKaiser,
+    };
+
+    enum JPEGDecoder {
+        JPEGDecoderLibJPEG,
+        JPEGDecoderTurboJPEG,
+    };
+
     static bool parse_args(int argc, char **argv);
     static void print_help();
 
@@ -51,6 +62,7 @@ struct Options {
     static std::vector<std::string> benchmark_files;
     static bool validate;
     static std::string data_path;
+    static std::string data_archive;
     static FrameEnd frame_end;
     static SwapMode swap_mode;
     static std::pair<int,int> size;
@@ -63,7 +75,15 @@ struct Options {
     static bool run_forever;
     static bool annotate;
     static bool offscreen;
+    static bool reference_normals;
+    static bool texture_pbo;
+    static TextureMipmaps texture_mipmaps;
+    static JPEGDecoder jpeg_decoder;
+    static unsigned int jpeg_max_size;
+    static std::string program_cache;
+    static bool shader_build_time;
     static GLVisualConfig visual_config;
+    static unsigned int msaa;
 };
 
 #endif /* OPTIONS_H_ */
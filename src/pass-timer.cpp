@@ -0,0 +1,148 @@
+#include "pass-timer.h"
+#include "log.h"
+#include "util.h"
+
+/* The number of frames the timer query results are read behind */
+static const unsigned int query_frames = 4;
+
+PassTimer::PassTimer(Mode mode) :
+    mode_(mode), current_(0), start_us_(0), frame_(0)
+{
+    if (mode_ == ModeGPU)
+        frames_.resize(query_frames);
+}
+
+PassTimer::~PassTimer()
+{
+    /* Results still in flight are dropped */
+    for (size_t i = 0; i < frames_.size(); i++) {
+        if (!frames_[i].queries.empty()) {
+            GLExtensions::DeleteQueries(frames_[i].queries.size(),
+                                        &frames_[i].queries[0]);
+        }
+    }
+}
+
+bool
+PassTimer::gpu_supported()
+{
+    return GLExtensions::GenQueries && GLExtensions::BeginQuery &&
+           GLExtensions::GetQueryObjectui64v;
+}
+
+void
+PassTimer::begin_frame()
+{
+    if (mode_ != ModeGPU)
+        return;
+
+    frame_ = (frame_ + 1) % frames_.size();
+    collect(frames_[frame_]);
+}
+
+void
+PassTimer::begin(const std::string &name)
+{
+    current_ = pass_index(name);
+
+    if (mode_ == ModeGPU) {
+        FrameQueries &frame(frames_[frame_]);
+        GLuint query;
+
+        GLExtensions::GenQueries(1, &query);
+        GLExtensions::BeginQuery(GL_TIME_ELAPSED, query);
+        frame.queries.push_back(query);
+        frame.passes.push_back(current_);
+    }
+    else {
+        glFinish();
+        start_us_ = Util::get_timestamp_us();
+    }
+}
+
+void
+PassTimer::end()
+{
+    if (mode_ == ModeGPU) {
+        GLExtensions::EndQuery(GL_TIME_ELAPSED);
+    }
+    else {
+        glFinish();
+        passes_[current_].total_ms += (Util::get_timestamp_us() - start_us_) / 1000.0;
+        passes_[current_].samples++;
+    }
+}
+
+void
+PassTimer::report(double frame_ms)
+{
+    double total_ms = 0.0;
+
+    for (size_t i = 0; i < passes_.size(); i++) {
+        const Pass &pass(passes_[i]);
+        if (!pass.samples)
+            continue;
+
+        double ms = pass.total_ms / pass.samples;
+        total_ms += ms;
+
+        Log::info("    %s pass: %.3f ms (%.1f%% of the frame)\n",
+                  pass.name.c_str(), ms, frame_ms > 0.0 ? 100.0 * ms / frame_ms : 0.0);
+    }
+
+    Log::info("    All passes (%s): %.3f ms of a %.3f ms frame\n",
+              mode_ == ModeGPU ? "GPU timer queries" : "CPU with glFinish",
+              total_ms, frame_ms);
+}
+
+unsigned int
+PassTimer::pass_index(const std::string &name)
+{
+    std::map<std::string, unsigned int>::iterator iter = pass_indices_.find(name);
+    if (iter != pass_indices_.end())
+        return iter->second;
+
+    passes_.push_back(Pass(name));
+    pass_indices_[name] = passes_.size() - 1;
+
+    return passes_.size() - 1;
+}
+
+/**
+ * Adds the results of the queries of a frame to the passes, and deletes the
+ * queries.
+ */
+void
+PassTimer::collect(FrameQueries &frame)
+{
+    if (frame.queries.empty())
+        return;
+
+    /*
+     * With GL_EXT_disjoint_timer_query, results are meaningless if a
+     * disjoint event (e.g. a GPU frequency change) happened meanwhile.
+     * The flag is reset when it is read, so results are checked in batches.
+     */
+    bool disjoint = false;
+    std::vector<GLuint64> elapsed(frame.queries.size());
+
+    for (size_t i = 0; i < frame.queries.size(); i++)
+        GLExtensions::GetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed[i]);
+
+    if (GLExtensions::TimerQueryDisjoint) {
+        GLint gpu_disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &gpu_disjoint);
+        disjoint = gpu_disjoint != 0;
+    }
+
+    if (!disjoint) {
+        for (size_t i = 0; i < frame.queries.size(); i++) {
+            passes_[frame.passes[i]].total_ms += elapsed[i] / 1000000.0;
+            passes_[frame.passes[i]].samples++;
+        }
+    }
+
+    GLExtensions::DeleteQueries(frame.queries.size(), &frame.queries[0]);
+    frame.queries.clear();
+    frame.passes.clear();
+}
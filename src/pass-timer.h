@@ -0,0 +1,85 @@
+#ifndef GPULOAD_PASS_TIMER_H_
+#define GPULOAD_PASS_TIMER_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gl-headers.h"
+
+/**
+ * Measures the time each pass of a frame takes, e.g. each renderer of a
+ * scene or the resolve of an offscreen canvas.
+ *
+ * Passes are timed either on the GPU with timer queries, whose results are
+ * read a few frames later so the pipeline isn't drained, or on the CPU by
+ * calling glFinish() before and after each pass. The latter is only meant
+ * for diagnosis, as it serializes the CPU and GPU work.
+ */
+class PassTimer
+{
+public:
+    enum Mode {
+        ModeGPU,
+        ModeFinish
+    };
+
+    PassTimer(Mode mode);
+    ~PassTimer();
+
+    /**
+     * Whether GPU timer queries are supported by the current context.
+     */
+    static bool gpu_supported();
+
+    /**
+     * Starts a new frame, collecting the results of earlier frames.
+     */
+    void begin_frame();
+
+    /**
+     * Starts and ends timing a pass. Passes can't be nested.
+     *
+     * @param name the name of the pass, used to accumulate its times
+     */
+    void begin(const std::string &name);
+    void end();
+
+    /**
+     * Logs the average time of each pass, and its percentage of a frame.
+     *
+     * @param frame_ms the average frame time in milliseconds
+     */
+    void report(double frame_ms);
+
+private:
+    struct Pass
+    {
+        Pass(const std::string &n) : name(n), total_ms(0.0), samples(0) {}
+        std::string name;
+        double total_ms;
+        unsigned int samples;
+    };
+
+    /* The queries of a frame, with the index of the pass each one timed */
+    struct FrameQueries
+    {
+        std::vector<GLuint> queries;
+        std::vector<unsigned int> passes;
+    };
+
+    unsigned int pass_index(const std::string &name);
+    void collect(FrameQueries &frame);
+
+    Mode mode_;
+    std::vector<Pass> passes_;
+    std::map<std::string, unsigned int> pass_indices_;
+    unsigned int current_;
+    uint64_t start_us_;
+
+    std::vector<FrameQueries> frames_;
+    unsigned int frame_;
+};
+
+#endif
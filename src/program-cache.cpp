@@ -0,0 +1,223 @@
+#include "program-cache.h"
+#include "gl-headers.h"
+#include "log.h"
+#include "options.h"
+#include "program.h"
+#include "util.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+namespace
+{
+
+const char cache_magic[8] = { 'G', 'P', 'U', 'P', 'B', 'I', 'N', '\0' };
+const uint32_t cache_version = 1;
+
+/* Header fields following the magic, as native-endian 32-bit words */
+enum CacheHeaderField {
+    CacheHeaderVersion,
+    CacheHeaderFormat,
+    CacheHeaderKeySize,
+    CacheHeaderBinarySize,
+    CacheHeaderFields
+};
+
+/* 64-bit FNV-1a */
+uint64_t
+hash(const unsigned char *data, size_t size, uint64_t h = 0xcbf29ce484222325ULL)
+{
+    for (size_t i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 0x100000001b3ULL;
+    }
+
+    return h;
+}
+
+std::string
+gl_string(GLenum name)
+{
+    const char *str = reinterpret_cast<const char *>(glGetString(name));
+    return str ? str : "";
+}
+
+/*
+ * The full cache key. It is stored in the entry as well, so that hash
+ * collisions can't return the wrong program.
+ */
+std::string
+cache_key(const std::string &vtx_shader, const std::string &frg_shader)
+{
+    std::string key;
+
+    key += gl_string(GL_VENDOR) + '\n';
+    key += gl_string(GL_RENDERER) + '\n';
+    key += gl_string(GL_VERSION) + '\n';
+    key += vtx_shader;
+    key += '\0';
+    key += frg_shader;
+
+    return key;
+}
+
+std::string
+cache_path(const std::string &key)
+{
+    uint64_t h = hash(reinterpret_cast<const unsigned char *>(key.data()), key.size());
+    char name[32];
+
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(h));
+
+    return Options::program_cache + "/" + name;
+}
+
+bool
+make_directory(const std::string &path)
+{
+#ifdef _WIN32
+    int ret = _mkdir(path.c_str());
+#else
+    int ret = mkdir(path.c_str(), 0755);
+#endif
+    return ret == 0 || errno == EEXIST;
+}
+
+}
+
+bool
+ProgramCache::enabled()
+{
+    if (Options::program_cache.empty() ||
+        !GLExtensions::GetProgramBinary || !GLExtensions::ProgramBinary)
+    {
+        return false;
+    }
+
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+    return num_formats > 0;
+}
+
+bool
+ProgramCache::load(Program &program, const std::string &vtx_shader,
+                   const std::string &frg_shader)
+{
+    std::string key(cache_key(vtx_shader, frg_shader));
+    std::string path(cache_path(key));
+    std::ifstream is(path.c_str(), std::ios::binary);
+
+    if (!is)
+        return false;
+
+    char magic[sizeof(cache_magic)];
+    uint32_t header[CacheHeaderFields];
+    uint64_t checksum;
+
+    is.read(magic, sizeof(magic));
+    is.read(reinterpret_cast<char *>(header), sizeof(header));
+    is.read(reinterpret_cast<char *>(&checksum), sizeof(checksum));
+
+    if (!is || memcmp(magic, cache_magic, sizeof(magic)) ||
+        header[CacheHeaderVersion] != cache_version ||
+        header[CacheHeaderKeySize] != key.size())
+    {
+        Log::debug("Ignoring invalid program cache entry %s\n", path.c_str());
+        return false;
+    }
+
+    std::string stored_key(key.size(), '\0');
+    std::vector<unsigned char> binary(header[CacheHeaderBinarySize]);
+
+    is.read(&stored_key[0], stored_key.size());
+    if (!binary.empty())
+        is.read(reinterpret_cast<char *>(&binary[0]), binary.size());
+
+    if (!is || stored_key != key || binary.empty() ||
+        hash(&binary[0], binary.size()) != checksum)
+    {
+        Log::debug("Ignoring invalid program cache entry %s\n", path.c_str());
+        return false;
+    }
+
+    program.loadBinary(header[CacheHeaderFormat], binary);
+    if (!program.ready()) {
+        Log::debug("Program binary %s was rejected, rebuilding\n", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void
+ProgramCache::store(Program &program, const std::string &vtx_shader,
+                    const std::string &frg_shader)
+{
+    unsigned int format = 0;
+    std::vector<unsigned char> binary;
+
+    if (!program.getBinary(format, binary))
+        return;
+
+    std::string key(cache_key(vtx_shader, frg_shader));
+    std::string path(cache_path(key));
+
+    /* Write to a unique temporary file and move it into place */
+    std::stringstream ss;
+    ss << path << ".tmp" << Util::get_timestamp_us();
+    std::string tmp_path(ss.str());
+
+    std::ofstream os(tmp_path.c_str(), std::ios::binary);
+    if (!os && make_directory(Options::program_cache))
+        os.open(tmp_path.c_str(), std::ios::binary);
+
+    if (!os) {
+        Log::debug("Couldn't create program cache entry %s\n", tmp_path.c_str());
+        return;
+    }
+
+    uint32_t header[CacheHeaderFields];
+    header[CacheHeaderVersion] = cache_version;
+    header[CacheHeaderFormat] = format;
+    header[CacheHeaderKeySize] = key.size();
+    header[CacheHeaderBinarySize] = binary.size();
+    uint64_t checksum = hash(&binary[0], binary.size());
+
+    os.write(cache_magic, sizeof(cache_magic));
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+    os.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+    os.write(key.data(), key.size());
+    os.write(reinterpret_cast<const char *>(&binary[0]), binary.size());
+    os.close();
+
+    if (!os) {
+        Log::debug("Couldn't write program cache entry %s\n", tmp_path.c_str());
+        remove(tmp_path.c_str());
+        return;
+    }
+
+#ifdef _WIN32
+    /* rename() doesn't replace existing files on Windows */
+    remove(path.c_str());
+#endif
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+        Log::debug("Couldn't move program cache entry into place %s\n", path.c_str());
+        remove(tmp_path.c_str());
+    }
+}
+
+ProgramCache::Stats &
+ProgramCache::stats()
+{
+    static Stats stats;
+    return stats;
+}
@@ -0,0 +1,73 @@
+#ifndef GPULOAD_PROGRAM_CACHE_H_
+#define GPULOAD_PROGRAM_CACHE_H_
+
+#include <stdint.h>
+#include <string>
+
+class Program;
+
+/**
+ * A persistent cache of linked program binaries.
+ *
+ * Programs are keyed by a hash of their final shader sources together with
+ * the GL vendor, renderer and version strings, so binaries are never used
+ * with a different driver. Each entry is a file in the cache directory
+ * (see --program-cache), written to a temporary file and renamed into
+ * place, so an interrupted run can't leave a partial entry behind. Entries
+ * that fail to load, for any reason, are treated as misses and rewritten.
+ */
+class ProgramCache
+{
+public:
+    struct Stats
+    {
+        Stats() : programs(0), hits(0), build_us(0) {}
+
+        /* The number of programs built */
+        unsigned int programs;
+        /* The number of programs loaded from the cache */
+        unsigned int hits;
+        /* The total time spent building programs, in microseconds */
+        uint64_t build_us;
+    };
+
+    /**
+     * Whether the cache is enabled and supported by the GL implementation.
+     */
+    static bool enabled();
+
+    /**
+     * Loads a program from the cache.
+     *
+     * @param program the program to load, which must be initialized
+     *                and have no shaders
+     * @param vtx_shader the vertex shader source
+     * @param frg_shader the fragment shader source
+     *
+     * @return whether the program was found and is ready
+     */
+    static bool load(Program &program, const std::string &vtx_shader,
+                     const std::string &frg_shader);
+
+    /**
+     * Stores a built program in the cache.
+     *
+     * @param program the built program
+     * @param vtx_shader the vertex shader source
+     * @param frg_shader the fragment shader source
+     */
+    static void store(Program &program, const std::string &vtx_shader,
+                      const std::string &frg_shader);
+
+    /**
+     * Gets the program build statistics since the last reset_stats().
+     */
+    static Stats &stats();
+
+    /**
+     * Resets the program build statistics.
+     */
+    static void reset_stats() { stats() = Stats(); }
+};
+
+#endif
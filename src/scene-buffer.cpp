@@ -8,6 +8,115 @@
 #include "util.h"
 #include "gl-headers.h"
 #include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*****************************
+ * WorkerPool implementation *
+ *****************************/
+
+/**
+ * A pool of persistent threads that split loops between them.
+ *
+ * Unlike spawning threads for each loop, the pool is cheap enough to use
+ * several times per frame.
+ */
+class WorkerPool
+{
+public:
+    /**
+     * Creates a worker pool.
+     *
+     * @param nthreads the number of threads taking part in each loop,
+     *                 including the calling thread
+     */
+    WorkerPool(unsigned int nthreads) :
+        nthreads_(std::max(nthreads, 1U)), count_(0), generation_(0),
+        pending_(0), stop_(false)
+    {
+        for (unsigned int i = 0; i < nthreads_ - 1; i++)
+            threads_.push_back(std::thread(&WorkerPool::run_worker, this, i));
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+
+        for (unsigned int i = 0; i < threads_.size(); i++)
+            threads_[i].join();
+    }
+
+    unsigned int nthreads() const { return nthreads_; }
+
+    /**
+     * Runs func(first, last) over [0, count) split into contiguous ranges,
+     * one per thread, and waits for all of them to finish. The calling
+     * thread processes the last range itself.
+     */
+    void parallel_for(size_t count, const std::function<void(size_t, size_t)> &func)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            func_ = func;
+            count_ = count;
+            pending_ = threads_.size();
+            generation_++;
+        }
+        work_cv_.notify_all();
+
+        func(chunk_start(nthreads_ - 1), count);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+private:
+    size_t chunk_start(unsigned int index) const
+    {
+        return count_ * index / nthreads_;
+    }
+
+    void run_worker(unsigned int index)
+    {
+        unsigned int generation = 0;
+
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [&] { return stop_ || generation_ != generation; });
+            if (stop_)
+                return;
+
+            generation = generation_;
+            size_t first = chunk_start(index);
+            size_t last = chunk_start(index + 1);
+            lock.unlock();
+
+            func_(first, last);
+
+            lock.lock();
+            if (--pending_ == 0)
+                done_cv_.notify_one();
+        }
+    }
+
+    unsigned int nthreads_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::function<void(size_t, size_t)> func_;
+    size_t count_;
+    unsigned int generation_;
+    unsigned int pending_;
+    bool stop_;
+};
 
 /***********************
  * Wave implementation *
@@ -75,14 +184,48 @@ public:
         wave_k_(2 * M_PI / (wavelength * length)),
         wave_period_(2.0 * M_PI / wave_k_),
         wave_full_period_(wave_period_ / duty_cycle),
-        wave_velocity_(0.1 * length), displacement_(nlength + 1)
+        wave_velocity_(0.1 * length), displacement_(nlength + 1),
+        job_pending_(false), job_stop_(false), job_elapsed_(0.0)
     {
         create_program();
         create_mesh();
     }
 
 
-    ~WaveMesh() { reset(); }
+    ~WaveMesh()
+    {
+        stop_parallel();
+        reset();
+    }
+
+    /**
+     * Computes the vertex data on a pool of worker threads instead of the
+     * render thread.
+     *
+     * The data is double-buffered: while a frame renders from the VBO, the
+     * workers prepare the mesh vertices for the next update, which uploads
+     * them and starts preparing the following frame. The uploaded data thus
+     * lags one update behind.
+     *
+     * @param nthreads the number of worker threads, 0 for one per CPU
+     */
+    void parallel_update(unsigned int nthreads)
+    {
+        stop_parallel();
+
+        if (nthreads == 0)
+            nthreads = std::max(std::thread::hardware_concurrency(), 1U);
+
+        displacement_.assign(nlength_ + 1, 0.0);
+        changed_.assign(nlength_ + 1, 0);
+        job_ranges_.clear();
+        job_pending_ = false;
+        job_stop_ = false;
+
+        /* The job thread takes part in the loops, so it's one of the workers */
+        pool_.reset(new WorkerPool(nthreads));
+        job_thread_ = std::thread(&WaveMesh::run_jobs, this);
+    }
 
     /**
      * Updates the state of a wave mesh.
@@ -91,6 +234,21 @@ public:
      */
     void update(double elapsed)
     {
+        if (pool_) {
+            std::unique_lock<std::mutex> lock(job_mutex_);
+
+            /* Upload the data of the previous job and start the next one */
+            job_cv_.wait(lock, [this] { return !job_pending_; });
+            if (!job_ranges_.empty())
+                mesh_.update_vbo(job_ranges_);
+
+            job_elapsed_ = elapsed;
+            job_pending_ = true;
+            lock.unlock();
+            job_cv_.notify_all();
+            return;
+        }
+
         std::vector<std::vector<float> >& vertices(mesh_.vertices());
 
         /* Figure out which length index ranges need update */
@@ -167,6 +325,127 @@ private:
 
     std::vector<double> displacement_;
 
+    /* Parallel update state */
+    std::unique_ptr<WorkerPool> pool_;
+    std::thread job_thread_;
+    std::mutex job_mutex_;
+    std::condition_variable job_cv_;
+    bool job_pending_;
+    bool job_stop_;
+    double job_elapsed_;
+    /* The vertex ranges updated by the last job */
+    std::vector<std::pair<size_t, size_t> > job_ranges_;
+    /* The length indices whose displacement changed in the last job */
+    std::vector<char> changed_;
+
+    /**
+     * Stops the parallel update threads, after the current job finishes.
+     */
+    void stop_parallel()
+    {
+        if (!job_thread_.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(job_mutex_);
+            job_stop_ = true;
+        }
+        job_cv_.notify_all();
+        job_thread_.join();
+        pool_.reset();
+    }
+
+    /**
+     * Runs the parallel update jobs, one for each update.
+     */
+    void run_jobs()
+    {
+        while (true) {
+            std::unique_lock<std::mutex> lock(job_mutex_);
+            job_cv_.wait(lock, [this] { return job_stop_ || job_pending_; });
+            if (job_stop_)
+                return;
+
+            double elapsed = job_elapsed_;
+            lock.unlock();
+
+            run_job(elapsed);
+
+            lock.lock();
+            job_pending_ = false;
+            lock.unlock();
+            job_cv_.notify_all();
+        }
+    }
+
+    /**
+     * Computes the displacement field and writes the vertices of the changed
+     * ranges to the mesh on the worker pool, setting job_ranges_.
+     *
+     * @param elapsed the time elapsed since the beginning of the rendering
+     */
+    void run_job(double elapsed)
+    {
+        std::vector<std::vector<float> >& vertices(mesh_.vertices());
+
+        /* Compute the displacement field, marking the changed length indices */
+        pool_->parallel_for(nlength_ + 1, [&](size_t first, size_t last) {
+            for (size_t n = first; n < last; n++) {
+                double d(displacement(n, elapsed));
+
+                changed_[n] = d != displacement_[n];
+                displacement_[n] = d;
+            }
+        });
+
+        /* Figure out which length index ranges need update, as in update() */
+        std::vector<std::pair<size_t, size_t> > ranges;
+
+        for (size_t n = 0; n <= nlength_; n++) {
+            if (!changed_[n])
+                continue;
+
+            if (ranges.size() > 0 && ranges.back().second == n - 1)
+                ranges.back().second = n;
+            else
+                ranges.push_back(std::pair<size_t, size_t>(n > 0 ? n - 1 : 0, n));
+        }
+
+        /* Convert to vertex ranges, and split all their vertices between the workers */
+        std::vector<size_t> offsets(1, 0);
+
+        for (size_t i = 0; i < ranges.size(); i++) {
+            size_t vstart(ranges[i].first * nwidth_ * 6 + (ranges[i].first % 2));
+            size_t vend((ranges[i].second + (ranges[i].second < nlength_)) * nwidth_ * 6);
+
+            ranges[i] = std::pair<size_t, size_t>(vstart, vend - 1);
+            offsets.push_back(offsets.back() + vend - vstart);
+        }
+
+        pool_->parallel_for(offsets.back(), [&](size_t first, size_t last) {
+            for (size_t i = 0; i < ranges.size() && first < last; i++) {
+                if (first >= offsets[i + 1])
+                    continue;
+
+                size_t v = ranges[i].first + (first - offsets[i]);
+                size_t vend = ranges[i].first + (std::min(last, offsets[i + 1]) - offsets[i]);
+
+                for (; v < vend; v++) {
+                    size_t vt = 3 * (v / 3);
+                    vertices[v][0 * 3 + 2] = displacement_[vertex_length_index(v)];
+                    vertices[v][1 * 3 + 2] = displacement_[vertex_length_index(vt)];
+                    vertices[v][2 * 3 + 2] = displacement_[vertex_length_index(vt + 1)];
+                    vertices[v][3 * 3 + 2] = displacement_[vertex_length_index(vt + 2)];
+                }
+
+                first = std::min(last, offsets[i + 1]);
+            }
+        });
+
+        std::lock_guard<std::mutex> lock(job_mutex_);
+        job_ranges_.swap(ranges);
+    }
+
     /**
      * Calculates the length index of a vertex.
      */
@@ -277,6 +556,24 @@ struct SceneBufferPrivate {
     ~SceneBufferPrivate() { delete wave; }
 };
 
+/**
+ * Gets the Mesh update method for an update-method option value.
+ */
+static Mesh::VBOUpdateMethod
+vbo_update_method_from_string(const std::string &str)
+{
+    if (str == "subdata")
+        return Mesh::VBOUpdateMethodSubData;
+    else if (str == "orphan")
+        return Mesh::VBOUpdateMethodOrphan;
+    else if (str == "map-range")
+        return Mesh::VBOUpdateMethodMapRange;
+    else if (str == "persistent")
+        return Mesh::VBOUpdateMethodPersistent;
+    else
+        return Mesh::VBOUpdateMethodMap;
+}
+
 SceneBuffer::SceneBuffer(Canvas &pCanvas) :
     Scene(pCanvas, "buffer")
 {
@@ -286,7 +583,9 @@ SceneBuffer::SceneBuffer(Canvas &pCanvas) :
                                            "false,true");
     options_["update-method"] = Scene::Option("update-method", "map",
                                               "Which method to use to update vertex data",
-                                              "map,subdata");
+                                              "map,subdata,orphan,map-range,persistent");
+    options_["ring-size"] = Scene::Option("ring-size", "3",
+                                          "The number of buffer segments in flight with the map-range and persistent update methods");
     options_["update-fraction"] = Scene::Option("update-fraction", "1.0",
                                                 "The fraction of the mesh length that is updated at every iteration (0.0-1.0)");
     options_["update-dispersion"] = Scene::Option("update-dispersion", "0.0",
@@ -298,6 +597,11 @@ SceneBuffer::SceneBuffer(Canvas &pCanvas) :
     options_["buffer-usage"] = Scene::Option("buffer-usage", "static",
                                              "How the buffer will be used",
                                              "static,stream,dynamic");
+    options_["cpu-update"] = Scene::Option("cpu-update", "single",
+                                           "Whether to compute the vertex data on the render thread or, one frame ahead, on a pool of worker threads",
+                                           "single,parallel");
+    options_["cpu-threads"] = Scene::Option("cpu-threads", "0",
+                                            "The number of worker threads for the parallel CPU update (0 for one per CPU)");
 }
 
 SceneBuffer::~SceneBuffer()
@@ -308,12 +612,20 @@ SceneBuffer::~SceneBuffer()
 bool
 SceneBuffer::supported(bool show_errors)
 {
-    if (options_["update-method"].value != "subdata" &&
-        (GLExtensions::MapBuffer == 0 || GLExtensions::UnmapBuffer == 0))
-    {
+    const std::string &method(options_["update-method"].value);
+
+    if (!Mesh::vbo_update_method_supported(vbo_update_method_from_string(method))) {
         if (show_errors) {
-            Log::error("Requested MapBuffer VBO update method but GL_OES_mapbuffer"
-                       " is not supported!\n");
+            if (method == "map-range" || method == "persistent") {
+                Log::error("Requested %s VBO update method but the required"
+                           " map buffer range, sync%s support is missing!\n",
+                           method.c_str(),
+                           method == "persistent" ? " and buffer storage" : "");
+            }
+            else {
+                Log::error("Requested MapBuffer VBO update method but GL_OES_mapbuffer"
+                           " is not supported!\n");
+            }
         }
         return false;
     }
@@ -349,13 +661,9 @@ SceneBuffer::setup()
     double update_dispersion;
     size_t nlength;
     size_t nwidth;
+    unsigned int ring_size;
 
-    if (options_["update-method"].value == "map")
-        update_method = Mesh::VBOUpdateMethodMap;
-    else if (options_["update-method"].value == "subdata")
-        update_method = Mesh::VBOUpdateMethodSubData;
-    else
-        update_method = Mesh::VBOUpdateMethodMap;
+    update_method = vbo_update_method_from_string(options_["update-method"].value);
 
     if (options_["buffer-usage"].value == "static")
         usage = Mesh::VBOUsageStatic;
@@ -368,6 +676,7 @@ SceneBuffer::setup()
     update_dispersion = Util::fromString<double>(options_["update-dispersion"].value);
     nlength = Util::fromString<size_t>(options_["columns"].value);
     nwidth = Util::fromString<size_t>(options_["rows"].value);
+    ring_size = Util::fromString<unsigned int>(options_["ring-size"].value);
 
 
     priv_->wave = new WaveMesh(5.0, 2.0, nlength, nwidth,
@@ -377,8 +686,14 @@ SceneBuffer::setup()
     priv_->wave->mesh().interleave(interleave);
     priv_->wave->mesh().vbo_update_method(update_method);
     priv_->wave->mesh().vbo_usage(usage);
+    priv_->wave->mesh().vbo_ring_size(ring_size);
     priv_->wave->mesh().build_vbo();
 
+    if (options_["cpu-update"].value == "parallel") {
+        priv_->wave->parallel_update(
+            Util::fromString<unsigned int>(options_["cpu-threads"].value));
+    }
+
     priv_->wave->program().start();
     priv_->wave->program()["Viewport"] = LibMatrix::vec2(canvas_.width(), canvas_.height());
 
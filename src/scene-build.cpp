@@ -36,6 +36,10 @@ SceneBuild::SceneBuild(Canvas &pCanvas) :
                                            "false,true");
     options_["model"] = Scene::Option("model", "horse", "Which model to use",
                                       optionValues);
+    options_["lod"] = Scene::Option("lod", "0",
+                                    "The level of detail of the model to use (0 is the original model, each level halves the triangle count)");
+    options_["triangles"] = Scene::Option("triangles", "0",
+                                          "Simplify the model to this number of triangles (0 to disable, overrides 'lod')");
 }
 
 SceneBuild::~SceneBuild()
@@ -119,6 +123,12 @@ SceneBuild::setup()
         orientationVec_ = vec3(0.0, 1.0, 0.0);
     }
 
+    unsigned int triangles(Util::fromString<unsigned int>(options_["triangles"].value));
+    if (triangles > 0)
+        model.select_triangles(triangles);
+    else
+        model.select_lod(Util::fromString<unsigned int>(options_["lod"].value));
+
     if (model.needNormals())
         model.calculate_normals();
 
@@ -17,6 +17,9 @@ SceneBump::SceneBump(Canvas &pCanvas) :
     options_["bump-render"] = Scene::Option("bump-render", "off",
                                             "How to render bumps",
                                             "off,normals,normals-tangent,height,high-poly");
+    options_["texture-format"] = Scene::Option("texture-format", "uncompressed",
+                                               "The format of the bump map textures (compressed formats are decoded on the CPU if unsupported)",
+                                               "uncompressed,etc2,astc");
 }
 
 SceneBump::~SceneBump()
@@ -138,7 +141,9 @@ SceneBump::setup_model_normals()
     attrib_locations.push_back(program_["texcoord"].location());
     mesh_.set_attrib_locations(attrib_locations);
 
-    if (!Texture::load("asteroid-normal-map", &texture_,
+    if (!Texture::load(Texture::name_for_format("asteroid-normal-map",
+                                                options_["texture-format"].value),
+                       &texture_,
                        GL_NEAREST, GL_NEAREST, 0))
     {
         return false;
@@ -196,7 +201,9 @@ SceneBump::setup_model_normals_tangent()
     attrib_locations.push_back(program_["tangent"].location());
     mesh_.set_attrib_locations(attrib_locations);
 
-    if (!Texture::load("asteroid-normal-map-tangent", &texture_,
+    if (!Texture::load(Texture::name_for_format("asteroid-normal-map-tangent",
+                                                options_["texture-format"].value),
+                       &texture_,
                        GL_NEAREST, GL_NEAREST, 0))
     {
         return false;
@@ -256,7 +263,9 @@ SceneBump::setup_model_height()
     attrib_locations.push_back(program_["tangent"].location());
     mesh_.set_attrib_locations(attrib_locations);
 
-    if (!Texture::load("asteroid-height-map", &texture_,
+    if (!Texture::load(Texture::name_for_format("asteroid-height-map",
+                                                options_["texture-format"].value),
+                       &texture_,
                        GL_NEAREST, GL_NEAREST, 0))
     {
         return false;
@@ -54,6 +54,13 @@ private:
         scenes_.push_back(new SceneShadow(canvas));
         scenes_.push_back(new SceneRefract(canvas));
         scenes_.push_back(new SceneClear(canvas));
+        scenes_.push_back(new SceneShaderCompile(canvas));
+        scenes_.push_back(new SceneInstancing(canvas));
+        scenes_.push_back(new SceneOverhead(canvas));
+        scenes_.push_back(new SceneCompute(canvas));
+        scenes_.push_back(new SceneFillrate(canvas));
+        scenes_.push_back(new SceneTBDR(canvas));
+        scenes_.push_back(new SceneTextureStream(canvas));
 
     }
 };
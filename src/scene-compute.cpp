@@ -0,0 +1,750 @@
+#include "scene.h"
+#include "log.h"
+#include "options.h"
+#include "shader-source.h"
+#include "util.h"
+#include "gl-headers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+enum ComputeTest {
+    ComputeTestParticles,
+    ComputeTestReduce,
+    ComputeTestScan,
+    ComputeTestConvolution,
+    ComputeTests
+};
+
+const char *compute_test_names[ComputeTests] = {
+    "particles", "reduce", "scan", "convolution"
+};
+
+/* The parameters of the particle integration, see compute-particles.comp */
+const float particle_time_step = 0.002f;
+const float particle_damping = 0.999f;
+const float particle_strength = 0.1f;
+const float particle_softening = 0.01f;
+const float particle_attractors[4][3] = {
+    {0.5f, 0.5f, 0.0f}, {-0.5f, 0.5f, 0.0f},
+    {-0.5f, -0.5f, 0.0f}, {0.5f, -0.5f, 0.0f}
+};
+
+/*
+ * The floating point operations of a step of a particle (19 for each of the
+ * 4 attractors, 15 for the integration) and of a pixel of the 5x5
+ * convolution (a weight product, and 4 multiply-adds, for each tap).
+ * inversesqrt() counts as one operation.
+ */
+const double particle_flops = 91.0;
+const double convolution_flops = 225.0;
+
+/* The size of the work groups of the convolution, see compute-convolution.comp */
+const unsigned int convolution_tile = 16;
+
+/**
+ * Hashes an integer, to generate the same pseudo-random input data on
+ * every run.
+ */
+unsigned int
+hash(unsigned int x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * Gets a pseudo-random float in [-1.0, 1.0].
+ */
+float
+hash_float(unsigned int x)
+{
+    return (hash(x) & 0xffff) / 32767.5f - 1.0f;
+}
+
+}
+
+struct SceneComputePrivate
+{
+    SceneComputePrivate() :
+        test(ComputeTestParticles), elements(0), image_size(0), local_size(0),
+        dispatches(0), groups(0), total_dispatches(0), images(), fbo(0) {}
+
+    ComputeTest test;
+    unsigned int elements;
+    unsigned int image_size;
+    unsigned int local_size;
+    unsigned int dispatches;
+    unsigned int groups;
+    uint64_t total_dispatches;
+
+    /* The compute programs of the passes of the test */
+    std::vector<Program *> programs;
+    Program render_program;
+
+    std::vector<GLuint> buffers;
+    std::vector<float> input;
+    std::vector<unsigned char> image;
+    GLuint images[2];
+    GLuint fbo;
+
+    ~SceneComputePrivate() { Util::dispose_pointer_vector(programs); }
+};
+
+SceneCompute::SceneCompute(Canvas &pCanvas) :
+    Scene(pCanvas, "compute")
+{
+    priv_ = new SceneComputePrivate();
+
+    options_["test"] = Scene::Option("test", "particles",
+            "The compute workload (particles: particle integration in storage buffers, "
+            "reduce: parallel sum, scan: parallel prefix sum, "
+            "convolution: 5x5 image convolution with image load/store)",
+            "particles,reduce,scan,convolution");
+    options_["elements"] = Scene::Option("elements", "1048576",
+            "The number of particles or values of the particles, reduce and scan tests");
+    options_["image-size"] = Scene::Option("image-size", "1024",
+            "The width and height of the image of the convolution test");
+    options_["workgroup-size"] = Scene::Option("workgroup-size", "256",
+            "The size of the work groups of the particles, reduce and scan tests (a power of two)");
+    options_["dispatches"] = Scene::Option("dispatches", "4",
+            "The number of times the workload runs every frame");
+}
+
+SceneCompute::~SceneCompute()
+{
+    delete priv_;
+}
+
+bool
+SceneCompute::supported(bool show_errors)
+{
+    if (show_errors && !GLExtensions::DispatchCompute) {
+        Log::error("SceneCompute requires OpenGL ES 3.1 or OpenGL 4.3 compute shaders\n");
+    }
+
+    return GLExtensions::DispatchCompute;
+}
+
+bool
+SceneCompute::load()
+{
+    running_ = false;
+
+    return true;
+}
+
+void
+SceneCompute::unload()
+{
+}
+
+/**
+ * Loads a compute shader of the test.
+ *
+ * @param name the name of the shader file, without the extension
+ * @param source the shader source to complete and build
+ *
+ * @return whether loading the shader succeeded
+ */
+bool
+SceneCompute::load_compute_program(const std::string &name, ShaderSource &source)
+{
+    const std::string filename(Options::data_path + "/shaders/" + name + ".comp");
+
+#if GPULOAD_USE_GLESv2
+    source.version("310 es");
+#elif GPULOAD_USE_GL
+    source.version("430");
+#endif
+    source.append_file(filename);
+    source.replace("$LOCAL_SIZE$", Util::toString(priv_->local_size));
+
+    priv_->programs.push_back(new Program());
+
+    return Scene::load_compute_shader_from_string(*priv_->programs.back(),
+                                                  source.str(), filename);
+}
+
+bool
+SceneCompute::setup()
+{
+    if (!Scene::setup())
+        return false;
+
+    /* Parse options */
+    const char **name = std::find(compute_test_names, compute_test_names + ComputeTests,
+                                  options_["test"].value);
+    priv_->test = static_cast<ComputeTest>(name - compute_test_names);
+    priv_->elements = Util::fromString<unsigned int>(options_["elements"].value);
+    priv_->image_size = Util::fromString<unsigned int>(options_["image-size"].value);
+    priv_->local_size = Util::fromString<unsigned int>(options_["workgroup-size"].value);
+    priv_->dispatches = Util::fromString<unsigned int>(options_["dispatches"].value);
+
+    if (priv_->elements < 1 || priv_->image_size < 1 || priv_->dispatches < 1) {
+        Log::error("The elements, image size and dispatches must be at least 1\n");
+        return false;
+    }
+
+    if (priv_->local_size < 1 || (priv_->local_size & (priv_->local_size - 1))) {
+        Log::error("The work group size must be a power of two\n");
+        return false;
+    }
+
+    bool ok = true;
+
+    switch (priv_->test) {
+        case ComputeTestParticles:
+            ok = setup_particles();
+            break;
+        case ComputeTestReduce:
+            ok = setup_reduce();
+            break;
+        case ComputeTestScan:
+            ok = setup_scan();
+            break;
+        case ComputeTestConvolution:
+            ok = setup_convolution();
+            break;
+        default:
+            ok = false;
+            break;
+    }
+
+    if (!ok)
+        return false;
+
+    priv_->total_dispatches = 0;
+
+    currentFrame_ = 0;
+    running_ = true;
+    startTime_ = Util::get_timestamp_us() / 1000000.0;
+    lastUpdateTime_ = startTime_;
+
+    return true;
+}
+
+bool
+SceneCompute::setup_particles()
+{
+    ShaderSource source;
+    source.add_const("TimeStep", particle_time_step);
+    source.add_const("Damping", particle_damping);
+    source.add_const("Strength", particle_strength);
+    source.add_const("Softening", particle_softening);
+
+    if (!load_compute_program("compute-particles", source))
+        return false;
+
+    ShaderSource vtx_source(Options::data_path + "/shaders/compute-particles.vert");
+    ShaderSource frg_source(Options::data_path + "/shaders/compute-particles.frag");
+    vtx_source.add_const("Scale", LibMatrix::vec2(static_cast<float>(canvas_.height()) / canvas_.width(),
+                                                  1.0f));
+
+    if (!Scene::load_shaders_from_strings(priv_->render_program, vtx_source.str(),
+                                          frg_source.str()))
+    {
+        return false;
+    }
+
+    /* Positions followed by velocities, as vec4s */
+    unsigned int n = priv_->elements;
+    priv_->input.resize(8 * n);
+
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int j = 0; j < 3; j++) {
+            priv_->input[4 * i + j] = hash_float(6 * i + j);
+            priv_->input[4 * (n + i) + j] = 0.1f * hash_float(6 * i + 3 + j);
+        }
+        priv_->input[4 * i + 3] = 1.0f;
+        priv_->input[4 * (n + i) + 3] = 0.0f;
+    }
+
+    priv_->buffers.resize(2);
+    glGenBuffers(2, &priv_->buffers[0]);
+    upload_particles();
+
+    priv_->groups = (n + priv_->local_size - 1) / priv_->local_size;
+
+    return true;
+}
+
+bool
+SceneCompute::setup_reduce()
+{
+    ShaderSource source;
+    if (!load_compute_program("compute-reduce", source))
+        return false;
+
+    /*
+     * Small integers, so that the sums are exact, and match the CPU
+     * reference, for up to 2^20 elements.
+     */
+    priv_->input.resize(priv_->elements);
+    for (unsigned int i = 0; i < priv_->elements; i++)
+        priv_->input[i] = hash(i) % 16;
+
+    /* The partial sums are added up by a single work group */
+    priv_->groups = std::min((priv_->elements + priv_->local_size - 1) / priv_->local_size,
+                             priv_->local_size);
+
+    priv_->buffers.resize(2);
+    glGenBuffers(2, &priv_->buffers[0]);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, priv_->buffers[0]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, priv_->input.size() * sizeof(float),
+                 &priv_->input[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, priv_->buffers[1]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, priv_->groups * sizeof(float), 0, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    return true;
+}
+
+bool
+SceneCompute::setup_scan()
+{
+    ShaderSource scan_source;
+    ShaderSource sums_source;
+    ShaderSource add_source;
+
+    if (!load_compute_program("compute-scan", scan_source) ||
+        !load_compute_program("compute-scan-sums", sums_source) ||
+        !load_compute_program("compute-scan-add", add_source))
+    {
+        return false;
+    }
+
+    /* Small integers, so that the sums are exact, see setup_reduce() */
+    priv_->input.resize(priv_->elements);
+    for (unsigned int i = 0; i < priv_->elements; i++)
+        priv_->input[i] = hash(i) % 16;
+
+    priv_->groups = (priv_->elements + priv_->local_size - 1) / priv_->local_size;
+
+    /* The input, the scanned values and the totals of the work groups */
+    priv_->buffers.resize(3);
+    glGenBuffers(3, &priv_->buffers[0]);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, priv_->buffers[0]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, priv_->input.size() * sizeof(float),
+                 &priv_->input[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, priv_->buffers[1]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, priv_->input.size() * sizeof(float), 0,
+                 GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, priv_->buffers[2]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, priv_->groups * sizeof(float), 0, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    return true;
+}
+
+bool
+SceneCompute::setup_convolution()
+{
+    ShaderSource source;
+    if (!load_compute_program("compute-convolution", source))
+        return false;
+
+    unsigned int size = priv_->image_size;
+
+    priv_->image.resize(4 * size * size);
+    for (unsigned int i = 0; i < priv_->image.size(); i++)
+        priv_->image[i] = hash(i) & 0xff;
+
+    /* Image load/store needs immutable textures */
+    glGenTextures(2, priv_->images);
+    for (unsigned int i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_2D, priv_->images[i]);
+        GLExtensions::TexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, size, size);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, priv_->images[0]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE,
+                    &priv_->image[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    /* To read the results back */
+    GLExtensions::GenFramebuffers(1, &priv_->fbo);
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, priv_->fbo);
+    GLExtensions::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                       GL_TEXTURE_2D, priv_->images[1], 0);
+    unsigned int status = GLExtensions::CheckFramebufferStatus(GL_FRAMEBUFFER);
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_.fbo());
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        Log::error("SceneCompute: glCheckFramebufferStatus failed (0x%x)\n", status);
+        return false;
+    }
+
+    priv_->groups = (size + convolution_tile - 1) / convolution_tile;
+
+    return true;
+}
+
+void
+SceneCompute::teardown()
+{
+    double elapsed = lastUpdateTime_ - startTime_;
+
+    if (elapsed > 0.0 && priv_->total_dispatches > 0) {
+        double flops = 0.0;
+        double bytes = 0.0;
+        double n = priv_->elements;
+        double pixels = static_cast<double>(priv_->image_size) * priv_->image_size;
+
+        /* The work and memory traffic the algorithms need, not the actual ones */
+        switch (priv_->test) {
+            case ComputeTestParticles:
+                flops = particle_flops * n;
+                bytes = 4 * 16 * n;
+                break;
+            case ComputeTestReduce:
+                flops = n;
+                bytes = 4 * n;
+                break;
+            case ComputeTestScan:
+                flops = n;
+                bytes = 2 * 4 * n;
+                break;
+            case ComputeTestConvolution:
+                flops = convolution_flops * pixels;
+                bytes = 2 * 4 * pixels;
+                break;
+            default:
+                break;
+        }
+
+        double rate = priv_->total_dispatches / elapsed;
+
+        Log::info("    %s: %.2f GFLOP/s, %.2f GB/s (%.1f runs/s)\n",
+                  compute_test_names[priv_->test],
+                  flops * rate / 1e9, bytes * rate / 1e9, rate);
+    }
+
+    if (!priv_->buffers.empty())
+        glDeleteBuffers(priv_->buffers.size(), &priv_->buffers[0]);
+    priv_->buffers.clear();
+
+    if (priv_->images[0]) {
+        glDeleteTextures(2, priv_->images);
+        priv_->images[0] = priv_->images[1] = 0;
+    }
+
+    if (priv_->fbo) {
+        GLExtensions::DeleteFramebuffers(1, &priv_->fbo);
+        priv_->fbo = 0;
+    }
+
+    for (unsigned int i = 0; i < priv_->programs.size(); i++) {
+        priv_->programs[i]->stop();
+        priv_->programs[i]->release();
+    }
+    Util::dispose_pointer_vector(priv_->programs);
+    priv_->render_program.release();
+
+    priv_->input.clear();
+    priv_->image.clear();
+
+    Scene::teardown();
+}
+
+void
+SceneCompute::update()
+{
+    Scene::update();
+}
+
+void
+SceneCompute::draw()
+{
+    for (unsigned int i = 0; i < priv_->dispatches; i++)
+        run();
+
+    priv_->total_dispatches += priv_->dispatches;
+
+    /* Show the particles, reading the positions as vertex attributes */
+    if (priv_->test == ComputeTestParticles) {
+        GLExtensions::MemoryBarrierGL(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+        Program &program(priv_->render_program);
+        GLint position = program["position"].location();
+
+        program.start();
+        glBindBuffer(GL_ARRAY_BUFFER, priv_->buffers[0]);
+        glVertexAttribPointer(position, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(position);
+        glDrawArrays(GL_POINTS, 0, priv_->elements);
+        glDisableVertexAttribArray(position);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        program.stop();
+    }
+}
+
+/**
+ * Runs the workload of the test once.
+ */
+void
+SceneCompute::run()
+{
+    std::vector<Program *> &programs(priv_->programs);
+    int count = priv_->elements;
+
+    switch (priv_->test) {
+        case ComputeTestParticles:
+            GLExtensions::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, priv_->buffers[0]);
+            GLExtensions::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, priv_->buffers[1]);
+            programs[0]->start();
+            (*programs[0])["Count"] = count;
+            GLExtensions::DispatchCompute(priv_->groups, 1, 1);
+            GLExtensions::MemoryBarrierGL(GL_SHADER_STORAGE_BARRIER_BIT);
+            break;
+
+        case ComputeTestReduce:
+            /* The partial sums of the groups, then their sum */
+            GLExtensions::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, priv_->buffers[0]);
+            GLExtensions::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, priv_->buffers[1]);
+            programs[0]->start();
+            (*programs[0])["Count"] = count;
+            GLExtensions::DispatchCompute(priv_->groups, 1, 1);
+            GLExtensions::MemoryBarrierGL(GL_SHADER_STORAGE_BARRIER_BIT);
+
+            GLExtensions::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, priv_->buffers[1]);
+            (*programs[0])["Count"] = static_cast<int>(priv_->groups);
+            GLExtensions::DispatchCompute(1, 1, 1);
+            GLExtensions::MemoryBarrierGL(GL_SHADER_STORAGE_BARRIER_BIT);
+            break;
+
+        case ComputeTestScan:
+            /* Scan the groups, then their totals, then add them to the groups */
+            for (unsigned int i = 0; i < 3; i++)
+                GLExtensions::BindBufferBase(GL_SHADER_STORAGE_BUFFER, i, priv_->buffers[i]);
+
+            programs[0]->start();
+            (*programs[0])["Count"] = count;
+            GLExtensions::DispatchCompute(priv_->groups, 1, 1);
+            GLExtensions::MemoryBarrierGL(GL_SHADER_STORAGE_BARRIER_BIT);
+
+            programs[1]->start();
+            (*programs[1])["Count"] = static_cast<int>(priv_->groups);
+            GLExtensions::DispatchCompute(1, 1, 1);
+            GLExtensions::MemoryBarrierGL(GL_SHADER_STORAGE_BARRIER_BIT);
+
+            programs[2]->start();
+            (*programs[2])["Count"] = count;
+            GLExtensions::DispatchCompute(priv_->groups, 1, 1);
+            GLExtensions::MemoryBarrierGL(GL_SHADER_STORAGE_BARRIER_BIT);
+            break;
+
+        case ComputeTestConvolution:
+            GLExtensions::BindImageTexture(0, priv_->images[0], 0, GL_FALSE, 0,
+                                           GL_READ_ONLY, GL_RGBA8);
+            GLExtensions::BindImageTexture(1, priv_->images[1], 0, GL_FALSE, 0,
+                                           GL_WRITE_ONLY, GL_RGBA8);
+            programs[0]->start();
+            GLExtensions::DispatchCompute(priv_->groups, priv_->groups, 1);
+            GLExtensions::MemoryBarrierGL(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * Uploads the initial positions and velocities of the particles.
+ */
+void
+SceneCompute::upload_particles()
+{
+    size_t size = 4 * priv_->elements * sizeof(float);
+
+    for (unsigned int i = 0; i < 2; i++) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, priv_->buffers[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, &priv_->input[i * 4 * priv_->elements],
+                     GL_DYNAMIC_COPY);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/**
+ * Reads back the contents of a storage buffer.
+ *
+ * @param buffer the buffer to read
+ * @param count the number of floats to read
+ * @param[out] data the contents of the buffer
+ *
+ * @return whether reading the buffer succeeded
+ */
+bool
+SceneCompute::read_buffer(GLuint buffer, unsigned int count, std::vector<float> &data)
+{
+    GLExtensions::MemoryBarrierGL(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    void *ptr = GLExtensions::MapBufferRange(GL_SHADER_STORAGE_BUFFER, 0,
+                                             count * sizeof(float), GL_MAP_READ_BIT);
+    if (ptr) {
+        data.resize(count);
+        std::memcpy(&data[0], ptr, count * sizeof(float));
+        GLExtensions::UnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (!ptr)
+        Log::debug("SceneCompute: failed to map the results\n");
+
+    return ptr != 0;
+}
+
+/**
+ * Checks that a result matches its CPU reference, within a relative
+ * tolerance.
+ */
+static bool
+matches(float result, float reference, float tolerance)
+{
+    return std::fabs(result - reference) <= tolerance * std::max(1.0f, std::fabs(reference));
+}
+
+Scene::ValidationResult
+SceneCompute::validate()
+{
+    static const float tolerance = 0.001f;
+    unsigned int n = priv_->elements;
+    unsigned int mismatches = 0;
+    std::vector<float> result;
+
+    /* Run the workload once more on the initial data, and check it with the CPU */
+    switch (priv_->test) {
+        case ComputeTestParticles:
+        {
+            upload_particles();
+            run();
+
+            if (!read_buffer(priv_->buffers[0], 4 * n, result))
+                return Scene::ValidationUnknown;
+
+            const std::vector<float> &input(priv_->input);
+
+            for (unsigned int i = 0; i < n; i++) {
+                float p[3];
+                float v[3];
+                float a[3] = {0.0f, 0.0f, 0.0f};
+
+                for (unsigned int k = 0; k < 3; k++) {
+                    p[k] = input[4 * i + k];
+                    v[k] = input[4 * (n + i) + k];
+                }
+
+                for (unsigned int j = 0; j < 4; j++) {
+                    float d[3];
+                    for (unsigned int k = 0; k < 3; k++)
+                        d[k] = particle_attractors[j][k] - p[k];
+                    float r2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2] + particle_softening;
+                    float inv = 1.0f / std::sqrt(r2);
+                    for (unsigned int k = 0; k < 3; k++)
+                        a[k] += d[k] * (particle_strength * inv * inv * inv);
+                }
+
+                for (unsigned int k = 0; k < 3; k++) {
+                    v[k] = v[k] * particle_damping + a[k] * particle_time_step;
+                    p[k] += v[k] * particle_time_step;
+                    if (!matches(result[4 * i + k], p[k], tolerance))
+                        mismatches++;
+                }
+            }
+            break;
+        }
+
+        case ComputeTestReduce:
+        {
+            run();
+
+            if (!read_buffer(priv_->buffers[1], 1, result))
+                return Scene::ValidationUnknown;
+
+            double sum = 0.0;
+            for (unsigned int i = 0; i < n; i++)
+                sum += priv_->input[i];
+
+            if (!matches(result[0], sum, tolerance))
+                mismatches++;
+            break;
+        }
+
+        case ComputeTestScan:
+        {
+            run();
+
+            if (!read_buffer(priv_->buffers[1], n, result))
+                return Scene::ValidationUnknown;
+
+            double sum = 0.0;
+            for (unsigned int i = 0; i < n; i++) {
+                sum += priv_->input[i];
+                if (!matches(result[i], sum, tolerance))
+                    mismatches++;
+            }
+            break;
+        }
+
+        case ComputeTestConvolution:
+        {
+            static const float kernel[5] = {0.0625f, 0.25f, 0.375f, 0.25f, 0.0625f};
+            int size = priv_->image_size;
+            std::vector<unsigned char> pixels(4 * size * size);
+
+            run();
+
+            GLExtensions::MemoryBarrierGL(GL_FRAMEBUFFER_BARRIER_BIT);
+            GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, priv_->fbo);
+            glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+            GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_.fbo());
+
+            /* Allow for the rounding of the 8-bit results */
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    for (int c = 0; c < 4; c++) {
+                        float sum = 0.0f;
+                        for (int j = -2; j <= 2; j++) {
+                            for (int i = -2; i <= 2; i++) {
+                                int qx = std::min(std::max(x + i, 0), size - 1);
+                                int qy = std::min(std::max(y + j, 0), size - 1);
+                                sum += priv_->image[4 * (qy * size + qx) + c] / 255.0f *
+                                       (kernel[i + 2] * kernel[j + 2]);
+                            }
+                        }
+
+                        int result_c = pixels[4 * (y * size + x) + c];
+                        if (std::abs(result_c - static_cast<int>(sum * 255.0f + 0.5f)) > 1)
+                            mismatches++;
+                    }
+                }
+            }
+            break;
+        }
+
+        default:
+            return Scene::ValidationUnknown;
+    }
+
+    if (mismatches > 0) {
+        Log::debug("Validation failed! %u results don't match the CPU reference\n",
+                   mismatches);
+        return Scene::ValidationFailure;
+    }
+
+    return Scene::ValidationSuccess;
+}
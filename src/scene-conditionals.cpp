@@ -34,8 +34,8 @@ SceneConditionals::~SceneConditionals()
 {
 }
 
-static std::string
-get_vertex_shader_source(int steps, bool conditionals)
+std::string
+SceneConditionals::vertex_shader_source(int steps, bool conditionals)
 {
     ShaderSource source(Options::data_path + vtx_file);
     ShaderSource source_main;
@@ -52,8 +52,8 @@ get_vertex_shader_source(int steps, bool conditionals)
     return source.str();
 }
 
-static std::string
-get_fragment_shader_source(int steps, bool conditionals)
+std::string
+SceneConditionals::fragment_shader_source(int steps, bool conditionals)
 {
     ShaderSource source(Options::data_path + frg_file);
     ShaderSource source_main;
@@ -82,8 +82,8 @@ SceneConditionals::setup()
     int vtx_steps(Util::fromString<int>(options_["vertex-steps"].value));
     int frg_steps(Util::fromString<int>(options_["fragment-steps"].value));
     /* Load shaders */
-    std::string vtx_shader(get_vertex_shader_source(vtx_steps, vtx_conditionals));
-    std::string frg_shader(get_fragment_shader_source(frg_steps, frg_conditionals));
+    std::string vtx_shader(vertex_shader_source(vtx_steps, vtx_conditionals));
+    std::string frg_shader(fragment_shader_source(frg_steps, frg_conditionals));
 
     if (!Scene::load_shaders_from_strings(program_, vtx_shader, frg_shader))
         return false;
@@ -20,6 +20,13 @@ enum BlurDirection {
     BlurDirectionBoth
 };
 
+enum BlurAlgorithm {
+    BlurAlgorithmGaussian,
+    BlurAlgorithmGaussianHalf,
+    BlurAlgorithmGaussianQuarter,
+    BlurAlgorithmDualKawase
+};
+
 static void
 create_blur_shaders(ShaderSource& vtx_source, ShaderSource& frg_source,
                     unsigned int radius, float sigma, BlurDirection direction)
@@ -221,6 +228,15 @@ public:
     }
 
     virtual void render_to(RenderObject& target, Program& program)
+    {
+        render_texture_to(target, texture_, program);
+    }
+
+    /**
+     * Draws a texture to the target, at the position, size and rotation
+     * of this object.
+     */
+    void render_texture_to(RenderObject& target, GLuint texture, Program& program)
     {
         LibMatrix::vec2 anchor(pos_);
         LibMatrix::vec2 ll(pos_ - anchor);
@@ -255,7 +271,7 @@ public:
         target.make_current();
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture_);
+        glBindTexture(GL_TEXTURE_2D, texture);
         draw_quad_with_program(position, texcoord, program);
     }
 
@@ -265,6 +281,16 @@ public:
         LibMatrix::vec2 ll_tex(target.normalize_texcoord(pos_));
         LibMatrix::vec2 ur_tex(target.normalize_texcoord(final_pos));
 
+        render_from_texture(target.texture(), ll_tex, ur_tex, program);
+    }
+
+    /**
+     * Draws a region of a texture, given in texture coordinates, to the
+     * whole of this object.
+     */
+    void render_from_texture(GLuint texture, const LibMatrix::vec2& ll_tex,
+                             const LibMatrix::vec2& ur_tex, Program& program)
+    {
         static const GLfloat position_blur[2 * 4] = {
             -1.0, -1.0,
              1.0, -1.0,
@@ -279,7 +305,7 @@ public:
         };
 
         make_current();
-        glBindTexture(GL_TEXTURE_2D, target.texture());
+        glBindTexture(GL_TEXTURE_2D, texture);
         draw_quad_with_program(position_blur, texcoord_blur, program);
     }
 
@@ -436,19 +462,50 @@ private:
 
 /**
  * A RenderObject that blurs the target it is drawn to.
+ *
+ * Besides the full resolution gaussian blur, the blur can be done at a
+ * lower resolution: either a gaussian blur with a proportionally smaller
+ * radius at half or quarter resolution, or the dual-Kawase filter, which
+ * progressively downsamples and then upsamples the window region. All
+ * the algorithms aim for the same visual radius.
  */
 class RenderWindowBlur : public RenderObject
 {
 public:
+    using RenderObject::size;
+
     RenderWindowBlur(unsigned int passes, unsigned int radius, bool separable,
+                     BlurAlgorithm algorithm = BlurAlgorithmGaussian,
                      bool draw_contents = true) :
         RenderObject(), passes_(passes), radius_(radius), separable_(separable),
-        draw_contents_(draw_contents) {}
+        algorithm_(algorithm), draw_contents_(draw_contents), kawase_offset_(1.0)
+    {
+        if (algorithm_ == BlurAlgorithmGaussianHalf ||
+            algorithm_ == BlurAlgorithmGaussianQuarter)
+        {
+            /* Blur with a radius scaled to the lower resolution */
+            unsigned int factor = downsample_factor();
+            radius_ = std::max(1u, (radius + factor / 2) / factor);
+            levels_.resize(2);
+        }
+        else if (algorithm_ == BlurAlgorithmDualKawase) {
+            unsigned int nlevels;
+            kawase_parameters(radius, passes, nlevels, kawase_offset_);
+            levels_.resize(nlevels);
+        }
+    }
 
     virtual void init()
     {
         RenderObject::init();
 
+        for (std::vector<RenderObject>::iterator iter = levels_.begin();
+             iter != levels_.end();
+             iter++)
+        {
+            iter->init();
+        }
+
         /* Only have one instance of the window contents data */
         if (draw_contents_ && RenderWindowBlur::use_count == 0)
             window_contents_.init();
@@ -464,6 +521,16 @@ public:
         if (draw_contents_ && RenderWindowBlur::use_count == 0)
             window_contents_.release();
 
+        for (std::vector<RenderObject>::iterator iter = levels_.begin();
+             iter != levels_.end();
+             iter++)
+        {
+            iter->release();
+        }
+
+        kawase_down_program_.release();
+        kawase_up_program_.release();
+
         RenderObject::release();
     }
 
@@ -472,11 +539,28 @@ public:
         RenderObject::size(size);
         if (draw_contents_)
             window_contents_.size(size);
+
+        /*
+         * The downsampled gaussian blurs between two images at the lower
+         * resolution, the dual-Kawase filter uses an image per level.
+         */
+        for (unsigned int i = 0; i < levels_.size(); i++) {
+            unsigned int factor = algorithm_ == BlurAlgorithmDualKawase ?
+                                  2u << i : downsample_factor();
+            levels_[i].size(LibMatrix::vec2(std::max(1.0f, std::ceil(size.x() / factor)),
+                                            std::max(1.0f, std::ceil(size.y() / factor))));
+        }
     }
 
     virtual void render_to(RenderObject& target)
     {
-        if (separable_) {
+        if (algorithm_ == BlurAlgorithmDualKawase) {
+            render_dual_kawase(target);
+        }
+        else if (!levels_.empty()) {
+            render_downsampled(target);
+        }
+        else if (separable_) {
             Program& blur_program_h1 = blur_program_h(target.size().x());
             Program& blur_program_v1 = blur_program_v(target.size().y());
 
@@ -517,6 +601,133 @@ public:
     }
 
 private:
+    unsigned int downsample_factor()
+    {
+        return algorithm_ == BlurAlgorithmGaussianQuarter ? 4 : 2;
+    }
+
+    /**
+     * Calculates the number of levels and the sample offset of the
+     * dual-Kawase filter that best match the gaussian blur of the same
+     * radius and passes.
+     *
+     * With a sample offset o, the filter on levels 1 to n has a standard
+     * deviation of about 2^n * sqrt(0.49 * o^2 + 0.44) pixels, counting
+     * the bilinear filtering of the samples. The number of levels is
+     * chosen so that the offset stays in about [0.35, 1.8].
+     */
+    static void kawase_parameters(unsigned int radius, unsigned int passes,
+                                  unsigned int& nlevels, float& offset)
+    {
+        static const unsigned int max_levels = 6;
+
+        /* The sigma of the gaussian blur, see create_blur_shaders() */
+        float sigma = std::max(1.0f, radius / 3.0f) * std::sqrt(std::max(1u, passes));
+        int n = static_cast<int>(std::floor(std::log(sigma) / std::log(2.0f) + 0.5f));
+
+        nlevels = std::min(max_levels, static_cast<unsigned int>(std::max(1, n)));
+
+        float scaled = sigma / (1 << nlevels);
+        offset = std::sqrt(std::max(0.0f, scaled * scaled - 0.44f) / 0.49f);
+    }
+
+    /**
+     * Blurs the window region of the target at a lower resolution, and
+     * scales the result back up to the target.
+     */
+    void render_downsampled(RenderObject& target)
+    {
+        RenderObject& front(levels_[0]);
+        RenderObject& back(levels_[1]);
+        LibMatrix::vec2 ll_tex(target.normalize_texcoord(position()));
+        LibMatrix::vec2 ur_tex(target.normalize_texcoord(position() + size()));
+
+        /* Filter the samples when downsampling, to avoid aliasing */
+        Program& down_program(kawase_down_program());
+        down_program.start();
+        down_program["HalfPixel"] = LibMatrix::vec2(0.5, 0.5) / target.size();
+        down_program["Offset"] = downsample_factor() / 2.0f;
+        front.render_from_texture(target.texture(), ll_tex, ur_tex, down_program);
+
+        Program& blur_program_h1 = blur_program_h(front.size().x());
+        Program& blur_program_v1 = blur_program_v(front.size().y());
+
+        for (unsigned int i = 0; i < passes_; i++) {
+            back.render_from_texture(front.texture(), LibMatrix::vec2(0.0, 0.0),
+                                     LibMatrix::vec2(1.0, 1.0), blur_program_h1);
+            front.render_from_texture(back.texture(), LibMatrix::vec2(0.0, 0.0),
+                                      LibMatrix::vec2(1.0, 1.0), blur_program_v1);
+        }
+
+        /* Bilinear filtering does the upsampling */
+        render_texture_to(target, front.texture(), main_program);
+    }
+
+    /**
+     * Blurs the window region of the target with the dual-Kawase filter:
+     * each level is a filtered half resolution copy of the previous one,
+     * and the levels are then filtered back up to the target.
+     */
+    void render_dual_kawase(RenderObject& target)
+    {
+        LibMatrix::vec2 ll_tex(target.normalize_texcoord(position()));
+        LibMatrix::vec2 ur_tex(target.normalize_texcoord(position() + size()));
+        Program& down_program(kawase_down_program());
+        Program& up_program(kawase_up_program());
+
+        down_program.start();
+        down_program["Offset"] = kawase_offset_;
+        down_program["HalfPixel"] = LibMatrix::vec2(0.5, 0.5) / target.size();
+        levels_[0].render_from_texture(target.texture(), ll_tex, ur_tex, down_program);
+
+        for (unsigned int i = 1; i < levels_.size(); i++) {
+            down_program.start();
+            down_program["HalfPixel"] = LibMatrix::vec2(0.5, 0.5) / levels_[i - 1].size();
+            levels_[i].render_from_texture(levels_[i - 1].texture(),
+                                           LibMatrix::vec2(0.0, 0.0),
+                                           LibMatrix::vec2(1.0, 1.0), down_program);
+        }
+
+        up_program.start();
+        up_program["Offset"] = kawase_offset_;
+
+        for (unsigned int i = levels_.size() - 1; i > 0; i--) {
+            up_program.start();
+            up_program["HalfPixel"] = LibMatrix::vec2(0.5, 0.5) / levels_[i].size();
+            levels_[i - 1].render_from_texture(levels_[i].texture(),
+                                               LibMatrix::vec2(0.0, 0.0),
+                                               LibMatrix::vec2(1.0, 1.0), up_program);
+        }
+
+        up_program.start();
+        up_program["HalfPixel"] = LibMatrix::vec2(0.5, 0.5) / levels_[0].size();
+        render_texture_to(target, levels_[0].texture(), up_program);
+    }
+
+    Program& kawase_down_program()
+    {
+        if (!kawase_down_program_.ready()) {
+            ShaderSource vtx_source(Options::data_path + "/shaders/desktop.vert");
+            ShaderSource frg_source(Options::data_path + "/shaders/desktop-kawase-down.frag");
+            Scene::load_shaders_from_strings(kawase_down_program_, vtx_source.str(),
+                                             frg_source.str());
+        }
+
+        return kawase_down_program_;
+    }
+
+    Program& kawase_up_program()
+    {
+        if (!kawase_up_program_.ready()) {
+            ShaderSource vtx_source(Options::data_path + "/shaders/desktop.vert");
+            ShaderSource frg_source(Options::data_path + "/shaders/desktop-kawase-up.frag");
+            Scene::load_shaders_from_strings(kawase_up_program_, vtx_source.str(),
+                                             frg_source.str());
+        }
+
+        return kawase_up_program_;
+    }
+
     Program& blur_program(unsigned int w, unsigned int h)
     {
         /*
@@ -598,10 +809,15 @@ private:
     Program blur_program_;
     Program blur_program_h_;
     Program blur_program_v_;
+    Program kawase_down_program_;
+    Program kawase_up_program_;
     unsigned int passes_;
     unsigned int radius_;
     bool separable_;
+    BlurAlgorithm algorithm_;
     bool draw_contents_;
+    float kawase_offset_;
+    std::vector<RenderObject> levels_;
 
     static int use_count;
     static RenderClearImage window_contents_;
@@ -782,6 +998,11 @@ SceneDesktop::SceneDesktop(Canvas &canvas) :
     options_["separable"] = Scene::Option("separable", "true",
                                           "use separable convolution for the blur effect",
                                           "false,true");
+    options_["blur-algorithm"] = Scene::Option("blur-algorithm", "gaussian",
+                                               "the blur algorithm, all with the same visual radius "
+                                               "(gaussian-half/quarter: separable gaussian at half/quarter resolution, "
+                                               "dual-kawase: progressive downsampling and upsampling, ignores passes)",
+                                               "gaussian,gaussian-half,gaussian-quarter,dual-kawase");
     options_["shadow-size"] = Scene::Option("shadow-size", "20",
                                             "the size of the shadow (in pixels)");
 }
@@ -825,6 +1046,7 @@ SceneDesktop::setup()
     float window_size_factor(0.0);
     unsigned int shadow_size(0);
     bool separable(options_["separable"].value == "true");
+    BlurAlgorithm blur_algorithm(BlurAlgorithmGaussian);
 
     windows = Util::fromString<unsigned int>(options_["windows"].value);
     window_size_factor = Util::fromString<float>(options_["window-size"].value);
@@ -832,6 +1054,13 @@ SceneDesktop::setup()
     blur_radius = Util::fromString<unsigned int>(options_["blur-radius"].value);
     shadow_size = Util::fromString<unsigned int>(options_["shadow-size"].value);
 
+    if (options_["blur-algorithm"].value == "gaussian-half")
+        blur_algorithm = BlurAlgorithmGaussianHalf;
+    else if (options_["blur-algorithm"].value == "gaussian-quarter")
+        blur_algorithm = BlurAlgorithmGaussianQuarter;
+    else if (options_["blur-algorithm"].value == "dual-kawase")
+        blur_algorithm = BlurAlgorithmDualKawase;
+
     // Make sure the Texture object knows where to find our images.
     Texture::find_textures();
 
@@ -860,7 +1089,7 @@ SceneDesktop::setup()
         if (options_["effect"].value == "shadow")
             win = new RenderWindowShadow(shadow_size);
         else
-            win = new RenderWindowBlur(passes, blur_radius, separable);
+            win = new RenderWindowBlur(passes, blur_radius, separable, blur_algorithm);
 
         win->init();
         win->position(center - corner_offset);
@@ -1004,7 +1233,8 @@ SceneDesktop::validate()
 
     if (options_["effect"].value == "blur")
     {
-        if (windows == 4 && passes == 1 && blur_radius == 5)
+        if (windows == 4 && passes == 1 && blur_radius == 5 &&
+            options_["blur-algorithm"].value == "gaussian")
             ref = Canvas::Pixel(0x89, 0xa3, 0x53, 0xff);
         else
             return Scene::ValidationUnknown;
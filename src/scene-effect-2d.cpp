@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <cmath>
 #include <climits>
 #include <numeric>
@@ -15,7 +16,8 @@
 #include "texture.h"
 
 SceneEffect2D::SceneEffect2D(Canvas &pCanvas) :
-    Scene(pCanvas, "effect2d")
+    Scene(pCanvas, "effect2d"), texture_(0), pass_fbo_(0), pass_texture_(0),
+    fetches_(0)
 {
     options_["kernel"] = Scene::Option("kernel",
         "0,0,0;0,1,0;0,0,0",
@@ -23,6 +25,14 @@ SceneEffect2D::SceneEffect2D(Canvas &pCanvas) :
     options_["normalize"] = Scene::Option("normalize", "true",
         "Whether to normalize the supplied convolution kernel matrix",
         "false,true");
+    options_["strategy"] = Scene::Option("strategy", "direct",
+        "How to apply the kernel (direct: all the fetches in one pass, "
+        "separable: a horizontal and a vertical pass, for separable kernels only, "
+        "auto: separable when the kernel allows it and that needs fewer fetches)",
+        "direct,separable,auto");
+    options_["bilinear-taps"] = Scene::Option("bilinear-taps", "false",
+        "Whether to merge pairs of taps of the separable passes into single bilinear fetches",
+        "false,true");
 }
 
 SceneEffect2D::~SceneEffect2D()
@@ -64,7 +74,7 @@ calc_offset(unsigned int i, unsigned int width, unsigned int height)
  * response). This also means that we don't need to perform the (implicit)
  * rotation of the kernel in our convolution implementation.
  *
- * @param canvas the destination Canvas for this shader
+ * @param texel_size the size of a texel of the image being filtered
  * @param array the array holding the filter coefficients in row-major
  *              order
  * @param width the width of the filter
@@ -73,7 +83,8 @@ calc_offset(unsigned int i, unsigned int width, unsigned int height)
  * @return a string containing the frament source code
  */
 static std::string
-create_convolution_fragment_shader(Canvas &canvas, std::vector<float> &array,
+create_convolution_fragment_shader(const LibMatrix::vec2 &texel_size,
+                                   std::vector<float> &array,
                                    unsigned int width, unsigned int height)
 {
     static const std::string frg_shader_filename(Options::data_path + "/shaders/effect-2d-convolution.frag");
@@ -85,8 +96,8 @@ create_convolution_fragment_shader(Canvas &canvas, std::vector<float> &array,
     }
 
     /* Steps are needed to be able to access nearby pixels */
-    source.add_const("TextureStepX", 1.0f/canvas.width());
-    source.add_const("TextureStepY", 1.0f/canvas.height());
+    source.add_const("TextureStepX", texel_size.x());
+    source.add_const("TextureStepY", texel_size.y());
 
     std::stringstream ss_def;
     std::stringstream ss_convolution;
@@ -125,6 +136,297 @@ create_convolution_fragment_shader(Canvas &canvas, std::vector<float> &array,
     return source.str();
 }
 
+/**
+ * A texture fetch of a one-dimensional convolution pass.
+ */
+struct ConvolutionTap
+{
+    ConvolutionTap(float o, float w) : offset(o), weight(w) {}
+
+    float offset;
+    float weight;
+};
+
+static bool
+tap_offset_less(const ConvolutionTap &a, const ConvolutionTap &b)
+{
+    return a.offset < b.offset;
+}
+
+/**
+ * Decomposes a kernel matrix into a column and a row vector, if it is
+ * separable.
+ *
+ * A kernel is separable when it has rank 1, that is when only its
+ * largest singular value is non-zero. That value and its singular vectors
+ * are found by power iteration, and the kernel is separable if they
+ * reconstruct it.
+ *
+ * @param kernel the kernel coefficients in row-major order
+ * @param width the width of the kernel
+ * @param height the height of the kernel
+ * @param[out] column the column vector (height elements)
+ * @param[out] row the row vector (width elements)
+ *
+ * @return whether the kernel is separable
+ */
+static bool
+separate_kernel(const std::vector<float> &kernel, unsigned int width,
+                unsigned int height, std::vector<float> &column,
+                std::vector<float> &row)
+{
+    static const unsigned int iterations = 100;
+    static const double tolerance = 0.0001;
+
+    std::vector<double> u(height, 0.0);
+    std::vector<double> v(width, 0.0);
+    double kernel_norm = 0.0;
+    double max_row_norm = 0.0;
+
+    /* Start from the largest row, which is already the answer for rank 1 */
+    for (unsigned int i = 0; i < height; i++) {
+        double row_norm = 0.0;
+        for (unsigned int j = 0; j < width; j++)
+            row_norm += kernel[i * width + j] * kernel[i * width + j];
+
+        kernel_norm += row_norm;
+        if (row_norm > max_row_norm) {
+            max_row_norm = row_norm;
+            for (unsigned int j = 0; j < width; j++)
+                v[j] = kernel[i * width + j] / std::sqrt(row_norm);
+        }
+    }
+
+    if (kernel_norm == 0.0)
+        return false;
+
+    double sigma = 0.0;
+
+    for (unsigned int n = 0; n < iterations; n++) {
+        /* u = K v / |K v| */
+        double norm = 0.0;
+        for (unsigned int i = 0; i < height; i++) {
+            u[i] = 0.0;
+            for (unsigned int j = 0; j < width; j++)
+                u[i] += kernel[i * width + j] * v[j];
+            norm += u[i] * u[i];
+        }
+
+        norm = std::sqrt(norm);
+        for (unsigned int i = 0; i < height; i++)
+            u[i] /= norm;
+
+        /* v = K^T u / |K^T u|, where |K^T u| is the singular value */
+        sigma = 0.0;
+        for (unsigned int j = 0; j < width; j++) {
+            v[j] = 0.0;
+            for (unsigned int i = 0; i < height; i++)
+                v[j] += kernel[i * width + j] * u[i];
+            sigma += v[j] * v[j];
+        }
+
+        sigma = std::sqrt(sigma);
+        for (unsigned int j = 0; j < width; j++)
+            v[j] /= sigma;
+    }
+
+    /* The relative error of the rank 1 approximation */
+    double error = 0.0;
+    for (unsigned int i = 0; i < height; i++) {
+        for (unsigned int j = 0; j < width; j++) {
+            double d = kernel[i * width + j] - sigma * u[i] * v[j];
+            error += d * d;
+        }
+    }
+
+    if (std::sqrt(error / kernel_norm) > tolerance)
+        return false;
+
+    column.resize(height);
+    row.resize(width);
+    for (unsigned int i = 0; i < height; i++)
+        column[i] = sigma * u[i];
+    for (unsigned int j = 0; j < width; j++)
+        row[j] = v[j];
+
+    return true;
+}
+
+/**
+ * Gets the sign of the elements of a vector.
+ *
+ * @return 1 if they are all >= 0, -1 if they are all <= 0, 0 otherwise
+ */
+static int
+constant_sign(const std::vector<float> &vec)
+{
+    static const float epsilon = 0.000001;
+    bool positive = true;
+    bool negative = true;
+
+    for (std::vector<float>::const_iterator iter = vec.begin();
+         iter != vec.end();
+         iter++)
+    {
+        positive = positive && *iter > -epsilon;
+        negative = negative && *iter < epsilon;
+    }
+
+    return positive ? 1 : (negative ? -1 : 0);
+}
+
+/**
+ * Orders the factors of a separable kernel into the first and second pass.
+ *
+ * The first pass is written to an 8-bit image, so its weights must be
+ * non-negative and add up to 1, with the scale moved to the second pass.
+ *
+ * @param[in,out] first the first factor, becomes the first pass weights
+ * @param[in,out] second the second factor, becomes the second pass weights
+ * @param[out] swapped whether the factors have been swapped
+ *
+ * @return false if neither factor has weights of the same sign
+ */
+static bool
+order_passes(std::vector<float> &first, std::vector<float> &second,
+             bool &swapped)
+{
+    int sign = constant_sign(first);
+
+    swapped = false;
+    if (sign == 0) {
+        sign = constant_sign(second);
+        if (sign == 0)
+            return false;
+        first.swap(second);
+        swapped = true;
+    }
+
+    float sum = std::accumulate(first.begin(), first.end(), 0.0) * sign;
+
+    for (std::vector<float>::iterator iter = first.begin();
+         iter != first.end();
+         iter++)
+    {
+        *iter *= sign / sum;
+        if (*iter < 0.0)
+            *iter = 0.0;
+    }
+
+    for (std::vector<float>::iterator iter = second.begin();
+         iter != second.end();
+         iter++)
+    {
+        *iter *= sign * sum;
+    }
+
+    return true;
+}
+
+/**
+ * Creates the taps of a one-dimensional convolution pass.
+ *
+ * Zero weights are dropped. When merging, two neighboring taps with
+ * weights of the same sign are replaced by a single tap between them,
+ * relying on bilinear filtering to fetch both texels with the right
+ * weights.
+ *
+ * @param weights the weights of the pass
+ * @param offsets the offsets, in texels, of the weights
+ * @param merge whether to merge neighboring taps
+ *
+ * @return the taps, in the order of their offsets
+ */
+static std::vector<ConvolutionTap>
+create_taps(const std::vector<float> &weights, const std::vector<float> &offsets,
+            bool merge)
+{
+    std::vector<ConvolutionTap> taps;
+
+    for (unsigned int i = 0; i < weights.size(); i++) {
+        if (weights[i] != 0.0)
+            taps.push_back(ConvolutionTap(offsets[i], weights[i]));
+    }
+
+    std::sort(taps.begin(), taps.end(), tap_offset_less);
+
+    if (!merge)
+        return taps;
+
+    std::vector<ConvolutionTap> merged;
+
+    for (unsigned int i = 0; i < taps.size(); i++) {
+        if (i + 1 < taps.size() &&
+            taps[i + 1].offset - taps[i].offset == 1.0 &&
+            (taps[i].weight > 0.0) == (taps[i + 1].weight > 0.0))
+        {
+            float weight = taps[i].weight + taps[i + 1].weight;
+            merged.push_back(ConvolutionTap(taps[i].offset + taps[i + 1].weight / weight,
+                                            weight));
+            i++;
+        }
+        else {
+            merged.push_back(taps[i]);
+        }
+    }
+
+    return merged;
+}
+
+/**
+ * Creates a fragment shader implementing a pass of separable convolution.
+ *
+ * @param texel_size the size of a texel of the image the pass reads, which
+ *                   the merged tap offsets are only correct for
+ * @param taps the taps of the pass
+ * @param horizontal whether the pass is horizontal or vertical
+ *
+ * @return a string containing the frament source code
+ */
+static std::string
+create_pass_fragment_shader(const LibMatrix::vec2 &texel_size,
+                            const std::vector<ConvolutionTap> &taps,
+                            bool horizontal)
+{
+    static const std::string frg_shader_filename(Options::data_path + "/shaders/effect-2d-convolution.frag");
+    ShaderSource source(frg_shader_filename);
+
+    if (horizontal)
+        source.add_const("TextureStepX", texel_size.x());
+    else
+        source.add_const("TextureStepY", texel_size.y());
+
+    std::stringstream ss_def;
+    std::stringstream ss_convolution;
+
+    ss_def << std::fixed;
+    ss_convolution << std::fixed;
+
+    ss_convolution << "result = ";
+
+    for (unsigned int i = 0; i < taps.size(); i++) {
+        ss_def << "const float Kernel" << i << " = "
+               << taps[i].weight << ";" << std::endl;
+
+        ss_convolution << "texture2D(Texture0, TextureCoord + vec2(";
+        if (horizontal)
+            ss_convolution << taps[i].offset << " * TextureStepX, 0.0";
+        else
+            ss_convolution << "0.0, " << taps[i].offset << " * TextureStepY";
+        ss_convolution << ")) * Kernel" << i;
+
+        if (i + 1 != taps.size())
+            ss_convolution << " +" << std::endl;
+    }
+
+    ss_convolution << ";" << std::endl;
+
+    source.add(ss_def.str());
+    source.replace("$CONVOLUTION$", ss_convolution.str());
+
+    return source.str();
+}
+
 /**
  * Creates a string containing a printout of a kernel matrix.
  *
@@ -283,6 +585,18 @@ SceneEffect2D::setup()
 
     Texture::find_textures();
 
+    unsigned int image_width = 0;
+    unsigned int image_height = 0;
+
+    if (!Texture::size("effect-2d", &image_width, &image_height)) {
+        Log::error("Couldn't get the size of the effect-2d texture\n");
+        return false;
+    }
+
+    /* The image and the canvas sized intermediate image are read per texel */
+    const LibMatrix::vec2 image_texel(1.0f / image_width, 1.0f / image_height);
+    const LibMatrix::vec2 canvas_texel(1.0f / canvas_.width(), 1.0f / canvas_.height());
+
     static const std::string vtx_shader_filename(Options::data_path + "/shaders/effect-2d.vert");
 
     std::vector<float> kernel;
@@ -303,12 +617,89 @@ SceneEffect2D::setup()
                    kernel_printout(kernel, kernel_width).c_str());
     }
 
+    /*
+     * Find the passes of the separable convolution: a horizontal pass with
+     * the row vector, and a vertical pass with the column vector, in the
+     * order that keeps the intermediate image in range.
+     */
+    const std::string &strategy(options_["strategy"].value);
+    bool merge(options_["bilinear-taps"].value == "true");
+    std::vector<ConvolutionTap> first_taps;
+    std::vector<ConvolutionTap> second_taps;
+    bool horizontal_first(true);
+    bool separable(false);
+
+    if (strategy != "direct") {
+        std::vector<float> row;
+        std::vector<float> column;
+        bool swapped(false);
+
+        if (!GLExtensions::GenFramebuffers) {
+            Log::debug("No framebuffer support for separable convolution\n");
+        }
+        else if (!separate_kernel(kernel, kernel_width, kernel_height, column, row) ||
+                 !order_passes(row, column, swapped))
+        {
+            Log::debug("The kernel matrix isn't separable into a pass with "
+                       "weights of the same sign and another pass\n");
+        }
+        else {
+            std::vector<float> row_offsets;
+            std::vector<float> column_offsets;
+
+            for (unsigned int j = 0; j < kernel_width; j++)
+                row_offsets.push_back(calc_offset(j, kernel_width, kernel_height).x());
+            for (unsigned int i = 0; i < kernel_height; i++)
+                column_offsets.push_back(calc_offset(i * kernel_width, kernel_width, kernel_height).y());
+
+            /* After a swap, the column is the first pass */
+            horizontal_first = !swapped;
+            first_taps = create_taps(row, swapped ? column_offsets : row_offsets, merge);
+            second_taps = create_taps(column, swapped ? row_offsets : column_offsets, merge);
+
+            separable = strategy == "separable" ||
+                        first_taps.size() + second_taps.size() < kernel.size();
+        }
+
+        if (strategy == "separable" && !separable) {
+            Log::error("The separable strategy can't be used with this kernel matrix\n");
+            return false;
+        }
+    }
+
     /* Create and load the shaders */
     ShaderSource vtx_source(vtx_shader_filename);
     ShaderSource frg_source;
-    frg_source.append(create_convolution_fragment_shader(canvas_, kernel,
-                                                         kernel_width,
-                                                         kernel_height));
+
+    if (separable) {
+        ShaderSource second_frg_source;
+
+        frg_source.append(create_pass_fragment_shader(image_texel, first_taps,
+                                                      horizontal_first));
+        second_frg_source.append(create_pass_fragment_shader(canvas_texel, second_taps,
+                                                             !horizontal_first));
+
+        if (!Scene::load_shaders_from_strings(second_program_, vtx_source.str(),
+                                              second_frg_source.str()))
+        {
+            return false;
+        }
+
+        second_program_.start();
+        second_program_["Texture0"] = 0;
+
+        /* Bilinear filtering only makes a difference for merged taps */
+        if (!create_pass_target(merge ? GL_LINEAR : GL_NEAREST))
+            return false;
+
+        fetches_ = first_taps.size() + second_taps.size();
+    }
+    else {
+        frg_source.append(create_convolution_fragment_shader(image_texel, kernel,
+                                                             kernel_width,
+                                                             kernel_height));
+        fetches_ = kernel.size();
+    }
 
     if (frg_source.str().empty())
         return false;
@@ -319,6 +710,11 @@ SceneEffect2D::setup()
         return false;
     }
 
+    GLint filter(separable && merge ? GL_LINEAR : GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
     std::vector<int> vertex_format;
     vertex_format.push_back(3);
     mesh_.set_vertex_format(vertex_format);
@@ -330,6 +726,11 @@ SceneEffect2D::setup()
     attrib_locations.push_back(program_["position"].location());
     mesh_.set_attrib_locations(attrib_locations);
 
+    if (separable && second_program_["position"].location() != attrib_locations[0]) {
+        Log::error("The convolution passes have different attribute locations\n");
+        return false;
+    }
+
     program_.start();
 
     // Load texture sampler value
@@ -346,10 +747,16 @@ SceneEffect2D::setup()
 void
 SceneEffect2D::teardown()
 {
+    Log::info("    %u texture fetches per pixel in %u pass%s\n", fetches_,
+              pass_fbo_ ? 2 : 1, pass_fbo_ ? "es" : "");
+
     mesh_.reset();
 
     program_.stop();
     program_.release();
+    second_program_.release();
+
+    release_pass_target();
 
     Scene::teardown();
 }
@@ -366,7 +773,71 @@ SceneEffect2D::draw()
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture_);
 
-    mesh_.render_vbo();
+    if (pass_fbo_) {
+        /* The first pass renders to the intermediate image... */
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, pass_fbo_);
+        program_.start();
+        mesh_.render_vbo();
+
+        /* ...which the second pass reads from */
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_.fbo());
+        glBindTexture(GL_TEXTURE_2D, pass_texture_);
+        second_program_.start();
+        mesh_.render_vbo();
+    }
+    else {
+        mesh_.render_vbo();
+    }
+}
+
+/**
+ * Creates the canvas sized image the first pass of the separable
+ * convolution renders to.
+ *
+ * @param filter the filter to read the image with
+ *
+ * @return whether creating the image succeeded
+ */
+bool
+SceneEffect2D::create_pass_target(GLint filter)
+{
+    glGenTextures(1, &pass_texture_);
+    glBindTexture(GL_TEXTURE_2D, pass_texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, canvas_.width(), canvas_.height(), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+    GLExtensions::GenFramebuffers(1, &pass_fbo_);
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, pass_fbo_);
+    GLExtensions::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                       GL_TEXTURE_2D, pass_texture_, 0);
+
+    unsigned int status = GLExtensions::CheckFramebufferStatus(GL_FRAMEBUFFER);
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_.fbo());
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        Log::error("SceneEffect2D: glCheckFramebufferStatus failed (0x%x)\n", status);
+        return false;
+    }
+
+    return true;
+}
+
+void
+SceneEffect2D::release_pass_target()
+{
+    if (pass_fbo_) {
+        GLExtensions::DeleteFramebuffers(1, &pass_fbo_);
+        pass_fbo_ = 0;
+    }
+
+    if (pass_texture_) {
+        glDeleteTextures(1, &pass_texture_);
+        pass_texture_ = 0;
+    }
 }
 
 Scene::ValidationResult
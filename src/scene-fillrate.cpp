@@ -0,0 +1,449 @@
+#include "scene.h"
+#include "log.h"
+#include "options.h"
+#include "shader-source.h"
+#include "util.h"
+#include "gl-headers.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+
+enum FillrateTest {
+    FillrateTestOverdraw,
+    FillrateTestTexel,
+    FillrateTestRop,
+    FillrateTests
+};
+
+const char *fillrate_test_names[FillrateTests] = {
+    "overdraw", "texel", "rop"
+};
+
+/* A pixel format of the textures or render targets */
+struct PixelFormat
+{
+    const char *name;
+    GLint internal_format;
+    GLenum format;
+    GLenum type;
+};
+
+const PixelFormat texture_formats[] = {
+    {"rgba8", GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE},
+    {"rgb565", GL_RGB, GL_RGB, GL_UNSIGNED_SHORT_5_6_5},
+    {"rgba4", GL_RGBA, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4},
+    {"l8", GL_LUMINANCE, GL_LUMINANCE, GL_UNSIGNED_BYTE},
+};
+
+const PixelFormat target_formats[] = {
+    {"rgba8", GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE},
+    {"rgb565", GL_RGB, GL_RGB, GL_UNSIGNED_SHORT_5_6_5},
+    {"rgba4", GL_RGBA, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4},
+    {"rgba16f", GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT},
+};
+
+template <size_t N> const PixelFormat *
+find_format(const PixelFormat (&formats)[N], const std::string &name)
+{
+    for (size_t i = 0; i < N; i++) {
+        if (name == formats[i].name)
+            return &formats[i];
+    }
+
+    return 0;
+}
+
+template <size_t N> std::string
+format_names(const PixelFormat (&formats)[N])
+{
+    std::string names;
+
+    for (size_t i = 0; i < N; i++)
+        names += std::string(i > 0 ? "," : "") + formats[i].name;
+
+    return names;
+}
+
+}
+
+struct SceneFillratePrivate
+{
+    SceneFillratePrivate() :
+        test(FillrateTestOverdraw), layers(0), fetches(0), blend(false),
+        vbo(0), texture(0), target_texture(0), fbo(0) {}
+
+    FillrateTest test;
+    unsigned int layers;
+    unsigned int fetches;
+    bool blend;
+
+    Program program;
+    /* Draws the render target of the rop test to the screen */
+    Program present_program;
+
+    GLuint vbo;
+    GLuint texture;
+    GLuint target_texture;
+    GLuint fbo;
+};
+
+SceneFillrate::SceneFillrate(Canvas &pCanvas) :
+    Scene(pCanvas, "fillrate")
+{
+    priv_ = new SceneFillratePrivate();
+
+    options_["test"] = Scene::Option("test", "overdraw",
+            "The throughput to measure (overdraw: full screen layers of flat color, "
+            "texel: texture fetches, rop: flat color layers in a render target of target-format)",
+            "overdraw,texel,rop");
+    options_["layers"] = Scene::Option("layers", "8",
+            "The number of full screen layers drawn every frame");
+    options_["blend"] = Scene::Option("blend", "false",
+            "Whether to blend the layers", "false,true");
+    options_["fetches"] = Scene::Option("fetches", "4",
+            "The number of texture fetches per pixel in the texel test");
+    options_["texture-size"] = Scene::Option("texture-size", "1024",
+            "The width and height of the texture in the texel test (stretched over "
+            "the screen, so sizes above the screen size are minified)");
+    options_["texture-format"] = Scene::Option("texture-format", "rgba8",
+            "The format of the texture in the texel test",
+            format_names(texture_formats));
+    options_["texture-filter"] = Scene::Option("texture-filter", "linear",
+            "The texture filter in the texel test (mipmap: trilinear, needs a "
+            "power of two texture-size on GLES 2.0)",
+            "nearest,linear,mipmap");
+    options_["target-format"] = Scene::Option("target-format", "rgba8",
+            "The format of the render target in the rop test",
+            format_names(target_formats));
+}
+
+SceneFillrate::~SceneFillrate()
+{
+    delete priv_;
+}
+
+bool
+SceneFillrate::load()
+{
+    running_ = false;
+
+    return true;
+}
+
+void
+SceneFillrate::unload()
+{
+}
+
+bool
+SceneFillrate::setup()
+{
+    if (!Scene::setup())
+        return false;
+
+    static const std::string vtx_shader_filename(Options::data_path + "/shaders/fillrate.vert");
+    static const std::string frg_shader_filename(Options::data_path + "/shaders/fillrate.frag");
+    static const std::string frg_texture_filename(Options::data_path + "/shaders/fillrate-texture.frag");
+
+    /* Parse options */
+    const char **name = std::find(fillrate_test_names, fillrate_test_names + FillrateTests,
+                                  options_["test"].value);
+    priv_->test = static_cast<FillrateTest>(name - fillrate_test_names);
+    priv_->layers = Util::fromString<unsigned int>(options_["layers"].value);
+    priv_->fetches = Util::fromString<unsigned int>(options_["fetches"].value);
+    priv_->blend = options_["blend"].value == "true";
+
+    if (priv_->layers < 1 || priv_->fetches < 1) {
+        Log::error("The layers and fetches must be at least 1\n");
+        return false;
+    }
+
+    /* The programs */
+    ShaderSource vtx_source(vtx_shader_filename);
+
+    if (priv_->test == FillrateTestTexel) {
+        unsigned int size = Util::fromString<unsigned int>(options_["texture-size"].value);
+        if (!create_texture(size))
+            return false;
+
+        if (!load_texture_program(priv_->program, size, priv_->fetches))
+            return false;
+    }
+    else {
+        ShaderSource frg_source(frg_shader_filename);
+        frg_source.add_const("LayerColor", LibMatrix::vec4(0.2f, 0.4f, 0.8f, 0.5f));
+
+        if (!Scene::load_shaders_from_strings(priv_->program, vtx_source.str(),
+                                              frg_source.str()))
+        {
+            return false;
+        }
+    }
+
+    if (priv_->test == FillrateTestRop) {
+        if (!create_target())
+            return false;
+
+        if (!load_texture_program(priv_->present_program, canvas_.width(), 1))
+            return false;
+    }
+
+    /* A full screen quad */
+    static const GLfloat quad[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+        -1.0f,  1.0f,
+         1.0f,  1.0f
+    };
+
+    glGenBuffers(1, &priv_->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, priv_->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    /* Every layer must reach the pixels */
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    currentFrame_ = 0;
+    running_ = true;
+    startTime_ = Util::get_timestamp_us() / 1000000.0;
+    lastUpdateTime_ = startTime_;
+
+    return true;
+}
+
+/**
+ * Loads a program that fetches from a texture a number of times per pixel,
+ * from neighboring texels, and averages the results.
+ */
+bool
+SceneFillrate::load_texture_program(Program &program, unsigned int texture_size,
+                                    unsigned int fetches)
+{
+    ShaderSource vtx_source(Options::data_path + "/shaders/fillrate.vert");
+    ShaderSource frg_source(Options::data_path + "/shaders/fillrate-texture.frag");
+    std::stringstream ss;
+
+    for (unsigned int i = 0; i < fetches; i++) {
+        ss << "result += texture2D(Texture0, TextureCoord + vec2("
+           << i << ".0 * TexelStep, 0.0)) * FetchWeight;" << std::endl;
+    }
+
+    frg_source.add_const("TexelStep", 1.0f / texture_size);
+    frg_source.add_const("FetchWeight", 1.0f / fetches);
+    frg_source.replace("$FETCHES$", ss.str());
+
+    if (!Scene::load_shaders_from_strings(program, vtx_source.str(), frg_source.str()))
+        return false;
+
+    program.start();
+    program["Texture0"] = 0;
+    program.stop();
+
+    return true;
+}
+
+/**
+ * Creates the texture of the texel test, filled with noise.
+ */
+bool
+SceneFillrate::create_texture(unsigned int size)
+{
+    const PixelFormat *format = find_format(texture_formats, options_["texture-format"].value);
+    const std::string &filter(options_["texture-filter"].value);
+
+    if (size < 1 || !format) {
+        Log::error("The texture size must be at least 1, with a valid format\n");
+        return false;
+    }
+
+    /* Enough for every format, whatever the row alignment */
+    std::vector<unsigned char> data(4 * size * size);
+    unsigned int seed = 1;
+    for (unsigned int i = 0; i < data.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+
+    glGenTextures(1, &priv_->texture);
+    glBindTexture(GL_TEXTURE_2D, priv_->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format->internal_format, size, size, 0,
+                 format->format, format->type, &data[0]);
+
+    if (filter == "mipmap") {
+        GLExtensions::GenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    else {
+        GLint gl_filter = filter == "nearest" ? GL_NEAREST : GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    return true;
+}
+
+/**
+ * Creates the screen sized render target of the rop test.
+ */
+bool
+SceneFillrate::create_target()
+{
+    const PixelFormat *found = find_format(target_formats, options_["target-format"].value);
+
+    if (!found || !GLExtensions::GenFramebuffers) {
+        Log::error("The rop test needs framebuffer support, and a valid target format\n");
+        return false;
+    }
+
+    PixelFormat format(*found);
+
+#if GPULOAD_USE_GLESv2
+    /* Before GLES 3.0, half float textures come from GL_OES_texture_half_float */
+    if (format.type == GL_HALF_FLOAT && !GLExtensions::version_at_least(3, 0)) {
+        format.internal_format = GL_RGBA;
+        format.type = GL_HALF_FLOAT_OES;
+    }
+#endif
+
+    glGenTextures(1, &priv_->target_texture);
+    glBindTexture(GL_TEXTURE_2D, priv_->target_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format.internal_format, canvas_.width(), canvas_.height(),
+                 0, format.format, format.type, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    GLExtensions::GenFramebuffers(1, &priv_->fbo);
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, priv_->fbo);
+    GLExtensions::FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                       GL_TEXTURE_2D, priv_->target_texture, 0);
+    unsigned int status = GLExtensions::CheckFramebufferStatus(GL_FRAMEBUFFER);
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_.fbo());
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        Log::error("The %s render target format isn't supported (0x%x)\n",
+                   format.name, status);
+        return false;
+    }
+
+    return true;
+}
+
+void
+SceneFillrate::teardown()
+{
+    double elapsed = lastUpdateTime_ - startTime_;
+
+    if (elapsed > 0.0 && currentFrame_ > 0) {
+        double pixels = static_cast<double>(canvas_.width()) * canvas_.height() *
+                        priv_->layers * currentFrame_;
+
+        if (priv_->test == FillrateTestTexel) {
+            Log::info("    %.3f Gtexels/s, %.3f Gpixels/s (%u layers, %u fetches per pixel)\n",
+                      pixels * priv_->fetches / elapsed / 1e9, pixels / elapsed / 1e9,
+                      priv_->layers, priv_->fetches);
+        }
+        else {
+            Log::info("    %.3f Gpixels/s (%u layers, blending %s)\n",
+                      pixels / elapsed / 1e9, priv_->layers, priv_->blend ? "on" : "off");
+        }
+    }
+
+    if (priv_->vbo) {
+        glDeleteBuffers(1, &priv_->vbo);
+        priv_->vbo = 0;
+    }
+
+    if (priv_->texture) {
+        glDeleteTextures(1, &priv_->texture);
+        priv_->texture = 0;
+    }
+
+    if (priv_->fbo) {
+        GLExtensions::DeleteFramebuffers(1, &priv_->fbo);
+        priv_->fbo = 0;
+    }
+
+    if (priv_->target_texture) {
+        glDeleteTextures(1, &priv_->target_texture);
+        priv_->target_texture = 0;
+    }
+
+    priv_->program.stop();
+    priv_->program.release();
+    priv_->present_program.release();
+
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+
+    Scene::teardown();
+}
+
+void
+SceneFillrate::update()
+{
+    Scene::update();
+}
+
+/**
+ * Draws full screen quads with a program.
+ */
+void
+SceneFillrate::draw_quads(Program &program, unsigned int count)
+{
+    GLint position = program["position"].location();
+
+    program.start();
+
+    glBindBuffer(GL_ARRAY_BUFFER, priv_->vbo);
+    glVertexAttribPointer(position, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(position);
+
+    for (unsigned int i = 0; i < count; i++)
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glDisableVertexAttribArray(position);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void
+SceneFillrate::draw()
+{
+    if (priv_->test == FillrateTestRop) {
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, priv_->fbo);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    if (priv_->test == FillrateTestTexel) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, priv_->texture);
+    }
+
+    if (priv_->blend)
+        glEnable(GL_BLEND);
+
+    draw_quads(priv_->program, priv_->layers);
+
+    if (priv_->blend)
+        glDisable(GL_BLEND);
+
+    /* Show the render target, which also makes sure it is resolved */
+    if (priv_->test == FillrateTestRop) {
+        GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_.fbo());
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, priv_->target_texture);
+        draw_quads(priv_->present_program, 1);
+    }
+}
@@ -39,8 +39,8 @@ SceneFunction::~SceneFunction()
 {
 }
 
-static std::string
-get_vertex_shader_source(int steps, bool function, std::string &complexity)
+std::string
+SceneFunction::vertex_shader_source(int steps, bool function, const std::string &complexity)
 {
     ShaderSource source(Options::data_path + vtx_file);
     ShaderSource source_main;
@@ -68,8 +68,8 @@ get_vertex_shader_source(int steps, bool function, std::string &complexity)
     return source.str();
 }
 
-static std::string
-get_fragment_shader_source(int steps, bool function, std::string &complexity)
+std::string
+SceneFunction::fragment_shader_source(int steps, bool function, const std::string &complexity)
 {
     ShaderSource source(Options::data_path + frg_file);
     ShaderSource source_main;
@@ -112,9 +112,9 @@ SceneFunction::setup()
     int frg_steps = Util::fromString<int>(options_["fragment-steps"].value);
 
     /* Load shaders */
-    std::string vtx_shader(get_vertex_shader_source(vtx_steps, vtx_function,
+    std::string vtx_shader(vertex_shader_source(vtx_steps, vtx_function,
                                                     vtx_complexity));
-    std::string frg_shader(get_fragment_shader_source(frg_steps, frg_function,
+    std::string frg_shader(fragment_shader_source(frg_steps, frg_function,
                                                       frg_complexity));
 
     if (!Scene::load_shaders_from_strings(program_, vtx_shader, frg_shader))
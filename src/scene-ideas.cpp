@@ -24,7 +24,10 @@ public:
         valid_(false),
         currentSpeed_(1.0), // Real time.
         currentTime_(START_TIME_),
-        timeOffset_(START_TIME_)
+        timeOffset_(START_TIME_),
+        useTable_(true),
+        frames_(0),
+        drawNs_(0)
     {
         startTime_.tv_sec = 0;
         startTime_.tv_nsec = 0; 
@@ -37,11 +40,13 @@ public:
     void update_time();
     void update_projection(const mat4& proj);
     void draw();
+    void report();
     bool valid() { return valid_; }
 
 private:
     void postIdle();
     void initLights();
+    void update_splines();
     bool valid_;
     Stack4 projection_;
     Stack4 modelview_;
@@ -52,6 +57,8 @@ private:
     static const float CYCLE_TIME_;
     static const float TIME_;
     static const float START_TIME_;
+    static const unsigned int SPLINE_SAMPLES_;
+    static const unsigned int SPLINE_BATCH_;
     // Table
     Table table_;
     // Logo
@@ -68,21 +75,43 @@ private:
     LightPositionSpline lightPosSpline_;
     LogoPositionSpline logoPosSpline_;
     LogoRotationSpline logoRotSpline_;
+    // All of the above, sampled at setup, evaluated together
+    SplineTable splineTable_;
+    bool useTable_;
     vec3 viewFrom_;
     vec3 viewTo_;
     vec3 lightPos_;
     vec3 logoPos_;
     vec3 logoRot_;
     vec4 lightPositions_[3];
+    // CPU time statistics
+    unsigned int frames_;
+    uint64_t drawNs_;
 };
 
 const float SceneIdeasPrivate::TIME_(15.0);
 const float SceneIdeasPrivate::CYCLE_TIME_(TIME_ * 1.0 - 3.0);
 const float SceneIdeasPrivate::START_TIME_(0.6);
+// Samples per unit of scene time in the spline table.  Interpolating
+// linearly between them stays within 1/1000 of the exact positions, and
+// within 1/50 of a degree of the exact rotation, which is drawn in steps
+// of 1/10 of a degree anyway.
+const unsigned int SceneIdeasPrivate::SPLINE_SAMPLES_(128);
+// Spline evaluations timed together for the report.  A single evaluation
+// takes about as long as reading the clock, so it can't be timed alone.
+const unsigned int SceneIdeasPrivate::SPLINE_BATCH_(10000);
 const vec4 SceneIdeasPrivate::light0_position_(0.0, 1.0, 0.0, 0.0);
 const vec4 SceneIdeasPrivate::light1_position_(-1.0, 0.0, 0.0, 0.0);
 const vec4 SceneIdeasPrivate::light2_position_(0.0, -1.0, 0.0, 0.0);
 
+static uint64_t
+get_timestamp_ns()
+{
+    struct timespec now = {0, 0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
 void
 SceneIdeasPrivate::initLights()
 {
@@ -118,6 +147,20 @@ SceneIdeasPrivate::initialize(map<string, Scene::Option>& options)
         return;
     }
 
+    // Sample the splines over the whole cycle, unless they are to be
+    // evaluated directly.
+    useTable_ = (options["splines"].value == "table");
+    if (useTable_)
+    {
+        std::vector<const Spline*> splines;
+        splines.push_back(&viewFromSpline_);
+        splines.push_back(&viewToSpline_);
+        splines.push_back(&lightPosSpline_);
+        splines.push_back(&logoPosSpline_);
+        splines.push_back(&logoRotSpline_);
+        splineTable_.build(splines, CYCLE_TIME_, SPLINE_SAMPLES_);
+    }
+
     reset_time();
 
     // If the option string tells us the user wants the speed to be a function
@@ -184,6 +227,9 @@ SceneIdeas::SceneIdeas(Canvas& canvas) :
 {
     options_["speed"] = Scene::Option("speed", "duration",
                                       "Time coefficient (1.0 is \"wall clock\" speed, <1.0 is slower, >1.0 is faster).  A special value of \"duration\" computes this as a function of the \"duration\" option");
+    options_["splines"] = Scene::Option("splines", "table",
+                                        "How the animation splines are evaluated each frame (table: interpolated from samples taken at setup, direct: the exact cubic of each spline)",
+                                        "table,direct");
 }
 
 SceneIdeas::~SceneIdeas()
@@ -233,14 +279,60 @@ SceneIdeas::update()
     priv_->update_projection(canvas_.projection());
 }
 
+void
+SceneIdeasPrivate::update_splines()
+{
+    if (useTable_)
+    {
+        vec3 v[5];
+        splineTable_.getCurrentVecs(currentTime_, v);
+        viewFrom_ = v[0];
+        viewTo_ = v[1];
+        lightPos_ = v[2];
+        logoPos_ = v[3];
+        logoRot_ = v[4];
+    }
+    else
+    {
+        viewFromSpline_.getCurrentVec(currentTime_, viewFrom_);
+        viewToSpline_.getCurrentVec(currentTime_, viewTo_);
+        lightPosSpline_.getCurrentVec(currentTime_, lightPos_);
+        logoPosSpline_.getCurrentVec(currentTime_, logoPos_);
+        logoRotSpline_.getCurrentVec(currentTime_, logoRot_);
+    }
+}
+
+void
+SceneIdeasPrivate::report()
+{
+    if (frames_ == 0)
+    {
+        return;
+    }
+
+    // Evaluate the splines over the whole cycle, and restore the state of
+    // the current time afterwards
+    float time(currentTime_);
+    uint64_t start(get_timestamp_ns());
+    for (unsigned int i = 0; i < SPLINE_BATCH_; i++)
+    {
+        currentTime_ = START_TIME_ + (CYCLE_TIME_ - START_TIME_) * i / SPLINE_BATCH_;
+        update_splines();
+    }
+    uint64_t splineNs(get_timestamp_ns() - start);
+    currentTime_ = time;
+    update_splines();
+
+    Log::info("    Splines (%s): %.3f us/frame, CPU time of the frame: %.3f ms\n",
+              useTable_ ? "table" : "direct",
+              splineNs / 1000.0 / SPLINE_BATCH_, drawNs_ / 1000000.0 / frames_);
+}
+
 void
 SceneIdeasPrivate::draw()
 {
-    viewFromSpline_.getCurrentVec(currentTime_, viewFrom_);
-    viewToSpline_.getCurrentVec(currentTime_, viewTo_);
-    lightPosSpline_.getCurrentVec(currentTime_, lightPos_);
-    logoPosSpline_.getCurrentVec(currentTime_, logoPos_);
-    logoRotSpline_.getCurrentVec(currentTime_, logoRot_);
+    uint64_t start(get_timestamp_ns());
+    update_splines();
 
     // Tell the logo its new position
     logo_.setPosition(logoPos_);
@@ -370,6 +462,9 @@ SceneIdeasPrivate::draw()
     {
         table_.drawUnder(modelview_, projection_);
     }
+
+    drawNs_ += get_timestamp_ns() - start;
+    frames_++;
 }
 
 void
@@ -387,6 +482,10 @@ SceneIdeas::validate()
 void
 SceneIdeas::teardown()
 {
+    if (priv_)
+    {
+        priv_->report();
+    }
     delete priv_;
     priv_ = 0;
     Scene::teardown();
@@ -6,9 +6,9 @@ using LibMatrix::vec3;
 void
 Spline::calcParams()
 {
-    unsigned int numParams(controlData_.size() - 3);
-    paramData_ = new param[numParams];
-    for (unsigned int i = 0; i < numParams; i++)
+    numParams_ = controlData_.size() - 3;
+    paramData_ = new param[numParams_];
+    for (unsigned int i = 0; i < numParams_; i++)
     {
         float x3(controlData_[i + 1].x());
         float x2(controlData_[i + 2].x() - controlData_[i].x());
@@ -60,6 +60,12 @@ Spline::getCurrentVec(float currentTime, vec3& v) const
 {
     unsigned int integerTime(static_cast<unsigned int>(currentTime));
     float t(currentTime - static_cast<float>(integerTime));
+    // Past the last segment, hold its end point.
+    if (integerTime >= numParams_)
+    {
+        integerTime = numParams_ - 1;
+        t = 1.0;
+    }
     v.x(paramData_[integerTime][3].x() +
 	paramData_[integerTime][2].x() * t +
 	paramData_[integerTime][1].x() * t * t +
@@ -74,6 +80,62 @@ Spline::getCurrentVec(float currentTime, vec3& v) const
 	paramData_[integerTime][0].z() * t * t * t);
 }
 
+void
+SplineTable::build(const std::vector<const Spline*>& splines, float endTime,
+                   unsigned int samplesPerUnit)
+{
+    numSplines_ = splines.size();
+    stride_ = (numSplines_ * 3 + 3) & ~3u;
+    rate_ = samplesPerUnit;
+    lastSample_ = static_cast<unsigned int>(endTime * samplesPerUnit) + 1;
+
+    samples_.assign((lastSample_ + 1) * stride_, 0.0);
+    current_.assign(stride_, 0.0);
+
+    for (unsigned int i = 0; i <= lastSample_; i++)
+    {
+        float* sample(&samples_[i * stride_]);
+        float time(static_cast<float>(i) / rate_);
+        for (unsigned int s = 0; s < numSplines_; s++)
+        {
+            vec3 v;
+            splines[s]->getCurrentVec(time, v);
+            sample[s * 3 + 0] = v.x();
+            sample[s * 3 + 1] = v.y();
+            sample[s * 3 + 2] = v.z();
+        }
+    }
+}
+
+void
+SplineTable::getCurrentVecs(float currentTime, vec3* v) const
+{
+    float position(currentTime * rate_);
+    unsigned int index(static_cast<unsigned int>(position));
+    float t(position - static_cast<float>(index));
+    // Past the end of the table, hold the last sample.
+    if (index >= lastSample_)
+    {
+        index = lastSample_ - 1;
+        t = 1.0;
+    }
+
+    // A straight unit-stride loop over all the components of all the
+    // splines, without dependencies between its iterations.
+    const float* a(&samples_[index * stride_]);
+    const float* b(a + stride_);
+    float* out(&current_[0]);
+    for (unsigned int i = 0; i < stride_; i++)
+    {
+        out[i] = a[i] + (b[i] - a[i]) * t;
+    }
+
+    for (unsigned int s = 0; s < numSplines_; s++)
+    {
+        v[s] = vec3(out[s * 3 + 0], out[s * 3 + 1], out[s * 3 + 2]);
+    }
+}
+
 ViewFromSpline::ViewFromSpline()
 {
     addControlPoint(vec3(-1.0, 1.0, -4.0));
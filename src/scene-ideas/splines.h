@@ -9,7 +9,7 @@ class Spline
 {
 public:
     Spline() :
-        paramData_(0) {}
+        numParams_(0), paramData_(0) {}
     ~Spline()
     {
         delete [] paramData_;
@@ -21,9 +21,35 @@ public:
 private:
     std::vector<LibMatrix::vec3> controlData_;
     typedef LibMatrix::vec3 param[4];
+    unsigned int numParams_;
     param* paramData_;
 };
 
+//
+// A set of splines sampled at regular intervals, so that they can all be
+// evaluated at once by interpolating between the two nearest samples.
+// The samples of a time are stored together, padded to a multiple of four
+// floats, which lets the compiler vectorize the interpolation.
+//
+class SplineTable
+{
+public:
+    SplineTable() :
+        numSplines_(0), stride_(0), rate_(0.0), lastSample_(0) {}
+    ~SplineTable() {}
+    void build(const std::vector<const Spline*>& splines, float endTime,
+               unsigned int samplesPerUnit);
+    void getCurrentVecs(float currentTime, LibMatrix::vec3* v) const;
+
+private:
+    unsigned int numSplines_;
+    unsigned int stride_;
+    float rate_;
+    unsigned int lastSample_;
+    std::vector<float> samples_;
+    mutable std::vector<float> current_;
+};
+
 class ViewFromSpline : public Spline
 {
 public:
@@ -0,0 +1,436 @@
+#include "scene.h"
+#include "log.h"
+#include "mat.h"
+#include "options.h"
+#include "stack.h"
+#include "shader-source.h"
+#include "model.h"
+#include "util.h"
+#include "gl-headers.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+enum DrawMethod {
+    DrawMethodIndividual,
+    DrawMethodInstanced,
+    DrawMethodUniformBatch
+};
+
+/* Uniform vectors kept free for the uniforms other than the instance array */
+const GLint reserved_uniform_vectors = 16;
+
+/* Floats per vertex: position and normal, followed by the instance index in batches */
+const unsigned int vertex_floats = 6;
+const unsigned int batch_vertex_floats = 7;
+
+}
+
+struct SceneInstancingPrivate
+{
+    SceneInstancingPrivate() :
+        method(DrawMethodIndividual), nobjects(0), batch_size(0), nvertices(0),
+        vbo(0), instance_vbo(0), batch_vbo(0), model_scale(1.0f),
+        draw_us(0) {}
+
+    DrawMethod method;
+    Program program;
+    unsigned int nobjects;
+    unsigned int batch_size;
+    unsigned int nvertices;
+
+    /* The model vertices, its copies for batching and the instance data */
+    GLuint vbo;
+    GLuint instance_vbo;
+    GLuint batch_vbo;
+    std::vector<float> instances;
+
+    float model_scale;
+    LibMatrix::vec3 model_center;
+    LibMatrix::mat4 perspective;
+
+    /* The CPU time spent submitting draws */
+    uint64_t draw_us;
+};
+
+SceneInstancing::SceneInstancing(Canvas &pCanvas) :
+    Scene(pCanvas, "instancing")
+{
+    priv_ = new SceneInstancingPrivate();
+
+    const ModelMap& modelMap = Model::find_models();
+    std::string optionValues;
+    for (ModelMap::const_iterator modelIt = modelMap.begin();
+         modelIt != modelMap.end();
+         modelIt++)
+    {
+        if (!optionValues.empty())
+            optionValues += ",";
+        optionValues += modelIt->first;
+    }
+
+    options_["model"] = Scene::Option("model", "cube", "Which model to use",
+                                      optionValues);
+    options_["triangles"] = Scene::Option("triangles", "0",
+                                          "Simplify the model to this number of triangles (0 to disable)");
+    options_["objects"] = Scene::Option("objects", "1000",
+                                        "The number of copies of the model to draw in each frame");
+    options_["method"] = Scene::Option("method", "individual",
+                                       "How to draw the copies: one draw call per copy, one instanced draw call, or batches of copies with per-copy uniforms",
+                                       "individual,instanced,uniform-batch");
+    options_["batch-size"] = Scene::Option("batch-size", "64",
+                                           "The maximum number of copies in each uniform-batch draw call (also limited by the uniform vectors available)");
+}
+
+SceneInstancing::~SceneInstancing()
+{
+    delete priv_;
+}
+
+bool
+SceneInstancing::supported(bool show_errors)
+{
+    if (options_["method"].value == "instanced" &&
+        (!GLExtensions::DrawArraysInstanced || !GLExtensions::VertexAttribDivisor))
+    {
+        if (show_errors) {
+            Log::error("Requested instanced draw method but instanced arrays"
+                       " are not supported!\n");
+        }
+        return false;
+    }
+
+    return true;
+}
+
+bool
+SceneInstancing::load()
+{
+    running_ = false;
+
+    return true;
+}
+
+void
+SceneInstancing::unload()
+{
+}
+
+bool
+SceneInstancing::setup()
+{
+    using LibMatrix::vec3;
+
+    if (!Scene::setup())
+        return false;
+
+    static const std::string vtx_shader_filename(Options::data_path + "/shaders/instancing.vert");
+    static const std::string frg_shader_filename(Options::data_path + "/shaders/light-basic.frag");
+    static const LibMatrix::vec4 lightPosition(20.0f, 20.0f, 10.0f, 1.0f);
+    static const LibMatrix::vec4 materialDiffuse(1.0f, 1.0f, 1.0f, 1.0f);
+
+    /* Parse options */
+    const std::string &method(options_["method"].value);
+
+    if (method == "instanced")
+        priv_->method = DrawMethodInstanced;
+    else if (method == "uniform-batch")
+        priv_->method = DrawMethodUniformBatch;
+    else
+        priv_->method = DrawMethodIndividual;
+
+    priv_->nobjects = Util::fromString<unsigned int>(options_["objects"].value);
+    priv_->batch_size = Util::fromString<unsigned int>(options_["batch-size"].value);
+
+    if (priv_->nobjects < 1 || priv_->batch_size < 1) {
+        Log::error("The number of objects and the batch size must be at least 1\n");
+        return false;
+    }
+
+    if (priv_->method == DrawMethodUniformBatch) {
+        GLint max_vectors = 0;
+#if GPULOAD_USE_GLESv2
+        glGetIntegerv(GL_MAX_VERTEX_UNIFORM_VECTORS, &max_vectors);
+#elif GPULOAD_USE_GL
+        glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &max_vectors);
+        max_vectors /= 4;
+#endif
+        if (max_vectors <= reserved_uniform_vectors) {
+            Log::error("Not enough vertex uniform vectors for uniform batching\n");
+            return false;
+        }
+
+        priv_->batch_size = std::min<unsigned int>(priv_->batch_size,
+                                                   max_vectors - reserved_uniform_vectors);
+        priv_->batch_size = std::min(priv_->batch_size, priv_->nobjects);
+    }
+
+    /* Set up the shaders, with the instance data from the draw method */
+    ShaderSource vtx_source(vtx_shader_filename);
+    ShaderSource frg_source(frg_shader_filename);
+
+    vtx_source.add_const("LightSourcePosition", lightPosition);
+    vtx_source.add_const("MaterialDiffuse", materialDiffuse);
+
+    if (priv_->method == DrawMethodInstanced) {
+        vtx_source.add("attribute vec4 instance_data;\n");
+        vtx_source.replace("$INSTANCE$", "instance_data");
+    }
+    else if (priv_->method == DrawMethodUniformBatch) {
+        vtx_source.add("attribute float instance_index;\n");
+        vtx_source.add("uniform vec4 InstanceData[" +
+                       Util::toString(priv_->batch_size) + "];\n");
+        vtx_source.replace("$INSTANCE$", "InstanceData[int(instance_index)]");
+    }
+    else {
+        vtx_source.add("uniform vec4 InstanceData;\n");
+        vtx_source.replace("$INSTANCE$", "InstanceData");
+    }
+
+    /* The scale is set once the model is loaded */
+    vtx_source.add("uniform float ModelScale;\n");
+
+    if (!Scene::load_shaders_from_strings(priv_->program, vtx_source.str(),
+                                          frg_source.str()))
+    {
+        return false;
+    }
+
+    /* Load the model, with only the position and normal attributes */
+    Model model;
+    if (!model.load(options_["model"].value))
+        return false;
+
+    unsigned int triangles(Util::fromString<unsigned int>(options_["triangles"].value));
+    if (triangles > 0)
+        model.select_triangles(triangles);
+
+    if (model.needNormals())
+        model.calculate_normals();
+
+    std::vector<std::pair<Model::AttribType, int> > attribs;
+    attribs.push_back(std::pair<Model::AttribType, int>(Model::AttribTypePosition, 3));
+    attribs.push_back(std::pair<Model::AttribType, int>(Model::AttribTypeNormal, 3));
+
+    Mesh mesh;
+    model.convert_to_mesh(mesh, attribs);
+
+    /* Center the model, so it rotates in place */
+    priv_->model_center = (model.maxVec() + model.minVec()) / 2.0f;
+
+    std::vector<std::vector<float> > &vertices(mesh.vertices());
+    std::vector<float> data;
+
+    priv_->nvertices = vertices.size();
+    data.reserve(priv_->nvertices * vertex_floats);
+
+    for (unsigned int v = 0; v < priv_->nvertices; v++) {
+        data.push_back(vertices[v][0] - priv_->model_center.x());
+        data.push_back(vertices[v][1] - priv_->model_center.y());
+        data.push_back(vertices[v][2] - priv_->model_center.z());
+        data.insert(data.end(), vertices[v].begin() + 3, vertices[v].begin() + 6);
+    }
+
+    glGenBuffers(1, &priv_->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, priv_->vbo);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0],
+                 GL_STATIC_DRAW);
+
+    /*
+     * Batches need a copy of the model for each object in the batch, with
+     * the index of the object (into InstanceData) as an extra attribute.
+     */
+    if (priv_->method == DrawMethodUniformBatch) {
+        std::vector<float> batch_data;
+        batch_data.reserve(priv_->batch_size * priv_->nvertices * batch_vertex_floats);
+
+        for (unsigned int i = 0; i < priv_->batch_size; i++) {
+            for (unsigned int v = 0; v < priv_->nvertices; v++) {
+                batch_data.insert(batch_data.end(), &data[v * vertex_floats],
+                                  &data[(v + 1) * vertex_floats]);
+                batch_data.push_back(i);
+            }
+        }
+
+        glGenBuffers(1, &priv_->batch_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, priv_->batch_vbo);
+        glBufferData(GL_ARRAY_BUFFER, batch_data.size() * sizeof(float),
+                     &batch_data[0], GL_STATIC_DRAW);
+    }
+
+    /*
+     * Lay the objects out in a cubic grid filling [-1, 1], each scaled to
+     * fit in its cell, with a different rotation phase.
+     */
+    unsigned int side = std::ceil(std::cbrt(static_cast<double>(priv_->nobjects)));
+    float cell = 2.0f / side;
+    float radius = (model.maxVec() - model.minVec()).length() / 2.0f;
+
+    priv_->model_scale = 0.5f * cell / std::max(radius, 1e-6f);
+    priv_->instances.clear();
+
+    for (unsigned int i = 0; i < priv_->nobjects; i++) {
+        unsigned int x = i % side;
+        unsigned int y = (i / side) % side;
+        unsigned int z = i / (side * side);
+
+        priv_->instances.push_back(-1.0f + (x + 0.5f) * cell);
+        priv_->instances.push_back(-1.0f + (y + 0.5f) * cell);
+        priv_->instances.push_back(-1.0f + (z + 0.5f) * cell);
+        priv_->instances.push_back(0.37f * i);
+    }
+
+    if (priv_->method == DrawMethodInstanced) {
+        glGenBuffers(1, &priv_->instance_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, priv_->instance_vbo);
+        glBufferData(GL_ARRAY_BUFFER, priv_->instances.size() * sizeof(float),
+                     &priv_->instances[0], GL_STATIC_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    float aspect(static_cast<float>(canvas_.width()) / static_cast<float>(canvas_.height()));
+    priv_->perspective.setIdentity();
+    priv_->perspective *= LibMatrix::Mat4::perspective(50.0, aspect, 1.0, 8.0);
+
+    priv_->program.start();
+    priv_->program["ModelScale"] = priv_->model_scale;
+
+    priv_->draw_us = 0;
+
+    currentFrame_ = 0;
+    running_ = true;
+    startTime_ = Util::get_timestamp_us() / 1000000.0;
+    lastUpdateTime_ = startTime_;
+
+    return true;
+}
+
+void
+SceneInstancing::teardown()
+{
+    if (currentFrame_ > 0) {
+        double elapsed = lastUpdateTime_ - startTime_;
+
+        Log::info("    %u objects/frame (%u draw calls), %.0f objects/s, "
+                  "CPU %.3f ms/frame to submit the draws\n",
+                  priv_->nobjects, draw_calls(),
+                  elapsed > 0.0 ? priv_->nobjects * currentFrame_ / elapsed : 0.0,
+                  priv_->draw_us / 1000.0 / currentFrame_);
+    }
+
+    priv_->program.stop();
+    priv_->program.release();
+
+    glDeleteBuffers(1, &priv_->vbo);
+    glDeleteBuffers(1, &priv_->instance_vbo);
+    glDeleteBuffers(1, &priv_->batch_vbo);
+    priv_->vbo = 0;
+    priv_->instance_vbo = 0;
+    priv_->batch_vbo = 0;
+    priv_->instances.clear();
+
+    Scene::teardown();
+}
+
+void
+SceneInstancing::update()
+{
+    Scene::update();
+}
+
+void
+SceneInstancing::draw()
+{
+    uint64_t start = Util::get_timestamp_us();
+    double elapsed_time = lastUpdateTime_ - startTime_;
+    Program &program(priv_->program);
+
+    LibMatrix::Stack4 model_view;
+    LibMatrix::mat4 model_view_proj(priv_->perspective);
+
+    model_view.translate(0.0f, 0.0f, -4.0f);
+    model_view.rotate(20.0f, 1.0f, 0.0f, 0.0f);
+    model_view.rotate(10.0f * elapsed_time, 0.0f, 1.0f, 0.0f);
+    model_view_proj *= model_view.getCurrent();
+
+    LibMatrix::mat4 normal_matrix(model_view.getCurrent());
+    normal_matrix.inverse().transpose();
+
+    program["ModelViewProjectionMatrix"] = model_view_proj;
+    program["NormalMatrix"] = normal_matrix;
+    program["Rotation"] = static_cast<float>(elapsed_time);
+
+    GLint position = program["position"].location();
+    GLint normal = program["normal"].location();
+    GLsizei stride = (priv_->method == DrawMethodUniformBatch ? batch_vertex_floats
+                                                               : vertex_floats) * sizeof(float);
+
+    glBindBuffer(GL_ARRAY_BUFFER, priv_->method == DrawMethodUniformBatch ? priv_->batch_vbo
+                                                                           : priv_->vbo);
+    glEnableVertexAttribArray(position);
+    glVertexAttribPointer(position, 3, GL_FLOAT, GL_FALSE, stride, 0);
+    glEnableVertexAttribArray(normal);
+    glVertexAttribPointer(normal, 3, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const GLvoid *>(3 * sizeof(float)));
+
+    if (priv_->method == DrawMethodInstanced) {
+        GLint instance_data = program["instance_data"].location();
+
+        glBindBuffer(GL_ARRAY_BUFFER, priv_->instance_vbo);
+        glEnableVertexAttribArray(instance_data);
+        glVertexAttribPointer(instance_data, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        GLExtensions::VertexAttribDivisor(instance_data, 1);
+
+        GLExtensions::DrawArraysInstanced(GL_TRIANGLES, 0, priv_->nvertices,
+                                          priv_->nobjects);
+
+        GLExtensions::VertexAttribDivisor(instance_data, 0);
+        glDisableVertexAttribArray(instance_data);
+    }
+    else if (priv_->method == DrawMethodUniformBatch) {
+        GLint instance_index = program["instance_index"].location();
+        GLint instance_data = program["InstanceData"].location();
+
+        glEnableVertexAttribArray(instance_index);
+        glVertexAttribPointer(instance_index, 1, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<const GLvoid *>(6 * sizeof(float)));
+
+        for (unsigned int i = 0; i < priv_->nobjects; i += priv_->batch_size) {
+            unsigned int count = std::min(priv_->batch_size, priv_->nobjects - i);
+
+            glUniform4fv(instance_data, count, &priv_->instances[4 * i]);
+            glDrawArrays(GL_TRIANGLES, 0, count * priv_->nvertices);
+        }
+
+        glDisableVertexAttribArray(instance_index);
+    }
+    else {
+        GLint instance_data = program["InstanceData"].location();
+
+        for (unsigned int i = 0; i < priv_->nobjects; i++) {
+            glUniform4fv(instance_data, 1, &priv_->instances[4 * i]);
+            glDrawArrays(GL_TRIANGLES, 0, priv_->nvertices);
+        }
+    }
+
+    glDisableVertexAttribArray(position);
+    glDisableVertexAttribArray(normal);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    priv_->draw_us += Util::get_timestamp_us() - start;
+}
+
+unsigned int
+SceneInstancing::draw_calls()
+{
+    if (priv_->method == DrawMethodInstanced)
+        return 1;
+    else if (priv_->method == DrawMethodUniformBatch)
+        return (priv_->nobjects + priv_->batch_size - 1) / priv_->batch_size;
+    else
+        return priv_->nobjects;
+}
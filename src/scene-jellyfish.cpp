@@ -1,4 +1,6 @@
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <fstream>
 #include <memory>
@@ -9,12 +11,17 @@
 #include "log.h"
 #include "util.h"
 #include "texture.h"
+#include "texture-atlas.h"
 #include "shader-source.h"
 
 SceneJellyfish::SceneJellyfish(Canvas& canvas) :
     Scene(canvas, "jellyfish"), priv_(0)
 {
-
+    options_["caustics"] = Scene::Option("caustics", "separate",
+                                         "How to store the caustics animation frames: one texture per frame, or all frames packed in an atlas",
+                                         "separate,packed");
+    options_["count"] = Scene::Option("count", "1",
+                                      "The number of jellyfish in the school, each with its own animation phase (drawn instanced when supported, otherwise one draw call each)");
 }
 
 SceneJellyfish::~SceneJellyfish()
@@ -40,9 +47,16 @@ SceneJellyfish::setup()
     if (!Scene::setup())
         return false;
 
+    unsigned int count = Util::fromString<unsigned int>(options_["count"].value);
+    if (count < 1)
+    {
+        Log::error("The number of jellyfish must be at least 1\n");
+        return false;
+    }
+
     // Set up our private object that does all of the lifting
     priv_ = new JellyfishPrivate();
-    if (!priv_->initialize())
+    if (!priv_->initialize(options_["caustics"].value == "packed", count))
         return false;
 
     // Set core scene timing after actual initialization so we don't measure
@@ -57,6 +71,18 @@ SceneJellyfish::setup()
 void
 SceneJellyfish::teardown()
 {
+    /* Setup may have failed before creating the private object */
+    if (!priv_)
+    {
+        Scene::teardown();
+        return;
+    }
+
+    if (priv_->count() > 1)
+    {
+        Log::info("    %u jellyfish/frame (%s)\n", priv_->count(),
+                  priv_->instanced() ? "1 instanced draw call" : "1 draw call each");
+    }
     priv_->cleanup();
     delete priv_;
     priv_ = 0;
@@ -88,6 +114,7 @@ SceneJellyfish::validate()
 // JellyfishPrivate implementation
 //
 using LibMatrix::mat4;
+using LibMatrix::vec4;
 using LibMatrix::vec3;
 using LibMatrix::vec2;
 using std::string;
@@ -323,10 +350,14 @@ JellyfishPrivate::load_obj(const std::string &filename)
 }
 
 JellyfishPrivate::JellyfishPrivate() :
+    instanced_(false),
+    whichCaustic_(0),
+    packedCaustics_(false),
     positionLocation_(0),
     normalLocation_(0),
     colorLocation_(0),
     texcoordLocation_(0),
+    instanceLocation_(-1),
     viewport_(512.0, 512.0),
     lightPosition_(10.0, 40.0, -60.0),
     lightColor_(0.8, 1.3, 1.1, 1.0),
@@ -335,6 +366,7 @@ JellyfishPrivate::JellyfishPrivate() :
     fresnelColor_(0.8, 0.7, 0.6, 1.1),
     fresnelPower_(1.0),
     rotation_(0.0),
+    schoolScale_(1.0),
     currentTime_(0.0),
     lastUpdateTime_(0.0),
     cullFace_(0),
@@ -355,8 +387,56 @@ JellyfishPrivate::~JellyfishPrivate()
 }
 
 bool
-JellyfishPrivate::initialize()
+JellyfishPrivate::initialize(bool packedCaustics, unsigned int count)
 {
+    using std::string;
+    static const string baseName("jellyfish-caustics-");
+
+    // The atlas is loaded first, as it decides which shader to use: fall
+    // back to separate textures if it is too large for the GL implementation.
+    packedCaustics_ = packedCaustics;
+    if (packedCaustics_)
+    {
+        if (!load_caustics_atlas(baseName))
+        {
+            return false;
+        }
+        if (!causticsAtlas_.fits())
+        {
+            Log::info("The caustics atlas exceeds GL_MAX_TEXTURE_SIZE, using separate textures\n");
+            packedCaustics_ = false;
+        }
+    }
+
+    // Lay the school out on a grid of model sized cells (the model is about
+    // 5 units wide and 11 tall), with some jitter, in depth too, and spread
+    // the animation phases.  The whole school is scaled down to fit where
+    // the single jellyfish was.  The first one sits at the origin, with no
+    // offset, so a single one is drawn as it always was.
+    unsigned int columns(std::ceil(std::sqrt(static_cast<double>(count))));
+    unsigned int rows((count + columns - 1) / columns);
+    instances_.clear();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        float column(i % columns);
+        float row(i / columns);
+        instances_.push_back(vec4(
+            (column - (columns - 1) / 2.0) * 6.0 + std::sin(i * 12.9898) * 1.0,
+            ((rows - 1) / 2.0 - row) * 8.0 + std::sin(i * 78.233) * 1.5,
+            std::sin(i * 37.719) * 6.0,
+            std::fmod(i * 2.39996f, 15.0f)));
+    }
+    schoolScale_ = 1.0 / std::max(columns, rows);
+
+    // Draw the school with a single instanced draw call if we can,
+    // otherwise with one draw call per jellyfish.
+    instanced_ = count > 1 && GLExtensions::DrawElementsInstanced &&
+                 GLExtensions::VertexAttribDivisor;
+    if (count > 1 && !instanced_)
+    {
+        Log::debug("Instanced arrays are not supported, drawing the jellyfish one by one\n");
+    }
+
     static const string modelFilename(Options::data_path + "/models/jellyfish.jobj");
     if (!load_obj(modelFilename))
     {
@@ -391,12 +471,24 @@ JellyfishPrivate::initialize()
 
     // Set up program first so we can store attribute and uniform locations
     // away for the 
-    using std::string;
     static const string vtx_shader_filename(Options::data_path + "/shaders/jellyfish.vert");
     static const string frg_shader_filename(Options::data_path + "/shaders/jellyfish.frag");
+    static const string frg_atlas_shader_filename(Options::data_path + "/shaders/jellyfish-atlas.frag");
 
     ShaderSource vtx_source(vtx_shader_filename);
-    ShaderSource frg_source(frg_shader_filename);
+    ShaderSource frg_source(packedCaustics_ ? frg_atlas_shader_filename :
+                                              frg_shader_filename);
+
+    if (instanced_)
+    {
+        vtx_source.add("attribute vec4 aInstance;\n");
+        vtx_source.replace("$INSTANCE$", "aInstance");
+    }
+    else
+    {
+        vtx_source.add("uniform vec4 uInstance;\n");
+        vtx_source.replace("$INSTANCE$", "uInstance");
+    }
 
     // Use high float precision, if available, in the jellyfish fragment shader
     frg_source.precision(std::string(",high,,"));
@@ -412,10 +504,14 @@ JellyfishPrivate::initialize()
     normalLocation_ = program_["aVertexNormal"].location();
     colorLocation_ = program_["aVertexColor"].location();
     texcoordLocation_ = program_["aTextureCoord"].location();
+    if (instanced_)
+    {
+        instanceLocation_ = program_["aInstance"].location();
+    }
 
-    // We need 2 buffers for our work here.  One for the vertex data.
-    // and one for the index data.
-    glGenBuffers(2, &bufferObjects_[0]);
+    // We need 3 buffers for our work here.  One for the vertex data,
+    // one for the index data, and one for the instance data, if any.
+    glGenBuffers(3, &bufferObjects_[0]);
 
     // First, setup the vertex data by binding the first buffer object, 
     // allocating its data store, and filling it in with our vertex data.
@@ -435,6 +531,13 @@ JellyfishPrivate::initialize()
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(unsigned short),
                  &indices_.front(), GL_STATIC_DRAW);
 
+    if (instanced_)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, bufferObjects_[2]);
+        glBufferData(GL_ARRAY_BUFFER, instances_.size() * sizeof(vec4),
+                     &instances_.front(), GL_STATIC_DRAW);
+    }
+
     // "Unbind" our buffer objects to make sure the state is consistent.
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -442,6 +545,7 @@ JellyfishPrivate::initialize()
     // Finally, set up our textures.
     //
     // First, the main jellyfish texture
+    std::fill(&textureObjects_[0], &textureObjects_[33], 0);
     bool gotTex = Texture::load("jellyfish256", &textureObjects_[0], GL_LINEAR,
                                 GL_LINEAR, 0);
     if (!gotTex || textureObjects_[0] == 0)
@@ -451,7 +555,10 @@ JellyfishPrivate::initialize()
     }
     glBindTexture(GL_TEXTURE_2D, 0);
     // Then, the caustics textures
-    static const string baseName("jellyfish-caustics-");
+    if (packedCaustics_)
+    {
+        return initialize_caustics_atlas();
+    }
     for (unsigned int i = 1; i < 33; i++)
     {
         std::stringstream ss;
@@ -470,6 +577,76 @@ JellyfishPrivate::initialize()
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
+    save_state();
+
+    return true;
+}
+
+bool
+JellyfishPrivate::load_caustics_atlas(const std::string& baseName)
+{
+    // Load the precomputed atlas, or pack one from the individual frames
+    // if it isn't available.
+    static const string atlasFilename(Options::data_path + "/textures/" +
+                                      baseName.substr(0, baseName.size() - 1) +
+                                      ".atlas");
+    TextureAtlas& atlas(causticsAtlas_);
+    if (!atlas.load(atlasFilename))
+    {
+        Log::debug("Packing the caustics atlas at run time\n");
+        const TextureMap& textureMap = Texture::find_textures();
+        std::vector<string> filenames;
+        for (unsigned int i = 1; i < 33; i++)
+        {
+            std::stringstream ss;
+            ss << baseName << std::setw(2) << std::setfill('0') << i;
+            TextureMap::const_iterator textureIt = textureMap.find(ss.str());
+            if (textureIt == textureMap.end())
+            {
+                Log::error("Caustics texture[%u] not found!!!\n", i);
+                return false;
+            }
+            filenames.push_back(textureIt->second->pathname());
+        }
+        if (!atlas.pack(filenames))
+        {
+            Log::error("Caustics atlas set up failed!!!\n");
+            return false;
+        }
+    }
+
+    if (atlas.count() < 32)
+    {
+        Log::error("Caustics atlas holds only %u frames!!!\n", atlas.count());
+        return false;
+    }
+
+    return true;
+}
+
+bool
+JellyfishPrivate::initialize_caustics_atlas()
+{
+    causticsAtlas_.upload(&textureObjects_[1], GL_LINEAR, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    causticsOffsets_.resize(32);
+    for (unsigned int i = 0; i < 32; i++)
+    {
+        causticsAtlas_.tile(i, causticsOffsets_[i], causticsScale_);
+    }
+
+    // The pixels are in the texture now
+    causticsAtlas_ = TextureAtlas();
+
+    save_state();
+
+    return true;
+}
+
+void
+JellyfishPrivate::save_state()
+{
     // Save the GL state we are changing so we can restore it later.
     cullFace_ = glIsEnabled(GL_CULL_FACE);
     depthTest_ = glIsEnabled(GL_DEPTH_TEST);
@@ -481,8 +658,6 @@ JellyfishPrivate::initialize()
     glEnable(GL_BLEND);
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
-
-    return true;
 }
 
 void
@@ -533,7 +708,7 @@ JellyfishPrivate::cleanup()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
     glDeleteTextures(33, &textureObjects_[0]);
-    glDeleteBuffers(2, &bufferObjects_[0]);
+    glDeleteBuffers(3, &bufferObjects_[0]);
 
     gradient_.cleanup();
 }
@@ -558,6 +733,7 @@ JellyfishPrivate::draw()
     world_.rotate(sin(rotation_ / 20.0) * 30.0, 1.0, 0.0, 0.0);
     world_.scale(5.0, 5.0, 5.0);
     world_.translate(0.0, sin(rotation_ / 10.0) * 2.5, 0.0);
+    world_.scale(schoolScale_, schoolScale_, schoolScale_);
     mat4 worldViewProjection(projection_.getCurrent());
     worldViewProjection *= world_.getCurrent();;
     mat4 worldInverseTranspose(world_.getCurrent());
@@ -582,7 +758,17 @@ JellyfishPrivate::draw()
     glBindTexture(GL_TEXTURE_2D, textureObjects_[0]);
     program_["uSampler"] = 0;
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, textureObjects_[whichCaustic_]);
+    if (packedCaustics_)
+    {
+        // All frames are in the same texture, select the current one
+        glBindTexture(GL_TEXTURE_2D, textureObjects_[1]);
+        program_["uCausticsOffset"] = causticsOffsets_[whichCaustic_ - 1];
+        program_["uCausticsScale"] = causticsScale_;
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, textureObjects_[whichCaustic_]);
+    }
     program_["uSampler1"] = 1;
 
     glBindBuffer(GL_ARRAY_BUFFER, bufferObjects_[0]);
@@ -601,7 +787,28 @@ JellyfishPrivate::draw()
     glVertexAttribPointer(texcoordLocation_ , 3, GL_FLOAT, GL_FALSE, 0,
         reinterpret_cast<const GLvoid*>(dataMap_.texcoordOffset));
 
-    glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_SHORT, 0);
+    if (instanced_)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, bufferObjects_[2]);
+        glEnableVertexAttribArray(instanceLocation_);
+        glVertexAttribPointer(instanceLocation_, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        GLExtensions::VertexAttribDivisor(instanceLocation_, 1);
+
+        GLExtensions::DrawElementsInstanced(GL_TRIANGLES, indices_.size(),
+                                            GL_UNSIGNED_SHORT, 0,
+                                            instances_.size());
+
+        GLExtensions::VertexAttribDivisor(instanceLocation_, 0);
+        glDisableVertexAttribArray(instanceLocation_);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < instances_.size(); i++)
+        {
+            program_["uInstance"] = instances_[i];
+            glDrawElements(GL_TRIANGLES, indices_.size(), GL_UNSIGNED_SHORT, 0);
+        }
+    }
 
     glDisableVertexAttribArray(positionLocation_);
     glDisableVertexAttribArray(normalLocation_);
@@ -5,6 +5,7 @@
 #include "vec.h"
 #include "stack.h"
 #include "program.h"
+#include "texture-atlas.h"
 
 class GradientRenderer
 {
@@ -35,6 +36,9 @@ public:
 class JellyfishPrivate
 {
     bool load_obj(const std::string& filename);
+    bool load_caustics_atlas(const std::string& baseName);
+    bool initialize_caustics_atlas();
+    void save_state();
 
     // For the background gradient.
     GradientRenderer gradient_;
@@ -59,10 +63,20 @@ class JellyfishPrivate
         unsigned int texcoordSize;
         unsigned int totalSize;
     } dataMap_;
+    // The offset (xyz) and animation phase (w) of each jellyfish in the
+    // school, drawn with a single instanced draw when possible.
+    std::vector<LibMatrix::vec4> instances_;
+    bool instanced_;
     // Object handles
-    unsigned int bufferObjects_[2];
+    unsigned int bufferObjects_[3];
     unsigned int textureObjects_[33];
     unsigned int whichCaustic_;
+    // When the caustics are packed in an atlas (textureObjects_[1]), the
+    // area of each caustics frame in it.
+    bool packedCaustics_;
+    TextureAtlas causticsAtlas_;
+    std::vector<LibMatrix::vec2> causticsOffsets_;
+    LibMatrix::vec2 causticsScale_;
     std::map<std::string, unsigned int> causticMap_;
 
     // Program state, including attributes, uniforms, and, locations.
@@ -71,6 +85,7 @@ class JellyfishPrivate
     int normalLocation_;
     int colorLocation_;
     int texcoordLocation_;
+    int instanceLocation_;
     LibMatrix::vec2 viewport_;
     LibMatrix::Stack4 world_;
     LibMatrix::Stack4 projection_;
@@ -81,6 +96,7 @@ class JellyfishPrivate
     LibMatrix::vec4 fresnelColor_;
     float fresnelPower_;
     float rotation_;
+    float schoolScale_;
     float currentTime_;
     double lastUpdateTime_;
     // GL state we plan to override, so we can restore it cleanly.
@@ -93,11 +109,13 @@ class JellyfishPrivate
 public:
     JellyfishPrivate();
     ~JellyfishPrivate();
-    bool initialize();
+    bool initialize(bool packedCaustics, unsigned int count);
     void update_viewport(const LibMatrix::vec2& viewport);
     void update_time();
     void cleanup();
     void draw();
+    unsigned int count() const { return instances_.size(); }
+    bool instanced() const { return instanced_; }
 };
 
 #endif // SCENE_JELLYFISH_
@@ -40,8 +40,8 @@ SceneLoop::~SceneLoop()
 {
 }
 
-static std::string
-get_fragment_shader_source(int steps, bool loop, bool uniform)
+std::string
+SceneLoop::fragment_shader_source(int steps, bool loop, bool uniform)
 {
     ShaderSource source(Options::data_path + frg_file);
     ShaderSource source_main;
@@ -65,8 +65,8 @@ get_fragment_shader_source(int steps, bool loop, bool uniform)
     return source.str();
 }
 
-static std::string
-get_vertex_shader_source(int steps, bool loop, bool uniform)
+std::string
+SceneLoop::vertex_shader_source(int steps, bool loop, bool uniform)
 {
     ShaderSource source(Options::data_path + vtx_file);
     ShaderSource source_main;
@@ -106,9 +106,9 @@ SceneLoop::setup()
     int frg_steps = Util::fromString<int>(options_["fragment-steps"].value);
 
     /* Load shaders */
-    std::string vtx_shader(get_vertex_shader_source(vtx_steps, vtx_loop,
+    std::string vtx_shader(vertex_shader_source(vtx_steps, vtx_loop,
                                                     vtx_uniform));
-    std::string frg_shader(get_fragment_shader_source(frg_steps, frg_loop,
+    std::string frg_shader(fragment_shader_source(frg_steps, frg_loop,
                                                       frg_uniform));
 
     if (!Scene::load_shaders_from_strings(program_, vtx_shader, frg_shader))
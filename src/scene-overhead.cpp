@@ -0,0 +1,370 @@
+#include "scene.h"
+#include "log.h"
+#include "options.h"
+#include "shader-source.h"
+#include "texture.h"
+#include "util.h"
+#include "gl-headers.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+
+enum OverheadTest {
+    OverheadTestDraw,
+    OverheadTestProgram,
+    OverheadTestTexture,
+    OverheadTestUniform,
+    OverheadTestAttrib,
+    OverheadTestState,
+    OverheadTests
+};
+
+const char *overhead_test_names[OverheadTests] = {
+    "draw", "program", "texture", "uniform", "attrib", "state"
+};
+
+const char *overhead_test_descriptions[OverheadTests] = {
+    "draw calls",
+    "program switches",
+    "texture binds",
+    "uniform uploads",
+    "vertex attribute respecifications",
+    "blend/depth state toggles"
+};
+
+/* The number of textures available to cycle through */
+const unsigned int max_textures = 32;
+
+/* The statistics of a call count of the sweep */
+struct SweepStep
+{
+    SweepStep() : calls(0), frames(0), cpu_us(0), start(0.0), end(0.0) {}
+
+    unsigned int calls;
+    unsigned int frames;
+    /* The CPU time spent making the calls */
+    uint64_t cpu_us;
+    /* The wall clock time the step started and ended at, in seconds */
+    double start;
+    double end;
+};
+
+}
+
+struct SceneOverheadPrivate
+{
+    SceneOverheadPrivate() :
+        test(OverheadTestDraw), step(0), vbos(), position(-1), offset(-1) {}
+
+    OverheadTest test;
+    std::vector<SweepStep> steps;
+    unsigned int step;
+
+    std::vector<std::unique_ptr<Program> > programs;
+    std::vector<GLuint> textures;
+    /* Two buffers with the same triangle, to alternate between */
+    GLuint vbos[2];
+    GLint position;
+    GLint offset;
+};
+
+SceneOverhead::SceneOverhead(Canvas &pCanvas) :
+    Scene(pCanvas, "overhead")
+{
+    priv_ = new SceneOverheadPrivate();
+
+    std::string test_names;
+    for (unsigned int i = 0; i < OverheadTests; i++)
+        test_names += std::string(i > 0 ? "," : "") + overhead_test_names[i];
+
+    options_["test"] = Scene::Option("test", "draw",
+            "The driver call to measure, each followed by a draw call (draw: draw calls only, "
+            "program: program switches, texture: texture binds, uniform: uniform uploads, "
+            "attrib: vertex attribute respecification, state: blend/depth state toggles)",
+            test_names);
+    options_["calls"] = Scene::Option("calls", "100,1000,10000",
+            "The comma separated numbers of calls per frame to sweep, each run for an equal part of the duration");
+    options_["programs"] = Scene::Option("programs", "4",
+            "The number of programs to switch between in the program test");
+    options_["textures"] = Scene::Option("textures", "8",
+            "The number of textures to bind in turn in the texture test (up to 32)");
+}
+
+SceneOverhead::~SceneOverhead()
+{
+    delete priv_;
+}
+
+bool
+SceneOverhead::load()
+{
+    running_ = false;
+
+    return true;
+}
+
+void
+SceneOverhead::unload()
+{
+}
+
+bool
+SceneOverhead::setup()
+{
+    if (!Scene::setup())
+        return false;
+
+    static const std::string vtx_shader_filename(Options::data_path + "/shaders/overhead.vert");
+    static const std::string frg_shader_filename(Options::data_path + "/shaders/overhead.frag");
+
+    /* Parse options */
+    const char **name = std::find(overhead_test_names, overhead_test_names + OverheadTests,
+                                  options_["test"].value);
+    priv_->test = static_cast<OverheadTest>(name - overhead_test_names);
+
+    std::vector<std::string> calls;
+    Util::split(options_["calls"].value, ',', calls, Util::SplitModeNormal);
+
+    priv_->steps.clear();
+    for (unsigned int i = 0; i < calls.size(); i++) {
+        SweepStep step;
+        step.calls = Util::fromString<unsigned int>(calls[i]);
+        if (step.calls < 1) {
+            Log::error("The number of calls per frame must be at least 1\n");
+            return false;
+        }
+        priv_->steps.push_back(step);
+    }
+
+    if (priv_->steps.empty()) {
+        Log::error("No numbers of calls per frame to sweep\n");
+        return false;
+    }
+
+    unsigned int nprograms = Util::fromString<unsigned int>(options_["programs"].value);
+    unsigned int ntextures = Util::fromString<unsigned int>(options_["textures"].value);
+
+    if (nprograms < 1 || ntextures < 1 || ntextures > max_textures) {
+        Log::error("The number of programs must be at least 1, and of textures 1 to %u\n",
+                   max_textures);
+        return false;
+    }
+
+    /* Programs that only differ in their color, to switch between */
+    if (priv_->test != OverheadTestProgram)
+        nprograms = 1;
+
+    priv_->programs.clear();
+    for (unsigned int i = 0; i < nprograms; i++) {
+        ShaderSource vtx_source(vtx_shader_filename);
+        ShaderSource frg_source(frg_shader_filename);
+
+        frg_source.add_const("Color", LibMatrix::vec4(0.5f + 0.5f * (i % 2),
+                                                      0.5f + 0.5f * (i / 2 % 2),
+                                                      0.5f + 0.5f * (i / 4 % 2),
+                                                      1.0f));
+
+        priv_->programs.push_back(std::unique_ptr<Program>(new Program()));
+        if (!Scene::load_shaders_from_strings(*priv_->programs.back(),
+                                              vtx_source.str(), frg_source.str()))
+        {
+            return false;
+        }
+
+        priv_->programs.back()->start();
+        (*priv_->programs.back())["Texture0"] = 0;
+        (*priv_->programs.back())["Offset"] = LibMatrix::vec4(0.0f);
+    }
+
+    /* The first program is current, with its locations */
+    Program &program(*priv_->programs[0]);
+    program.start();
+    priv_->position = program["position"].location();
+    priv_->offset = program["Offset"].location();
+
+    for (unsigned int i = 1; i < priv_->programs.size(); i++) {
+        if ((*priv_->programs[i])["position"].location() != priv_->position) {
+            Log::error("The programs to switch between have different attribute locations\n");
+            return false;
+        }
+    }
+
+    /* Textures to bind in turn, only one of them for the other tests */
+    if (priv_->test != OverheadTestTexture)
+        ntextures = 1;
+
+    std::vector<std::string> texture_names;
+    for (unsigned int i = 0; i < ntextures; i++) {
+        texture_names.push_back(std::string("jellyfish-caustics-") +
+                                (i < 9 ? "0" : "") + Util::toString(i + 1));
+    }
+
+    Texture::find_textures();
+    priv_->textures.resize(ntextures);
+    if (!Texture::load_all(texture_names, &priv_->textures[0], GL_LINEAR, GL_LINEAR))
+        return false;
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, priv_->textures[0]);
+
+    /* The triangle */
+    static const GLfloat triangle[] = {
+        -1.0f, -1.0f, 0.0f,
+         1.0f, -1.0f, 0.0f,
+         0.0f,  1.0f, 0.0f
+    };
+
+    glGenBuffers(2, priv_->vbos);
+    for (unsigned int i = 0; i < 2; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, priv_->vbos[i]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, priv_->vbos[0]);
+    glVertexAttribPointer(priv_->position, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(priv_->position);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    priv_->step = 0;
+
+    currentFrame_ = 0;
+    running_ = true;
+    startTime_ = Util::get_timestamp_us() / 1000000.0;
+    lastUpdateTime_ = startTime_;
+
+    priv_->steps[0].start = startTime_;
+
+    return true;
+}
+
+void
+SceneOverhead::teardown()
+{
+    for (unsigned int i = 0; i < priv_->steps.size(); i++) {
+        const SweepStep &step(priv_->steps[i]);
+        double elapsed = step.end - step.start;
+        double ncalls = static_cast<double>(step.calls) * step.frames;
+
+        if (step.frames == 0 || elapsed <= 0.0)
+            continue;
+
+        Log::info("    %u %s/frame: %.0f calls/s, %.1f ns/call CPU (%u frames)\n",
+                  step.calls, overhead_test_descriptions[priv_->test],
+                  ncalls / elapsed, step.cpu_us * 1000.0 / ncalls, step.frames);
+    }
+
+    if (priv_->position >= 0)
+        glDisableVertexAttribArray(priv_->position);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(2, priv_->vbos);
+
+    if (!priv_->textures.empty())
+        glDeleteTextures(priv_->textures.size(), &priv_->textures[0]);
+    priv_->textures.clear();
+
+    for (unsigned int i = 0; i < priv_->programs.size(); i++) {
+        priv_->programs[i]->stop();
+        priv_->programs[i]->release();
+    }
+    priv_->programs.clear();
+
+    glDisable(GL_BLEND);
+    glDepthFunc(GL_LEQUAL);
+
+    Scene::teardown();
+}
+
+void
+SceneOverhead::update()
+{
+    Scene::update();
+
+    SweepStep &current(priv_->steps[priv_->step]);
+    current.end = lastUpdateTime_;
+
+    /* Move on to the next step of the sweep when its share of the run is over */
+    unsigned int nsteps = priv_->steps.size();
+    double progress;
+
+    if (nframes_ > 0)
+        progress = static_cast<double>(currentFrame_) / nframes_;
+    else
+        progress = (lastUpdateTime_ - startTime_) / duration_;
+
+    unsigned int step = std::min<unsigned int>(progress * nsteps, nsteps - 1);
+
+    if (step != priv_->step) {
+        priv_->step = step;
+        priv_->steps[step].start = lastUpdateTime_;
+    }
+}
+
+void
+SceneOverhead::draw()
+{
+    SweepStep &step(priv_->steps[priv_->step]);
+    unsigned int calls = step.calls;
+    GLint offset = priv_->offset;
+    uint64_t start = Util::get_timestamp_us();
+
+    switch (priv_->test) {
+        case OverheadTestDraw:
+            for (unsigned int i = 0; i < calls; i++)
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            break;
+
+        case OverheadTestProgram:
+            for (unsigned int i = 0; i < calls; i++) {
+                priv_->programs[i % priv_->programs.size()]->start();
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            priv_->programs[0]->start();
+            break;
+
+        case OverheadTestTexture:
+            for (unsigned int i = 0; i < calls; i++) {
+                glBindTexture(GL_TEXTURE_2D, priv_->textures[i % priv_->textures.size()]);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            break;
+
+        case OverheadTestUniform:
+            /* Spread the triangles over the screen */
+            for (unsigned int i = 0; i < calls; i++) {
+                glUniform4f(offset, -0.95f + 1.9f / 63.0f * (i % 64),
+                            -0.95f + 1.9f / 63.0f * (i / 64 % 64), 0.0f, 0.0f);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            glUniform4f(offset, 0.0f, 0.0f, 0.0f, 0.0f);
+            break;
+
+        case OverheadTestAttrib:
+            for (unsigned int i = 0; i < calls; i++) {
+                glBindBuffer(GL_ARRAY_BUFFER, priv_->vbos[i % 2]);
+                glVertexAttribPointer(priv_->position, 3, GL_FLOAT, GL_FALSE, 0, 0);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            break;
+
+        case OverheadTestState:
+            for (unsigned int i = 0; i < calls; i++) {
+                if (i % 2)
+                    glEnable(GL_BLEND);
+                else
+                    glDisable(GL_BLEND);
+                glDepthFunc(i % 2 ? GL_LESS : GL_LEQUAL);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    step.cpu_us += Util::get_timestamp_us() - start;
+    step.frames++;
+}
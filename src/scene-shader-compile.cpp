@@ -0,0 +1,412 @@
+#include "scene.h"
+#include "gl-state.h"
+#include "mat.h"
+#include "stack.h"
+#include "log.h"
+#include "util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+
+enum VariantClass {
+    VariantClassConditionals,
+    VariantClassLoop,
+    VariantClassFunction,
+    VariantClasses
+};
+
+const char *variant_class_names[VariantClasses] = {
+    "conditionals", "loop", "function"
+};
+
+struct Variant
+{
+    VariantClass cls;
+    int steps;
+    std::string vtx_shader;
+    std::string frg_shader;
+};
+
+/* A program built from a variant, with its build times */
+struct BuiltVariant
+{
+    BuiltVariant() : index(0), compile_us(0), link_us(0) {}
+
+    unsigned int index;
+    std::unique_ptr<Program> program;
+    uint64_t compile_us;
+    uint64_t link_us;
+};
+
+/*
+ * Compiles and links a variant. This makes no calls other than GL ones, so
+ * it can run on any thread with a current context.
+ */
+BuiltVariant
+build_variant(const std::vector<Variant> &variants, unsigned int index)
+{
+    BuiltVariant built;
+    const Variant &variant(variants[index]);
+
+    built.index = index;
+    built.program.reset(new Program());
+
+    Program &program(*built.program);
+    program.init();
+
+    uint64_t start = Util::get_timestamp_us();
+    program.addShader(GL_VERTEX_SHADER, variant.vtx_shader);
+    program.addShader(GL_FRAGMENT_SHADER, variant.frg_shader);
+    uint64_t compiled = Util::get_timestamp_us();
+    program.build();
+    uint64_t linked = Util::get_timestamp_us();
+
+    built.compile_us = compiled - start;
+    built.link_us = linked - compiled;
+
+    return built;
+}
+
+/* The nearest-rank percentile of a set of samples, in milliseconds */
+double
+percentile_ms(std::vector<uint64_t> samples, unsigned int percent)
+{
+    if (samples.empty())
+        return 0.0;
+
+    std::sort(samples.begin(), samples.end());
+    size_t rank = (percent * samples.size() + 99) / 100;
+
+    return samples[std::max<size_t>(rank, 1) - 1] / 1000.0;
+}
+
+}
+
+struct SceneShaderCompilePrivate
+{
+    SceneShaderCompilePrivate() :
+        worker(false), context(0), next(0), drawn(0), failed(0),
+        build_us(0), worker_failed(false), stop(false) {}
+
+    std::vector<Variant> variants;
+    bool worker;
+    GLSharedContext *context;
+
+    /* The next variant to build on the main thread */
+    unsigned int next;
+    /* The number of variants built, drawn or failed */
+    unsigned int drawn;
+    unsigned int failed;
+    /* The wall clock time spent building all the variants */
+    uint64_t build_us;
+
+    /* Per class samples, in microseconds */
+    std::vector<uint64_t> compile_us[VariantClasses];
+    std::vector<uint64_t> link_us[VariantClasses];
+    std::vector<uint64_t> draw_us[VariantClasses];
+
+    /* The program drawn in the last frame */
+    std::unique_ptr<Program> current;
+
+    /* Worker thread state */
+    std::thread thread;
+    std::mutex mutex;
+    std::deque<BuiltVariant> built;
+    std::atomic<bool> worker_failed;
+    std::atomic<bool> stop;
+
+    void run_worker();
+};
+
+void
+SceneShaderCompilePrivate::run_worker()
+{
+    if (!context->make_current()) {
+        worker_failed = true;
+        return;
+    }
+
+    uint64_t start = Util::get_timestamp_us();
+
+    for (unsigned int i = 0; i < variants.size() && !stop; i++) {
+        BuiltVariant b(build_variant(variants, i));
+
+        /* Make sure the program is complete before it's used in the main context */
+        glFinish();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        built.push_back(std::move(b));
+        build_us = Util::get_timestamp_us() - start;
+    }
+
+    context->release();
+}
+
+SceneShaderCompile::SceneShaderCompile(Canvas &pCanvas) :
+    SceneGrid(pCanvas, "shader-compile")
+{
+    priv_ = new SceneShaderCompilePrivate();
+
+    options_["variants"] = Scene::Option("variants", "16",
+            "The number of unique shader variants to build for each class");
+    options_["classes"] = Scene::Option("classes", "conditionals,loop,function",
+            "The comma separated classes of shader variants to build (conditionals, loop, function)");
+    options_["max-steps"] = Scene::Option("max-steps", "8",
+            "The maximum number of computational steps in each variant");
+    options_["worker"] = Scene::Option("worker", "false",
+            "Whether to build the programs on a worker thread with a shared context",
+            "false,true");
+    options_["unique"] = Scene::Option("unique", "true",
+            "Whether to make the sources unique to each run, so they can't be served by a driver shader cache",
+            "false,true");
+}
+
+SceneShaderCompile::~SceneShaderCompile()
+{
+    delete priv_;
+}
+
+bool
+SceneShaderCompile::setup()
+{
+    if (!SceneGrid::setup())
+        return false;
+
+    /* Parse options */
+    int nvariants = Util::fromString<int>(options_["variants"].value);
+    int max_steps = Util::fromString<int>(options_["max-steps"].value);
+    bool unique = options_["unique"].value == "true";
+    std::vector<std::string> class_names;
+
+    Util::split(options_["classes"].value, ',', class_names, Util::SplitModeNormal);
+
+    if (nvariants < 1 || max_steps < 1) {
+        Log::error("The number of variants and steps must be at least 1\n");
+        return false;
+    }
+
+    /*
+     * Generate all the sources up front, so only the GL work is measured.
+     * Each variant gets a different step count and flags, and a unique
+     * constant in case the generated code is the same.
+     */
+    std::string run_seed(unique ? Util::toString(Util::get_timestamp_us() % 1000000000) : "0");
+
+    priv_->variants.clear();
+
+    for (unsigned int c = 0; c < class_names.size(); c++) {
+        const char **name = std::find(variant_class_names,
+                                      variant_class_names + VariantClasses,
+                                      class_names[c]);
+        if (name == variant_class_names + VariantClasses) {
+            Log::error("Unknown shader variant class '%s'\n", class_names[c].c_str());
+            return false;
+        }
+
+        VariantClass cls = static_cast<VariantClass>(name - variant_class_names);
+
+        for (int i = 0; i < nvariants; i++) {
+            Variant variant;
+            int steps = 1 + i % max_steps;
+            bool flag = (i / max_steps) % 2 == 0;
+            bool flag2 = (i / (2 * max_steps)) % 2 == 0;
+
+            variant.cls = cls;
+            variant.steps = steps;
+
+            switch (cls) {
+                case VariantClassConditionals:
+                    variant.vtx_shader = SceneConditionals::vertex_shader_source(steps, flag);
+                    variant.frg_shader = SceneConditionals::fragment_shader_source(steps, flag);
+                    break;
+                case VariantClassLoop:
+                    variant.vtx_shader = SceneLoop::vertex_shader_source(steps, flag, flag2);
+                    variant.frg_shader = SceneLoop::fragment_shader_source(steps, flag, flag2);
+                    break;
+                default:
+                    variant.vtx_shader = SceneFunction::vertex_shader_source(
+                        steps, flag, flag2 ? "low" : "medium");
+                    variant.frg_shader = SceneFunction::fragment_shader_source(
+                        steps, flag, flag2 ? "low" : "medium");
+                    break;
+            }
+
+            std::string salt("\nconst int VariantSeed = " +
+                             Util::toString(priv_->variants.size()) + ";\n" +
+                             "const int RunSeed = " + run_seed + ";\n");
+            variant.vtx_shader += salt;
+            variant.frg_shader += salt;
+
+            priv_->variants.push_back(variant);
+        }
+    }
+
+    priv_->next = 0;
+    priv_->drawn = 0;
+    priv_->failed = 0;
+    priv_->build_us = 0;
+    priv_->worker_failed = false;
+    priv_->stop = false;
+    for (unsigned int c = 0; c < VariantClasses; c++) {
+        priv_->compile_us[c].clear();
+        priv_->link_us[c].clear();
+        priv_->draw_us[c].clear();
+    }
+
+    priv_->worker = options_["worker"].value == "true";
+
+    if (priv_->worker) {
+        priv_->context = canvas_.create_shared_context();
+        if (!priv_->context) {
+            Log::error("Couldn't create a shared GL context for the worker thread\n");
+            return false;
+        }
+
+        priv_->thread = std::thread(&SceneShaderCompilePrivate::run_worker, priv_);
+    }
+
+    running_ = true;
+    startTime_ = Util::get_timestamp_us() / 1000000.0;
+    lastUpdateTime_ = startTime_;
+
+    return true;
+}
+
+void
+SceneShaderCompile::teardown()
+{
+    if (priv_->thread.joinable()) {
+        priv_->stop = true;
+        priv_->thread.join();
+    }
+
+    delete priv_->context;
+    priv_->context = 0;
+    priv_->built.clear();
+    priv_->current.reset();
+
+    for (unsigned int c = 0; c < VariantClasses; c++) {
+        unsigned int count = priv_->draw_us[c].size();
+        if (!count)
+            continue;
+
+        Log::info("    %s: %u programs, compile p50 %.3f p99 %.3f ms, "
+                  "link p50 %.3f p99 %.3f ms, first draw p50 %.3f p99 %.3f ms\n",
+                  variant_class_names[c], count,
+                  percentile_ms(priv_->compile_us[c], 50),
+                  percentile_ms(priv_->compile_us[c], 99),
+                  percentile_ms(priv_->link_us[c], 50),
+                  percentile_ms(priv_->link_us[c], 99),
+                  percentile_ms(priv_->draw_us[c], 50),
+                  percentile_ms(priv_->draw_us[c], 99));
+    }
+
+    if (priv_->build_us > 0) {
+        Log::info("    Throughput: %.1f programs/s on the %s thread (%u failed)\n",
+                  (priv_->drawn + priv_->failed) * 1000000.0 / priv_->build_us,
+                  priv_->worker ? "worker" : "main", priv_->failed);
+    }
+
+    priv_->variants.clear();
+
+    SceneGrid::teardown();
+}
+
+void
+SceneShaderCompile::update()
+{
+    SceneGrid::update();
+
+    if (priv_->worker_failed) {
+        Log::error("Couldn't make the shared GL context current on the worker thread\n");
+        running_ = false;
+    }
+
+    if (priv_->drawn + priv_->failed >= priv_->variants.size())
+        running_ = false;
+}
+
+void
+SceneShaderCompile::draw()
+{
+    BuiltVariant built;
+    bool have_built = false;
+
+    if (priv_->worker) {
+        std::lock_guard<std::mutex> lock(priv_->mutex);
+        if (!priv_->built.empty()) {
+            built = std::move(priv_->built.front());
+            priv_->built.pop_front();
+            have_built = true;
+        }
+    }
+    else if (priv_->next < priv_->variants.size()) {
+        uint64_t start = Util::get_timestamp_us();
+        built = build_variant(priv_->variants, priv_->next++);
+        priv_->build_us += Util::get_timestamp_us() - start;
+        have_built = true;
+    }
+
+    if (have_built) {
+        const Variant &variant(priv_->variants[built.index]);
+
+        if (!built.program->ready()) {
+            Log::error("Failed to build %s variant %u:\n  %s\n",
+                       variant_class_names[variant.cls], built.index,
+                       built.program->errorMessage().c_str());
+            priv_->failed++;
+            have_built = false;
+        }
+        else {
+            priv_->compile_us[variant.cls].push_back(built.compile_us);
+            priv_->link_us[variant.cls].push_back(built.link_us);
+            priv_->current = std::move(built.program);
+        }
+    }
+
+    if (!priv_->current)
+        return;
+
+    /* Time the first draw with a new program, which may finish deferred work */
+    uint64_t start = Util::get_timestamp_us();
+    Program &program(*priv_->current);
+
+    LibMatrix::Stack4 model_view;
+    LibMatrix::mat4 model_view_proj(canvas_.projection());
+
+    model_view.translate(0.0f, 0.0f, -5.0f);
+    model_view.rotate(rotation_, 0.0f, 0.0f, 1.0f);
+    model_view_proj *= model_view.getCurrent();
+
+    program.start();
+    program["ModelViewProjectionMatrix"] = model_view_proj;
+
+    if (have_built) {
+        const Variant &variant(priv_->variants[built.index]);
+
+        if (variant.cls == VariantClassLoop) {
+            program["VertexLoops"] = variant.steps;
+            program["FragmentLoops"] = variant.steps;
+        }
+
+        std::vector<GLint> attrib_locations;
+        attrib_locations.push_back(program["position"].location());
+        mesh_.set_attrib_locations(attrib_locations);
+    }
+
+    mesh_.render_vbo();
+
+    if (have_built) {
+        glFinish();
+        priv_->draw_us[priv_->variants[built.index].cls].push_back(
+            Util::get_timestamp_us() - start);
+        priv_->drawn++;
+    }
+}
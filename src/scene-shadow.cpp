@@ -6,6 +6,9 @@
 #include "log.h"
 #include "shader-source.h"
 #include "stack.h"
+#include "pass-timer.h"
+
+#include <algorithm>
 
 using std::string;
 using std::vector;
@@ -18,6 +21,39 @@ using LibMatrix::vec2;
 
 static const vec4 lightPosition(0.0f, 3.0f, 2.0f, 1.0f);
 
+//
+// The formats the shadow map can be stored in.  With GL_OES_depth_texture
+// the format is unsized, and only the type selects the precision.
+//
+struct DepthFormat
+{
+    const char *name;
+    GLenum sized_format;
+    GLenum type;
+};
+
+static const DepthFormat depthFormats[] = {
+    {"default", GL_DEPTH_COMPONENT, GL_UNSIGNED_INT},
+    {"16", GL_DEPTH_COMPONENT16, GL_UNSIGNED_SHORT},
+    {"24", GL_DEPTH_COMPONENT24, GL_UNSIGNED_INT},
+    {"32f", GL_DEPTH_COMPONENT32F, GL_FLOAT},
+};
+
+//
+// The cascades are nested light frusta centered on the point the light looks
+// at, each covering half the extent of the previous one, so each one has
+// twice the shadow map resolution of the previous one over a quarter of
+// its area.
+//
+static mat4
+cascade_projection(const mat4& projection, unsigned int cascade)
+{
+    float zoom = static_cast<float>(1 << cascade);
+    mat4 m(LibMatrix::Mat4::scale(zoom, zoom, 1.0));
+    m *= projection;
+    return m;
+}
+
 //
 // To create a shadow map, we need a framebuffer object set up for a 
 // depth-only pass.  The render target can then be bound as a texture,
@@ -32,6 +68,7 @@ class DepthRenderTarget
     unsigned int canvas_height_;
     unsigned int width_;
     unsigned int height_;
+    unsigned int cascades_;
     unsigned int tex_;
     unsigned int fbo_;
     unsigned int canvas_fbo_;
@@ -41,19 +78,26 @@ public:
         canvas_height_(0),
         width_(0),
         height_(0),
+        cascades_(1),
         tex_(0),
         fbo_(0) {}
     ~DepthRenderTarget() {}
-    bool setup(unsigned int canvas_fbo, unsigned int width, unsigned int height);
+    bool setup(unsigned int canvas_fbo, unsigned int width, unsigned int height,
+               unsigned int size, const DepthFormat& format, unsigned int cascades);
     void teardown();
-    void enable(const mat4& mvp);
+    void enable();
+    void enable_cascade(unsigned int cascade, const mat4& mvp);
     void disable();
     unsigned int texture() { return tex_; }
+    // The size of each cascade, side by side in the texture
+    unsigned int width() { return width_; }
+    unsigned int height() { return height_; }
     Program& program() { return program_; }
 };
 
 bool
-DepthRenderTarget::setup(unsigned int canvas_fbo, unsigned int width, unsigned int height)
+DepthRenderTarget::setup(unsigned int canvas_fbo, unsigned int width, unsigned int height,
+                         unsigned int size, const DepthFormat& format, unsigned int cascades)
 {
     static const string vtx_shader_filename(Options::data_path + "/shaders/depth.vert");
     static const string frg_shader_filename(Options::data_path + "/shaders/depth.frag");
@@ -68,20 +112,48 @@ DepthRenderTarget::setup(unsigned int canvas_fbo, unsigned int width, unsigned i
     canvas_width_ = width;
     canvas_height_ = height;
     canvas_fbo_ = canvas_fbo;
-    width_ = canvas_width_ * 2;
-    height_ = canvas_height_ * 2;
+    cascades_ = cascades;
+    if (size) {
+        width_ = size;
+        height_ = size;
+    }
+    else {
+        width_ = canvas_width_ * 2;
+        height_ = canvas_height_ * 2;
+    }
 
     // If the texture will be too large for the implemnetation, we need to
     // clamp the dimensions but maintain the aspect ratio.
     GLint tex_size(0);
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &tex_size);
     unsigned int max_size = static_cast<unsigned int>(tex_size);
-    if (max_size < width_ || max_size < height_) {
-        float aspect = static_cast<float>(width) / static_cast<float>(height);
-        width_ = max_size;
-        height_ = width_ / aspect;
-        Log::debug("DepthRenderTarget::setup: original texture size (%u x %u), clamped to (%u x %u)\n",
-            canvas_width_ * 2, canvas_height_ * 2, width_, height_);
+    if (max_size < width_ * cascades_ || max_size < height_) {
+        float scale = std::min(static_cast<float>(max_size) / (width_ * cascades_),
+                               static_cast<float>(max_size) / height_);
+        Log::debug("DepthRenderTarget::setup: original cascade size (%u x %u), clamped to (%u x %u)\n",
+            width_, height_,
+            static_cast<unsigned int>(width_ * scale), static_cast<unsigned int>(height_ * scale));
+        width_ *= scale;
+        height_ *= scale;
+    }
+
+    // Sized depth formats need GLES 3.0, and floating point ones GL 3.0 too
+    GLenum internal_format = format.sized_format;
+    bool float_depth = false;
+#if GPULOAD_USE_GLESv2
+    if (GLExtensions::version_at_least(3, 0))
+        float_depth = true;
+    else
+        internal_format = GL_DEPTH_COMPONENT;
+#elif GPULOAD_USE_GL
+    float_depth = GLExtensions::version_at_least(3, 0) ||
+                  GLExtensions::support("GL_ARB_depth_buffer_float");
+#endif
+
+    if (format.type == GL_FLOAT && !float_depth) {
+        Log::error("DepthRenderTarget::setup: the %s depth format requires OpenGL ES 3.0 "
+                   "or OpenGL 3.0\n", format.name);
+        return false;
     }
 
     glGenTextures(1, &tex_);
@@ -90,8 +162,8 @@ DepthRenderTarget::setup(unsigned int canvas_fbo, unsigned int width, unsigned i
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width_, height_, 0,
-                 GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width_ * cascades_, height_, 0,
+                 GL_DEPTH_COMPONENT, format.type, 0);
     glBindTexture(GL_TEXTURE_2D, 0);
 
     GLExtensions::GenFramebuffers(1, &fbo_);
@@ -124,18 +196,24 @@ DepthRenderTarget::teardown()
 }
 
 void
-DepthRenderTarget::enable(const mat4& mvp)
+DepthRenderTarget::enable()
 {
     program_.start();
-    program_["ModelViewProjectionMatrix"] = mvp;
     GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, fbo_);
     GLExtensions::FramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
                            tex_, 0);
-    glViewport(0, 0, width_, height_);
+    glViewport(0, 0, width_ * cascades_, height_);
     glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
     glClear(GL_DEPTH_BUFFER_BIT);
 }
 
+void
+DepthRenderTarget::enable_cascade(unsigned int cascade, const mat4& mvp)
+{
+    program_["ModelViewProjectionMatrix"] = mvp;
+    glViewport(cascade * width_, 0, width_, height_);
+}
+
 void DepthRenderTarget::disable()
 {
     GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_fbo_);
@@ -157,7 +235,7 @@ void DepthRenderTarget::disable()
 class GroundRenderer
 {
     Program program_;
-    mat4 light_;
+    vector<mat4> lights_;
     Stack4 modelview_;
     mat4 projection_;
     int positionLocation_;
@@ -171,13 +249,15 @@ public:
         positionLocation_(0),
         bufferObject_(0) {}
     ~GroundRenderer() {}
-    bool setup(const mat4& projection, unsigned int texture);
+    bool setup(const mat4& projection, unsigned int texture, unsigned int cascades,
+               unsigned int pcf, const vec2& texel_size);
     void teardown();
     void draw();
 };
 
 bool
-GroundRenderer::setup(const mat4& projection, unsigned int texture)
+GroundRenderer::setup(const mat4& projection, unsigned int texture, unsigned int cascades,
+                      unsigned int pcf, const vec2& texel_size)
 {
     projection_ = projection;
     texture_ = texture;
@@ -190,6 +270,10 @@ GroundRenderer::setup(const mat4& projection, unsigned int texture)
     ShaderSource frg_source(frg_shader_filename);
 
     vtx_source.add_const("MaterialDiffuse", materialDiffuse);
+    vtx_source.replace("$CASCADES$", Util::toString(cascades));
+    frg_source.add_const("TexelSize", texel_size);
+    frg_source.replace("$CASCADES$", Util::toString(cascades));
+    frg_source.replace("$PCF$", Util::toString(pcf));
 
     if (!Scene::load_shaders_from_strings(program_, vtx_source.str(), frg_source.str())) {
         return false;
@@ -209,15 +293,20 @@ GroundRenderer::setup(const mat4& projection, unsigned int texture)
                  &vertices_.front(), GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    // Set up the light matrix with a bias that will convert values
-    // in the range of [-1, 1] to [0, 1)], then add in the projection
+    // Set up the light matrix of each cascade with a bias that will convert
+    // values in the range of [-1, 1] to [0, 1)], then add in the projection
     // and the "look at" matrix from the light position.
-    light_ *= LibMatrix::Mat4::translate(0.5, 0.5, 0.5);
-    light_ *= LibMatrix::Mat4::scale(0.5, 0.5, 0.5);
-    light_ *= projection_;
-    light_ *= LibMatrix::Mat4::lookAt(lightPosition.x(), lightPosition.y(), lightPosition.z(),
-                                      0.0, 0.0, 0.0,
-                                      0.0, 1.0, 0.0);
+    lights_.clear();
+    for (unsigned int i = 0; i < cascades; i++) {
+        mat4 light;
+        light *= LibMatrix::Mat4::translate(0.5, 0.5, 0.5);
+        light *= LibMatrix::Mat4::scale(0.5, 0.5, 0.5);
+        light *= cascade_projection(projection_, i);
+        light *= LibMatrix::Mat4::lookAt(lightPosition.x(), lightPosition.y(), lightPosition.z(),
+                                         0.0, 0.0, 0.0,
+                                         0.0, 1.0, 0.0);
+        lights_.push_back(light);
+    }
 
     return true;
 }
@@ -251,7 +340,8 @@ GroundRenderer::draw()
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture_);
     program_["ShadowMap"] = 0;
-    program_["LightMatrix"] = light_;
+    for (unsigned int i = 0; i < lights_.size(); i++)
+        program_["LightMatrix[" + Util::toString(i) + "]"] = lights_[i];
     program_["ModelViewProjectionMatrix"] = mvp;
 
     glEnableVertexAttribArray(positionLocation_);
@@ -277,6 +367,8 @@ class ShadowPrivate
     float rotation_;
     float rotationSpeed_;
     bool useVbo_;
+    unsigned int cascades_;
+    PassTimer* timer_;
     
 public:
     ShadowPrivate(Canvas& canvas) :
@@ -284,13 +376,17 @@ public:
         radius_(0.0),
         rotation_(0.0),
         rotationSpeed_(36.0),
-        useVbo_(true) {}
-    ~ShadowPrivate() {}
+        useVbo_(true),
+        cascades_(1),
+        timer_(0) {}
+    ~ShadowPrivate() { delete timer_; }
 
     bool setup(map<string, Scene::Option>& options);
     void teardown();
     void update(double elapsedTime);
     void draw();
+    void report(double frame_ms);
+    void render_mesh();
 };
 
 bool
@@ -355,16 +451,45 @@ ShadowPrivate::setup(map<string, Scene::Option>& options)
     float aspect(static_cast<float>(canvas_.width())/static_cast<float>(canvas_.height()));
     projection_.perspective(fovy, aspect, 2.0, 50.0);
 
-    if (!depthTarget_.setup(canvas_.fbo(), canvas_.width(), canvas_.height())) {
+    // Shadow map options
+    unsigned int size = Util::fromString<unsigned int>(options["shadow-size"].value);
+    unsigned int pcf = Util::fromString<unsigned int>(options["pcf"].value);
+    cascades_ = Util::fromString<unsigned int>(options["cascades"].value);
+
+    if (cascades_ < 1 || cascades_ > 4 || pcf < 1 || pcf > 8) {
+        Log::error("The number of cascades must be 1 to 4, and the PCF kernel size 1 to 8\n");
+        return false;
+    }
+
+    const DepthFormat* format(depthFormats);
+    while (format->name != options["depth-format"].value)
+        format++;
+
+    if (!depthTarget_.setup(canvas_.fbo(), canvas_.width(), canvas_.height(),
+                            size, *format, cascades_)) {
         Log::error("Failed to set up the render target for the depth pass\n");
         return false;
     }
 
-    if (!ground_.setup(projection_.getCurrent(), depthTarget_.texture())) {
+    vec2 texel_size(1.0 / depthTarget_.width(), 1.0 / depthTarget_.height());
+    if (!ground_.setup(projection_.getCurrent(), depthTarget_.texture(), cascades_,
+                       pcf, texel_size)) {
         Log::error("Failed to set up the ground renderer\n");
         return false;
     }
 
+    // Set up the pass timing
+    const string& pass_timing(options["pass-timing"].value);
+
+    if (pass_timing == "gpu" && PassTimer::gpu_supported()) {
+        timer_ = new PassTimer(PassTimer::ModeGPU);
+    }
+    else if (pass_timing != "off") {
+        if (pass_timing == "gpu")
+            Log::info("GPU timer queries are not supported, timing the passes with glFinish()\n");
+        timer_ = new PassTimer(PassTimer::ModeFinish);
+    }
+
     return true;
 }
 
@@ -385,9 +510,32 @@ ShadowPrivate::update(double elapsedTime)
     rotation_ = rotationSpeed_ * elapsedTime;
 }
 
+void
+ShadowPrivate::report(double frame_ms)
+{
+    if (timer_)
+        timer_->report(frame_ms);
+}
+
+void
+ShadowPrivate::render_mesh()
+{
+    if (useVbo_) {
+        mesh_.render_vbo();
+    }
+    else {
+        mesh_.render_array();
+    }
+}
+
 void
 ShadowPrivate::draw()
 {
+    if (timer_) {
+        timer_->begin_frame();
+        timer_->begin("Depth");
+    }
+
     // To perform the depth pass, set up the model-view transformation so
     // that we're looking at the horse from the light position.  That will
     // give us the appropriate view for the shadow.
@@ -397,32 +545,42 @@ ShadowPrivate::draw()
                       0.0, 0.0, 0.0,
                       0.0, 1.0, 0.0);
     modelview_.rotate(rotation_, 0.0f, 1.0f, 0.0f);
-    mat4 mvp(projection_.getCurrent());
-    mvp *= modelview_.getCurrent();
+    mat4 light_view(modelview_.getCurrent());
     modelview_.pop();
 
-    // Enable the depth render target with our transformation and render.
-    depthTarget_.enable(mvp);
+    // Enable the depth render target and render each cascade with its
+    // transformation.
+    depthTarget_.enable();
     vector<GLint> attrib_locations;
     attrib_locations.push_back(depthTarget_.program()["position"].location());
     attrib_locations.push_back(depthTarget_.program()["normal"].location());
     mesh_.set_attrib_locations(attrib_locations);
-    if (useVbo_) {
-        mesh_.render_vbo();
-    }
-    else {
-        mesh_.render_array();
+    for (unsigned int i = 0; i < cascades_; i++) {
+        mat4 mvp(cascade_projection(projection_.getCurrent(), i));
+        mvp *= light_view;
+        depthTarget_.enable_cascade(i, mvp);
+        render_mesh();
     }
     depthTarget_.disable();
 
+    if (timer_) {
+        timer_->end();
+        timer_->begin("Ground");
+    }
+
     // Ground rendering using the above generated texture...
     ground_.draw();
 
+    if (timer_) {
+        timer_->end();
+        timer_->begin("Model");
+    }
+
     // Draw the "normal" view of the horse
     modelview_.push();
     modelview_.translate(-centerVec_.x(), -centerVec_.y(), -(centerVec_.z() + 2.0 + radius_));
     modelview_.rotate(rotation_, 0.0f, 1.0f, 0.0f);
-    mvp = projection_.getCurrent();
+    mat4 mvp(projection_.getCurrent());
     mvp *= modelview_.getCurrent();
 
     program_.start();
@@ -437,12 +595,10 @@ ShadowPrivate::draw()
     attrib_locations.push_back(program_["position"].location());
     attrib_locations.push_back(program_["normal"].location());
     mesh_.set_attrib_locations(attrib_locations);
-    if (useVbo_) {
-        mesh_.render_vbo();
-    }
-    else {
-        mesh_.render_array();
-    }
+    render_mesh();
+
+    if (timer_)
+        timer_->end();
 
     // Per-frame cleanup
     modelview_.pop();
@@ -458,6 +614,23 @@ SceneShadow::SceneShadow(Canvas& canvas) :
     options_["interleave"] = Scene::Option("interleave", "false",
                                            "Whether to interleave vertex attribute data",
                                            "false,true");
+    options_["shadow-size"] = Scene::Option("shadow-size", "0",
+            "The width and height of the shadow map of each cascade (0: twice the canvas size)");
+    options_["depth-format"] = Scene::Option("depth-format", "default",
+            "The depth format of the shadow map (default: unsized, uploaded as GL_UNSIGNED_INT; "
+            "32f requires GLES 3.0 or GL 3.0)",
+            "default,16,24,32f");
+    options_["cascades"] = Scene::Option("cascades", "1",
+            "The number of nested shadow map cascades, each rendered in its own depth pass",
+            "1,2,3,4");
+    options_["pcf"] = Scene::Option("pcf", "1",
+            "The width and height of the percentage closer filtering kernel in shadow map "
+            "texels (1: a single sample)");
+    options_["pass-timing"] = Scene::Option("pass-timing", "off",
+            "Report the time of the depth, ground and model passes, measured with GPU timer "
+            "queries or, for diagnosis, on the CPU with glFinish() around each pass "
+            "(gpu falls back to finish without timer query support)",
+            "off,gpu,finish");
 }
 
 bool
@@ -525,6 +698,8 @@ SceneShadow::teardown()
 {
     // Add scene-specific teardown here
     if (priv_) {
+        if (currentFrame_ > 0)
+            priv_->report((lastUpdateTime_ - startTime_) * 1000.0 / currentFrame_);
         priv_->teardown();
         delete priv_;
     }
@@ -0,0 +1,314 @@
+#include "scene.h"
+#include "log.h"
+#include "mat.h"
+#include "options.h"
+#include "shader-source.h"
+#include "util.h"
+#include "renderer.h"
+#include "gl-headers.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+
+enum TBDRReadback {
+    TBDRReadbackNone,
+    TBDRReadbackPixel,
+    TBDRReadbackFull,
+    TBDRReadbacks
+};
+
+const char *tbdr_readback_names[TBDRReadbacks] = {
+    "none", "pixel", "full"
+};
+
+/**
+ * A render target of the probe, on or off the screen, which draws
+ * overlapping full screen layers.
+ */
+class ProbeRenderer : public BaseRenderer
+{
+public:
+    ProbeRenderer(Program &program, Mesh &mesh, unsigned int layers) :
+        BaseRenderer(), program_(program), mesh_(mesh), layers_(layers) {}
+    virtual ~ProbeRenderer() { }
+
+    /* IRenderer/BaseRenderer methods */
+    virtual void render();
+
+    /**
+     * Invalidates the depth and stencil contents of the target, so that a
+     * tiler doesn't have to store them to memory.
+     */
+    void invalidate_depth_stencil();
+
+private:
+    Program &program_;
+    Mesh &mesh_;
+    unsigned int layers_;
+};
+
+void
+ProbeRenderer::render()
+{
+    program_.start();
+
+    /* Back to front, so that every layer passes the depth test */
+    for (unsigned int i = 0; i < layers_; i++) {
+        float f = static_cast<float>(i + 1) / layers_;
+
+        program_["Depth"] = 0.9f - 1.8f * f;
+        program_["Color"] = LibMatrix::vec4(f, 0.5f, 1.0f - f, 1.0f);
+        mesh_.render_vbo();
+    }
+
+    program_.stop();
+}
+
+void
+ProbeRenderer::invalidate_depth_stencil()
+{
+    /* The default framebuffer names its attachments differently */
+    static const GLenum default_attachments[] = {GL_DEPTH, GL_STENCIL};
+    static const GLenum fbo_attachments[] = {GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT};
+
+    GLExtensions::InvalidateFramebuffer(GL_FRAMEBUFFER, 2,
+                                        fbo_ ? fbo_attachments : default_attachments);
+}
+
+}
+
+struct SceneTBDRPrivate
+{
+    SceneTBDRPrivate() :
+        switches(0), clear(true), invalidate(false), readback(TBDRReadbackNone),
+        readback_us(0), readback_bytes(0) {}
+
+    unsigned int switches;
+    bool clear;
+    bool invalidate;
+    TBDRReadback readback;
+
+    Program program;
+    Mesh mesh;
+    std::unique_ptr<ProbeRenderer> screen;
+    std::unique_ptr<ProbeRenderer> offscreen;
+
+    std::vector<uint8_t> pixels;
+    /* The CPU time spent waiting for readbacks, and the amount read back */
+    uint64_t readback_us;
+    uint64_t readback_bytes;
+};
+
+/**
+ * Renders a pass to a target, with the loads, stores and flushes the options
+ * ask for.
+ *
+ * Only the color contents are ever loaded. Depth and stencil are always
+ * cleared, so that every layer passes the depth test and the shading work is
+ * the same whether or not color is loaded, and so that no pass depends on
+ * the depth and stencil contents an earlier pass invalidated.
+ */
+static void
+draw_pass(SceneTBDRPrivate &priv, ProbeRenderer &target, bool cleared)
+{
+    target.make_current();
+
+    if (!cleared) {
+        GLbitfield mask = GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT;
+        if (priv.clear)
+            mask |= GL_COLOR_BUFFER_BIT;
+        glClear(mask);
+    }
+
+    target.render();
+
+    if (priv.invalidate)
+        target.invalidate_depth_stencil();
+
+    if (priv.readback != TBDRReadbackNone) {
+        GLsizei width = 1;
+        GLsizei height = 1;
+
+        if (priv.readback == TBDRReadbackFull) {
+            width = target.size().x();
+            height = target.size().y();
+        }
+
+        uint64_t start = Util::get_timestamp_us();
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &priv.pixels[0]);
+        priv.readback_us += Util::get_timestamp_us() - start;
+        priv.readback_bytes += width * height * 4;
+    }
+}
+
+SceneTBDR::SceneTBDR(Canvas &pCanvas) :
+    Scene(pCanvas, "tbdr")
+{
+    priv_ = new SceneTBDRPrivate();
+
+    options_["switches"] = Scene::Option("switches", "0",
+            "The number of times per frame rendering switches to an offscreen target "
+            "and back to the screen, which makes a tiler store and reload the screen tiles");
+    options_["clear"] = Scene::Option("clear", "true",
+            "Whether each pass clears the color of its target first (false: the previous "
+            "color is loaded; depth and stencil are always cleared)", "false,true");
+    options_["invalidate"] = Scene::Option("invalidate", "false",
+            "Whether each pass invalidates the depth and stencil of its target at its end "
+            "(glInvalidateFramebuffer or GL_EXT_discard_framebuffer), so they aren't stored",
+            "false,true");
+    options_["readback"] = Scene::Option("readback", "none",
+            "Read back the target at the end of each pass, which flushes the tiles "
+            "(none, pixel: a single pixel, full: the whole target)",
+            "none,pixel,full");
+    options_["layers"] = Scene::Option("layers", "4",
+            "The number of depth tested full screen layers drawn in each pass");
+}
+
+SceneTBDR::~SceneTBDR()
+{
+    delete priv_;
+}
+
+bool
+SceneTBDR::load()
+{
+    running_ = false;
+
+    return true;
+}
+
+void
+SceneTBDR::unload()
+{
+}
+
+bool
+SceneTBDR::setup()
+{
+    if (!Scene::setup())
+        return false;
+
+    static const std::string vtx_shader_filename(Options::data_path + "/shaders/tbdr.vert");
+    static const std::string frg_shader_filename(Options::data_path + "/shaders/tbdr.frag");
+
+    /* Parse options */
+    priv_->switches = Util::fromString<unsigned int>(options_["switches"].value);
+    priv_->clear = options_["clear"].value == "true";
+    priv_->invalidate = options_["invalidate"].value == "true";
+
+    const char **name = std::find(tbdr_readback_names, tbdr_readback_names + TBDRReadbacks,
+                                  options_["readback"].value);
+    priv_->readback = static_cast<TBDRReadback>(name - tbdr_readback_names);
+
+    unsigned int layers = Util::fromString<unsigned int>(options_["layers"].value);
+
+    if (layers < 1) {
+        Log::error("The number of layers must be at least 1\n");
+        return false;
+    }
+
+    if (priv_->invalidate && !GLExtensions::InvalidateFramebuffer) {
+        Log::error("Invalidating framebuffers requires OpenGL ES 3.0, OpenGL 4.3, "
+                   "GL_EXT_discard_framebuffer or GL_ARB_invalidate_subdata\n");
+        return false;
+    }
+
+    ShaderSource vtx_source(vtx_shader_filename);
+    ShaderSource frg_source(frg_shader_filename);
+
+    if (!Scene::load_shaders_from_strings(priv_->program, vtx_source.str(),
+                                          frg_source.str()))
+    {
+        return false;
+    }
+
+    /* The full screen quad of the layers */
+    std::vector<int> vertex_format;
+    vertex_format.push_back(3);
+    priv_->mesh.set_vertex_format(vertex_format);
+    priv_->mesh.make_grid(1, 1, 2.0, 2.0, 0);
+    priv_->mesh.build_vbo();
+
+    std::vector<GLint> attrib_locations;
+    attrib_locations.push_back(priv_->program["position"].location());
+    priv_->mesh.set_attrib_locations(attrib_locations);
+
+    /* The screen, and an offscreen target of the same size with a depth buffer */
+    priv_->screen.reset(new ProbeRenderer(priv_->program, priv_->mesh, layers));
+    priv_->screen->setup_onscreen(canvas_);
+
+    if (priv_->switches > 0) {
+        priv_->offscreen.reset(new ProbeRenderer(priv_->program, priv_->mesh, layers));
+        priv_->offscreen->setup_offscreen(LibMatrix::vec2(canvas_.width(), canvas_.height()),
+                                          true);
+    }
+
+    if (priv_->readback == TBDRReadbackFull)
+        priv_->pixels.resize(canvas_.width() * canvas_.height() * 4);
+    else
+        priv_->pixels.resize(4);
+
+    priv_->readback_us = 0;
+    priv_->readback_bytes = 0;
+
+    currentFrame_ = 0;
+    running_ = true;
+    startTime_ = Util::get_timestamp_us() / 1000000.0;
+    lastUpdateTime_ = startTime_;
+
+    return true;
+}
+
+void
+SceneTBDR::teardown()
+{
+    double elapsed = lastUpdateTime_ - startTime_;
+
+    if (currentFrame_ > 0 && elapsed > 0.0) {
+        Log::info("    %u passes/frame, clear: %s, invalidate: %s, readback: %s\n",
+                  2 * priv_->switches + 1, priv_->clear ? "yes" : "no",
+                  priv_->invalidate ? "yes" : "no", tbdr_readback_names[priv_->readback]);
+        Log::info("    %.3f ms/frame (%u frames)\n",
+                  elapsed * 1000.0 / currentFrame_, currentFrame_);
+
+        if (priv_->readback != TBDRReadbackNone) {
+            Log::info("    Readbacks: %.3f ms/frame waiting, %.1f MiB/s\n",
+                      priv_->readback_us / 1000.0 / currentFrame_,
+                      priv_->readback_bytes / (1024.0 * 1024.0) / elapsed);
+        }
+    }
+
+    priv_->screen.reset();
+    priv_->offscreen.reset();
+    priv_->mesh.reset();
+    priv_->pixels.clear();
+
+    priv_->program.stop();
+    priv_->program.release();
+
+    GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_.fbo());
+    glViewport(0, 0, canvas_.width(), canvas_.height());
+
+    Scene::teardown();
+}
+
+void
+SceneTBDR::update()
+{
+    Scene::update();
+}
+
+void
+SceneTBDR::draw()
+{
+    /* The main loop has cleared the screen for the first pass already */
+    draw_pass(*priv_, *priv_->screen, true);
+
+    for (unsigned int i = 0; i < priv_->switches; i++) {
+        draw_pass(*priv_, *priv_->offscreen, false);
+        draw_pass(*priv_, *priv_->screen, false);
+    }
+}
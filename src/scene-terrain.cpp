@@ -26,7 +26,8 @@ public:
         overlay_renderer(0), tilt_v_renderer(0), tilt_h_renderer(0),
         copy_renderer(0), height_map_renderer(0), normal_map_renderer(0),
         specular_map_renderer(0),
-        height_normal_chain(0), bloom_chain(0), tilt_chain(0), terrain_chain(0)
+        height_normal_chain(0), bloom_chain(0), tilt_chain(0), terrain_chain(0),
+        timer(0)
     {
         init_renderers();
     }
@@ -108,27 +109,27 @@ public:
 
         /* Height normal chain */
         height_normal_chain = new RendererChain();
-        height_normal_chain->append(*height_map_renderer);
-        height_normal_chain->append(*normal_map_renderer);
+        height_normal_chain->append(*height_map_renderer, "Simplex noise height map");
+        height_normal_chain->append(*normal_map_renderer, "Normal from height");
 
         /* Bloom effect chain */
         if (use_bloom) {
             bloom_chain = new RendererChain();
-            bloom_chain->append(*bloom_h_renderer);
-            bloom_chain->append(*bloom_v_renderer);
-            bloom_chain->append(*overlay_renderer);
+            bloom_chain->append(*bloom_h_renderer, "Bloom horizontal blur");
+            bloom_chain->append(*bloom_v_renderer, "Bloom vertical blur");
+            bloom_chain->append(*overlay_renderer, "Bloom overlay");
         }
 
         /* Tilt-shift effect chain */
         if (use_tilt_shift) {
             tilt_chain = new RendererChain();
-            tilt_chain->append(*tilt_h_renderer);
-            tilt_chain->append(*tilt_v_renderer);
+            tilt_chain->append(*tilt_h_renderer, "Tilt-shift horizontal blur");
+            tilt_chain->append(*tilt_v_renderer, "Tilt-shift vertical blur");
         }
 
         /* Terrain chain */
         terrain_chain = new RendererChain();
-        terrain_chain->append(*terrain_renderer);
+        terrain_chain->append(*terrain_renderer, "Terrain");
         if (use_bloom)
             terrain_chain->append(*bloom_chain);
         if (use_tilt_shift)
@@ -140,7 +141,7 @@ public:
          * contents to the screen to make the scene visible.
          */
         if (use_bloom && !use_tilt_shift)
-            terrain_chain->append(*copy_renderer);
+            terrain_chain->append(*copy_renderer, "Copy");
 
         /*
          * Set up renderer textures.
@@ -152,8 +153,27 @@ public:
         specular_map_renderer->input_texture(terrain_renderer->diffuse1_texture());
     }
 
+    /**
+     * Times the passes of all the chains with a timer.
+     *
+     * @param t the timer, owned by this object from now on
+     */
+    void time_passes(PassTimer *t)
+    {
+        timer = t;
+
+        height_normal_chain->timer(timer);
+        terrain_chain->timer(timer);
+        if (bloom_chain)
+            bloom_chain->timer(timer);
+        if (tilt_chain)
+            tilt_chain->timer(timer);
+    }
+
     void release_renderers()
     {
+        delete timer;
+
         delete terrain_chain;
         delete bloom_chain;
         delete tilt_chain;
@@ -194,6 +214,9 @@ public:
     RendererChain *bloom_chain;
     RendererChain *tilt_chain;
     RendererChain *terrain_chain;
+
+    /* Times the passes, if enabled */
+    PassTimer *timer;
 };
 
 SceneTerrain::SceneTerrain(Canvas &pCanvas) :
@@ -207,6 +230,11 @@ SceneTerrain::SceneTerrain(Canvas &pCanvas) :
     options_["tilt-shift"] = Scene::Option("tilt-shift", "true",
                                            "Use tilt-shift post-processing effect",
                                            "false,true");
+    options_["pass-timing"] = Scene::Option("pass-timing", "off",
+            "Report the time of each rendering pass, measured with GPU timer queries "
+            "or, for diagnosis, on the CPU with glFinish() around each pass "
+            "(gpu falls back to finish without timer query support)",
+            "off,gpu,finish");
 }
 
 SceneTerrain::~SceneTerrain()
@@ -298,6 +326,18 @@ SceneTerrain::setup()
     /* Create the specular map */
     priv_->specular_map_renderer->render();
 
+    /* Set up the pass timing */
+    const std::string &pass_timing(options_["pass-timing"].value);
+
+    if (pass_timing == "gpu" && PassTimer::gpu_supported()) {
+        priv_->time_passes(new PassTimer(PassTimer::ModeGPU));
+    }
+    else if (pass_timing != "off") {
+        if (pass_timing == "gpu")
+            Log::info("GPU timer queries are not supported, timing the passes with glFinish()\n");
+        priv_->time_passes(new PassTimer(PassTimer::ModeFinish));
+    }
+
     GLExtensions::BindFramebuffer(GL_FRAMEBUFFER, canvas_.fbo());
     glViewport(0, 0, canvas_.width(), canvas_.height());
 
@@ -311,6 +351,9 @@ SceneTerrain::setup()
 void
 SceneTerrain::teardown()
 {
+    if (priv_->timer && currentFrame_ > 0)
+        priv_->timer->report((lastUpdateTime_ - startTime_) * 1000.0 / currentFrame_);
+
     delete priv_;
     priv_ = 0;
     Scene::teardown();
@@ -336,6 +379,9 @@ SceneTerrain::update()
 void
 SceneTerrain::draw()
 {
+    if (priv_->timer)
+        priv_->timer->begin_frame();
+
     /* Render the height and normal maps used by the terrain */
     priv_->height_normal_chain->render();
 
@@ -80,16 +80,21 @@ RendererChain::update_mipmap()
 void
 RendererChain::render()
 {
-    for(std::vector<IRenderer *>::iterator iter = renderers_.begin();
-        iter != renderers_.end();
-        iter++)
-    {
-        (*iter)->render();
+    for (size_t i = 0; i < renderers_.size(); i++) {
+        bool timed = timer_ && !names_[i].empty();
+
+        if (timed)
+            timer_->begin(names_[i]);
+
+        renderers_[i]->render();
+
+        if (timed)
+            timer_->end();
     }
 }
 
 void
-RendererChain::append(IRenderer &renderer)
+RendererChain::append(IRenderer &renderer, const std::string &name)
 {
     if (!renderers_.empty()) {
         IRenderer &prev_renderer(*renderers_.back());
@@ -97,4 +102,5 @@ RendererChain::append(IRenderer &renderer)
     }
 
     renderers_.push_back(&renderer);
+    names_.push_back(name);
 }
@@ -1,5 +1,7 @@
 
 #include <stdint.h>
+#include <map>
+#include <string>
 #include <vector>
 
 #include "canvas.h"
@@ -7,6 +9,7 @@
 #include "vec.h"
 #include "program.h"
 #include "gl-headers.h"
+#include "pass-timer.h"
 
 /** 
  * Renderer interface.
@@ -59,7 +62,7 @@ protected:
 class RendererChain : public IRenderer
 {
 public:
-    RendererChain() {}
+    RendererChain() : timer_(0) {}
     virtual ~RendererChain() {}
 
     /* IRenderer methods */
@@ -78,11 +81,23 @@ public:
      * Appends a renderer to the chain.
      * 
      * @param renderer the renderer to append
+     * @param name the name to time the renderer's pass under, if any
      */
-    void append(IRenderer &renderer);
+    void append(IRenderer &renderer, const std::string &name = "");
+
+    /**
+     * Sets the timer to time the named passes of the chain with.
+     *
+     * Chains appended to this one are timed by their own timer, if any.
+     *
+     * @param timer the timer, or 0 to stop timing
+     */
+    void timer(PassTimer *timer) { timer_ = timer; }
 
 private:
     std::vector<IRenderer *> renderers_;
+    std::vector<std::string> names_;
+    PassTimer *timer_;
 };
 
 /** 
@@ -39,13 +39,18 @@ TerrainRenderer::render()
 void
 TerrainRenderer::init_textures()
 {
-    /* Create textures */
-    Texture::load("terrain-grasslight-512", &diffuse1_tex_,
-            GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, 0);
-    Texture::load("terrain-backgrounddetailed6", &diffuse2_tex_,
-            GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, 0);
-    Texture::load("terrain-grasslight-512-nm", &detail_tex_,
-            GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, 0);
+    /* Create textures, decoding the images in parallel */
+    std::vector<std::string> names;
+    names.push_back("terrain-grasslight-512");
+    names.push_back("terrain-backgrounddetailed6");
+    names.push_back("terrain-grasslight-512-nm");
+
+    GLuint textures[3] = { 0, 0, 0 };
+    Texture::load_all(names, textures, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+
+    diffuse1_tex_ = textures[0];
+    diffuse2_tex_ = textures[1];
+    detail_tex_ = textures[2];
 
     /* Set REPEAT wrap mode */
     glBindTexture(GL_TEXTURE_2D, diffuse1_tex_);
@@ -0,0 +1,415 @@
+#include "scene.h"
+#include "log.h"
+#include "mat.h"
+#include "options.h"
+#include "shader-source.h"
+#include "texture.h"
+#include "util.h"
+#include "gl-headers.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+enum StreamMethod {
+    StreamMethodSubImage,
+    StreamMethodPBO,
+    StreamMethodEGLImage,
+    StreamMethods
+};
+
+const char *stream_method_names[StreamMethods] = {
+    "subimage", "pbo", "eglimage"
+};
+
+/* The client formats of the uploads, as camera and video frames come in */
+struct StreamFormat
+{
+    const char *name;
+    GLenum format;
+    GLenum type;
+    unsigned int bytes;
+};
+
+const StreamFormat stream_formats[] = {
+    {"rgba", GL_RGBA, GL_UNSIGNED_BYTE, 4},
+    {"rgb", GL_RGB, GL_UNSIGNED_BYTE, 3},
+    {"rgb565", GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 2},
+    {"luminance", GL_LUMINANCE, GL_UNSIGNED_BYTE, 1}
+};
+
+const unsigned int stream_format_count = sizeof(stream_formats) / sizeof(stream_formats[0]);
+
+}
+
+struct SceneTextureStreamPrivate
+{
+    SceneTextureStreamPrivate() :
+        method(StreamMethodSubImage), format(&stream_formats[0]), width(0), height(0),
+        row_bytes(0), uploads(1), next_texture(0), next_pbo(0), shown(0),
+        upload_count(0), upload_us(0), upload_bytes(0), failed_maps(0) {}
+
+    StreamMethod method;
+    const StreamFormat *format;
+    unsigned int width;
+    unsigned int height;
+    unsigned int row_bytes;
+    unsigned int uploads;
+
+    Program program;
+    Mesh mesh;
+
+    /*
+     * The textures uploaded to in turn, and the ones drawn with: the same
+     * ones, except with EGLImages where they are siblings of the uploaded ones.
+     */
+    std::vector<GLuint> sources;
+    std::vector<GLuint> textures;
+    std::vector<GLuint> pbos;
+    unsigned int next_texture;
+    unsigned int next_pbo;
+    unsigned int shown;
+
+    /* Twice the rows of a texture, uploaded from a scrolling offset */
+    std::vector<uint8_t> content;
+
+    /* The number of uploads, the CPU time spent in them, and the amount uploaded */
+    unsigned int upload_count;
+    uint64_t upload_us;
+    uint64_t upload_bytes;
+    /* The number of uploads skipped because a PBO couldn't be mapped */
+    unsigned int failed_maps;
+};
+
+/**
+ * Uploads new content to the next texture of the ring.
+ */
+static void
+upload(SceneTextureStreamPrivate &priv)
+{
+    /* Scroll through the content, so that every upload differs */
+    unsigned int offset = (priv.upload_count * 4) % priv.height;
+    const uint8_t *pixels = &priv.content[offset * priv.row_bytes];
+    size_t size = static_cast<size_t>(priv.row_bytes) * priv.height;
+    const StreamFormat &format(*priv.format);
+
+    uint64_t start = Util::get_timestamp_us();
+
+    glBindTexture(GL_TEXTURE_2D, priv.sources[priv.next_texture]);
+
+    if (priv.method == StreamMethodPBO) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, priv.pbos[priv.next_pbo]);
+
+        /* Don't wait for the previous upload from the buffer to complete */
+        void *ptr;
+        if (GLExtensions::MapBufferRange) {
+            ptr = GLExtensions::MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        }
+        else {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_STREAM_DRAW);
+            ptr = GLExtensions::MapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        }
+
+        if (ptr) {
+            memcpy(ptr, pixels, size);
+            GLExtensions::UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, priv.width, priv.height,
+                            format.format, format.type, 0);
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        priv.next_pbo = (priv.next_pbo + 1) % priv.pbos.size();
+
+        /* Nothing was uploaded, so leave it out of the measurements */
+        if (!ptr) {
+            if (priv.failed_maps++ == 0)
+                Log::error("Failed to map a pixel buffer object, skipping the upload\n");
+            return;
+        }
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, priv.width, priv.height,
+                        format.format, format.type, pixels);
+    }
+
+    priv.upload_us += Util::get_timestamp_us() - start;
+    priv.upload_bytes += size;
+    priv.upload_count++;
+
+    priv.shown = priv.next_texture;
+    priv.next_texture = (priv.next_texture + 1) % priv.sources.size();
+}
+
+/**
+ * Creates a texture with storage for the uploads.
+ */
+static GLuint
+create_texture(const SceneTextureStreamPrivate &priv, bool storage)
+{
+    GLuint texture;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    if (storage) {
+        glTexImage2D(GL_TEXTURE_2D, 0, priv.format->format, priv.width, priv.height, 0,
+                     priv.format->format, priv.format->type, &priv.content[0]);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture;
+}
+
+SceneTextureStream::SceneTextureStream(Canvas &pCanvas) :
+    Scene(pCanvas, "texture-stream")
+{
+    priv_ = new SceneTextureStreamPrivate();
+
+    std::string format_names;
+    for (unsigned int i = 0; i < stream_format_count; i++)
+        format_names += std::string(i > 0 ? "," : "") + stream_formats[i].name;
+
+    options_["size"] = Scene::Option("size", "1280x720",
+            "The size of the uploaded textures (WxH)");
+    options_["format"] = Scene::Option("format", "rgba",
+            "The format of the uploaded content", format_names);
+    options_["method"] = Scene::Option("method", "subimage",
+            "How the content is uploaded (subimage: glTexSubImage2D from client memory, "
+            "pbo: glTexSubImage2D from a ring of pixel buffer objects, "
+            "eglimage: glTexSubImage2D to textures drawn through EGLImage siblings)",
+            "subimage,pbo,eglimage");
+    options_["uploads"] = Scene::Option("uploads", "1",
+            "The number of texture uploads per frame (0: none, to measure the frame time without them)");
+    options_["textures"] = Scene::Option("textures", "1",
+            "The number of textures uploaded to in turn (1: every upload replaces a texture "
+            "the previous frame may still be drawing with)");
+    options_["pbos"] = Scene::Option("pbos", "3",
+            "The number of pixel buffer objects uploaded from in turn, with method=pbo");
+}
+
+SceneTextureStream::~SceneTextureStream()
+{
+    delete priv_;
+}
+
+bool
+SceneTextureStream::load()
+{
+    running_ = false;
+
+    return true;
+}
+
+void
+SceneTextureStream::unload()
+{
+}
+
+bool
+SceneTextureStream::setup()
+{
+    if (!Scene::setup())
+        return false;
+
+    static const std::string vtx_shader_filename(Options::data_path + "/shaders/texture-stream.vert");
+    static const std::string frg_shader_filename(Options::data_path + "/shaders/texture-stream.frag");
+
+    /* Parse options */
+    std::vector<std::string> size;
+    Util::split(options_["size"].value, 'x', size, Util::SplitModeNormal);
+
+    if (size.size() != 2) {
+        Log::error("The texture size must be given as WxH\n");
+        return false;
+    }
+
+    priv_->width = Util::fromString<unsigned int>(size[0]);
+    priv_->height = Util::fromString<unsigned int>(size[1]);
+
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+    if (priv_->width < 1 || priv_->height < 1 ||
+        priv_->width > static_cast<unsigned int>(max_size) ||
+        priv_->height > static_cast<unsigned int>(max_size))
+    {
+        Log::error("The texture size must be from 1x1 to %dx%d\n", max_size, max_size);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < stream_format_count; i++) {
+        if (options_["format"].value == stream_formats[i].name)
+            priv_->format = &stream_formats[i];
+    }
+
+    const char **name = std::find(stream_method_names, stream_method_names + StreamMethods,
+                                  options_["method"].value);
+    priv_->method = static_cast<StreamMethod>(name - stream_method_names);
+
+    priv_->uploads = Util::fromString<unsigned int>(options_["uploads"].value);
+    unsigned int ntextures = Util::fromString<unsigned int>(options_["textures"].value);
+    unsigned int npbos = Util::fromString<unsigned int>(options_["pbos"].value);
+
+    if (ntextures < 1 || npbos < 1) {
+        Log::error("The number of textures and of pixel buffer objects must be at least 1\n");
+        return false;
+    }
+
+    if (priv_->method == StreamMethodPBO && !Texture::pbo_supported()) {
+        Log::error("Uploading from pixel buffer objects requires OpenGL ES 3.0, "
+                   "OpenGL 2.1 or GL_ARB_pixel_buffer_object\n");
+        return false;
+    }
+
+    ShaderSource vtx_source(vtx_shader_filename);
+    ShaderSource frg_source(frg_shader_filename);
+
+    if (!Scene::load_shaders_from_strings(priv_->program, vtx_source.str(),
+                                          frg_source.str()))
+    {
+        return false;
+    }
+
+    /* The full screen quad */
+    std::vector<int> vertex_format;
+    vertex_format.push_back(3);
+    priv_->mesh.set_vertex_format(vertex_format);
+    priv_->mesh.make_grid(1, 1, 2.0, 2.0, 0);
+    priv_->mesh.build_vbo();
+
+    std::vector<GLint> attrib_locations;
+    attrib_locations.push_back(priv_->program["position"].location());
+    priv_->mesh.set_attrib_locations(attrib_locations);
+
+    /* Diagonal stripes, for twice the rows of a texture */
+    priv_->row_bytes = priv_->width * priv_->format->bytes;
+    priv_->content.resize(static_cast<size_t>(priv_->row_bytes) * priv_->height * 2);
+
+    for (unsigned int y = 0; y < priv_->height * 2; y++) {
+        uint8_t *row = &priv_->content[static_cast<size_t>(y) * priv_->row_bytes];
+        for (unsigned int x = 0; x < priv_->row_bytes; x++)
+            row[x] = ((x / priv_->format->bytes + y) & 0x40) ? 0xe0 : 0x20 + (x % 3) * 0x30;
+    }
+
+    /* Rows of RGB, RGB565 and luminance data need not be 4-byte aligned */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (unsigned int i = 0; i < ntextures; i++) {
+        priv_->sources.push_back(create_texture(*priv_, true));
+
+        if (priv_->method != StreamMethodEGLImage) {
+            priv_->textures.push_back(priv_->sources.back());
+            continue;
+        }
+
+        priv_->textures.push_back(create_texture(*priv_, false));
+        if (!canvas_.bind_texture_image(priv_->sources.back(), priv_->textures.back())) {
+            Log::error("Drawing textures through EGLImages requires EGL_KHR_gl_texture_2D_image "
+                       "and GL_OES_EGL_image\n");
+            return false;
+        }
+    }
+
+    if (priv_->method == StreamMethodPBO) {
+        priv_->pbos.resize(npbos);
+        glGenBuffers(npbos, &priv_->pbos[0]);
+
+        for (unsigned int i = 0; i < npbos; i++) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, priv_->pbos[i]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, priv_->row_bytes * priv_->height, 0,
+                         GL_STREAM_DRAW);
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    priv_->program.start();
+    priv_->program["Texture0"] = 0;
+    glActiveTexture(GL_TEXTURE0);
+
+    priv_->next_texture = 0;
+    priv_->next_pbo = 0;
+    priv_->shown = 0;
+    priv_->upload_count = 0;
+    priv_->upload_us = 0;
+    priv_->upload_bytes = 0;
+    priv_->failed_maps = 0;
+
+    currentFrame_ = 0;
+    running_ = true;
+    startTime_ = Util::get_timestamp_us() / 1000000.0;
+    lastUpdateTime_ = startTime_;
+
+    return true;
+}
+
+void
+SceneTextureStream::teardown()
+{
+    double elapsed = lastUpdateTime_ - startTime_;
+
+    if (currentFrame_ > 0 && elapsed > 0.0) {
+        Log::info("    %ux%u %s, %s, %u uploads/frame to %u textures\n",
+                  priv_->width, priv_->height, priv_->format->name,
+                  stream_method_names[priv_->method], priv_->uploads,
+                  static_cast<unsigned int>(priv_->sources.size()));
+        Log::info("    %.1f MiB/s uploaded, CPU %.3f ms/frame in the uploads, %.3f ms/frame\n",
+                  priv_->upload_bytes / (1024.0 * 1024.0) / elapsed,
+                  priv_->upload_us / 1000.0 / currentFrame_,
+                  elapsed * 1000.0 / currentFrame_);
+
+        if (priv_->failed_maps > 0) {
+            Log::info("    %u uploads skipped, their buffers couldn't be mapped\n",
+                      priv_->failed_maps);
+        }
+    }
+
+    if (!priv_->pbos.empty())
+        glDeleteBuffers(priv_->pbos.size(), &priv_->pbos[0]);
+    priv_->pbos.clear();
+
+    /* Sibling textures are distinct from the uploaded ones */
+    if (priv_->method == StreamMethodEGLImage && !priv_->textures.empty())
+        glDeleteTextures(priv_->textures.size(), &priv_->textures[0]);
+    if (!priv_->sources.empty())
+        glDeleteTextures(priv_->sources.size(), &priv_->sources[0]);
+    priv_->textures.clear();
+    priv_->sources.clear();
+    priv_->content.clear();
+
+    priv_->mesh.reset();
+
+    priv_->program.stop();
+    priv_->program.release();
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    Scene::teardown();
+}
+
+void
+SceneTextureStream::update()
+{
+    Scene::update();
+}
+
+void
+SceneTextureStream::draw()
+{
+    for (unsigned int i = 0; i < priv_->uploads; i++)
+        upload(*priv_);
+
+    /* Draw with the latest content */
+    glBindTexture(GL_TEXTURE_2D, priv_->textures[priv_->shown]);
+    priv_->program.start();
+    priv_->mesh.render_vbo();
+}
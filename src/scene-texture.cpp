@@ -45,12 +45,17 @@ SceneTexture::SceneTexture(Canvas &pCanvas) :
          textureIt != textureMap.end();
          textureIt++)
     {
+        // The compressed variants are selected with texture-format
+        const std::string& curName = textureIt->first;
+        if (Texture::is_format_variant(curName))
+        {
+            continue;
+        }
         static bool doSeparator(false);
         if (doSeparator)
         {
             optionValues += ",";
         }
-        const std::string& curName = textureIt->first;
         optionValues += curName;
         doSeparator = true;
     }
@@ -59,6 +64,9 @@ SceneTexture::SceneTexture(Canvas &pCanvas) :
     options_["texgen"] = Scene::Option("texgen", "false",
                                        "Whether to generate texcoords in the shader",
                                        "false,true");
+    options_["texture-format"] = Scene::Option("texture-format", "uncompressed",
+                                               "The texture format to use (compressed formats are decoded on the CPU if unsupported)",
+                                               "uncompressed,etc2,astc");
 }
 
 SceneTexture::~SceneTexture()
@@ -116,7 +124,8 @@ SceneTexture::setup()
         mag_filter = GL_LINEAR;
     }
 
-    const string& whichTexture(options_["texture"].value);
+    const string whichTexture(Texture::name_for_format(options_["texture"].value,
+                                                       options_["texture-format"].value));
     if (!Texture::load(whichTexture, &texture_, min_filter, mag_filter, 0))
         return false;
 
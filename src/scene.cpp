@@ -3,6 +3,7 @@
 #include "log.h"
 #include "shader-source.h"
 #include "options.h"
+#include "program-cache.h"
 #include "util.h"
 #include <sstream>
 #include <algorithm>
@@ -98,6 +99,8 @@ Scene::Scene(Canvas &pCanvas, const string &name) :
     options_["fragment-precision"] = Scene::Option("fragment-precision",
                                                    "default,default,default,default",
                                                    "The precision values for the fragment shader (\"int,float,sampler2d,samplercube\")");
+    options_["msaa"] = Scene::Option("msaa", "",
+                                     "The number of samples per pixel to render with (default: the --msaa value)");
     /* FPS options */
     options_["show-fps"] = Scene::Option("show-fps", "false",
                                          "Show live FPS counter",
@@ -156,6 +159,15 @@ Scene::setup()
             ShaderSource::ShaderTypeFragment
             );
 
+    unsigned int samples = Options::msaa;
+    if (!options_["msaa"].value.empty())
+        samples = Util::fromString<unsigned int>(options_["msaa"].value);
+
+    if (!canvas_.samples(samples)) {
+        Log::error("Rendering with %u samples per pixel is not supported\n", samples);
+        return false;
+    }
+
     currentFrame_ = 0;
     running_ = false;
     startTime_ = Util::get_timestamp_us() / 1000000.0;
@@ -299,8 +311,21 @@ Scene::load_shaders_from_strings(Program &program,
                                  const std::string &vtx_shader_filename,
                                  const std::string &frg_shader_filename)
 {
+    uint64_t start = Util::get_timestamp_us();
+    ProgramCache::Stats &stats = ProgramCache::stats();
+    bool use_cache = ProgramCache::enabled();
+
+    stats.programs++;
     program.init();
 
+    if (use_cache && ProgramCache::load(program, vtx_shader, frg_shader)) {
+        Log::debug("Loaded program for files %s and %s from the cache\n",
+                   vtx_shader_filename.c_str(), frg_shader_filename.c_str());
+        stats.hits++;
+        stats.build_us += Util::get_timestamp_us() - start;
+        return true;
+    }
+
     Log::debug("Loading vertex shader from file %s:\n%s",
                vtx_shader_filename.c_str(), vtx_shader.c_str());
 
@@ -325,6 +350,9 @@ Scene::load_shaders_from_strings(Program &program,
         return false;
     }
 
+    if (use_cache)
+        program.setBinaryRetrievable();
+
     program.build();
     if (!program.ready()) {
         Log::error("Failed to link program created from files %s and %s:  %s\n",
@@ -335,6 +363,43 @@ Scene::load_shaders_from_strings(Program &program,
         return false;
     }
 
+    /* Writing the cache entry is not part of the build time */
+    stats.build_us += Util::get_timestamp_us() - start;
+
+    if (use_cache)
+        ProgramCache::store(program, vtx_shader, frg_shader);
+
+    return true;
+}
+
+bool
+Scene::load_compute_shader_from_string(Program &program,
+                                       const std::string &shader,
+                                       const std::string &shader_filename)
+{
+    program.init();
+
+    Log::debug("Loading compute shader from file %s:\n%s",
+               shader_filename.c_str(), shader.c_str());
+
+    program.addShader(GL_COMPUTE_SHADER, shader);
+    if (!program.valid()) {
+        Log::error("Failed to add compute shader from file %s:\n  %s\n",
+                   shader_filename.c_str(),
+                   program.errorMessage().c_str());
+        program.release();
+        return false;
+    }
+
+    program.build();
+    if (!program.ready()) {
+        Log::error("Failed to link program created from file %s:  %s\n",
+                   shader_filename.c_str(),
+                   program.errorMessage().c_str());
+        program.release();
+        return false;
+    }
+
     return true;
 }
 
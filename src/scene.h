@@ -204,6 +204,15 @@ public:
                                           const std::string &vtx_shader_filename = "None",
                                           const std::string &frg_shader_filename = "None");
 
+    /**
+     * Loads a compute shader program from a compute shader string.
+     *
+     * @return whether the operation succeeded
+     */
+    static bool load_compute_shader_from_string(Program &program,
+                                                const std::string &shader,
+                                                const std::string &shader_filename = "None");
+
 protected:
     Scene(Canvas &pCanvas, const std::string &name);
     std::string construct_title(const std::string &title);
@@ -344,6 +353,9 @@ public:
     bool setup();
     ValidationResult validate();
 
+    static std::string vertex_shader_source(int steps, bool conditionals);
+    static std::string fragment_shader_source(int steps, bool conditionals);
+
     ~SceneConditionals();
 };
 
@@ -354,6 +366,11 @@ public:
     bool setup();
     ValidationResult validate();
 
+    static std::string vertex_shader_source(int steps, bool function,
+                                            const std::string &complexity);
+    static std::string fragment_shader_source(int steps, bool function,
+                                              const std::string &complexity);
+
     ~SceneFunction();
 };
 
@@ -364,6 +381,9 @@ public:
     bool setup();
     ValidationResult validate();
 
+    static std::string vertex_shader_source(int steps, bool loop, bool uniform);
+    static std::string fragment_shader_source(int steps, bool loop, bool uniform);
+
     ~SceneLoop();
 };
 
@@ -409,10 +429,20 @@ public:
     ~SceneEffect2D();
 
 protected:
+    bool create_pass_target(GLint filter);
+    void release_pass_target();
+
+    /* The direct convolution, or the first pass of the separable one */
     Program program_;
+    /* The second pass of the separable convolution */
+    Program second_program_;
 
     Mesh mesh_;
     GLuint texture_;
+    /* The target of the first pass of the separable convolution */
+    GLuint pass_fbo_;
+    GLuint pass_texture_;
+    unsigned int fetches_;
 };
 
 class ScenePulsar : public Scene
@@ -586,4 +616,156 @@ public:
     ValidationResult validate();
 };
 
+struct SceneShaderCompilePrivate;
+
+class SceneShaderCompile : public SceneGrid
+{
+public:
+    SceneShaderCompile(Canvas &pCanvas);
+    bool setup();
+    void teardown();
+    void update();
+    void draw();
+
+    ~SceneShaderCompile();
+
+private:
+    SceneShaderCompilePrivate *priv_;
+};
+
+struct SceneInstancingPrivate;
+
+class SceneInstancing : public Scene
+{
+public:
+    SceneInstancing(Canvas &pCanvas);
+    bool supported(bool show_errors);
+    bool load();
+    void unload();
+    bool setup();
+    void teardown();
+    void update();
+    void draw();
+
+    ~SceneInstancing();
+
+private:
+    unsigned int draw_calls();
+
+    SceneInstancingPrivate *priv_;
+};
+
+struct SceneOverheadPrivate;
+
+class SceneOverhead : public Scene
+{
+public:
+    SceneOverhead(Canvas &pCanvas);
+    bool load();
+    void unload();
+    bool setup();
+    void teardown();
+    void update();
+    void draw();
+
+    ~SceneOverhead();
+
+private:
+    SceneOverheadPrivate *priv_;
+};
+
+struct SceneFillratePrivate;
+
+class SceneFillrate : public Scene
+{
+public:
+    SceneFillrate(Canvas &pCanvas);
+    bool load();
+    void unload();
+    bool setup();
+    void teardown();
+    void update();
+    void draw();
+
+    ~SceneFillrate();
+
+private:
+    bool load_texture_program(Program &program, unsigned int texture_size,
+                              unsigned int fetches);
+    bool create_texture(unsigned int size);
+    bool create_target();
+    void draw_quads(Program &program, unsigned int count);
+
+    SceneFillratePrivate *priv_;
+};
+
+class ShaderSource;
+struct SceneComputePrivate;
+
+class SceneCompute : public Scene
+{
+public:
+    SceneCompute(Canvas &pCanvas);
+    bool supported(bool show_errors);
+    bool load();
+    void unload();
+    bool setup();
+    void teardown();
+    void update();
+    void draw();
+    ValidationResult validate();
+
+    ~SceneCompute();
+
+private:
+    bool load_compute_program(const std::string &name, ShaderSource &source);
+    bool setup_particles();
+    bool setup_reduce();
+    bool setup_scan();
+    bool setup_convolution();
+    void run();
+    void upload_particles();
+    bool read_buffer(GLuint buffer, unsigned int count, std::vector<float> &data);
+
+    SceneComputePrivate *priv_;
+};
+
+struct SceneTBDRPrivate;
+
+class SceneTBDR : public Scene
+{
+public:
+    SceneTBDR(Canvas &pCanvas);
+    bool load();
+    void unload();
+    bool setup();
+    void teardown();
+    void update();
+    void draw();
+
+    ~SceneTBDR();
+
+private:
+    SceneTBDRPrivate *priv_;
+};
+
+struct SceneTextureStreamPrivate;
+
+class SceneTextureStream : public Scene
+{
+public:
+    SceneTextureStream(Canvas &pCanvas);
+    bool load();
+    void unload();
+    bool setup();
+    void teardown();
+    void update();
+    void draw();
+
+    ~SceneTextureStream();
+
+private:
+    SceneTextureStreamPrivate *priv_;
+};
+
 #endif
@@ -0,0 +1,286 @@
+#include "texture-atlas.h"
+#include "image-reader.h"
+#include "log.h"
+#include "util.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+
+const char atlas_magic[8] = { 'G', 'P', 'U', 'A', 'T', 'L', 'A', 'S' };
+const uint32_t atlas_version = 1;
+
+/* Header fields following the magic, as little-endian 32-bit words */
+enum AtlasHeaderField {
+    AtlasHeaderVersion,
+    AtlasHeaderWidth,
+    AtlasHeaderHeight,
+    AtlasHeaderChannels,
+    AtlasHeaderTileWidth,
+    AtlasHeaderTileHeight,
+    AtlasHeaderColumns,
+    AtlasHeaderCount,
+    AtlasHeaderFields
+};
+
+/* Border texels around each tile */
+const unsigned int tile_border = 1;
+
+/* Largest accepted atlas, in bytes */
+const uint64_t max_atlas_size = 256 * 1024 * 1024;
+
+uint32_t
+read_le32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void
+write_le32(uint32_t v, unsigned char *p)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+GLenum
+format_for_channels(unsigned int channels)
+{
+    switch (channels) {
+        case 1:
+            return GL_LUMINANCE;
+        case 3:
+            return GL_RGB;
+        default:
+            return GL_RGBA;
+    }
+}
+
+}
+
+bool
+TextureAtlas::pack(const std::vector<std::string> &filenames)
+{
+    std::vector<std::vector<unsigned char> > images;
+    unsigned int bpp = 0;
+    bool gray = true;
+
+    for (unsigned int i = 0; i < filenames.size(); i++) {
+        PNGReader reader(filenames[i]);
+        if (reader.error())
+            return false;
+
+        if (i == 0) {
+            tile_width_ = reader.width();
+            tile_height_ = reader.height();
+            bpp = reader.pixelBytes();
+        }
+        else if (reader.width() != tile_width_ || reader.height() != tile_height_ ||
+                 reader.pixelBytes() != bpp)
+        {
+            Log::error("Atlas image %s doesn't match the size of the first image\n",
+                       filenames[i].c_str());
+            return false;
+        }
+
+        images.push_back(std::vector<unsigned char>(tile_width_ * tile_height_ * bpp));
+        std::vector<unsigned char> &image = images.back();
+
+        /* Images are read bottom row first, as the atlas is uploaded */
+        if (!reader.readImage(&image[0]))
+            return false;
+
+        for (unsigned int p = 0; gray && p < tile_width_ * tile_height_; p++) {
+            const unsigned char *texel = &image[p * bpp];
+            gray = texel[0] == texel[1] && texel[0] == texel[2];
+        }
+    }
+
+    if (images.empty())
+        return false;
+
+    count_ = images.size();
+    channels_ = gray && bpp == 3 ? 1 : bpp;
+
+    /*
+     * Use the fewest columns giving a square grid, which minimizes the
+     * largest atlas dimension, e.g. 1548x1548 for 32 tiles of 256x256,
+     * well within the 2048 GL_MAX_TEXTURE_SIZE of many GLES2 GPUs. The
+     * atlas is not a power of two, which is fine without mipmaps.
+     */
+    columns_ = 1;
+    while (columns_ * columns_ < count_)
+        columns_++;
+
+    unsigned int rows = (count_ + columns_ - 1) / columns_;
+    unsigned int cell_width = tile_width_ + 2 * tile_border;
+    unsigned int cell_height = tile_height_ + 2 * tile_border;
+
+    width_ = columns_ * cell_width;
+    height_ = rows * cell_height;
+    pixels_.assign(width_ * height_ * channels_, 0);
+
+    for (unsigned int i = 0; i < count_; i++) {
+        unsigned int x0 = (i % columns_) * cell_width;
+        unsigned int y0 = (i / columns_) * cell_height;
+        const std::vector<unsigned char> &image = images[i];
+
+        for (unsigned int y = 0; y < cell_height; y++) {
+            unsigned int sy = (y + tile_height_ - tile_border) % tile_height_;
+            for (unsigned int x = 0; x < cell_width; x++) {
+                unsigned int sx = (x + tile_width_ - tile_border) % tile_width_;
+                const unsigned char *src = &image[(sy * tile_width_ + sx) * bpp];
+                unsigned char *dst = &pixels_[((y0 + y) * width_ + x0 + x) * channels_];
+                memcpy(dst, src, channels_);
+            }
+        }
+    }
+
+    Log::debug("Packed %u images into a %ux%u atlas\n", count_, width_, height_);
+
+    return true;
+}
+
+bool
+TextureAtlas::load(const std::string &filename)
+{
+    const std::unique_ptr<std::istream> is_ptr(Util::get_resource(filename));
+
+    if (!is_ptr || !is_ptr->good()) {
+        Log::debug("Couldn't open atlas %s\n", filename.c_str());
+        return false;
+    }
+
+    std::istream &is(*is_ptr);
+    char magic[sizeof(atlas_magic)];
+    unsigned char bytes[AtlasHeaderFields * 4];
+    uint32_t header[AtlasHeaderFields];
+
+    is.read(magic, sizeof(magic));
+    is.read(reinterpret_cast<char *>(bytes), sizeof(bytes));
+
+    for (unsigned int i = 0; i < AtlasHeaderFields; i++)
+        header[i] = read_le32(&bytes[i * 4]);
+
+    if (!is || memcmp(magic, atlas_magic, sizeof(magic)) ||
+        header[AtlasHeaderVersion] != atlas_version)
+    {
+        Log::error("%s is not a valid atlas file\n", filename.c_str());
+        return false;
+    }
+
+    uint32_t width = header[AtlasHeaderWidth];
+    uint32_t height = header[AtlasHeaderHeight];
+    uint32_t channels = header[AtlasHeaderChannels];
+    uint32_t tile_width = header[AtlasHeaderTileWidth];
+    uint32_t tile_height = header[AtlasHeaderTileHeight];
+    uint32_t columns = header[AtlasHeaderColumns];
+    uint32_t count = header[AtlasHeaderCount];
+
+    /* Products are computed in 64 bits, each factor is below 2^32 */
+    uint64_t cell_width = static_cast<uint64_t>(tile_width) + 2 * tile_border;
+    uint64_t cell_height = static_cast<uint64_t>(tile_height) + 2 * tile_border;
+    uint64_t rows = columns ? height / cell_height : 0;
+    uint64_t size = static_cast<uint64_t>(width) * height * channels;
+
+    if ((channels != 1 && channels != 3 && channels != 4) ||
+        tile_width == 0 || tile_height == 0 || columns == 0 || count == 0 ||
+        size > max_atlas_size || columns * cell_width > width ||
+        count > columns * rows)
+    {
+        Log::error("Atlas file %s has an invalid header\n", filename.c_str());
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    channels_ = channels;
+    tile_width_ = tile_width;
+    tile_height_ = tile_height;
+    columns_ = columns;
+    count_ = count;
+
+    pixels_.resize(size);
+    is.read(reinterpret_cast<char *>(&pixels_[0]), pixels_.size());
+
+    if (!is) {
+        Log::error("Atlas file %s is truncated\n", filename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool
+TextureAtlas::save(const std::string &filename) const
+{
+    std::ofstream os(filename.c_str(), std::ios::binary);
+    uint32_t header[AtlasHeaderFields];
+    unsigned char bytes[AtlasHeaderFields * 4];
+
+    header[AtlasHeaderVersion] = atlas_version;
+    header[AtlasHeaderWidth] = width_;
+    header[AtlasHeaderHeight] = height_;
+    header[AtlasHeaderChannels] = channels_;
+    header[AtlasHeaderTileWidth] = tile_width_;
+    header[AtlasHeaderTileHeight] = tile_height_;
+    header[AtlasHeaderColumns] = columns_;
+    header[AtlasHeaderCount] = count_;
+
+    for (unsigned int i = 0; i < AtlasHeaderFields; i++)
+        write_le32(header[i], &bytes[i * 4]);
+
+    os.write(atlas_magic, sizeof(atlas_magic));
+    os.write(reinterpret_cast<const char *>(bytes), sizeof(bytes));
+    os.write(reinterpret_cast<const char *>(&pixels_[0]), pixels_.size());
+
+    return os.good();
+}
+
+bool
+TextureAtlas::fits() const
+{
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+    return max_size > 0 && width_ <= static_cast<unsigned int>(max_size) &&
+           height_ <= static_cast<unsigned int>(max_size);
+}
+
+void
+TextureAtlas::upload(GLuint *tex, GLint min_filter, GLint mag_filter) const
+{
+    GLenum format = format_for_channels(channels_);
+
+    glGenTextures(1, tex);
+    glBindTexture(GL_TEXTURE_2D, *tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width_, height_, 0,
+                 format, GL_UNSIGNED_BYTE, &pixels_[0]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void
+TextureAtlas::tile(unsigned int index, LibMatrix::vec2 &offset,
+                   LibMatrix::vec2 &scale) const
+{
+    unsigned int cell_width = tile_width_ + 2 * tile_border;
+    unsigned int cell_height = tile_height_ + 2 * tile_border;
+    unsigned int x0 = (index % columns_) * cell_width + tile_border;
+    unsigned int y0 = (index / columns_) * cell_height + tile_border;
+
+    offset = LibMatrix::vec2(static_cast<float>(x0) / width_,
+                             static_cast<float>(y0) / height_);
+    scale = LibMatrix::vec2(static_cast<float>(tile_width_) / width_,
+                            static_cast<float>(tile_height_) / height_);
+}
@@ -0,0 +1,95 @@
+#ifndef GPULOAD_TEXTURE_ATLAS_H_
+#define GPULOAD_TEXTURE_ATLAS_H_
+
+#include "gl-headers.h"
+#include "vec.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * A sequence of equally sized images packed into a single texture.
+ *
+ * The images are laid out as tiles in a grid. Each tile is surrounded by a
+ * one texel border holding the wrapped-around edges of the image, so a tile
+ * can be sampled with linear filtering and repeat wrapping (emulated with
+ * fract() in the shader) without bleeding from its neighbours.
+ *
+ * Atlases are normally loaded from a precomputed blob (see
+ * tools/pack-texture-atlas.cpp), which needs no decoding, but can also be
+ * packed from PNG files at run time.
+ */
+class TextureAtlas
+{
+public:
+    TextureAtlas() :
+        width_(0), height_(0), channels_(0), tile_width_(0), tile_height_(0),
+        columns_(0), count_(0) {}
+
+    /**
+     * Packs a sequence of PNG images, which must all have the same size.
+     * Images whose color channels are all equal are packed as luminance.
+     *
+     * @param filenames the image files
+     *
+     * @return whether the operation succeeded
+     */
+    bool pack(const std::vector<std::string> &filenames);
+
+    /**
+     * Loads a packed atlas blob.
+     *
+     * @param filename the blob file
+     *
+     * @return whether the operation succeeded
+     */
+    bool load(const std::string &filename);
+
+    /**
+     * Saves the atlas as a blob.
+     *
+     * @param filename the blob file
+     *
+     * @return whether the operation succeeded
+     */
+    bool save(const std::string &filename) const;
+
+    /**
+     * Whether the atlas fits in a texture of the current GL implementation
+     * (GL_MAX_TEXTURE_SIZE).
+     */
+    bool fits() const;
+
+    /**
+     * Creates a texture holding the atlas.
+     *
+     * @param tex the texture name to set
+     * @param min_filter the minification filter (mipmaps are not supported)
+     * @param mag_filter the magnification filter
+     */
+    void upload(GLuint *tex, GLint min_filter, GLint mag_filter) const;
+
+    /**
+     * Gets the area of a tile (excluding its border) in texture coordinates.
+     *
+     * @param index the tile index
+     * @param offset the texture coordinates of the tile origin
+     * @param scale the size of the tile in texture coordinates
+     */
+    void tile(unsigned int index, LibMatrix::vec2 &offset,
+              LibMatrix::vec2 &scale) const;
+
+    unsigned int count() const { return count_; }
+
+private:
+    unsigned int width_;
+    unsigned int height_;
+    unsigned int channels_;
+    unsigned int tile_width_;
+    unsigned int tile_height_;
+    unsigned int columns_;
+    unsigned int count_;
+    std::vector<unsigned char> pixels_;
+};
+
+#endif
@@ -0,0 +1,890 @@
+#include "texture-decoder.h"
+
+#include <cstring>
+#include <stdint.h>
+
+/*
+ * LDR ASTC block decoding, following the "ASTC Compressed Texture Image
+ * Formats" section of the KHR_texture_compression_astc_ldr specification.
+ *
+ * Blocks that are invalid, or use HDR endpoint modes, decode to the error
+ * color (opaque magenta).
+ */
+
+namespace
+{
+
+const unsigned int max_weights = 64;
+const unsigned int max_color_values = 18;
+
+/* Integer sequence encoding ranges: number of levels and their encoding */
+struct ISERange
+{
+    unsigned int levels;
+    unsigned int trits;
+    unsigned int quints;
+    unsigned int bits;
+};
+
+const ISERange ise_ranges[] = {
+    { 2, 0, 0, 1 }, { 3, 1, 0, 0 }, { 4, 0, 0, 2 }, { 5, 0, 1, 0 },
+    { 6, 1, 0, 1 }, { 8, 0, 0, 3 }, { 10, 0, 1, 1 }, { 12, 1, 0, 2 },
+    { 16, 0, 0, 4 }, { 20, 0, 1, 2 }, { 24, 1, 0, 3 }, { 32, 0, 0, 5 },
+    { 40, 0, 1, 3 }, { 48, 1, 0, 4 }, { 64, 0, 0, 6 }, { 80, 0, 1, 4 },
+    { 96, 1, 0, 5 }, { 128, 0, 0, 7 }, { 160, 0, 1, 5 }, { 192, 1, 0, 6 },
+    { 256, 0, 0, 8 }
+};
+
+/* The lowest range usable for color endpoints (6 levels) */
+const unsigned int min_color_range = 4;
+const unsigned int max_color_range = 20;
+
+/**
+ * Reads bits [offset, offset + count) of a 128-bit block, with bits at or
+ * beyond 'end' reading as zero.
+ */
+unsigned int
+read_bits(const unsigned char *data, unsigned int offset, unsigned int count,
+          unsigned int end = 128)
+{
+    unsigned int value = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int pos = offset + i;
+        if (pos >= end)
+            break;
+        value |= ((data[pos >> 3] >> (pos & 7)) & 1) << i;
+    }
+
+    return value;
+}
+
+unsigned int
+ise_bit_count(unsigned int count, unsigned int range)
+{
+    const ISERange &r = ise_ranges[range];
+
+    return count * r.bits + (r.trits ? (8 * count + 4) / 5 : 0) +
+           (r.quints ? (7 * count + 2) / 3 : 0);
+}
+
+void
+decode_trits(unsigned int t, unsigned int out[5])
+{
+    unsigned int c;
+
+    if (((t >> 2) & 7) == 7) {
+        c = (((t >> 5) & 7) << 2) | (t & 3);
+        out[4] = 2;
+        out[3] = 2;
+    }
+    else {
+        c = t & 0x1f;
+        if (((t >> 5) & 3) == 3) {
+            out[4] = 2;
+            out[3] = (t >> 7) & 1;
+        }
+        else {
+            out[4] = (t >> 7) & 1;
+            out[3] = (t >> 5) & 3;
+        }
+    }
+
+    if ((c & 3) == 3) {
+        out[2] = 2;
+        out[1] = (c >> 4) & 1;
+        out[0] = (((c >> 3) & 1) << 1) | (((c >> 2) & 1) & ~((c >> 3) & 1));
+    }
+    else if (((c >> 2) & 3) == 3) {
+        out[2] = 2;
+        out[1] = 2;
+        out[0] = c & 3;
+    }
+    else {
+        out[2] = (c >> 4) & 1;
+        out[1] = (c >> 2) & 3;
+        out[0] = (c & 2) | ((c & 1) & ~((c >> 1) & 1));
+    }
+}
+
+void
+decode_quints(unsigned int q, unsigned int out[3])
+{
+    if (((q >> 1) & 3) == 3 && ((q >> 5) & 3) == 0) {
+        unsigned int q0 = q & 1;
+        out[2] = (q0 << 2) | ((((q >> 4) & 1) & ~q0) << 1) | (((q >> 3) & 1) & ~q0);
+        out[1] = 4;
+        out[0] = 4;
+        return;
+    }
+
+    unsigned int c;
+
+    if (((q >> 1) & 3) == 3) {
+        out[2] = 4;
+        c = (((q >> 3) & 3) << 3) | ((~(q >> 5) & 3) << 1) | (q & 1);
+    }
+    else {
+        out[2] = (q >> 5) & 3;
+        c = q & 0x1f;
+    }
+
+    if ((c & 7) == 5) {
+        out[1] = 4;
+        out[0] = (c >> 3) & 3;
+    }
+    else {
+        out[1] = (c >> 3) & 3;
+        out[0] = c & 7;
+    }
+}
+
+/**
+ * Decodes an integer sequence. Each output value holds the trit or quint
+ * in the bits above the plain bits.
+ */
+void
+decode_ise(const unsigned char *data, unsigned int offset, unsigned int count,
+           unsigned int range, unsigned int *out)
+{
+    const ISERange &r = ise_ranges[range];
+    unsigned int end = offset + ise_bit_count(count, range);
+    unsigned int pos = offset;
+    unsigned int b = r.bits;
+
+    if (r.trits) {
+        /* Trit bits interleaved after each value: 2, 2, 1, 2, 1 */
+        static const unsigned int tbits[5] = { 2, 2, 1, 2, 1 };
+
+        for (unsigned int i = 0; i < count; i += 5) {
+            unsigned int m[5] = { 0, 0, 0, 0, 0 };
+            unsigned int t = 0;
+            unsigned int tshift = 0;
+
+            for (unsigned int j = 0; j < 5; j++) {
+                m[j] = read_bits(data, pos, b, end);
+                pos += b;
+                t |= read_bits(data, pos, tbits[j], end) << tshift;
+                pos += tbits[j];
+                tshift += tbits[j];
+            }
+
+            unsigned int trits[5];
+            decode_trits(t, trits);
+
+            for (unsigned int j = 0; j < 5 && i + j < count; j++)
+                out[i + j] = (trits[j] << b) | m[j];
+        }
+    }
+    else if (r.quints) {
+        /* Quint bits interleaved after each value: 3, 2, 2 */
+        static const unsigned int qbits[3] = { 3, 2, 2 };
+
+        for (unsigned int i = 0; i < count; i += 3) {
+            unsigned int m[3] = { 0, 0, 0 };
+            unsigned int q = 0;
+            unsigned int qshift = 0;
+
+            for (unsigned int j = 0; j < 3; j++) {
+                m[j] = read_bits(data, pos, b, end);
+                pos += b;
+                q |= read_bits(data, pos, qbits[j], end) << qshift;
+                pos += qbits[j];
+                qshift += qbits[j];
+            }
+
+            unsigned int quints[3];
+            decode_quints(q, quints);
+
+            for (unsigned int j = 0; j < 3 && i + j < count; j++)
+                out[i + j] = (quints[j] << b) | m[j];
+        }
+    }
+    else {
+        for (unsigned int i = 0; i < count; i++) {
+            out[i] = read_bits(data, pos, b, end);
+            pos += b;
+        }
+    }
+}
+
+/** Replicates a bits-wide value to fill dst_bits bits */
+unsigned int
+replicate_bits(unsigned int value, unsigned int bits, unsigned int dst_bits)
+{
+    unsigned int result = 0;
+    int shift = dst_bits - bits;
+
+    while (shift > -static_cast<int>(bits)) {
+        result |= shift >= 0 ? value << shift : value >> -shift;
+        shift -= bits;
+    }
+
+    return result & ((1 << dst_bits) - 1);
+}
+
+/** Unquantizes a color endpoint value to [0, 255] */
+unsigned int
+unquantize_color(unsigned int value, unsigned int range)
+{
+    const ISERange &r = ise_ranges[range];
+
+    if (!r.trits && !r.quints)
+        return replicate_bits(value, r.bits, 8);
+
+    unsigned int d = value >> r.bits;
+    unsigned int m = value & ((1 << r.bits) - 1);
+    unsigned int a = (m & 1) ? 0x1ff : 0;
+    unsigned int b = 0;
+    unsigned int c = 0;
+
+    switch (r.levels) {
+        case 6:
+            c = 204;
+            break;
+        case 10:
+            c = 113;
+            break;
+        case 12: {
+            unsigned int x = (m >> 1) & 1;
+            b = (x << 8) | (x << 4) | (x << 2) | (x << 1);
+            c = 93;
+            break;
+        }
+        case 20: {
+            unsigned int x = (m >> 1) & 1;
+            b = (x << 8) | (x << 3) | (x << 2);
+            c = 54;
+            break;
+        }
+        case 24: {
+            unsigned int x = (m >> 1) & 3;
+            b = (x << 7) | (x << 2) | x;
+            c = 44;
+            break;
+        }
+        case 40: {
+            unsigned int x = (m >> 1) & 3;
+            b = (x << 7) | (x << 1) | (x >> 1);
+            c = 26;
+            break;
+        }
+        case 48: {
+            unsigned int x = (m >> 1) & 7;
+            b = (x << 6) | x;
+            c = 22;
+            break;
+        }
+        case 80: {
+            unsigned int x = (m >> 1) & 7;
+            b = (x << 6) | (x >> 1);
+            c = 13;
+            break;
+        }
+        case 96: {
+            unsigned int x = (m >> 1) & 0xf;
+            b = (x << 5) | (x >> 2);
+            c = 11;
+            break;
+        }
+        case 160: {
+            unsigned int x = (m >> 1) & 0xf;
+            b = (x << 5) | (x >> 3);
+            c = 6;
+            break;
+        }
+        case 192: {
+            unsigned int x = (m >> 1) & 0x1f;
+            b = (x << 4) | (x >> 4);
+            c = 5;
+            break;
+        }
+        default:
+            break;
+    }
+
+    unsigned int t = d * c + b;
+    t ^= a;
+    return (a & 0x80) | (t >> 2);
+}
+
+/** Unquantizes a weight value to [0, 64] */
+unsigned int
+unquantize_weight(unsigned int value, unsigned int range)
+{
+    const ISERange &r = ise_ranges[range];
+    unsigned int t;
+
+    if (!r.trits && !r.quints) {
+        t = replicate_bits(value, r.bits, 6);
+    }
+    else if (r.bits == 0) {
+        static const unsigned int trit_values[3] = { 0, 32, 63 };
+        static const unsigned int quint_values[5] = { 0, 16, 32, 47, 63 };
+        t = r.trits ? trit_values[value] : quint_values[value];
+    }
+    else {
+        unsigned int d = value >> r.bits;
+        unsigned int m = value & ((1 << r.bits) - 1);
+        unsigned int a = (m & 1) ? 0x7f : 0;
+        unsigned int b = 0;
+        unsigned int c = 0;
+
+        switch (r.levels) {
+            case 6:
+                c = 50;
+                break;
+            case 10:
+                c = 28;
+                break;
+            case 12: {
+                unsigned int x = (m >> 1) & 1;
+                b = (x << 6) | (x << 2) | x;
+                c = 23;
+                break;
+            }
+            case 20: {
+                unsigned int x = (m >> 1) & 1;
+                b = (x << 6) | (x << 1);
+                c = 13;
+                break;
+            }
+            case 24: {
+                unsigned int x = (m >> 1) & 3;
+                b = (x << 5) | x;
+                c = 11;
+                break;
+            }
+            default:
+                break;
+        }
+
+        t = d * c + b;
+        t ^= a;
+        t = (a & 0x20) | (t >> 2);
+    }
+
+    return t > 32 ? t + 1 : t;
+}
+
+/**
+ * Decodes the 11-bit block mode.
+ *
+ * @return false for reserved block modes
+ */
+bool
+decode_block_mode(unsigned int mode, unsigned int &grid_width,
+                  unsigned int &grid_height, bool &dual_plane,
+                  unsigned int &weight_range)
+{
+    unsigned int r = (mode >> 4) & 1;
+    unsigned int h = (mode >> 9) & 1;
+    unsigned int d = (mode >> 10) & 1;
+    unsigned int a = (mode >> 5) & 3;
+
+    if ((mode & 3) != 0) {
+        r |= (mode & 3) << 1;
+        unsigned int b = (mode >> 7) & 3;
+
+        switch ((mode >> 2) & 3) {
+            case 0:
+                grid_width = b + 4;
+                grid_height = a + 2;
+                break;
+            case 1:
+                grid_width = b + 8;
+                grid_height = a + 2;
+                break;
+            case 2:
+                grid_width = a + 2;
+                grid_height = b + 8;
+                break;
+            default:
+                b &= 1;
+                if (mode & 0x100) {
+                    grid_width = b + 2;
+                    grid_height = a + 2;
+                }
+                else {
+                    grid_width = a + 2;
+                    grid_height = b + 6;
+                }
+                break;
+        }
+    }
+    else {
+        r |= ((mode >> 2) & 3) << 1;
+        if (((mode >> 2) & 3) == 0)
+            return false;
+
+        unsigned int b = (mode >> 9) & 3;
+
+        switch ((mode >> 7) & 3) {
+            case 0:
+                grid_width = 12;
+                grid_height = a + 2;
+                break;
+            case 1:
+                grid_width = a + 2;
+                grid_height = 12;
+                break;
+            case 2:
+                grid_width = a + 6;
+                grid_height = b + 6;
+                d = 0;
+                h = 0;
+                break;
+            default:
+                if (((mode >> 5) & 3) == 0) {
+                    grid_width = 6;
+                    grid_height = 10;
+                }
+                else if (((mode >> 5) & 3) == 1) {
+                    grid_width = 10;
+                    grid_height = 6;
+                }
+                else {
+                    return false;
+                }
+                break;
+        }
+    }
+
+    dual_plane = d != 0;
+    weight_range = (r - 2) + 6 * h;
+
+    return true;
+}
+
+uint32_t
+hash52(uint32_t p)
+{
+    p ^= p >> 15;
+    p -= p << 17;
+    p += p << 7;
+    p += p << 4;
+    p ^= p >> 5;
+    p += p << 16;
+    p ^= p >> 7;
+    p ^= p >> 3;
+    p ^= p << 6;
+    p ^= p >> 17;
+    return p;
+}
+
+unsigned int
+select_partition(int seed, int x, int y, int partition_count, bool small_block)
+{
+    if (small_block) {
+        x <<= 1;
+        y <<= 1;
+    }
+
+    seed += (partition_count - 1) * 1024;
+
+    uint32_t rnum = hash52(seed);
+    uint8_t seeds[12];
+
+    seeds[0] = rnum & 0xf;
+    seeds[1] = (rnum >> 4) & 0xf;
+    seeds[2] = (rnum >> 8) & 0xf;
+    seeds[3] = (rnum >> 12) & 0xf;
+    seeds[4] = (rnum >> 16) & 0xf;
+    seeds[5] = (rnum >> 20) & 0xf;
+    seeds[6] = (rnum >> 24) & 0xf;
+    seeds[7] = (rnum >> 28) & 0xf;
+    seeds[8] = (rnum >> 18) & 0xf;
+    seeds[9] = (rnum >> 22) & 0xf;
+    seeds[10] = (rnum >> 26) & 0xf;
+    seeds[11] = ((rnum >> 30) | (rnum << 2)) & 0xf;
+
+    for (unsigned int i = 0; i < 12; i++)
+        seeds[i] *= seeds[i];
+
+    int sh1, sh2;
+    if (seed & 1) {
+        sh1 = (seed & 2) ? 4 : 5;
+        sh2 = (partition_count == 3) ? 6 : 5;
+    }
+    else {
+        sh1 = (partition_count == 3) ? 6 : 5;
+        sh2 = (seed & 2) ? 4 : 5;
+    }
+    int sh3 = (seed & 0x10) ? sh1 : sh2;
+
+    for (unsigned int i = 0; i < 8; i++)
+        seeds[i] >>= (i & 1) ? sh2 : sh1;
+    for (unsigned int i = 8; i < 12; i++)
+        seeds[i] >>= sh3;
+
+    /* z is always 0 for 2D blocks */
+    int a = (seeds[0] * x + seeds[1] * y + (rnum >> 14)) & 0x3f;
+    int b = (seeds[2] * x + seeds[3] * y + (rnum >> 10)) & 0x3f;
+    int c = (seeds[4] * x + seeds[5] * y + (rnum >> 6)) & 0x3f;
+    int d = (seeds[6] * x + seeds[7] * y + (rnum >> 2)) & 0x3f;
+
+    if (partition_count < 4)
+        d = 0;
+    if (partition_count < 3)
+        c = 0;
+
+    if (a >= b && a >= c && a >= d)
+        return 0;
+    else if (b >= c && b >= d)
+        return 1;
+    else if (c >= d)
+        return 2;
+    else
+        return 3;
+}
+
+inline int
+clamp255(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+void
+bit_transfer_signed(int &a, int &b)
+{
+    b = (b >> 1) | (a & 0x80);
+    a = (a >> 1) & 0x3f;
+    if (a & 0x20)
+        a -= 0x40;
+}
+
+void
+blue_contract(int &r, int &g, int &b)
+{
+    r = (r + b) >> 1;
+    g = (g + b) >> 1;
+}
+
+/**
+ * Decodes a pair of LDR color endpoints.
+ *
+ * @return false for HDR endpoint modes
+ */
+bool
+decode_endpoints(unsigned int mode, const unsigned int *v, int e0[4], int e1[4])
+{
+    int vi[8];
+    for (unsigned int i = 0; i < 8; i++)
+        vi[i] = i < 2 * ((mode >> 2) + 1) ? v[i] : 0;
+
+    switch (mode) {
+        case 0: /* Luminance, direct */
+            e0[0] = e0[1] = e0[2] = vi[0]; e0[3] = 255;
+            e1[0] = e1[1] = e1[2] = vi[1]; e1[3] = 255;
+            break;
+        case 1: { /* Luminance, base + offset */
+            int l0 = (vi[0] >> 2) | (vi[1] & 0xc0);
+            int l1 = l0 + (vi[1] & 0x3f);
+            if (l1 > 255)
+                l1 = 255;
+            e0[0] = e0[1] = e0[2] = l0; e0[3] = 255;
+            e1[0] = e1[1] = e1[2] = l1; e1[3] = 255;
+            break;
+        }
+        case 4: /* Luminance + alpha, direct */
+            e0[0] = e0[1] = e0[2] = vi[0]; e0[3] = vi[2];
+            e1[0] = e1[1] = e1[2] = vi[1]; e1[3] = vi[3];
+            break;
+        case 5: /* Luminance + alpha, base + offset */
+            bit_transfer_signed(vi[1], vi[0]);
+            bit_transfer_signed(vi[3], vi[2]);
+            e0[0] = e0[1] = e0[2] = vi[0]; e0[3] = vi[2];
+            e1[0] = e1[1] = e1[2] = clamp255(vi[0] + vi[1]);
+            e1[3] = clamp255(vi[2] + vi[3]);
+            break;
+        case 6: /* RGB, base + scale */
+            e0[0] = (vi[0] * vi[3]) >> 8;
+            e0[1] = (vi[1] * vi[3]) >> 8;
+            e0[2] = (vi[2] * vi[3]) >> 8;
+            e0[3] = 255;
+            e1[0] = vi[0]; e1[1] = vi[1]; e1[2] = vi[2]; e1[3] = 255;
+            break;
+        case 8: /* RGB, direct */
+        case 12: { /* RGBA, direct */
+            int a0 = mode == 12 ? vi[6] : 255;
+            int a1 = mode == 12 ? vi[7] : 255;
+            if (vi[1] + vi[3] + vi[5] >= vi[0] + vi[2] + vi[4]) {
+                e0[0] = vi[0]; e0[1] = vi[2]; e0[2] = vi[4]; e0[3] = a0;
+                e1[0] = vi[1]; e1[1] = vi[3]; e1[2] = vi[5]; e1[3] = a1;
+            }
+            else {
+                e0[0] = vi[1]; e0[1] = vi[3]; e0[2] = vi[5]; e0[3] = a1;
+                e1[0] = vi[0]; e1[1] = vi[2]; e1[2] = vi[4]; e1[3] = a0;
+                blue_contract(e0[0], e0[1], e0[2]);
+                blue_contract(e1[0], e1[1], e1[2]);
+            }
+            break;
+        }
+        case 9: /* RGB, base + offset */
+        case 13: { /* RGBA, base + offset */
+            bit_transfer_signed(vi[1], vi[0]);
+            bit_transfer_signed(vi[3], vi[2]);
+            bit_transfer_signed(vi[5], vi[4]);
+            if (mode == 13) {
+                bit_transfer_signed(vi[7], vi[6]);
+            }
+            else {
+                vi[6] = 255;
+                vi[7] = 0;
+            }
+
+            if (vi[1] + vi[3] + vi[5] >= 0) {
+                e0[0] = vi[0]; e0[1] = vi[2]; e0[2] = vi[4]; e0[3] = vi[6];
+                e1[0] = clamp255(vi[0] + vi[1]);
+                e1[1] = clamp255(vi[2] + vi[3]);
+                e1[2] = clamp255(vi[4] + vi[5]);
+                e1[3] = clamp255(vi[6] + vi[7]);
+            }
+            else {
+                e0[0] = clamp255(vi[0] + vi[1]);
+                e0[1] = clamp255(vi[2] + vi[3]);
+                e0[2] = clamp255(vi[4] + vi[5]);
+                e0[3] = clamp255(vi[6] + vi[7]);
+                e1[0] = vi[0]; e1[1] = vi[2]; e1[2] = vi[4]; e1[3] = vi[6];
+                blue_contract(e0[0], e0[1], e0[2]);
+                blue_contract(e1[0], e1[1], e1[2]);
+            }
+            break;
+        }
+        case 10: /* RGB, base + scale, plus two alpha */
+            e0[0] = (vi[0] * vi[3]) >> 8;
+            e0[1] = (vi[1] * vi[3]) >> 8;
+            e0[2] = (vi[2] * vi[3]) >> 8;
+            e0[3] = vi[4];
+            e1[0] = vi[0]; e1[1] = vi[1]; e1[2] = vi[2]; e1[3] = vi[5];
+            break;
+        default: /* HDR modes */
+            return false;
+    }
+
+    for (unsigned int i = 0; i < 4; i++) {
+        e0[i] = clamp255(e0[i]);
+        e1[i] = clamp255(e1[i]);
+    }
+
+    return true;
+}
+
+void
+fill_error(unsigned char *dst, unsigned int texels)
+{
+    for (unsigned int i = 0; i < texels; i++) {
+        dst[4 * i] = 255;
+        dst[4 * i + 1] = 0;
+        dst[4 * i + 2] = 255;
+        dst[4 * i + 3] = 255;
+    }
+}
+
+}
+
+/**
+ * Decodes an LDR ASTC block into an RGBA8 texel array.
+ *
+ * @param src the 16 bytes of block data
+ * @param block_width the width of the block in texels
+ * @param block_height the height of the block in texels
+ * @param dst the RGBA8 output (block_width * block_height texels, row-major)
+ */
+void
+TextureDecoder::decode_astc_block(const unsigned char *src,
+                                  unsigned int block_width,
+                                  unsigned int block_height,
+                                  unsigned char *dst)
+{
+    unsigned int texels = block_width * block_height;
+    unsigned int mode = read_bits(src, 0, 11);
+
+    /* Void-extent blocks hold a single constant color */
+    if ((mode & 0x1ff) == 0x1fc) {
+        if (mode & 0x200) {
+            /* HDR */
+            fill_error(dst, texels);
+            return;
+        }
+
+        unsigned char color[4];
+        for (unsigned int c = 0; c < 4; c++)
+            color[c] = read_bits(src, 64 + 16 * c, 16) >> 8;
+
+        for (unsigned int i = 0; i < texels; i++)
+            memcpy(dst + 4 * i, color, 4);
+        return;
+    }
+
+    unsigned int grid_width, grid_height, weight_range;
+    bool dual_plane;
+
+    if (!decode_block_mode(mode, grid_width, grid_height, dual_plane,
+                           weight_range))
+    {
+        fill_error(dst, texels);
+        return;
+    }
+
+    unsigned int planes = dual_plane ? 2 : 1;
+    unsigned int weight_count = grid_width * grid_height * planes;
+    unsigned int partitions = read_bits(src, 11, 2) + 1;
+
+    if (grid_width > block_width || grid_height > block_height ||
+        weight_count > max_weights || (dual_plane && partitions == 4))
+    {
+        fill_error(dst, texels);
+        return;
+    }
+
+    unsigned int weight_bits = ise_bit_count(weight_count, weight_range);
+    if (weight_bits < 24 || weight_bits > 96) {
+        fill_error(dst, texels);
+        return;
+    }
+
+    unsigned int below_weights = 128 - weight_bits;
+    unsigned int modes[4];
+    unsigned int seed = 0;
+    unsigned int color_start;
+
+    if (partitions == 1) {
+        modes[0] = read_bits(src, 13, 4);
+        color_start = 17;
+    }
+    else {
+        seed = read_bits(src, 13, 10);
+        unsigned int encoded = read_bits(src, 23, 6);
+
+        if ((encoded & 3) == 0) {
+            for (unsigned int p = 0; p < partitions; p++)
+                modes[p] = encoded >> 2;
+        }
+        else {
+            /* The remaining mode bits are stored below the weights */
+            unsigned int extra = 3 * partitions - 4;
+            below_weights -= extra;
+            encoded |= read_bits(src, below_weights, extra) << 6;
+
+            unsigned int base_class = (encoded & 3) - 1;
+            for (unsigned int p = 0; p < partitions; p++) {
+                modes[p] = (((encoded >> (p + 2)) & 1) + base_class) << 2;
+                modes[p] |= (encoded >> (partitions + 2 * p + 2)) & 3;
+            }
+        }
+
+        color_start = 29;
+    }
+
+    unsigned int plane2_component = 4;
+    if (dual_plane) {
+        below_weights -= 2;
+        plane2_component = read_bits(src, below_weights, 2);
+    }
+
+    /* Color endpoints */
+    unsigned int color_count = 0;
+    for (unsigned int p = 0; p < partitions; p++)
+        color_count += 2 * ((modes[p] >> 2) + 1);
+
+    if (color_count > max_color_values || below_weights <= color_start) {
+        fill_error(dst, texels);
+        return;
+    }
+
+    unsigned int color_bits = below_weights - color_start;
+    unsigned int color_range = max_color_range + 1;
+
+    for (unsigned int r = max_color_range; r >= min_color_range; r--) {
+        if (ise_bit_count(color_count, r) <= color_bits) {
+            color_range = r;
+            break;
+        }
+    }
+
+    if (color_range > max_color_range) {
+        fill_error(dst, texels);
+        return;
+    }
+
+    unsigned int color_values[max_color_values];
+    decode_ise(src, color_start, color_count, color_range, color_values);
+
+    for (unsigned int i = 0; i < color_count; i++)
+        color_values[i] = unquantize_color(color_values[i], color_range);
+
+    int endpoints[4][2][4];
+    const unsigned int *v = color_values;
+
+    for (unsigned int p = 0; p < partitions; p++) {
+        if (!decode_endpoints(modes[p], v, endpoints[p][0], endpoints[p][1])) {
+            fill_error(dst, texels);
+            return;
+        }
+        v += 2 * ((modes[p] >> 2) + 1);
+    }
+
+    /* Weights are stored bit-reversed from the top of the block */
+    unsigned char reversed[16];
+    for (unsigned int i = 0; i < 16; i++) {
+        unsigned char b = src[15 - i];
+        b = ((b & 0xf0) >> 4) | ((b & 0x0f) << 4);
+        b = ((b & 0xcc) >> 2) | ((b & 0x33) << 2);
+        b = ((b & 0xaa) >> 1) | ((b & 0x55) << 1);
+        reversed[i] = b;
+    }
+
+    unsigned int weights[max_weights];
+    decode_ise(reversed, 0, weight_count, weight_range, weights);
+
+    for (unsigned int i = 0; i < weight_count; i++)
+        weights[i] = unquantize_weight(weights[i], weight_range);
+
+    /* Infill the weight grid to the texels, and interpolate */
+    unsigned int ds = (1024 + block_width / 2) / (block_width - 1);
+    unsigned int dt = (1024 + block_height / 2) / (block_height - 1);
+    bool small_block = texels < 31;
+
+    for (unsigned int t = 0; t < block_height; t++) {
+        for (unsigned int s = 0; s < block_width; s++) {
+            unsigned int gs = (ds * s * (grid_width - 1) + 32) >> 6;
+            unsigned int gt = (dt * t * (grid_height - 1) + 32) >> 6;
+            unsigned int js = gs >> 4;
+            unsigned int fs = gs & 0xf;
+            unsigned int jt = gt >> 4;
+            unsigned int ft = gt & 0xf;
+            unsigned int w11 = (fs * ft + 8) >> 4;
+            unsigned int w10 = ft - w11;
+            unsigned int w01 = fs - w11;
+            unsigned int w00 = 16 - fs - ft + w11;
+
+            unsigned int js1 = js + 1 < grid_width ? js + 1 : js;
+            unsigned int jt1 = jt + 1 < grid_height ? jt + 1 : jt;
+            unsigned int i00 = jt * grid_width + js;
+            unsigned int i01 = jt * grid_width + js1;
+            unsigned int i10 = jt1 * grid_width + js;
+            unsigned int i11 = jt1 * grid_width + js1;
+
+            unsigned int w[2];
+            for (unsigned int plane = 0; plane < planes; plane++) {
+                w[plane] = (weights[i00 * planes + plane] * w00 +
+                            weights[i01 * planes + plane] * w01 +
+                            weights[i10 * planes + plane] * w10 +
+                            weights[i11 * planes + plane] * w11 + 8) >> 4;
+            }
+
+            unsigned int p = partitions > 1 ?
+                select_partition(seed, s, t, partitions, small_block) : 0;
+            unsigned char *texel = dst + 4 * (t * block_width + s);
+
+            for (unsigned int c = 0; c < 4; c++) {
+                unsigned int weight = c == plane2_component ? w[1] : w[0];
+                unsigned int c0 = endpoints[p][0][c] * 257;
+                unsigned int c1 = endpoints[p][1][c] * 257;
+                unsigned int value = (c0 * (64 - weight) + c1 * weight + 32) >> 6;
+                texel[c] = value >> 8;
+            }
+        }
+    }
+}
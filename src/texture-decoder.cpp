@@ -0,0 +1,400 @@
+#include "texture-decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+/*
+ * The ETC2 and EAC decoding follows the "ETC Compressed Texture Image
+ * Formats" section of the OpenGL ES 3.0 specification.
+ */
+
+namespace
+{
+
+struct ASTCBlockSize
+{
+    GLenum format;
+    unsigned int width;
+    unsigned int height;
+};
+
+const ASTCBlockSize astc_block_sizes[] = {
+    { GL_COMPRESSED_RGBA_ASTC_4x4_KHR, 4, 4 },
+    { GL_COMPRESSED_RGBA_ASTC_5x4_KHR, 5, 4 },
+    { GL_COMPRESSED_RGBA_ASTC_5x5_KHR, 5, 5 },
+    { GL_COMPRESSED_RGBA_ASTC_6x5_KHR, 6, 5 },
+    { GL_COMPRESSED_RGBA_ASTC_6x6_KHR, 6, 6 },
+    { GL_COMPRESSED_RGBA_ASTC_8x5_KHR, 8, 5 },
+    { GL_COMPRESSED_RGBA_ASTC_8x6_KHR, 8, 6 },
+    { GL_COMPRESSED_RGBA_ASTC_8x8_KHR, 8, 8 },
+    { GL_COMPRESSED_RGBA_ASTC_10x5_KHR, 10, 5 },
+    { GL_COMPRESSED_RGBA_ASTC_10x6_KHR, 10, 6 },
+    { GL_COMPRESSED_RGBA_ASTC_10x8_KHR, 10, 8 },
+    { GL_COMPRESSED_RGBA_ASTC_10x10_KHR, 10, 10 },
+    { GL_COMPRESSED_RGBA_ASTC_12x10_KHR, 12, 10 },
+    { GL_COMPRESSED_RGBA_ASTC_12x12_KHR, 12, 12 },
+};
+
+const unsigned int astc_srgb_offset =
+    GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR - GL_COMPRESSED_RGBA_ASTC_4x4_KHR;
+
+const int etc_modifier_table[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+const int etc_distance_table[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+const int eac_modifier_table[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+inline unsigned char
+clamp255(int v)
+{
+    return static_cast<unsigned char>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+inline int
+extend4(int v)
+{
+    return (v << 4) | v;
+}
+
+inline int
+extend5(int v)
+{
+    return (v << 3) | (v >> 2);
+}
+
+inline int
+extend6(int v)
+{
+    return (v << 2) | (v >> 4);
+}
+
+inline int
+extend7(int v)
+{
+    return (v << 1) | (v >> 6);
+}
+
+inline int
+sign_extend3(int v)
+{
+    return (v & 4) ? v - 8 : v;
+}
+
+inline void
+set_texel(unsigned char *dst, unsigned int x, unsigned int y,
+          int r, int g, int b, int a)
+{
+    unsigned char *p = dst + 4 * (y * 4 + x);
+    p[0] = clamp255(r);
+    p[1] = clamp255(g);
+    p[2] = clamp255(b);
+    p[3] = clamp255(a);
+}
+
+}
+
+bool
+TextureDecoder::block_info(GLenum format, unsigned int &block_width,
+                           unsigned int &block_height, unsigned int &block_bytes)
+{
+    switch (format) {
+        case GL_ETC1_RGB8_OES:
+        case GL_COMPRESSED_RGB8_ETC2:
+        case GL_COMPRESSED_SRGB8_ETC2:
+        case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+        case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+            block_width = 4;
+            block_height = 4;
+            block_bytes = 8;
+            return true;
+        case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+            block_width = 4;
+            block_height = 4;
+            block_bytes = 16;
+            return true;
+        default:
+            break;
+    }
+
+    for (unsigned int i = 0; i < sizeof(astc_block_sizes) / sizeof(*astc_block_sizes); i++) {
+        const ASTCBlockSize &bs = astc_block_sizes[i];
+        if (format == bs.format || format == bs.format + astc_srgb_offset) {
+            block_width = bs.width;
+            block_height = bs.height;
+            block_bytes = 16;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+unsigned int
+TextureDecoder::image_size(GLenum format, unsigned int width, unsigned int height)
+{
+    unsigned int bw, bh, bytes;
+
+    if (!block_info(format, bw, bh, bytes))
+        return 0;
+
+    return ((width + bw - 1) / bw) * ((height + bh - 1) / bh) * bytes;
+}
+
+bool
+TextureDecoder::decode(GLenum format, const unsigned char *src,
+                       unsigned int width, unsigned int height,
+                       unsigned char *dst)
+{
+    unsigned int bw, bh, bytes;
+
+    if (!block_info(format, bw, bh, bytes))
+        return false;
+
+    bool astc = bytes == 16 && format != GL_COMPRESSED_RGBA8_ETC2_EAC &&
+                format != GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+    bool punchthrough = format == GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 ||
+                        format == GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2;
+    bool eac = format == GL_COMPRESSED_RGBA8_ETC2_EAC ||
+               format == GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+
+    /* Large enough for the biggest (12x12) ASTC block */
+    unsigned char block[12 * 12 * 4];
+
+    for (unsigned int by = 0; by < height; by += bh) {
+        for (unsigned int bx = 0; bx < width; bx += bw) {
+            if (astc) {
+                decode_astc_block(src, bw, bh, block);
+            }
+            else if (eac) {
+                decode_etc2_block(src + 8, false, block);
+                decode_eac_alpha_block(src, block);
+            }
+            else {
+                /* ETC1 is a subset of ETC2 RGB8 */
+                decode_etc2_block(src, punchthrough, block);
+            }
+
+            src += bytes;
+
+            /* Copy the block to the image, clipping at the edges */
+            unsigned int cw = std::min(bw, width - bx);
+            unsigned int ch = std::min(bh, height - by);
+
+            for (unsigned int y = 0; y < ch; y++) {
+                memcpy(dst + 4 * ((by + y) * width + bx),
+                       block + 4 * y * bw, 4 * cw);
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Decodes an ETC1/ETC2 RGB block into a 4x4 RGBA8 texel array.
+ *
+ * @param src the 8 bytes of block data
+ * @param punchthrough whether the block uses punchthrough alpha
+ * @param dst the RGBA8 output (16 texels, row-major)
+ */
+void
+TextureDecoder::decode_etc2_block(const unsigned char *src, bool punchthrough,
+                                  unsigned char *dst)
+{
+    /* Texel indices, stored in column-major order */
+    unsigned int msb = (src[4] << 8) | src[5];
+    unsigned int lsb = (src[6] << 8) | src[7];
+    bool diff = src[3] & 2;
+    bool flip = src[3] & 1;
+    /* With punchthrough alpha the diff bit signals a fully opaque block */
+    bool opaque = punchthrough ? diff : true;
+
+    if (punchthrough)
+        diff = true;
+
+    int r1, g1, b1, r2, g2, b2;
+
+    if (diff) {
+        int r = src[0] >> 3;
+        int g = src[1] >> 3;
+        int b = src[2] >> 3;
+        int dr = r + sign_extend3(src[0] & 7);
+        int dg = g + sign_extend3(src[1] & 7);
+        int db = b + sign_extend3(src[2] & 7);
+
+        if (dr < 0 || dr > 31) {
+            /* T mode */
+            r1 = extend4(((src[0] >> 1) & 0xc) | (src[0] & 3));
+            g1 = extend4(src[1] >> 4);
+            b1 = extend4(src[1] & 0xf);
+            r2 = extend4(src[2] >> 4);
+            g2 = extend4(src[2] & 0xf);
+            b2 = extend4(src[3] >> 4);
+            int d = etc_distance_table[((src[3] >> 1) & 6) | (src[3] & 1)];
+
+            int paint[4][3] = {
+                { r1, g1, b1 },
+                { r2 + d, g2 + d, b2 + d },
+                { r2, g2, b2 },
+                { r2 - d, g2 - d, b2 - d }
+            };
+
+            for (unsigned int i = 0; i < 16; i++) {
+                unsigned int idx = (((msb >> i) & 1) << 1) | ((lsb >> i) & 1);
+                if (!opaque && idx == 2)
+                    set_texel(dst, i / 4, i % 4, 0, 0, 0, 0);
+                else
+                    set_texel(dst, i / 4, i % 4, paint[idx][0], paint[idx][1],
+                              paint[idx][2], 255);
+            }
+            return;
+        }
+        else if (dg < 0 || dg > 31) {
+            /* H mode */
+            int hr1 = (src[0] >> 3) & 0xf;
+            int hg1 = ((src[0] & 7) << 1) | ((src[1] >> 4) & 1);
+            int hb1 = (src[1] & 8) | ((src[1] & 3) << 1) | (src[2] >> 7);
+            int hr2 = (src[2] >> 3) & 0xf;
+            int hg2 = ((src[2] & 7) << 1) | (src[3] >> 7);
+            int hb2 = (src[3] >> 3) & 0xf;
+            int di = (src[3] & 4) | ((src[3] & 1) << 1);
+
+            if (((hr1 << 8) | (hg1 << 4) | hb1) >= ((hr2 << 8) | (hg2 << 4) | hb2))
+                di |= 1;
+
+            int d = etc_distance_table[di];
+            r1 = extend4(hr1); g1 = extend4(hg1); b1 = extend4(hb1);
+            r2 = extend4(hr2); g2 = extend4(hg2); b2 = extend4(hb2);
+
+            int paint[4][3] = {
+                { r1 + d, g1 + d, b1 + d },
+                { r1 - d, g1 - d, b1 - d },
+                { r2 + d, g2 + d, b2 + d },
+                { r2 - d, g2 - d, b2 - d }
+            };
+
+            for (unsigned int i = 0; i < 16; i++) {
+                unsigned int idx = (((msb >> i) & 1) << 1) | ((lsb >> i) & 1);
+                if (!opaque && idx == 2)
+                    set_texel(dst, i / 4, i % 4, 0, 0, 0, 0);
+                else
+                    set_texel(dst, i / 4, i % 4, paint[idx][0], paint[idx][1],
+                              paint[idx][2], 255);
+            }
+            return;
+        }
+        else if (db < 0 || db > 31) {
+            /* Planar mode */
+            unsigned long long v = 0;
+            for (unsigned int i = 0; i < 8; i++)
+                v = (v << 8) | src[i];
+
+            int ro = extend6((v >> 57) & 0x3f);
+            int go = extend7((((v >> 56) & 1) << 6) | ((v >> 49) & 0x3f));
+            int bo = extend6((((v >> 48) & 1) << 5) | (((v >> 43) & 3) << 3) |
+                             ((v >> 39) & 7));
+            int rh = extend6((((v >> 34) & 0x1f) << 1) | ((v >> 32) & 1));
+            int gh = extend7((v >> 25) & 0x7f);
+            int bh = extend6((v >> 19) & 0x3f);
+            int rv = extend6((v >> 13) & 0x3f);
+            int gv = extend7((v >> 6) & 0x7f);
+            int bv = extend6(v & 0x3f);
+
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    set_texel(dst, x, y,
+                              (x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+                              (x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+                              (x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2,
+                              255);
+                }
+            }
+            return;
+        }
+
+        r1 = extend5(r); g1 = extend5(g); b1 = extend5(b);
+        r2 = extend5(dr); g2 = extend5(dg); b2 = extend5(db);
+    }
+    else {
+        r1 = extend4(src[0] >> 4); r2 = extend4(src[0] & 0xf);
+        g1 = extend4(src[1] >> 4); g2 = extend4(src[1] & 0xf);
+        b1 = extend4(src[2] >> 4); b2 = extend4(src[2] & 0xf);
+    }
+
+    /* Individual or differential mode */
+    const int *table1 = etc_modifier_table[src[3] >> 5];
+    const int *table2 = etc_modifier_table[(src[3] >> 2) & 7];
+
+    for (unsigned int i = 0; i < 16; i++) {
+        unsigned int x = i / 4;
+        unsigned int y = i % 4;
+        bool second = flip ? y >= 2 : x >= 2;
+        const int *table = second ? table2 : table1;
+        unsigned int idx = (((msb >> i) & 1) << 1) | ((lsb >> i) & 1);
+        int modifier;
+
+        if (!opaque && idx == 2) {
+            set_texel(dst, x, y, 0, 0, 0, 0);
+            continue;
+        }
+
+        switch (idx) {
+            case 0: modifier = opaque ? table[0] : 0; break;
+            case 1: modifier = table[1]; break;
+            case 2: modifier = -table[0]; break;
+            default: modifier = -table[1]; break;
+        }
+
+        if (second)
+            set_texel(dst, x, y, r2 + modifier, g2 + modifier, b2 + modifier, 255);
+        else
+            set_texel(dst, x, y, r1 + modifier, g1 + modifier, b1 + modifier, 255);
+    }
+}
+
+/**
+ * Decodes an EAC alpha block into the alpha channel of a 4x4 RGBA8 texel
+ * array.
+ *
+ * @param src the 8 bytes of block data
+ * @param dst the RGBA8 texels (16 texels, row-major)
+ */
+void
+TextureDecoder::decode_eac_alpha_block(const unsigned char *src, unsigned char *dst)
+{
+    int base = src[0];
+    int multiplier = src[1] >> 4;
+    const int *table = eac_modifier_table[src[1] & 0xf];
+
+    unsigned long long indices = 0;
+    for (unsigned int i = 2; i < 8; i++)
+        indices = (indices << 8) | src[i];
+
+    for (unsigned int i = 0; i < 16; i++) {
+        unsigned int idx = (indices >> (45 - 3 * i)) & 7;
+        unsigned int x = i / 4;
+        unsigned int y = i % 4;
+        dst[4 * (y * 4 + x) + 3] = clamp255(base + table[idx] * multiplier);
+    }
+}
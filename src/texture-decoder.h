@@ -0,0 +1,67 @@
+#ifndef GPULOAD_TEXTURE_DECODER_H_
+#define GPULOAD_TEXTURE_DECODER_H_
+
+#include "gl-headers.h"
+
+/**
+ * CPU decoders for compressed texture formats.
+ *
+ * These are used as a fallback when the GL implementation doesn't support
+ * a compressed format natively. Supported formats are ETC1, ETC2 (RGB8,
+ * RGB8 with punchthrough alpha, RGBA8 with EAC alpha) and LDR ASTC in all
+ * 2D block sizes. sRGB variants are decoded without any conversion.
+ */
+class TextureDecoder
+{
+public:
+    /**
+     * Gets the block layout of a compressed format.
+     *
+     * @param format the GL internal format
+     * @param block_width the width of a block in texels
+     * @param block_height the height of a block in texels
+     * @param block_bytes the size of a block in bytes
+     *
+     * @return whether the format is a known compressed format
+     */
+    static bool block_info(GLenum format, unsigned int &block_width,
+                           unsigned int &block_height, unsigned int &block_bytes);
+
+    /**
+     * Gets the size in bytes of a compressed image.
+     *
+     * @return the size, or 0 if the format is not a known compressed format
+     */
+    static unsigned int image_size(GLenum format, unsigned int width,
+                                   unsigned int height);
+
+    /**
+     * Decodes a compressed image to RGBA8.
+     *
+     * The decoded rows are in the same order as the block rows, so the
+     * result can be uploaded in place of the compressed data.
+     *
+     * @param format the GL internal format of the data
+     * @param src the compressed data
+     * @param width the width of the image in texels
+     * @param height the height of the image in texels
+     * @param dst the RGBA8 output, of size width * height * 4
+     *
+     * @return whether the format is supported
+     */
+    static bool decode(GLenum format, const unsigned char *src,
+                       unsigned int width, unsigned int height,
+                       unsigned char *dst);
+
+private:
+    static void decode_etc2_block(const unsigned char *src, bool punchthrough,
+                                  unsigned char *dst);
+    static void decode_eac_alpha_block(const unsigned char *src,
+                                       unsigned char *dst);
+    static void decode_astc_block(const unsigned char *src,
+                                  unsigned int block_width,
+                                  unsigned int block_height,
+                                  unsigned char *dst);
+};
+
+#endif
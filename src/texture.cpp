@@ -4,9 +4,18 @@
 #include "options.h"
 #include "util.h"
 #include "image-reader.h"
+#include "ktx-reader.h"
+#include "mipmap-builder.h"
+#include "texture-decoder.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdarg>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <thread>
 #include <vector>
 
 class ImageData {
@@ -20,16 +29,33 @@ class ImageData {
     }
 
 public:
-    ImageData() : pixels(0), width(0), height(0), bpp(0) {}
-    ~ImageData() { delete [] pixels; }
+    ImageData() : pixels(0), width(0), height(0), bpp(0), pbo(0) {}
+    ~ImageData()
+    {
+        delete [] pixels;
+        if (pbo)
+            glDeleteBuffers(1, &pbo);
+    }
     bool load(ImageReader &reader);
+    bool load_pbo(ImageReader &reader);
 
     unsigned char *pixels;
     unsigned int width;
     unsigned int height;
     unsigned int bpp;
+    GLuint pbo;
 };
 
+static void
+log_decode_rate(unsigned int bytes, uint64_t start)
+{
+    double elapsed = (Util::get_timestamp_us() - start) / 1000000.0;
+
+    Log::debug("    Decoded %u bytes in %.3f ms (%.1f MB/s)\n",
+               bytes, elapsed * 1000.0,
+               elapsed > 0.0 ? bytes / (elapsed * 1000000.0) : 0.0);
+}
+
 bool
 ImageData::load(ImageReader &reader)
 {
@@ -40,23 +66,200 @@ ImageData::load(ImageReader &reader)
 
     Log::debug("    Height: %d Width: %d Bpp: %d\n", width, height, bpp);
 
-    /* 
-     * Copy the row data to the image buffer in reverse Y order, suitable
-     * for texture upload.
-     */
-    unsigned char *ptr = &pixels[bpp * width * (height - 1)];
+    /* Decode the image in reverse Y order, suitable for texture upload */
+    uint64_t start = Util::get_timestamp_us();
+
+    if (!reader.readImage(pixels))
+        return false;
 
-    while (reader.nextRow(ptr))
-        ptr -= bpp * width;
+    log_decode_rate(bpp * width * height, start);
 
     return !reader.error();
 }
 
+/**
+ * Decodes the image directly into a mapped pixel unpack buffer, which is
+ * then used as the source of the texture uploads.
+ */
+bool
+ImageData::load_pbo(ImageReader &reader)
+{
+    if (reader.error())
+        return false;
+
+    width = reader.width();
+    height = reader.height();
+    bpp = reader.pixelBytes();
+
+    Log::debug("    Height: %d Width: %d Bpp: %d (PBO)\n", width, height, bpp);
+
+    unsigned int size = bpp * width * height;
+
+    glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_STREAM_DRAW);
+
+    unsigned char *ptr = reinterpret_cast<unsigned char *>(
+        GLExtensions::MapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY));
+
+    if (!ptr) {
+        Log::error("Failed to map pixel unpack buffer\n");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+
+    uint64_t start = Util::get_timestamp_us();
+    bool ret = reader.readImage(ptr);
+
+    if (GLExtensions::UnmapBuffer(GL_PIXEL_UNPACK_BUFFER) != GL_TRUE)
+        ret = false;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (ret)
+        log_decode_rate(size, start);
+
+    return ret && !reader.error();
+}
+
+bool
+Texture::pbo_supported()
+{
+    if (!GLExtensions::MapBuffer || !GLExtensions::UnmapBuffer)
+        return false;
+
+    const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    if (!version)
+        return false;
+
+    std::string version_str(version);
+#if GPULOAD_USE_GLESv2
+    /* "OpenGL ES N.M ..." */
+    static const std::string prefix("OpenGL ES ");
+    if (version_str.compare(0, prefix.size(), prefix) != 0)
+        return false;
+    return Util::fromString<unsigned int>(version_str.substr(prefix.size(), 1)) >= 3;
+#else
+    /* "N.M ..." */
+    if (version_str.size() < 3)
+        return false;
+    unsigned int major = Util::fromString<unsigned int>(version_str.substr(0, 1));
+    unsigned int minor = Util::fromString<unsigned int>(version_str.substr(2, 1));
+    return major > 2 || (major == 2 && minor >= 1) ||
+           GLExtensions::support("GL_ARB_pixel_buffer_object");
+#endif
+}
+
+/* Upper bound of the memory used by cached mipmap levels */
+static const size_t max_mipmap_cache_bytes = 64 * 1024 * 1024;
+
+/**
+ * Uploads mipmap levels 1 and up of the bound texture, built on the CPU.
+ *
+ * The levels are cached, keyed by the texture file, its size, the color
+ * space and the filter, so later loads of the same texture skip the
+ * filtering. The oldest entries are evicted when the cache grows past
+ * max_mipmap_cache_bytes.
+ *
+ * @param key the cache key of the image
+ * @param pixels the base level pixels
+ * @param width the width of the base level
+ * @param height the height of the base level
+ * @param bpp the bytes per pixel of the base level (3 or 4)
+ * @param srgb whether the color channels are sRGB encoded
+ *
+ * @return false if CPU mipmaps are disabled, and GL should generate them
+ */
+static bool
+upload_cpu_mipmaps(const std::string &key, const unsigned char *pixels,
+                   unsigned int width, unsigned int height, unsigned int bpp,
+                   bool srgb)
+{
+    typedef std::map<std::string, std::vector<MipmapBuilder::Level> > MipmapCache;
+    static MipmapCache cache;
+    static std::deque<std::string> cache_order;
+    static size_t cache_bytes = 0;
+    MipmapBuilder::Filter filter;
+
+    if (Options::texture_mipmaps == Options::TextureMipmapsBox)
+        filter = MipmapBuilder::FilterBox;
+    else if (Options::texture_mipmaps == Options::TextureMipmapsKaiser)
+        filter = MipmapBuilder::FilterKaiser;
+    else
+        return false;
+
+    std::stringstream ss;
+    ss << key << ":" << width << "x" << height << ":" << bpp
+       << (srgb ? ":srgb" : ":linear")
+       << (filter == MipmapBuilder::FilterBox ? ":box" : ":kaiser");
+
+    std::string cache_key(ss.str());
+    std::vector<MipmapBuilder::Level> built;
+    const std::vector<MipmapBuilder::Level> *levels_ptr = &built;
+    MipmapCache::iterator iter = cache.find(cache_key);
+
+    if (iter != cache.end()) {
+        levels_ptr = &iter->second;
+    }
+    else {
+        uint64_t start = Util::get_timestamp_us();
+
+        MipmapBuilder(filter, srgb).build(pixels, width, height, bpp, built);
+
+        Log::debug("    Built %u mipmap levels in %.3f ms\n",
+                   static_cast<unsigned int>(built.size()),
+                   (Util::get_timestamp_us() - start) / 1000.0);
+
+        size_t bytes = 0;
+        for (unsigned int i = 0; i < built.size(); i++)
+            bytes += built[i].pixels.size();
+
+        /* Chains larger than the whole cache are used once and dropped */
+        if (bytes <= max_mipmap_cache_bytes) {
+            while (cache_bytes + bytes > max_mipmap_cache_bytes) {
+                MipmapCache::iterator oldest = cache.find(cache_order.front());
+                for (unsigned int i = 0; i < oldest->second.size(); i++)
+                    cache_bytes -= oldest->second[i].pixels.size();
+                cache.erase(oldest);
+                cache_order.pop_front();
+            }
+
+            std::vector<MipmapBuilder::Level> &cached = cache[cache_key];
+            cached.swap(built);
+            cache_order.push_back(cache_key);
+            cache_bytes += bytes;
+            levels_ptr = &cached;
+        }
+    }
+
+    GLenum format = bpp == 3 ? GL_RGB : GL_RGBA;
+    const std::vector<MipmapBuilder::Level> &levels = *levels_ptr;
+
+    /* Small mipmap levels of RGB data are not 4-byte aligned */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (unsigned int i = 0; i < levels.size(); i++) {
+        glTexImage2D(GL_TEXTURE_2D, i + 1, format, levels[i].width,
+                     levels[i].height, 0, format, GL_UNSIGNED_BYTE,
+                     &levels[i].pixels[0]);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return true;
+}
+
 static void
-setup_texture(GLuint *tex, ImageData &image, GLint min_filter, GLint mag_filter)
+setup_texture(GLuint *tex, ImageData &image, GLint min_filter, GLint mag_filter,
+              const std::string &key, bool srgb)
 {
     GLenum format = image.bpp == 3 ? GL_RGB : GL_RGBA;
     bool needs_mipmap = min_filter != GL_NEAREST && min_filter != GL_LINEAR;
+    bool cpu_mipmap = needs_mipmap && image.pixels &&
+                      Options::texture_mipmaps != Options::TextureMipmapsGL;
+
+    if (cpu_mipmap)
+        needs_mipmap = false;
 
     glGenTextures(1, tex);
     glBindTexture(GL_TEXTURE_2D, *tex);
@@ -66,13 +269,181 @@ setup_texture(GLuint *tex, ImageData &image, GLint min_filter, GLint mag_filter)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     if (needs_mipmap && !GLExtensions::GenerateMipmap)
         glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+
+    /* When using a PBO the pixel pointer is an offset into the buffer */
+    if (image.pbo)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, image.pbo);
+
+    /* Rows of RGB data (e.g. of scaled down JPEGs) are not 4-byte aligned */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0,
                  format, GL_UNSIGNED_BYTE, image.pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (image.pbo)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (cpu_mipmap)
+        upload_cpu_mipmaps(key, image.pixels, image.width, image.height, image.bpp,
+                           srgb);
 
     if (needs_mipmap && GLExtensions::GenerateMipmap)
         GLExtensions::GenerateMipmap(GL_TEXTURE_2D);
 }
 
+/**
+ * Whether the GL implementation can sample a compressed format natively.
+ */
+static bool
+compressed_format_supported(GLenum format)
+{
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &num_formats);
+    if (num_formats <= 0)
+        return false;
+
+    std::vector<GLint> formats(num_formats);
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, &formats[0]);
+
+    return std::find(formats.begin(), formats.end(),
+                     static_cast<GLint>(format)) != formats.end();
+}
+
+/**
+ * Sets up a texture from the contents of a KTX file.
+ *
+ * Compressed levels are uploaded as is if the format is supported by the GL
+ * implementation, otherwise they are decoded to RGBA on the CPU. Mipmaps are
+ * taken from the file if it holds a full chain, and generated otherwise.
+ */
+static void
+setup_texture(GLuint *tex, const KTXReader &ktx, GLint min_filter, GLint mag_filter,
+              const std::string &key, bool srgb)
+{
+    bool needs_mipmap = min_filter != GL_NEAREST && min_filter != GL_LINEAR;
+    bool native = ktx.compressed() && compressed_format_supported(ktx.internal_format());
+    unsigned int full_levels = 1;
+
+    while (std::max(ktx.width(), ktx.height()) >> full_levels)
+        full_levels++;
+
+    bool generate_mipmap = needs_mipmap && ktx.num_levels() < full_levels;
+    unsigned int levels = needs_mipmap && !generate_mipmap ? full_levels : 1;
+
+    /* Mipmaps can't be generated for compressed textures */
+    if (generate_mipmap)
+        native = false;
+
+    if (ktx.compressed() && !native) {
+        Log::debug("    Decoding texture format 0x%x on the CPU\n",
+                   ktx.internal_format());
+    }
+
+    glGenTextures(1, tex);
+    glBindTexture(GL_TEXTURE_2D, *tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (generate_mipmap && !GLExtensions::GenerateMipmap &&
+        Options::texture_mipmaps == Options::TextureMipmapsGL)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+    }
+
+    /* Small mipmap levels of RGB data are not 4-byte aligned */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    std::vector<unsigned char> decoded;
+
+    for (unsigned int i = 0; i < levels; i++) {
+        const KTXReader::Level &level = ktx.level(i);
+
+        if (native) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, ktx.internal_format(),
+                                   level.width, level.height, 0,
+                                   level.size, level.data);
+        }
+        else if (ktx.compressed()) {
+            decoded.resize(level.width * level.height * 4);
+            TextureDecoder::decode(ktx.internal_format(), level.data,
+                                   level.width, level.height, &decoded[0]);
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, level.width, level.height, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, &decoded[0]);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, i, ktx.internal_format(),
+                         level.width, level.height, 0,
+                         ktx.internal_format(), GL_UNSIGNED_BYTE, level.data);
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (generate_mipmap) {
+        const KTXReader::Level &base = ktx.level(0);
+        const unsigned char *pixels = ktx.compressed() ? &decoded[0] : base.data;
+        unsigned int bpp = ktx.compressed() || ktx.internal_format() == GL_RGBA ? 4 : 3;
+
+        if (!upload_cpu_mipmaps(key, pixels, base.width, base.height, bpp, srgb) &&
+            GLExtensions::GenerateMipmap)
+        {
+            GLExtensions::GenerateMipmap(GL_TEXTURE_2D);
+        }
+    }
+}
+
+/**
+ * Decodes a PNG or JPEG image into memory.
+ *
+ * This makes no GL calls, so it can run on a worker thread.
+ */
+static bool
+decode_image(const TextureDescriptor &desc, ImageData &image)
+{
+    const std::string &filename = desc.pathname();
+
+    if (desc.filetype() == TextureDescriptor::FileTypePNG) {
+        PNGReader reader(filename);
+        return image.load(reader);
+    }
+    else if (desc.filetype() == TextureDescriptor::FileTypeJPEG) {
+        if (Options::jpeg_decoder == Options::JPEGDecoderTurboJPEG) {
+            TurboJPEGReader reader(filename, Options::jpeg_max_size);
+            return image.load(reader);
+        }
+
+        JPEGReader reader(filename);
+        return image.load(reader);
+    }
+
+    return false;
+}
+
+/**
+ * Whether a texture holds data rather than colors, judging by its name.
+ *
+ * Normal and height maps are named "*-normal-map*", "*-height-map*" or
+ * "*-nm", optionally followed by a compressed format suffix.
+ */
+static bool
+is_data_map(const std::string &name)
+{
+    static const char *markers[] = {"-normal-map", "-height-map", "-nm"};
+
+    for (unsigned int i = 0; i < sizeof(markers) / sizeof(markers[0]); i++) {
+        std::string::size_type pos = name.find(markers[i]);
+        if (pos == std::string::npos)
+            continue;
+
+        std::string rest(name, pos + strlen(markers[i]));
+        if (rest.empty() || rest[0] == '-')
+            return true;
+    }
+
+    return false;
+}
+
 namespace TexturePrivate
 {
 TextureMap textureMap;
@@ -93,15 +464,41 @@ Texture::load(const std::string &textureName, GLuint *pTexture, ...)
     const std::string& filename = desc->pathname();
     ImageData image;
 
+    if (desc->filetype() == TextureDescriptor::FileTypeKTX) {
+        KTXReader reader(filename);
+        if (reader.error())
+            return false;
+
+        va_list ap;
+        va_start(ap, pTexture);
+        GLint arg;
+
+        while ((arg = va_arg(ap, GLint)) != 0) {
+            GLint arg2 = va_arg(ap, GLint);
+            setup_texture(pTexture, reader, arg, arg2, filename, desc->srgb());
+            pTexture++;
+        }
+
+        va_end(ap);
+
+        return true;
+    }
+
     if (desc->filetype() == TextureDescriptor::FileTypePNG) {
         PNGReader reader(filename);
-        if (!image.load(reader))
+        bool use_pbo = Options::texture_pbo && Texture::pbo_supported();
+        if (Options::texture_pbo && !use_pbo)
+            Log::debug("Pixel unpack buffers not supported, not using a PBO\n");
+        /* CPU mipmap generation needs the decoded pixels in memory */
+        if (use_pbo && Options::texture_mipmaps != Options::TextureMipmapsGL) {
+            Log::debug("CPU mipmap generation enabled, not using a PBO\n");
+            use_pbo = false;
+        }
+        if (!(use_pbo ? image.load_pbo(reader) : image.load(reader)))
             return false;
     }
-    else if (desc->filetype() == TextureDescriptor::FileTypeJPEG) {
-        JPEGReader reader(filename);
-        if (!image.load(reader))
-            return false;
+    else if (!decode_image(*desc, image)) {
+        return false;
     }
 
     va_list ap;
@@ -110,7 +507,7 @@ Texture::load(const std::string &textureName, GLuint *pTexture, ...)
 
     while ((arg = va_arg(ap, GLint)) != 0) {
         GLint arg2 = va_arg(ap, GLint);
-        setup_texture(pTexture, image, arg, arg2);
+        setup_texture(pTexture, image, arg, arg2, filename, desc->srgb());
         pTexture++;
     }
 
@@ -119,6 +516,108 @@ Texture::load(const std::string &textureName, GLuint *pTexture, ...)
     return true;
 }
 
+bool
+Texture::size(const std::string &textureName, unsigned int *width,
+              unsigned int *height)
+{
+    TextureMap::const_iterator textureIt = TexturePrivate::textureMap.find(textureName);
+    if (textureIt == TexturePrivate::textureMap.end())
+        return false;
+
+    const TextureDescriptor &desc = *textureIt->second;
+    const std::string &filename = desc.pathname();
+    std::unique_ptr<ImageReader> reader;
+
+    if (desc.filetype() == TextureDescriptor::FileTypeKTX) {
+        KTXReader ktx(filename);
+        if (ktx.error())
+            return false;
+        *width = ktx.width();
+        *height = ktx.height();
+        return true;
+    }
+    /* The image readers don't decode any pixels until rows are read */
+    else if (desc.filetype() == TextureDescriptor::FileTypePNG) {
+        reader.reset(new PNGReader(filename));
+    }
+    else if (desc.filetype() == TextureDescriptor::FileTypeJPEG) {
+        if (Options::jpeg_decoder == Options::JPEGDecoderTurboJPEG)
+            reader.reset(new TurboJPEGReader(filename, Options::jpeg_max_size));
+        else
+            reader.reset(new JPEGReader(filename));
+    }
+
+    if (!reader || reader->error())
+        return false;
+
+    *width = reader->width();
+    *height = reader->height();
+
+    return true;
+}
+
+bool
+Texture::load_all(const std::vector<std::string> &names, GLuint *textures,
+                  GLint min_filter, GLint mag_filter)
+{
+    std::vector<const TextureDescriptor *> descs;
+
+    for (unsigned int i = 0; i < names.size(); i++) {
+        TextureMap::const_iterator textureIt = TexturePrivate::textureMap.find(names[i]);
+        if (textureIt == TexturePrivate::textureMap.end())
+            return false;
+        descs.push_back(textureIt->second);
+    }
+
+    /* KTX files need no decoding, they are loaded one by one below */
+    std::unique_ptr<ImageData[]> images(new ImageData[names.size()]);
+    std::vector<char> decoded(names.size(), 0);
+    std::atomic<unsigned int> next(0);
+
+    auto worker = [&]() {
+        unsigned int i;
+        while ((i = next++) < descs.size()) {
+            if (descs[i]->filetype() != TextureDescriptor::FileTypeKTX)
+                decoded[i] = decode_image(*descs[i], images[i]);
+        }
+    };
+
+    unsigned int nthreads = std::min<unsigned int>(
+        std::max(std::thread::hardware_concurrency(), 1U), names.size());
+    std::vector<std::thread> threads;
+    uint64_t start = Util::get_timestamp_us();
+
+    for (unsigned int i = 1; i < nthreads; i++)
+        threads.push_back(std::thread(worker));
+
+    worker();
+
+    for (unsigned int i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    Log::debug("Decoded %u textures on %u threads in %.3f ms\n",
+               static_cast<unsigned int>(names.size()), nthreads,
+               (Util::get_timestamp_us() - start) / 1000.0);
+
+    /* The GL uploads happen on the calling thread, which owns the context */
+    bool ret = true;
+
+    for (unsigned int i = 0; i < descs.size(); i++) {
+        if (descs[i]->filetype() == TextureDescriptor::FileTypeKTX) {
+            ret = load(names[i], &textures[i], min_filter, mag_filter, 0) && ret;
+        }
+        else if (decoded[i]) {
+            setup_texture(&textures[i], images[i], min_filter, mag_filter,
+                          descs[i]->pathname(), descs[i]->srgb());
+        }
+        else {
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
 const TextureMap&
 Texture::find_textures()
 {
@@ -150,20 +649,19 @@ Texture::find_textures()
         // Find the position of the extension
         string::size_type pngExtPos = curPath.rfind(".png");
         string::size_type jpgExtPos = curPath.rfind(".jpg");
+        string::size_type ktxExtPos = curPath.rfind(".ktx");
         string::size_type extPos(string::npos);
 
         // Select the extension that's closer to the end of the file name
-        if (pngExtPos == string::npos)
-        {
-            extPos = jpgExtPos;
-        }
-        else if (jpgExtPos == string::npos)
-        {
-            extPos = pngExtPos;
-        }
-        else
+        // (".ktx2" files are matched by the ".ktx" prefix)
+        string::size_type extPositions[] = { pngExtPos, jpgExtPos, ktxExtPos };
+        for (unsigned int i = 0; i < sizeof(extPositions) / sizeof(*extPositions); i++)
         {
-            extPos = std::max(pngExtPos, jpgExtPos);
+            if (extPositions[i] != string::npos &&
+                (extPos == string::npos || extPositions[i] > extPos))
+            {
+                extPos = extPositions[i];
+            }
         }
 
         if (extPos == string::npos)
@@ -182,11 +680,50 @@ Texture::find_textures()
         {
             type = TextureDescriptor::FileTypeJPEG;
         }
+        else if (extPos == ktxExtPos)
+        {
+            type = TextureDescriptor::FileTypeKTX;
+        }
 
         string name(curPath, namePos, extPos - namePos);
-        TextureDescriptor* desc = new TextureDescriptor(name, curPath, type);
+        TextureDescriptor* desc = new TextureDescriptor(name, curPath, type,
+                                                        !is_data_map(name));
         TexturePrivate::textureMap.insert(std::make_pair(name, desc));
     }
 
     return TexturePrivate::textureMap;
 }
+
+std::string
+Texture::name_for_format(const std::string &name, const std::string &format)
+{
+    if (format.empty() || format == "uncompressed")
+        return name;
+
+    std::string variant(name + "-" + format);
+
+    if (TexturePrivate::textureMap.find(variant) == TexturePrivate::textureMap.end()) {
+        Log::info("No %s variant of texture %s, using the uncompressed texture\n",
+                  format.c_str(), name.c_str());
+        return name;
+    }
+
+    return variant;
+}
+
+bool
+Texture::is_format_variant(const std::string &name)
+{
+    static const char *formats[] = {"etc2", "astc"};
+
+    for (unsigned int i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        std::string suffix(std::string("-") + formats[i]);
+        if (name.size() > suffix.size() &&
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 /**
  * A descriptor for a texture file.
@@ -17,20 +18,28 @@ public:
         FileTypeUnknown,
         FileTypePNG,
         FileTypeJPEG,
+        FileTypeKTX,
     };
 
     TextureDescriptor(const std::string& name, const std::string& pathname,
-                      FileType filetype) :
+                      FileType filetype, bool srgb = true) :
         name_(name),
         pathname_(pathname),
-        filetype_(filetype) {}
+        filetype_(filetype),
+        srgb_(srgb) {}
     ~TextureDescriptor() {}
     const std::string& pathname() const { return pathname_; }
     FileType filetype() const { return filetype_; }
+    /**
+     * Whether the texture holds sRGB encoded colors, as opposed to data
+     * such as normals or heights that must be filtered as is.
+     */
+    bool srgb() const { return srgb_; }
 private:
     std::string name_;
     std::string pathname_;
     FileType filetype_;
+    bool srgb_;
     TextureDescriptor();
 };
 
@@ -50,6 +59,32 @@ public:
      * @return:      true if the operation succeeded, false otherwise
      */
     static bool load(const std::string &name, GLuint *pTexture, ...);
+    /**
+     * Load several textures with the same filters.
+     *
+     * The images are decoded concurrently on worker threads, and then
+     * uploaded in order on the calling thread.
+     *
+     * @names:       the texture names
+     * @textures:    the textures to create, one for each name
+     * @min_filter:  the minification filter
+     * @mag_filter:  the magnification filter
+     *
+     * @return:      true if all the textures were loaded, false otherwise
+     */
+    static bool load_all(const std::vector<std::string> &names, GLuint *textures,
+                         GLint min_filter, GLint mag_filter);
+    /**
+     * Get the size a texture is loaded with, without decoding it.
+     *
+     * @name:        the texture name
+     * @width:       the width of the texture
+     * @height:      the height of the texture
+     *
+     * @return:      true if the operation succeeded, false otherwise
+     */
+    static bool size(const std::string &name, unsigned int *width,
+                     unsigned int *height);
     /**
      * Locate all available textures.
      *
@@ -60,6 +95,38 @@ public:
      * @return:     a map containing information about the located textures
      */
     static const TextureMap& find_textures();
+    /**
+     * Get the name of the variant of a texture in a given format.
+     *
+     * Compressed variants of textures are stored as KTX files named after
+     * the uncompressed texture, with the format as a suffix, for example
+     * "crate-base-etc2.ktx" for "crate-base" in the "etc2" format. Textures
+     * without a variant in the format fall back to the uncompressed texture.
+     *
+     * You must initialize the available texture collection using
+     * Texture::find_textures() before using this method.
+     *
+     * @name:       the texture name
+     * @format:     the texture format ("uncompressed", "etc2" or "astc")
+     *
+     * @return:     the name of the texture variant
+     */
+    static std::string name_for_format(const std::string &name,
+                                       const std::string &format);
+    /**
+     * Whether a texture is the compressed variant of another one.
+     *
+     * @name:       the texture name
+     *
+     * @return:     true if the name has a compressed format suffix
+     */
+    static bool is_format_variant(const std::string &name);
+    /**
+     * Whether textures can be uploaded from pixel unpack buffers.
+     *
+     * @return:     true if pixel buffer objects are supported
+     */
+    static bool pbo_supported();
 };
 
 #endif
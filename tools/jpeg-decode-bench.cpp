@@ -0,0 +1,220 @@
+/*
+ * Measures the JPEG decoding paths used for textures: the scanline based
+ * libjpeg reader, the TurboJPEG reader at each DCT scaling factor, and
+ * concurrent decoding of all the images on worker threads (as done by
+ * Texture::load_all()).
+ *
+ * It is built by waf along with the common library, as
+ * build/src/jpeg-decode-bench, and is not installed.
+ *
+ * Usage:
+ *
+ *   jpeg-decode-bench [-n ITERATIONS] IMAGE...
+ *
+ * For example, for the terrain scene textures:
+ *
+ *   jpeg-decode-bench data/textures/terrain-*.jpg
+ */
+#include "image-reader.h"
+#include "log.h"
+#include "util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+/*
+ * Decodes an image with a reader, returning the number of decoded bytes,
+ * or 0 on failure.
+ */
+unsigned int
+decode(ImageReader &reader, std::vector<unsigned char> &pixels)
+{
+    if (reader.error())
+        return 0;
+
+    unsigned int size = reader.width() * reader.height() * reader.pixelBytes();
+    pixels.resize(size);
+
+    return reader.readImage(&pixels[0]) ? size : 0;
+}
+
+unsigned int
+decode_libjpeg(const std::string &filename, std::vector<unsigned char> &pixels)
+{
+    JPEGReader reader(filename);
+    return decode(reader, pixels);
+}
+
+unsigned int
+decode_turbojpeg(const std::string &filename, unsigned int max_size,
+                 std::vector<unsigned char> &pixels)
+{
+    TurboJPEGReader reader(filename, max_size);
+    return decode(reader, pixels);
+}
+
+/*
+ * Runs a decode function over all the files a number of times, and prints
+ * the median time per file.
+ */
+template <typename Func> bool
+run(const char *name, const std::vector<std::string> &filenames,
+    unsigned int iterations, Func func)
+{
+    std::vector<unsigned char> pixels;
+
+    for (unsigned int f = 0; f < filenames.size(); f++) {
+        std::vector<uint64_t> times;
+        unsigned int bytes = 0;
+
+        for (unsigned int i = 0; i < iterations; i++) {
+            uint64_t start = Util::get_timestamp_us();
+            bytes = func(filenames[f], pixels);
+            times.push_back(Util::get_timestamp_us() - start);
+
+            if (!bytes) {
+                fprintf(stderr, "Failed to decode %s\n", filenames[f].c_str());
+                return false;
+            }
+        }
+
+        std::sort(times.begin(), times.end());
+        double ms = times[times.size() / 2] / 1000.0;
+
+        printf("%-16s %-48s %9.3f ms %8.1f MB/s\n", name, filenames[f].c_str(),
+               ms, bytes / (ms * 1000.0));
+    }
+
+    return true;
+}
+
+/*
+ * Decodes all the files serially and then concurrently, one thread per CPU,
+ * and prints the median wall clock time of each.
+ */
+bool
+run_parallel(const std::vector<std::string> &filenames, unsigned int iterations)
+{
+    unsigned int nthreads = std::min<unsigned int>(
+        std::max(std::thread::hardware_concurrency(), 1U), filenames.size());
+    std::vector<std::vector<unsigned char> > pixels(filenames.size());
+    std::vector<uint64_t> serial_times;
+    std::vector<uint64_t> parallel_times;
+    std::atomic<bool> ok(true);
+
+    for (unsigned int i = 0; i < iterations; i++) {
+        uint64_t start = Util::get_timestamp_us();
+
+        for (unsigned int f = 0; f < filenames.size(); f++) {
+            if (!decode_turbojpeg(filenames[f], 0, pixels[f]))
+                ok = false;
+        }
+
+        serial_times.push_back(Util::get_timestamp_us() - start);
+
+        std::atomic<unsigned int> next(0);
+        auto worker = [&]() {
+            unsigned int f;
+            while ((f = next++) < filenames.size()) {
+                if (!decode_turbojpeg(filenames[f], 0, pixels[f]))
+                    ok = false;
+            }
+        };
+
+        start = Util::get_timestamp_us();
+
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < nthreads; t++)
+            threads.push_back(std::thread(worker));
+        worker();
+        for (unsigned int t = 0; t < threads.size(); t++)
+            threads[t].join();
+
+        parallel_times.push_back(Util::get_timestamp_us() - start);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Failed to decode the images\n");
+        return false;
+    }
+
+    std::sort(serial_times.begin(), serial_times.end());
+    std::sort(parallel_times.begin(), parallel_times.end());
+
+    printf("all images, serial:             %9.3f ms\n",
+           serial_times[serial_times.size() / 2] / 1000.0);
+    printf("all images, %2u threads:         %9.3f ms\n", nthreads,
+           parallel_times[parallel_times.size() / 2] / 1000.0);
+
+    return true;
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int iterations = 20;
+    int first = 1;
+
+    if (argc > 2 && !strcmp(argv[1], "-n")) {
+        iterations = std::max(atoi(argv[2]), 1);
+        first = 3;
+    }
+
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [-n ITERATIONS] IMAGE...\n", argv[0]);
+        return 1;
+    }
+
+    Log::init(argv[0], false);
+
+    std::vector<std::string> filenames(argv + first, argv + argc);
+    std::vector<unsigned char> reference;
+    std::vector<unsigned char> pixels;
+
+    std::map<std::string, unsigned int> full_sizes;
+
+    /* The two decoders must produce identical images at full size */
+    for (unsigned int f = 0; f < filenames.size(); f++) {
+        if (!decode_libjpeg(filenames[f], reference) ||
+            !decode_turbojpeg(filenames[f], 0, pixels) || reference != pixels)
+        {
+            fprintf(stderr, "Decoders disagree on %s\n", filenames[f].c_str());
+            return 1;
+        }
+
+        TurboJPEGReader reader(filenames[f]);
+        full_sizes[filenames[f]] = std::max(reader.width(), reader.height());
+    }
+
+    if (!run("libjpeg", filenames, iterations, decode_libjpeg))
+        return 1;
+
+    static const char *scale_names[] = { "turbojpeg", "turbojpeg 1/2",
+                                         "turbojpeg 1/4", "turbojpeg 1/8" };
+
+    for (unsigned int s = 0; s < 4; s++) {
+        bool ok = run(scale_names[s], filenames, iterations,
+                      [s, &full_sizes](const std::string &filename,
+                                       std::vector<unsigned char> &out) {
+                          /* Limit the size to the scaled size of the image */
+                          unsigned int max_size = s > 0 ? full_sizes[filename] >> s : 0;
+                          return decode_turbojpeg(filename, max_size, out);
+                      });
+        if (!ok)
+            return 1;
+    }
+
+    return run_parallel(filenames, iterations) ? 0 : 1;
+}
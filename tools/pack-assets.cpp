@@ -0,0 +1,129 @@
+/*
+ * Packs the data directory into an asset archive, which is mapped as a
+ * whole instead of opening each model, shader and texture file (see
+ * src/libmatrix/asset-archive.h).
+ *
+ * It is built by waf, as build/src/pack-assets, and is not installed.
+ *
+ * Usage:
+ *
+ *   pack-assets [-z] OUTPUT DIR
+ *
+ * With -z, files that compress well (models and shaders) are stored
+ * compressed. Only files in the subdirectories of DIR are packed, leaving
+ * out the build files at the top level.
+ *
+ * The waf build generates build/src/data.pak from the data directory with:
+ *
+ *   pack-assets -z build/src/data.pak data
+ *
+ * which gpuload reads in place of the individual files when run with
+ * --data-archive build/src/data.pak. The archive must not be written into
+ * the data directory, which is installed and shipped as the Android assets
+ * as is.
+ */
+#include "asset-archive.h"
+#include "log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+namespace
+{
+
+/*
+ * Adds all the files under a directory to the archive, with names relative
+ * to the archive root.
+ */
+bool
+add_directory(AssetArchiveWriter &writer, const std::string &path,
+              const std::string &name, bool compress, unsigned int &count)
+{
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        fprintf(stderr, "Couldn't open directory %s\n", path.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent *entry;
+
+    while (ok && (entry = readdir(dir)) != 0) {
+        /* Skip '.', '..' and hidden files */
+        if (entry->d_name[0] == '.')
+            continue;
+
+        std::string entry_path(path + "/" + entry->d_name);
+        std::string entry_name(name.empty() ? entry->d_name : name + "/" + entry->d_name);
+        struct stat st;
+
+        if (stat(entry_path.c_str(), &st) != 0) {
+            fprintf(stderr, "Couldn't stat %s\n", entry_path.c_str());
+            ok = false;
+        }
+        else if (S_ISDIR(st.st_mode)) {
+            ok = add_directory(writer, entry_path, entry_name, compress, count);
+        }
+        else if (S_ISREG(st.st_mode) && !name.empty()) {
+            std::ifstream ifs(entry_path.c_str(), std::ios::binary);
+            std::stringstream ss;
+
+            ss << ifs.rdbuf();
+            if (!ifs) {
+                fprintf(stderr, "Couldn't read %s\n", entry_path.c_str());
+                ok = false;
+            }
+
+            writer.add(entry_name, ss.str(), compress);
+            count++;
+        }
+    }
+
+    closedir(dir);
+
+    return ok;
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+    bool compress = false;
+    int first = 1;
+
+    if (argc > 1 && !strcmp(argv[1], "-z")) {
+        compress = true;
+        first = 2;
+    }
+
+    if (argc - first != 2) {
+        fprintf(stderr, "Usage: %s [-z] OUTPUT DIR\n", argv[0]);
+        return 1;
+    }
+
+    Log::init(argv[0], false);
+
+    std::string output(argv[first]);
+    std::string dir(argv[first + 1]);
+    AssetArchiveWriter writer;
+    unsigned int count = 0;
+
+    /* Files at the top level of DIR (e.g. the build files) are never packed */
+    if (!add_directory(writer, dir, "", compress, count))
+        return 1;
+
+    if (!writer.write(output)) {
+        fprintf(stderr, "Failed to write %s\n", output.c_str());
+        return 1;
+    }
+
+    printf("Packed %u files into %s\n", count, output.c_str());
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Packs a sequence of PNG images into a texture atlas blob, which scenes can
+ * load without decoding the individual images (see src/texture-atlas.h).
+ *
+ * It is built by waf along with the common library, as
+ * build/src/pack-texture-atlas, and is not installed.
+ *
+ * Usage:
+ *
+ *   pack-texture-atlas OUTPUT IMAGE...
+ *
+ * The jellyfish caustics atlas is generated with:
+ *
+ *   pack-texture-atlas data/textures/jellyfish-caustics.atlas \
+ *       data/textures/jellyfish-caustics-??.png
+ *
+ * and is checked in, so it must be regenerated when the images or the
+ * layout change.
+ */
+#include "texture-atlas.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s OUTPUT IMAGE...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> filenames(argv + 2, argv + argc);
+    TextureAtlas atlas;
+
+    if (!atlas.pack(filenames)) {
+        fprintf(stderr, "Failed to pack the images\n");
+        return 1;
+    }
+
+    if (!atlas.save(argv[1])) {
+        fprintf(stderr, "Failed to write %s\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}